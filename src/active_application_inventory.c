@@ -4,173 +4,754 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "fixed_pool.h"
+
 #define INITIAL_APPLICATION_CAPACITY 4
-#define INITIAL_STREAM_INDEX_CAPACITY 4
 
-static void clear_application(active_application_t *application) {
-    free(application->identity_value);
-    free(application->display_name);
-    free(application->stream_indexes);
-    *application = (active_application_t){0};
+/*
+ * Fixed-capacity arenas are sized for the largest relocation: twice the live
+ * data plus one more application, where at most CHATWHEEL_MAX_STREAMS
+ * applications hold spans of span_capacity() and two strings each. A
+ * relocation or rebuild holds the old and the new arena at once.
+ */
+#define FIXED_ARENA_BYTES \
+    (2 * (CHATWHEEL_MAX_STREAMS + 1) * sizeof(active_application_t) + \
+     (8 * CHATWHEEL_MAX_STREAMS + 2) * sizeof(uint32_t) + \
+     4 * (CHATWHEEL_MAX_STREAMS + 1) * (CHATWHEEL_MAX_PROPERTY_LENGTH + 1))
+FIXED_POOL_DEFINE(arena_pool,
+                  FIXED_ARENA_BYTES,
+                  2 * CHATWHEEL_FIXED_INSTANCES)
+
+/* Sizes of the three regions of an inventory arena. */
+typedef struct {
+    size_t applications;
+    size_t stream_indexes;
+    size_t string_bytes;
+} arena_size_t;
+
+/* Span reserved for stream_count indexes, with room for at least one more. */
+static size_t span_capacity(size_t stream_count) {
+    return stream_count + stream_count / 2 + 1;
 }
 
-static int ensure_application_capacity(
-    active_application_inventory_t *inventory) {
-    if (inventory->count < inventory->capacity) return 0;
+/*
+ * Replaces inventory with an empty one whose arena holds the given region
+ * sizes. The applications region comes first, so freeing applications
+ * releases the whole arena. Nothing is allocated when every size is zero.
+ */
+static int allocate_arena(active_application_inventory_t *inventory,
+                          arena_size_t size) {
+    active_application_inventory_init(inventory);
+    if (size.applications > SIZE_MAX / sizeof(*inventory->applications) ||
+        size.stream_indexes > SIZE_MAX / sizeof(*inventory->stream_indexes)) {
+        return -1;
+    }
+
+    size_t application_bytes =
+        size.applications * sizeof(*inventory->applications);
+    size_t index_bytes =
+        size.stream_indexes * sizeof(*inventory->stream_indexes);
+    if (index_bytes > SIZE_MAX - application_bytes ||
+        size.string_bytes > SIZE_MAX - application_bytes - index_bytes) {
+        return -1;
+    }
+    size_t total = application_bytes + index_bytes + size.string_bytes;
+    if (total == 0) return 0;
+
+    unsigned char *arena = POOL_MALLOC(arena_pool, total);
+    if (!arena) return -1;
+
+    /* Application records are a multiple of 8 bytes, keeping spans aligned. */
+    inventory->applications = (active_application_t *)arena;
+    inventory->capacity = size.applications;
+    inventory->stream_indexes = (uint32_t *)(arena + application_bytes);
+    inventory->stream_index_capacity = size.stream_indexes;
+    inventory->strings = (char *)(arena + application_bytes + index_bytes);
+    inventory->string_capacity = size.string_bytes;
+    return 0;
+}
+
+/* Claims capacity unused stream indexes. The caller must have reserved them. */
+static uint32_t *claim_span(active_application_inventory_t *inventory,
+                            size_t capacity) {
+    uint32_t *span = inventory->stream_indexes + inventory->stream_index_used;
+    inventory->stream_index_used += capacity;
+    return span;
+}
+
+/* Copies text into unused string bytes the caller has reserved. */
+static const char *copy_string(active_application_inventory_t *inventory,
+                               const char *text) {
+    size_t length = strlen(text) + 1;
+    char *copy = inventory->strings + inventory->string_used;
+    memcpy(copy, text, length);
+    inventory->string_used += length;
+    return copy;
+}
+
+static size_t arena_bytes(const active_application_inventory_t *inventory) {
+    return inventory->capacity * sizeof(*inventory->applications) +
+        inventory->stream_index_capacity * sizeof(*inventory->stream_indexes) +
+        inventory->string_capacity;
+}
+
+/*
+ * Installs replacement as inventory's arena, keeping the memory statistics
+ * that belong to the inventory rather than to one arena.
+ */
+static void replace_arena(active_application_inventory_t *inventory,
+                          active_application_inventory_t *replacement) {
+    memory_usage_t memory = inventory->memory;
+    POOL_FREE(arena_pool, inventory->applications);
+    *inventory = *replacement;
+    inventory->memory = memory;
+    memory_usage_set(&inventory->memory, arena_bytes(inventory));
+}
+
+static int grown_region_size(size_t live,
+                             size_t extra,
+                             size_t minimum,
+                             size_t *size) {
+    if (extra > SIZE_MAX - live || live + extra > SIZE_MAX / 2) return -1;
+    *size = (live + extra) * 2;
+    if (*size < minimum) *size = minimum;
+    return 0;
+}
+
+/*
+ * Moves every application into a new arena with room for extra on top of the
+ * live data, dropping spans and strings left behind by earlier updates. Each
+ * span is given span_capacity() of its stream count. On failure inventory is
+ * unchanged.
+ */
+static int relocate_arena(active_application_inventory_t *inventory,
+                          arena_size_t extra) {
+    arena_size_t live = {.applications = inventory->count};
+    for (size_t i = 0; i < inventory->count; i++) {
+        const active_application_t *application = &inventory->applications[i];
+        live.stream_indexes += span_capacity(application->stream_count);
+        live.string_bytes += strlen(application->identity_value) + 1 +
+            strlen(application->display_name) + 1;
+    }
 
-    size_t new_capacity = INITIAL_APPLICATION_CAPACITY;
-    if (inventory->capacity > 0) {
-        if (inventory->capacity > SIZE_MAX / 2) return -1;
-        new_capacity = inventory->capacity * 2;
+    arena_size_t size;
+    if (grown_region_size(live.applications,
+                          extra.applications,
+                          INITIAL_APPLICATION_CAPACITY,
+                          &size.applications) != 0 ||
+        grown_region_size(live.stream_indexes,
+                          extra.stream_indexes,
+                          0,
+                          &size.stream_indexes) != 0 ||
+        grown_region_size(live.string_bytes,
+                          extra.string_bytes,
+                          0,
+                          &size.string_bytes) != 0) {
+        return -1;
     }
-    if (new_capacity > SIZE_MAX / sizeof(*inventory->applications)) return -1;
 
-    active_application_t *resized = realloc(
-        inventory->applications,
-        new_capacity * sizeof(*inventory->applications));
-    if (!resized) return -1;
+    active_application_inventory_t replacement;
+    if (allocate_arena(&replacement, size) != 0) return -1;
 
-    inventory->applications = resized;
-    inventory->capacity = new_capacity;
+    for (size_t i = 0; i < inventory->count; i++) {
+        const active_application_t *application = &inventory->applications[i];
+        active_application_t *moved = &replacement.applications[i];
+        *moved = *application;
+        moved->identity_value = copy_string(
+            &replacement,
+            application->identity_value);
+        moved->display_name = copy_string(
+            &replacement,
+            application->display_name);
+        moved->stream_capacity = span_capacity(application->stream_count);
+        moved->stream_indexes = claim_span(
+            &replacement,
+            moved->stream_capacity);
+        memcpy(moved->stream_indexes,
+               application->stream_indexes,
+               application->stream_count * sizeof(*moved->stream_indexes));
+    }
+    replacement.count = inventory->count;
+
+    replace_arena(inventory, &replacement);
     return 0;
 }
 
-static int ensure_stream_capacity(active_application_t *application) {
-    if (application->stream_count < application->stream_capacity) return 0;
+/*
+ * Makes room for extra applications, stream indexes, and string bytes at the
+ * end of the arena, relocating it when any region is short. Relocation
+ * invalidates every pointer into the arena.
+ */
+static int reserve_arena(active_application_inventory_t *inventory,
+                         arena_size_t extra) {
+    if (extra.applications <= inventory->capacity - inventory->count &&
+        extra.stream_indexes <=
+            inventory->stream_index_capacity - inventory->stream_index_used &&
+        extra.string_bytes <=
+            inventory->string_capacity - inventory->string_used) {
+        return 0;
+    }
+    return relocate_arena(inventory, extra);
+}
 
-    size_t new_capacity = INITIAL_STREAM_INDEX_CAPACITY;
-    if (application->stream_capacity > 0) {
-        if (application->stream_capacity > SIZE_MAX / 2) return -1;
-        new_capacity = application->stream_capacity * 2;
+/*
+ * Ensures the application at position can take one more stream index and
+ * reserves string_bytes for the caller. A full span moves to the end of the
+ * arena with span_capacity() room.
+ */
+static int reserve_stream_slot(active_application_inventory_t *inventory,
+                               size_t position,
+                               size_t string_bytes) {
+    const active_application_t *application =
+        &inventory->applications[position];
+    size_t capacity = 0;
+    if (application->stream_count == application->stream_capacity) {
+        capacity = span_capacity(application->stream_count);
     }
-    if (new_capacity > SIZE_MAX / sizeof(*application->stream_indexes)) {
+    if (reserve_arena(inventory, (arena_size_t){
+            .stream_indexes = capacity,
+            .string_bytes = string_bytes,
+        }) != 0) {
         return -1;
     }
 
-    uint32_t *resized = realloc(
-        application->stream_indexes,
-        new_capacity * sizeof(*application->stream_indexes));
-    if (!resized) return -1;
+    /* Relocation leaves room in every span. */
+    active_application_t *growing = &inventory->applications[position];
+    if (growing->stream_count < growing->stream_capacity) return 0;
 
-    application->stream_indexes = resized;
-    application->stream_capacity = new_capacity;
+    uint32_t *span = claim_span(inventory, capacity);
+    memcpy(span,
+           growing->stream_indexes,
+           growing->stream_count * sizeof(*span));
+    growing->stream_indexes = span;
+    growing->stream_capacity = capacity;
     return 0;
 }
 
-static int add_stream_index(active_application_t *application,
-                            uint32_t stream_index) {
-    for (size_t i = 0; i < application->stream_count; i++) {
-        if (application->stream_indexes[i] == stream_index) return 0;
+typedef struct {
+    size_t application_position;
+    uint32_t stream_index;
+    int occupied;
+} stream_membership_t;
+
+/*
+ * An application found by a rebuild before its arena is sized. The strings
+ * are interned handles borrowed from the stream inventory.
+ */
+typedef struct {
+    application_identity_property_t identity_property;
+    const char *identity_value;
+    const char *display_name;
+    size_t stream_count;
+} pending_application_t;
+
+/*
+ * Transient lookup tables for one rebuild. applications maps an identity to
+ * the position of its pending application + 1, with 0 marking an empty slot.
+ * memberships records which stream indexes each application already holds.
+ * Both tables use linear probing with a power-of-two size at least twice the
+ * stream count, so they never fill. stream_applications holds the pending
+ * position each raw stream joins, or SIZE_MAX when it joins none.
+ */
+typedef struct {
+    pending_application_t *pending;
+    size_t pending_count;
+    size_t *stream_applications;
+    size_t *applications;
+    stream_membership_t *memberships;
+    size_t mask;
+} rebuild_index_t;
+
+/* Fixed-capacity rebuild tables, for up to CHATWHEEL_MAX_STREAMS streams. */
+FIXED_POOL_DEFINE(pending_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(pending_application_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(stream_application_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(size_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(application_table_pool,
+                  2 * CHATWHEEL_MAX_STREAMS * sizeof(size_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(membership_table_pool,
+                  2 * CHATWHEEL_MAX_STREAMS * sizeof(stream_membership_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+static size_t mix_hash(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return (size_t)value;
+}
+
+static int rebuild_index_init(rebuild_index_t *index, size_t stream_count) {
+    *index = (rebuild_index_t){0};
+    if (stream_count == 0) return 0;
+
+    size_t table_size = 1;
+    while (table_size < stream_count * 2) {
+        if (table_size > SIZE_MAX / 2) return -1;
+        table_size *= 2;
+    }
+    if (stream_count > SIZE_MAX / sizeof(*index->pending) ||
+        table_size > SIZE_MAX / sizeof(*index->memberships)) {
+        return -1;
     }
 
-    if (ensure_stream_capacity(application) != 0) return -1;
-    application->stream_indexes[application->stream_count] = stream_index;
-    application->stream_count++;
+    index->pending = POOL_MALLOC(
+        pending_pool,
+        stream_count * sizeof(*index->pending));
+    index->stream_applications = POOL_MALLOC(
+        stream_application_pool,
+        stream_count * sizeof(*index->stream_applications));
+    index->applications = POOL_CALLOC(
+        application_table_pool,
+        table_size,
+        sizeof(*index->applications));
+    index->memberships = POOL_CALLOC(
+        membership_table_pool,
+        table_size,
+        sizeof(*index->memberships));
+    index->mask = table_size - 1;
+    if (!index->pending ||
+        !index->stream_applications ||
+        !index->applications ||
+        !index->memberships) {
+        return -1;
+    }
     return 0;
 }
 
-static active_application_t *find_mutable_application(
-    active_application_inventory_t *inventory,
+static void rebuild_index_clear(rebuild_index_t *index) {
+    POOL_FREE(pending_pool, index->pending);
+    POOL_FREE(stream_application_pool, index->stream_applications);
+    POOL_FREE(application_table_pool, index->applications);
+    POOL_FREE(membership_table_pool, index->memberships);
+    *index = (rebuild_index_t){0};
+}
+
+/*
+ * Returns the slot of the pending application with an interned identity
+ * value, or the empty slot where it belongs. Identity values of one stream
+ * inventory are equal exactly when their handles are equal.
+ */
+static size_t find_application_slot(
+    const rebuild_index_t *index,
     application_identity_property_t identity_property,
     const char *identity_value) {
-    for (size_t i = 0; i < inventory->count; i++) {
-        active_application_t *application = &inventory->applications[i];
-        if (application->identity_property == identity_property &&
-            strcmp(application->identity_value, identity_value) == 0) {
-            return application;
+    size_t slot = mix_hash(
+        (uint64_t)(uintptr_t)identity_value ^
+        ((uint64_t)identity_property << 56)) & index->mask;
+    while (index->applications[slot] != 0) {
+        const pending_application_t *pending =
+            &index->pending[index->applications[slot] - 1];
+        if (pending->identity_property == identity_property &&
+            pending->identity_value == identity_value) {
+            break;
         }
+        slot = (slot + 1) & index->mask;
     }
-
-    return NULL;
+    return slot;
 }
 
-static int initialize_application(
-    active_application_t *application,
-    application_identity_resolution_t identity,
-    application_identity_resolution_t display_name) {
-    *application = (active_application_t){
-        .identity_property = identity.property,
-    };
-
-    application->identity_value = strdup(identity.value);
-    if (!application->identity_value) return -1;
-
-    application->display_name = strdup(display_name.value);
-    if (!application->display_name) {
-        clear_application(application);
-        return -1;
+/*
+ * Records that the application at application_position holds stream_index.
+ * Returns 0 when it was new and 1 when it was already recorded.
+ */
+static int record_membership(rebuild_index_t *index,
+                             size_t application_position,
+                             uint32_t stream_index) {
+    size_t slot = mix_hash(
+        ((uint64_t)application_position << 32) ^ stream_index) & index->mask;
+    while (index->memberships[slot].occupied) {
+        const stream_membership_t *membership = &index->memberships[slot];
+        if (membership->application_position == application_position &&
+            membership->stream_index == stream_index) {
+            return 1;
+        }
+        slot = (slot + 1) & index->mask;
     }
 
+    index->memberships[slot] = (stream_membership_t){
+        .application_position = application_position,
+        .stream_index = stream_index,
+        .occupied = 1,
+    };
     return 0;
 }
 
 void active_application_inventory_init(
     active_application_inventory_t *inventory) {
     if (!inventory) return;
-    inventory->applications = NULL;
-    inventory->count = 0;
-    inventory->capacity = 0;
+    *inventory = (active_application_inventory_t){0};
 }
 
 int active_application_inventory_rebuild(
     active_application_inventory_t *destination,
     const audio_stream_inventory_t *streams) {
     if (!destination || !streams) return -1;
-    if (streams->count > 0 && !streams->streams) return -1;
+    if (streams->count > 0 && (!streams->streams || !streams->properties)) {
+        return -1;
+    }
 
-    active_application_inventory_t replacement;
-    active_application_inventory_init(&replacement);
+    rebuild_index_t index;
+    if (rebuild_index_init(&index, streams->count) != 0) goto fail;
 
+    arena_size_t size = {0};
     for (size_t i = 0; i < streams->count; i++) {
-        const audio_stream_t *stream = &streams->streams[i];
+        const audio_stream_properties_t *properties = &streams->properties[i];
+        uint32_t stream_index = streams->streams[i].index;
+        index.stream_applications[i] = SIZE_MAX;
+
         application_identity_resolution_t identity =
-            application_identity_resolve(stream);
+            application_identity_resolve(properties);
         if (identity.property == APPLICATION_IDENTITY_PROPERTY_NONE) continue;
         if (!identity.value) goto fail;
 
+        size_t slot = find_application_slot(
+            &index,
+            identity.property,
+            identity.value);
+        if (index.applications[slot] != 0) {
+            size_t position = index.applications[slot] - 1;
+            if (record_membership(&index, position, stream_index)) continue;
+            index.pending[position].stream_count++;
+            index.stream_applications[i] = position;
+            continue;
+        }
+
         application_identity_resolution_t display_name =
-            application_display_name_resolve(stream);
+            application_display_name_resolve(properties);
         if (display_name.property == APPLICATION_IDENTITY_PROPERTY_NONE ||
             !display_name.value) {
             goto fail;
         }
 
-        active_application_t *application = find_mutable_application(
-            &replacement,
-            identity.property,
-            identity.value);
-        if (application) {
-            if (add_stream_index(application, stream->index) != 0) goto fail;
+        size_t position = index.pending_count;
+        index.pending[position] = (pending_application_t){
+            .identity_property = identity.property,
+            .identity_value = identity.value,
+            .display_name = display_name.value,
+            .stream_count = 1,
+        };
+        index.applications[slot] = position + 1;
+        record_membership(&index, position, stream_index);
+        index.stream_applications[i] = position;
+        index.pending_count++;
+        size.string_bytes += strlen(identity.value) + 1 +
+            strlen(display_name.value) + 1;
+    }
+
+    size.applications = index.pending_count;
+    for (size_t i = 0; i < index.pending_count; i++) {
+        size.stream_indexes += span_capacity(index.pending[i].stream_count);
+    }
+
+    active_application_inventory_t replacement;
+    if (allocate_arena(&replacement, size) != 0) goto fail;
+
+    for (size_t i = 0; i < index.pending_count; i++) {
+        const pending_application_t *pending = &index.pending[i];
+        size_t capacity = span_capacity(pending->stream_count);
+        replacement.applications[i] = (active_application_t){
+            .identity_property = pending->identity_property,
+            .identity_value = copy_string(
+                &replacement,
+                pending->identity_value),
+            .display_name = copy_string(&replacement, pending->display_name),
+            .stream_indexes = claim_span(&replacement, capacity),
+            .stream_capacity = capacity,
+        };
+    }
+    replacement.count = index.pending_count;
+
+    for (size_t i = 0; i < streams->count; i++) {
+        size_t position = index.stream_applications[i];
+        if (position == SIZE_MAX) continue;
+
+        active_application_t *application =
+            &replacement.applications[position];
+        application->stream_indexes[application->stream_count] =
+            streams->streams[i].index;
+        application->stream_count++;
+    }
+
+    rebuild_index_clear(&index);
+    replace_arena(destination, &replacement);
+    return 0;
+
+fail:
+    rebuild_index_clear(&index);
+    return -1;
+}
+
+/* Returns the raw inventory position of stream_index, or SIZE_MAX. */
+static size_t raw_stream_position(const audio_stream_inventory_t *streams,
+                                  uint32_t stream_index) {
+    const audio_stream_t *stream = audio_stream_inventory_find(
+        streams,
+        stream_index);
+    return stream ? (size_t)(stream - streams->streams) : SIZE_MAX;
+}
+
+static size_t first_stream_position(const active_application_t *application,
+                                    const audio_stream_inventory_t *streams) {
+    return raw_stream_position(streams, application->stream_indexes[0]);
+}
+
+/*
+ * Moves the application at position so applications stay ordered by the raw
+ * position of their first stream. All other applications must already be in
+ * that order.
+ */
+static void reposition_application(active_application_inventory_t *inventory,
+                                   const audio_stream_inventory_t *streams,
+                                   size_t position) {
+    active_application_t *applications = inventory->applications;
+    size_t key = first_stream_position(&applications[position], streams);
+    size_t target = position;
+
+    while (target > 0 &&
+           first_stream_position(&applications[target - 1], streams) > key) {
+        target--;
+    }
+    while (target + 1 < inventory->count &&
+           first_stream_position(&applications[target + 1], streams) < key) {
+        target++;
+    }
+    if (target == position) return;
+
+    active_application_t moving = applications[position];
+    if (target < position) {
+        memmove(&applications[target + 1],
+                &applications[target],
+                (position - target) * sizeof(*applications));
+    } else {
+        memmove(&applications[position],
+                &applications[position + 1],
+                (target - position) * sizeof(*applications));
+    }
+    applications[target] = moving;
+}
+
+/* The removed application's span and strings stay claimed in the arena. */
+static void remove_application_at(active_application_inventory_t *inventory,
+                                  size_t position) {
+    if (position + 1 < inventory->count) {
+        memmove(&inventory->applications[position],
+                &inventory->applications[position + 1],
+                (inventory->count - position - 1) *
+                    sizeof(*inventory->applications));
+    }
+    inventory->count--;
+}
+
+static int find_stream_owner(const active_application_inventory_t *inventory,
+                             uint32_t stream_index,
+                             size_t *application_position,
+                             size_t *stream_position) {
+    for (size_t i = 0; i < inventory->count; i++) {
+        const active_application_t *application = &inventory->applications[i];
+        for (size_t j = 0; j < application->stream_count; j++) {
+            if (application->stream_indexes[j] != stream_index) continue;
+
+            *application_position = i;
+            *stream_position = j;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int detach_stream(active_application_inventory_t *inventory,
+                         const audio_stream_inventory_t *streams,
+                         uint32_t stream_index) {
+    size_t position;
+    size_t stream_position;
+    if (!find_stream_owner(
+            inventory,
+            stream_index,
+            &position,
+            &stream_position)) {
+        return 0;
+    }
+
+    active_application_t *application = &inventory->applications[position];
+    if (application->stream_count == 1) {
+        remove_application_at(inventory, position);
+        return 0;
+    }
+
+    const char *display_name = NULL;
+    if (stream_position == 0) {
+        application_identity_resolution_t next_display_name =
+            application_display_name_resolve(
+                audio_stream_inventory_find_properties(
+                    streams,
+                    application->stream_indexes[1]));
+        if (next_display_name.property ==
+                APPLICATION_IDENTITY_PROPERTY_NONE ||
+            !next_display_name.value) {
+            return -1;
+        }
+        display_name = next_display_name.value;
+        if (reserve_arena(inventory, (arena_size_t){
+                .string_bytes = strlen(display_name) + 1,
+            }) != 0) {
+            return -1;
+        }
+        application = &inventory->applications[position];
+    }
+
+    memmove(&application->stream_indexes[stream_position],
+            &application->stream_indexes[stream_position + 1],
+            (application->stream_count - stream_position - 1) *
+                sizeof(*application->stream_indexes));
+    application->stream_count--;
+    application->classification =
+        (application_classification_cache_t){0};
+
+    if (display_name) {
+        application->display_name = copy_string(inventory, display_name);
+        reposition_application(inventory, streams, position);
+    }
+    return 0;
+}
+
+static int attach_stream(active_application_inventory_t *inventory,
+                         const audio_stream_inventory_t *streams,
+                         const audio_stream_t *stream) {
+    size_t raw_position = (size_t)(stream - streams->streams);
+    const audio_stream_properties_t *properties =
+        &streams->properties[raw_position];
+    application_identity_resolution_t identity =
+        application_identity_resolve(properties);
+    if (identity.property == APPLICATION_IDENTITY_PROPERTY_NONE) return 0;
+    if (!identity.value) return -1;
+
+    application_identity_resolution_t display_name =
+        application_display_name_resolve(properties);
+    if (display_name.property == APPLICATION_IDENTITY_PROPERTY_NONE ||
+        !display_name.value) {
+        return -1;
+    }
+
+    for (size_t position = 0; position < inventory->count; position++) {
+        active_application_t *application =
+            &inventory->applications[position];
+        if (application->identity_property != identity.property ||
+            strcmp(application->identity_value, identity.value) != 0) {
             continue;
         }
 
-        active_application_t new_application;
-        if (initialize_application(
-                &new_application,
-                identity,
-                display_name) != 0) {
-            goto fail;
+        size_t insert_at = application->stream_count;
+        while (insert_at > 0 &&
+               raw_stream_position(
+                   streams,
+                   application->stream_indexes[insert_at - 1]) >
+                   raw_position) {
+            insert_at--;
         }
-        if (add_stream_index(&new_application, stream->index) != 0) {
-            clear_application(&new_application);
-            goto fail;
+
+        size_t display_bytes =
+            insert_at == 0 ? strlen(display_name.value) + 1 : 0;
+        if (reserve_stream_slot(inventory, position, display_bytes) != 0) {
+            return -1;
         }
-        if (ensure_application_capacity(&replacement) != 0) {
-            clear_application(&new_application);
-            goto fail;
+        application = &inventory->applications[position];
+
+        memmove(&application->stream_indexes[insert_at + 1],
+                &application->stream_indexes[insert_at],
+                (application->stream_count - insert_at) *
+                    sizeof(*application->stream_indexes));
+        application->stream_indexes[insert_at] = stream->index;
+        application->stream_count++;
+        application->classification =
+            (application_classification_cache_t){0};
+
+        if (insert_at == 0) {
+            application->display_name = copy_string(
+                inventory,
+                display_name.value);
+            reposition_application(inventory, streams, position);
         }
+        return 0;
+    }
 
-        replacement.applications[replacement.count] = new_application;
-        replacement.count++;
+    size_t capacity = span_capacity(1);
+    if (reserve_arena(inventory, (arena_size_t){
+            .applications = 1,
+            .stream_indexes = capacity,
+            .string_bytes = strlen(identity.value) + 1 +
+                strlen(display_name.value) + 1,
+        }) != 0) {
+        return -1;
     }
 
-    active_application_inventory_clear(destination);
-    *destination = replacement;
+    active_application_t *new_application =
+        &inventory->applications[inventory->count];
+    *new_application = (active_application_t){
+        .identity_property = identity.property,
+        .identity_value = copy_string(inventory, identity.value),
+        .display_name = copy_string(inventory, display_name.value),
+        .stream_indexes = claim_span(inventory, capacity),
+        .stream_count = 1,
+        .stream_capacity = capacity,
+    };
+    new_application->stream_indexes[0] = stream->index;
+    inventory->count++;
+    reposition_application(inventory, streams, inventory->count - 1);
     return 0;
+}
 
-fail:
-    active_application_inventory_clear(&replacement);
-    return -1;
+int active_application_inventory_upsert_stream(
+    active_application_inventory_t *destination,
+    const audio_stream_inventory_t *streams,
+    uint32_t stream_index) {
+    if (!destination || !streams) return -1;
+
+    const audio_stream_t *stream = audio_stream_inventory_find(
+        streams,
+        stream_index);
+    if (!stream) return -1;
+
+    if (detach_stream(destination, streams, stream_index) != 0) return -1;
+    return attach_stream(destination, streams, stream);
+}
+
+/*
+ * Relocates the arena into one sized for the live data once either the
+ * applications or their stream index spans use at most a quarter of it.
+ */
+static void shrink_arena(active_application_inventory_t *inventory) {
+    size_t live_indexes = 0;
+    for (size_t i = 0; i < inventory->count; i++) {
+        live_indexes += span_capacity(inventory->applications[i].stream_count);
+    }
+
+    if (memory_usage_shrunk_capacity(
+            inventory->count,
+            inventory->capacity,
+            INITIAL_APPLICATION_CAPACITY) == inventory->capacity &&
+        inventory->stream_index_capacity / 4 <= live_indexes) {
+        return;
+    }
+    if (relocate_arena(inventory, (arena_size_t){0}) == 0) {
+        inventory->memory.shrink_count++;
+    }
+}
+
+int active_application_inventory_remove_stream(
+    active_application_inventory_t *destination,
+    const audio_stream_inventory_t *streams,
+    uint32_t stream_index) {
+    if (!destination || !streams) return -1;
+    if (detach_stream(destination, streams, stream_index) != 0) return -1;
+
+    shrink_arena(destination);
+    return 0;
 }
 
 const active_application_t *active_application_inventory_find(
@@ -206,9 +787,6 @@ void active_application_inventory_clear(
     active_application_inventory_t *inventory) {
     if (!inventory) return;
 
-    for (size_t i = 0; i < inventory->count; i++) {
-        clear_application(&inventory->applications[i]);
-    }
-    free(inventory->applications);
+    POOL_FREE(arena_pool, inventory->applications);
     active_application_inventory_init(inventory);
 }
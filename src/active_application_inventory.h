@@ -5,20 +5,62 @@
 #include <stdint.h>
 
 #include "application_identity.h"
+#include "memory_usage.h"
 
+/*
+ * Classification last computed for an application. configuration is NULL
+ * while nothing is cached; otherwise it identifies the configuration and
+ * generation the result was computed from and is never dereferenced. group
+ * holds an application_group_t.
+ */
+typedef struct {
+    const void *configuration;
+    unsigned int generation;
+    int group;
+    int matched_config_index;
+} application_classification_cache_t;
+
+/*
+ * identity_value, display_name, and stream_indexes point into the arena of
+ * the containing inventory. stream_indexes is a span of stream_capacity
+ * entries, of which the first stream_count are used. The inventory empties
+ * classification whenever it adds or removes one of the application's
+ * streams; application_classifier_classify_cached() fills it.
+ */
 typedef struct {
     application_identity_property_t identity_property;
-    char *identity_value;
-    char *display_name;
+    const char *identity_value;
+    const char *display_name;
     uint32_t *stream_indexes;
     size_t stream_count;
     size_t stream_capacity;
+    application_classification_cache_t classification;
 } active_application_t;
 
+/*
+ * All data of an inventory lives in one arena: capacity application records,
+ * then stream_index_capacity stream indexes holding every application's span
+ * back to back, then string_capacity bytes of strings. applications is the
+ * start of the arena. The first stream_index_used indexes and string_used
+ * bytes are claimed; spans and strings dropped by incremental updates stay
+ * claimed until a later update runs out of room and compacts the arena.
+ */
 typedef struct {
     active_application_t *applications;
     size_t count;
     size_t capacity;
+    uint32_t *stream_indexes;
+    size_t stream_index_used;
+    size_t stream_index_capacity;
+    char *strings;
+    size_t string_used;
+    size_t string_capacity;
+    /*
+     * The arena, carried across rebuilds. Removals compact it once the
+     * application region is at most a quarter full or the index region holds
+     * more than four times the live spans.
+     */
+    memory_usage_t memory;
 } active_application_inventory_t;
 
 /*
@@ -29,8 +71,10 @@ void active_application_inventory_init(
     active_application_inventory_t *inventory);
 
 /*
- * Rebuilds destination from the complete stream inventory. Applications own
- * their identity_value, display_name, and stream_indexes. Streams without a
+ * Rebuilds destination from the complete stream inventory. Identity values
+ * and display names are copied into a new arena sized for exactly the
+ * result, with spare room in each stream index span, so a rebuild allocates
+ * one arena plus a fixed number of transient tables. Streams without a
  * canonical identity are skipped. Returns 0 on success and -1 for invalid
  * arguments or an allocation failure.
  *
@@ -52,6 +96,38 @@ int active_application_inventory_rebuild(
     active_application_inventory_t *destination,
     const audio_stream_inventory_t *streams);
 
+/*
+ * Brings destination up to date after the stream with stream_index was added
+ * to or updated in streams, touching only the applications that stream
+ * leaves or joins. Removal uses active_application_inventory_remove_stream().
+ * Destination must equal a rebuild from streams as they were before this
+ * stream changed; the result then equals a rebuild from streams now,
+ * including application order, stream index order, and display names.
+ *
+ * Returns 0 on success and -1 for invalid arguments, an index that is not in
+ * streams, or an allocation failure. After failure destination remains safe
+ * to clear() or rebuild, but its contents may no longer match streams.
+ * Pointers previously borrowed from destination may be invalidated by any
+ * call.
+ */
+int active_application_inventory_upsert_stream(
+    active_application_inventory_t *destination,
+    const audio_stream_inventory_t *streams,
+    uint32_t stream_index);
+
+/*
+ * Removes stream_index from destination after it was removed from streams.
+ * An application left without streams is removed, and one that lost its first
+ * stream takes its display name and position from its next stream. Unknown
+ * indexes are ignored. A mostly empty arena is compacted afterwards, which
+ * invalidates pointers into it. Preconditions, return values, and failure
+ * behavior are the same as for active_application_inventory_upsert_stream().
+ */
+int active_application_inventory_remove_stream(
+    active_application_inventory_t *destination,
+    const audio_stream_inventory_t *streams,
+    uint32_t stream_index);
+
 /*
  * Returns a borrowed read-only application matching both the identity
  * property and exact identity value, or NULL when no match exists or the
@@ -73,7 +149,10 @@ const active_application_t *active_application_inventory_get(
     const active_application_inventory_t *inventory,
     size_t position);
 
-/* Frees all owned data. Repeated calls on an initialized inventory are safe. */
+/*
+ * Frees the arena with a single free(). Repeated calls on an initialized
+ * inventory are safe.
+ */
 void active_application_inventory_clear(
     active_application_inventory_t *inventory);
 
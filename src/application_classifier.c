@@ -9,24 +9,22 @@ static application_classification_t unassigned_classification(void) {
     };
 }
 
-static int stream_matches_pattern(const audio_stream_t *stream,
-                                  const char *pattern) {
-    if (stream->application_id &&
-        pattern_matches_text(pattern, stream->application_id)) {
-        return 1;
-    }
-    if (stream->application_name &&
-        pattern_matches_text(pattern, stream->application_name)) {
-        return 1;
-    }
-    if (stream->process_binary &&
-        pattern_matches_text(pattern, stream->process_binary)) {
-        return 1;
-    }
-    if (stream->node_name &&
-        pattern_matches_text(pattern, stream->node_name)) {
-        return 1;
+/*
+ * Tries every matched property of the table in order. Both sides are already
+ * lowercased, so matching compares plain bytes.
+ */
+static int stream_matches_pattern(const audio_stream_properties_t *stream,
+                                  const char *folded_pattern) {
+#define MATCH_PROPERTY(name, field, key, matched) \
+    if ((matched) && \
+        stream->folded_##field && \
+        pattern_matches_folded_text( \
+            folded_pattern, \
+            stream->folded_##field)) { \
+        return 1; \
     }
+    AUDIO_STREAM_PROPERTY_TABLE(MATCH_PROPERTY)
+#undef MATCH_PROPERTY
     return 0;
 }
 
@@ -41,7 +39,7 @@ application_classification_t application_classifier_classify(
         return result;
     }
     if (streams->count > streams->capacity ||
-        (streams->count > 0 && !streams->streams)) {
+        (streams->count > 0 && (!streams->streams || !streams->properties))) {
         return result;
     }
     if (application->stream_count > application->stream_capacity ||
@@ -58,12 +56,13 @@ application_classification_t application_classifier_classify(
         for (size_t stream_position = 0;
              stream_position < application->stream_count;
              stream_position++) {
-            const audio_stream_t *stream = audio_stream_inventory_find(
-                streams,
-                application->stream_indexes[stream_position]);
+            const audio_stream_properties_t *stream =
+                audio_stream_inventory_find_properties(
+                    streams,
+                    application->stream_indexes[stream_position]);
             if (!stream) continue;
 
-            if (stream_matches_pattern(stream, config_entry->name)) {
+            if (stream_matches_pattern(stream, config_entry->folded_name)) {
                 result.group = config_entry->is_chat != 0
                     ? APPLICATION_GROUP_CHAT
                     : APPLICATION_GROUP_GAME;
@@ -75,3 +74,34 @@ application_classification_t application_classifier_classify(
 
     return result;
 }
+
+application_classification_t application_classifier_classify_cached(
+    active_application_t *application,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration) {
+    if (!application || !streams || !configuration ||
+        configuration->count < 0 || configuration->count > MAX_APPS) {
+        return unassigned_classification();
+    }
+
+    application_classification_cache_t *cache = &application->classification;
+    if (cache->configuration == configuration &&
+        cache->generation == configuration->generation) {
+        return (application_classification_t){
+            .group = (application_group_t)cache->group,
+            .matched_config_index = cache->matched_config_index,
+        };
+    }
+
+    application_classification_t result = application_classifier_classify(
+        application,
+        streams,
+        configuration);
+    *cache = (application_classification_cache_t){
+        .configuration = configuration,
+        .generation = configuration->generation,
+        .group = result.group,
+        .matched_config_index = result.matched_config_index,
+    };
+    return result;
+}
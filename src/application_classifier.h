@@ -2,15 +2,10 @@
 #define APPLICATION_CLASSIFIER_H
 
 #include "active_application_inventory.h"
+#include "application_group.h"
 #include "audio_stream_inventory.h"
 #include "config.h"
 
-typedef enum {
-    APPLICATION_GROUP_UNASSIGNED,
-    APPLICATION_GROUP_GAME,
-    APPLICATION_GROUP_CHAT
-} application_group_t;
-
 typedef struct {
     application_group_t group;
     int matched_config_index;
@@ -26,7 +21,8 @@ typedef struct {
  * stream indexes in stored order. Missing raw stream indexes are skipped. The
  * first config entry matching application.id, application.name,
  * application.process.binary, or node.name wins. Matching is case-insensitive
- * and supports '*' and '?' through the shared pattern matcher.
+ * and supports '*' and '?'; it compares the lowercased copies kept in the
+ * stream properties with each entry's folded_name.
  *
  * NULL arguments, malformed inventory state, a negative configuration count,
  * a count greater than MAX_APPS, or no match return APPLICATION_GROUP_UNASSIGNED
@@ -37,4 +33,19 @@ application_classification_t application_classifier_classify(
     const audio_stream_inventory_t *streams,
     const config_t *configuration);
 
+/*
+ * Returns the same result as application_classifier_classify(), reusing the
+ * classification cached on application while it was computed from this
+ * configuration at its current generation. Otherwise the application is
+ * classified and the result is cached. streams must be the inventory the
+ * application was derived from, kept in step through the active application
+ * inventory functions, which drop the cache when the application's streams
+ * change. Invalid arguments return APPLICATION_GROUP_UNASSIGNED with
+ * matched_config_index -1 and leave the cache unchanged.
+ */
+application_classification_t application_classifier_classify_cached(
+    active_application_t *application,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration);
+
 #endif
@@ -0,0 +1,14 @@
+#include "application_group.h"
+
+const char *application_group_name(application_group_t group) {
+    switch (group) {
+        case APPLICATION_GROUP_UNASSIGNED:
+            return "Unassigned";
+        case APPLICATION_GROUP_GAME:
+            return "Game";
+        case APPLICATION_GROUP_CHAT:
+            return "Chat";
+        default:
+            return "Unknown";
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef APPLICATION_GROUP_H
+#define APPLICATION_GROUP_H
+
+typedef enum {
+    APPLICATION_GROUP_UNASSIGNED,
+    APPLICATION_GROUP_GAME,
+    APPLICATION_GROUP_CHAT
+} application_group_t;
+
+/*
+ * Returns the display name of group, or "Unknown" for a value outside the
+ * enumeration, such as one decoded from a damaged journal record. The result
+ * is a static string.
+ */
+const char *application_group_name(application_group_t group);
+
+#endif
@@ -15,7 +15,7 @@ static application_identity_resolution_t make_resolution(
 }
 
 application_identity_resolution_t application_identity_resolve(
-    const audio_stream_t *stream) {
+    const audio_stream_properties_t *stream) {
     if (!stream) {
         return make_resolution(APPLICATION_IDENTITY_PROPERTY_NONE, NULL);
     }
@@ -44,7 +44,7 @@ application_identity_resolution_t application_identity_resolve(
 }
 
 application_identity_resolution_t application_display_name_resolve(
-    const audio_stream_t *stream) {
+    const audio_stream_properties_t *stream) {
     if (!stream) {
         return make_resolution(APPLICATION_IDENTITY_PROPERTY_NONE, NULL);
     }
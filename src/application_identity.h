@@ -27,7 +27,7 @@ typedef struct {
  * returns PROPERTY_NONE with a NULL value.
  */
 application_identity_resolution_t application_identity_resolve(
-    const audio_stream_t *stream);
+    const audio_stream_properties_t *stream);
 
 /*
  * Selects a display name in this order: non-empty application.name, node.name,
@@ -36,6 +36,6 @@ application_identity_resolution_t application_identity_resolve(
  * APPLICATION_IDENTITY_PROPERTY_NONE with a NULL value.
  */
 application_identity_resolution_t application_display_name_resolve(
-    const audio_stream_t *stream);
+    const audio_stream_properties_t *stream);
 
 #endif
@@ -4,52 +4,114 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "fixed_pool.h"
+
 #define INITIAL_STREAM_CAPACITY 4
+#define INITIAL_SLOT_CAPACITY 8
+
+/*
+ * Fixed-capacity storage. The stream and property arrays grow in place up to
+ * CHATWHEEL_MAX_STREAMS, and the slot table needs a second block while it is
+ * rebuilt.
+ */
+FIXED_POOL_DEFINE(stream_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(audio_stream_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(property_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(audio_stream_properties_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(slot_pool,
+                  2 * CHATWHEEL_MAX_STREAMS * sizeof(size_t),
+                  2 * CHATWHEEL_FIXED_INSTANCES)
+
+const char *const audio_stream_property_keys[AUDIO_STREAM_PROPERTY_COUNT] = {
+#define PROPERTY_KEY(name, field, key, matched) key,
+    AUDIO_STREAM_PROPERTY_TABLE(PROPERTY_KEY)
+#undef PROPERTY_KEY
+};
+
+static void release_stream_properties(audio_stream_inventory_t *inventory,
+                                      audio_stream_properties_t *properties) {
+    string_pool_t *strings = &inventory->strings;
+#define RELEASE_PROPERTY(name, field, key, matched) \
+    string_pool_release(strings, properties->field); \
+    string_pool_release(strings, properties->folded_##field);
+    AUDIO_STREAM_PROPERTY_TABLE(RELEASE_PROPERTY)
+#undef RELEASE_PROPERTY
+    *properties = (audio_stream_properties_t){0};
+}
 
-static int duplicate_nullable_string(const char *source, char **copy) {
-    if (!source) {
-        *copy = NULL;
-        return 0;
+/*
+ * Interns every value and its folded form into properties, which must start
+ * zeroed so a failure part way releases only what was taken.
+ */
+static int intern_stream_properties(
+    audio_stream_inventory_t *inventory,
+    audio_stream_properties_t *properties,
+    const char *const values[AUDIO_STREAM_PROPERTY_COUNT]) {
+    if (!values) return 0;
+
+    string_pool_t *strings = &inventory->strings;
+#define INTERN_PROPERTY(name, field, key, matched) \
+    if (string_pool_intern( \
+            strings, \
+            values[AUDIO_STREAM_PROPERTY_##name], \
+            &properties->field) != 0 || \
+        string_pool_intern_folded( \
+            strings, \
+            values[AUDIO_STREAM_PROPERTY_##name], \
+            &properties->folded_##field) != 0) { \
+        release_stream_properties(inventory, properties); \
+        return -1; \
     }
+    AUDIO_STREAM_PROPERTY_TABLE(INTERN_PROPERTY)
+#undef INTERN_PROPERTY
 
-    *copy = strdup(source);
-    return *copy ? 0 : -1;
+    return 0;
 }
 
-static void free_stream_properties(audio_stream_t *stream) {
-    free(stream->application_id);
-    free(stream->application_name);
-    free(stream->process_binary);
-    free(stream->node_name);
-    stream->application_id = NULL;
-    stream->application_name = NULL;
-    stream->process_binary = NULL;
-    stream->node_name = NULL;
+static void update_memory(audio_stream_inventory_t *inventory) {
+    memory_usage_set(
+        &inventory->memory,
+        inventory->capacity *
+                (sizeof(*inventory->streams) +
+                 sizeof(*inventory->properties)) +
+            inventory->slot_capacity * sizeof(*inventory->slots));
 }
 
-static int copy_stream_properties(audio_stream_t *stream,
-                                  const char *application_id,
-                                  const char *application_name,
-                                  const char *process_binary,
-                                  const char *node_name) {
-    if (duplicate_nullable_string(application_id, &stream->application_id) != 0) {
-        goto fail;
-    }
-    if (duplicate_nullable_string(application_name, &stream->application_name) != 0) {
-        goto fail;
-    }
-    if (duplicate_nullable_string(process_binary, &stream->process_binary) != 0) {
-        goto fail;
-    }
-    if (duplicate_nullable_string(node_name, &stream->node_name) != 0) {
-        goto fail;
+/*
+ * Resizes the stream and property arrays to new_capacity, which must hold
+ * every stored stream.
+ */
+static int resize_arrays(void *container, size_t new_capacity) {
+    audio_stream_inventory_t *inventory = container;
+    if (new_capacity > SIZE_MAX / sizeof(*inventory->properties)) return -1;
+
+    audio_stream_t *resized = POOL_REALLOC(
+        stream_pool,
+        inventory->streams,
+        new_capacity * sizeof(*inventory->streams));
+    if (!resized) return -1;
+    inventory->streams = resized;
+
+    /*
+     * Either array may end up larger than capacity: streams when growing
+     * properties fails, and properties when shrinking it fails. Both are
+     * harmless.
+     */
+    audio_stream_properties_t *resized_properties = POOL_REALLOC(
+        property_pool,
+        inventory->properties,
+        new_capacity * sizeof(*inventory->properties));
+    if (resized_properties) {
+        inventory->properties = resized_properties;
+    } else if (new_capacity > inventory->capacity) {
+        return -1;
     }
 
+    inventory->capacity = new_capacity;
+    update_memory(inventory);
     return 0;
-
-fail:
-    free_stream_properties(stream);
-    return -1;
 }
 
 static int ensure_capacity(audio_stream_inventory_t *inventory) {
@@ -60,25 +122,147 @@ static int ensure_capacity(audio_stream_inventory_t *inventory) {
         if (inventory->capacity > SIZE_MAX / 2) return -1;
         new_capacity = inventory->capacity * 2;
     }
+    return resize_arrays(inventory, new_capacity);
+}
 
-    if (new_capacity > SIZE_MAX / sizeof(*inventory->streams)) return -1;
+static size_t home_slot(uint32_t index, size_t slot_capacity) {
+    /* Sink input indexes are sequential, so mix them before masking. */
+    index ^= index >> 16;
+    index *= 0x85ebca6bU;
+    index ^= index >> 13;
+    index *= 0xc2b2ae35U;
+    index ^= index >> 16;
+    return (size_t)index & (slot_capacity - 1);
+}
 
-    audio_stream_t *resized = realloc(
-        inventory->streams,
-        new_capacity * sizeof(*inventory->streams));
-    if (!resized) return -1;
+/*
+ * Returns the slot holding index, or the empty slot where it would be
+ * inserted. The slot table must be allocated.
+ */
+static size_t probe_slot(const audio_stream_inventory_t *inventory,
+                         uint32_t index) {
+    size_t mask = inventory->slot_capacity - 1;
+    size_t slot = home_slot(index, inventory->slot_capacity);
+    while (inventory->slots[slot] != 0 &&
+           inventory->streams[inventory->slots[slot] - 1].index != index) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
 
-    inventory->streams = resized;
-    inventory->capacity = new_capacity;
+static int find_position(const audio_stream_inventory_t *inventory,
+                         uint32_t index,
+                         size_t *position) {
+    if (inventory->slot_capacity == 0) return 0;
+
+    size_t slot = probe_slot(inventory, index);
+    if (inventory->slots[slot] == 0) return 0;
+
+    *position = inventory->slots[slot] - 1;
+    return 1;
+}
+
+/* Rebuilds the slot table with new_capacity slots. */
+static int resize_slots(void *container, size_t new_capacity) {
+    audio_stream_inventory_t *inventory = container;
+    size_t *slots = POOL_CALLOC(slot_pool, new_capacity, sizeof(*slots));
+    if (!slots) return -1;
+
+    POOL_FREE(slot_pool, inventory->slots);
+    inventory->slots = slots;
+    inventory->slot_capacity = new_capacity;
+    for (size_t position = 0; position < inventory->count; position++) {
+        size_t slot = probe_slot(
+            inventory,
+            inventory->streams[position].index);
+        inventory->slots[slot] = position + 1;
+    }
+    update_memory(inventory);
     return 0;
 }
 
+static int ensure_slot_capacity(audio_stream_inventory_t *inventory,
+                                size_t stream_count) {
+    if (stream_count > SIZE_MAX / 2) return -1;
+    if (stream_count * 2 <= inventory->slot_capacity) return 0;
+
+    size_t new_capacity = inventory->slot_capacity > 0
+        ? inventory->slot_capacity
+        : INITIAL_SLOT_CAPACITY;
+    while (new_capacity < stream_count * 2) {
+        if (new_capacity > SIZE_MAX / 2) return -1;
+        new_capacity *= 2;
+    }
+    return resize_slots(inventory, new_capacity);
+}
+
+/* Gives the stream arrays and the slot table memory back after removals. */
+static void shrink_storage(audio_stream_inventory_t *inventory) {
+    memory_usage_shrink(&inventory->memory,
+                        inventory,
+                        resize_arrays,
+                        inventory->count,
+                        inventory->capacity,
+                        INITIAL_STREAM_CAPACITY);
+    memory_usage_shrink(&inventory->memory,
+                        inventory,
+                        resize_slots,
+                        inventory->count * 2,
+                        inventory->slot_capacity,
+                        INITIAL_SLOT_CAPACITY);
+}
+
+/*
+ * Empties slot with backward-shift deletion, moving later entries of the
+ * probe run back so lookups never need tombstones. Stream positions must
+ * still be valid for every occupied slot.
+ */
+static void erase_slot(audio_stream_inventory_t *inventory, size_t slot) {
+    size_t mask = inventory->slot_capacity - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+
+    while (inventory->slots[next] != 0) {
+        size_t home = home_slot(
+            inventory->streams[inventory->slots[next] - 1].index,
+            inventory->slot_capacity);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            inventory->slots[hole] = inventory->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    inventory->slots[hole] = 0;
+}
+
+/*
+ * Updates the slot of a stream that moved from position + 1 to position.
+ * Slot values are matched instead of stream indexes, because streams have
+ * already moved while slots still hold the old positions.
+ */
+static void repoint_slot(audio_stream_inventory_t *inventory,
+                         uint32_t index,
+                         size_t position) {
+    size_t mask = inventory->slot_capacity - 1;
+    size_t slot = home_slot(index, inventory->slot_capacity);
+    while (inventory->slots[slot] != position + 2) {
+        slot = (slot + 1) & mask;
+    }
+    inventory->slots[slot] = position + 1;
+}
+
 void audio_stream_inventory_init(audio_stream_inventory_t *inventory) {
     if (!inventory) return;
 
     inventory->streams = NULL;
+    inventory->properties = NULL;
     inventory->count = 0;
     inventory->capacity = 0;
+    inventory->slots = NULL;
+    inventory->slot_capacity = 0;
+    string_pool_init(&inventory->strings);
+    memory_usage_init(&inventory->memory);
 }
 
 const audio_stream_t *audio_stream_inventory_find(
@@ -86,89 +270,189 @@ const audio_stream_t *audio_stream_inventory_find(
     uint32_t index) {
     if (!inventory) return NULL;
 
-    for (size_t i = 0; i < inventory->count; i++) {
-        if (inventory->streams[i].index == index) {
-            return &inventory->streams[i];
-        }
-    }
+    size_t position;
+    if (!find_position(inventory, index, &position)) return NULL;
+    return &inventory->streams[position];
+}
 
-    return NULL;
+const audio_stream_properties_t *audio_stream_inventory_find_properties(
+    const audio_stream_inventory_t *inventory,
+    uint32_t index) {
+    if (!inventory) return NULL;
+
+    size_t position;
+    if (!find_position(inventory, index, &position)) return NULL;
+    return &inventory->properties[position];
 }
 
-int audio_stream_inventory_upsert(audio_stream_inventory_t *inventory,
-                                  uint32_t index,
-                                  unsigned int channel_count,
-                                  const char *application_id,
-                                  const char *application_name,
-                                  const char *process_binary,
-                                  const char *node_name) {
+int audio_stream_inventory_upsert_values(
+    audio_stream_inventory_t *inventory,
+    uint32_t index,
+    unsigned int channel_count,
+    const char *const values[AUDIO_STREAM_PROPERTY_COUNT]) {
     if (!inventory || channel_count == 0) return -1;
 
     audio_stream_t replacement = {
         .index = index,
         .channel_count = channel_count,
     };
-    if (copy_stream_properties(
-            &replacement,
-            application_id,
-            application_name,
-            process_binary,
-            node_name) != 0) {
+    audio_stream_properties_t replacement_properties = {0};
+    if (intern_stream_properties(
+            inventory,
+            &replacement_properties,
+            values) != 0) {
         return -1;
     }
 
-    for (size_t i = 0; i < inventory->count; i++) {
-        audio_stream_t *stream = &inventory->streams[i];
-        if (stream->index != index) continue;
-
-        free_stream_properties(stream);
+    size_t position;
+    if (find_position(inventory, index, &position)) {
+        audio_stream_t *stream = &inventory->streams[position];
+        replacement.volume_known = stream->volume_known;
+        replacement.volume = stream->volume;
+        replacement.corked = stream->corked;
+        replacement.volume_deferred = stream->volume_deferred;
         *stream = replacement;
+        release_stream_properties(inventory, &inventory->properties[position]);
+        inventory->properties[position] = replacement_properties;
         return 0;
     }
 
-    if (ensure_capacity(inventory) != 0) {
-        free_stream_properties(&replacement);
+    if (ensure_capacity(inventory) != 0 ||
+        ensure_slot_capacity(inventory, inventory->count + 1) != 0) {
+        release_stream_properties(inventory, &replacement_properties);
         return -1;
     }
 
     inventory->streams[inventory->count] = replacement;
+    inventory->properties[inventory->count] = replacement_properties;
+    inventory->slots[probe_slot(inventory, index)] = inventory->count + 1;
     inventory->count++;
     return 0;
 }
 
+int audio_stream_inventory_upsert(audio_stream_inventory_t *inventory,
+                                  uint32_t index,
+                                  unsigned int channel_count,
+                                  const char *application_id,
+                                  const char *application_name,
+                                  const char *process_binary,
+                                  const char *node_name) {
+    const char *values[AUDIO_STREAM_PROPERTY_COUNT] = {NULL};
+    values[AUDIO_STREAM_PROPERTY_APPLICATION_ID] = application_id;
+    values[AUDIO_STREAM_PROPERTY_APPLICATION_NAME] = application_name;
+    values[AUDIO_STREAM_PROPERTY_PROCESS_BINARY] = process_binary;
+    values[AUDIO_STREAM_PROPERTY_NODE_NAME] = node_name;
+    return audio_stream_inventory_upsert_values(
+        inventory,
+        index,
+        channel_count,
+        values);
+}
+
+static audio_stream_t *find_mutable_stream(
+    audio_stream_inventory_t *inventory,
+    uint32_t index) {
+    size_t position;
+    if (!find_position(inventory, index, &position)) return NULL;
+    return &inventory->streams[position];
+}
+
+int audio_stream_inventory_set_volume(audio_stream_inventory_t *inventory,
+                                      uint32_t index,
+                                      int volume_known,
+                                      uint32_t volume) {
+    if (!inventory) return -1;
+
+    audio_stream_t *stream = find_mutable_stream(inventory, index);
+    if (!stream) return -1;
+
+    stream->volume_known = volume_known ? 1 : 0;
+    stream->volume = volume_known ? volume : 0;
+    return 0;
+}
+
+int audio_stream_inventory_set_corked(audio_stream_inventory_t *inventory,
+                                      uint32_t index,
+                                      int corked) {
+    if (!inventory) return -1;
+
+    audio_stream_t *stream = find_mutable_stream(inventory, index);
+    if (!stream) return -1;
+
+    stream->corked = corked ? 1 : 0;
+    if (stream->corked || !stream->volume_deferred) return 0;
+
+    stream->volume_deferred = 0;
+    return 1;
+}
+
+int audio_stream_inventory_set_fingerprint(
+    audio_stream_inventory_t *inventory,
+    uint32_t index,
+    uint64_t fingerprint) {
+    if (!inventory) return -1;
+
+    size_t position;
+    if (!find_position(inventory, index, &position)) return -1;
+
+    inventory->properties[position].property_fingerprint = fingerprint;
+    return 0;
+}
+
+int audio_stream_inventory_defer_volume(audio_stream_inventory_t *inventory,
+                                        uint32_t index) {
+    if (!inventory) return -1;
+
+    audio_stream_t *stream = find_mutable_stream(inventory, index);
+    if (!stream) return -1;
+
+    stream->volume_deferred = 1;
+    return 0;
+}
+
 int audio_stream_inventory_remove(audio_stream_inventory_t *inventory,
                                   uint32_t index) {
-    if (!inventory) return 0;
+    if (!inventory || inventory->slot_capacity == 0) return 0;
 
-    for (size_t i = 0; i < inventory->count; i++) {
-        audio_stream_t *stream = &inventory->streams[i];
-        if (stream->index != index) continue;
+    size_t slot = probe_slot(inventory, index);
+    if (inventory->slots[slot] == 0) return 0;
 
-        free_stream_properties(stream);
+    size_t position = inventory->slots[slot] - 1;
+    erase_slot(inventory, slot);
 
-        if (i + 1 < inventory->count) {
-            memmove(stream,
-                    stream + 1,
-                    (inventory->count - i - 1) * sizeof(*stream));
-        }
+    release_stream_properties(inventory, &inventory->properties[position]);
 
-        inventory->count--;
-        memset(&inventory->streams[inventory->count],
-               0,
-               sizeof(*inventory->streams));
-        return 1;
+    size_t following = inventory->count - position - 1;
+    if (following > 0) {
+        memmove(&inventory->streams[position],
+                &inventory->streams[position + 1],
+                following * sizeof(*inventory->streams));
+        memmove(&inventory->properties[position],
+                &inventory->properties[position + 1],
+                following * sizeof(*inventory->properties));
     }
 
-    return 0;
+    inventory->count--;
+    memset(&inventory->streams[inventory->count],
+           0,
+           sizeof(*inventory->streams));
+    memset(&inventory->properties[inventory->count],
+           0,
+           sizeof(*inventory->properties));
+
+    for (size_t moved = position; moved < inventory->count; moved++) {
+        repoint_slot(inventory, inventory->streams[moved].index, moved);
+    }
+    shrink_storage(inventory);
+    return 1;
 }
 
 void audio_stream_inventory_clear(audio_stream_inventory_t *inventory) {
     if (!inventory) return;
 
-    for (size_t i = 0; i < inventory->count; i++) {
-        free_stream_properties(&inventory->streams[i]);
-    }
-
-    free(inventory->streams);
+    POOL_FREE(stream_pool, inventory->streams);
+    POOL_FREE(property_pool, inventory->properties);
+    POOL_FREE(slot_pool, inventory->slots);
+    string_pool_clear(&inventory->strings);
     audio_stream_inventory_init(inventory);
 }
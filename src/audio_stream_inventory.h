@@ -4,20 +4,106 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "string_pool.h"
+
+/*
+ * Stream properties read from the server, defined once. Each entry is
+ * X(NAME, field, key, matched): NAME suffixes the AUDIO_STREAM_PROPERTY_
+ * constant, field names the audio_stream_properties_t member, key is the
+ * server property, and matched is nonzero when config patterns are tried
+ * against the value. Storage, interning, fingerprints, reading from the
+ * server, and the stream views are all generated from this table.
+ */
+#define AUDIO_STREAM_PROPERTY_TABLE(X) \
+    X(APPLICATION_ID, application_id, "application.id", 1) \
+    X(APPLICATION_NAME, application_name, "application.name", 1) \
+    X(PROCESS_BINARY, process_binary, "application.process.binary", 1) \
+    X(NODE_NAME, node_name, "node.name", 1)
+
+typedef enum {
+#define AUDIO_STREAM_PROPERTY_ENUM(name, field, key, matched) \
+    AUDIO_STREAM_PROPERTY_##name,
+    AUDIO_STREAM_PROPERTY_TABLE(AUDIO_STREAM_PROPERTY_ENUM)
+#undef AUDIO_STREAM_PROPERTY_ENUM
+    AUDIO_STREAM_PROPERTY_COUNT
+} audio_stream_property_t;
+
+/* Server property keys, indexed by audio_stream_property_t. */
+extern const char *const
+    audio_stream_property_keys[AUDIO_STREAM_PROPERTY_COUNT];
+
+/*
+ * State read for every stream whenever volumes are planned or checked. It is
+ * kept small so scans over many streams touch few cache lines; identity
+ * properties live in the parallel audio_stream_properties_t array.
+ */
 typedef struct {
     uint32_t index;
+    /*
+     * Volume the server last reported on every channel. It is meaningful only
+     * while volume_known is nonzero.
+     */
+    uint32_t volume;
     unsigned int channel_count;
-    /* All strings are owned by the containing inventory. */
-    char *application_id;
-    char *application_name;
-    char *process_binary;
-    char *node_name;
+    unsigned char volume_known;
+    /* Nonzero while the server reports the stream as corked (paused). */
+    unsigned char corked;
+    /* Nonzero when a volume write was held back until the stream uncorks. */
+    unsigned char volume_deferred;
 } audio_stream_t;
 
+/* Identity properties, read only when applications are derived or matched. */
 typedef struct {
+    /*
+     * One member per table entry: interned handles owned by the containing
+     * inventory's string pool. Equal non-NULL values of streams in one
+     * inventory share one pointer.
+     */
+#define AUDIO_STREAM_PROPERTY_FIELD(name, field, key, matched) \
+    const char *field;
+    AUDIO_STREAM_PROPERTY_TABLE(AUDIO_STREAM_PROPERTY_FIELD)
+#undef AUDIO_STREAM_PROPERTY_FIELD
+    /*
+     * The same properties with ASCII letters lowercased, for case-insensitive
+     * matching without folding on every comparison. A value that is already
+     * lowercase shares the handle above. Interned in the same pool.
+     */
+#define AUDIO_STREAM_PROPERTY_FOLDED_FIELD(name, field, key, matched) \
+    const char *folded_##field;
+    AUDIO_STREAM_PROPERTY_TABLE(AUDIO_STREAM_PROPERTY_FOLDED_FIELD)
+#undef AUDIO_STREAM_PROPERTY_FOLDED_FIELD
+    /*
+     * Caller-defined digest of the properties last stored, or 0 when none was
+     * recorded since they were stored.
+     */
+    uint64_t property_fingerprint;
+} audio_stream_properties_t;
+
+typedef struct {
+    /*
+     * Streams in insertion order; removal keeps the order of the others.
+     * properties[position] belongs to streams[position], and both arrays
+     * have capacity entries.
+     */
     audio_stream_t *streams;
+    audio_stream_properties_t *properties;
     size_t count;
     size_t capacity;
+    /*
+     * Open-addressing index from stream index to position in streams, using
+     * linear probing. Each slot holds position + 1, and 0 marks an empty
+     * slot. slot_capacity is zero or a power of two at least twice count.
+     */
+    size_t *slots;
+    size_t slot_capacity;
+    /* Property strings shared by all streams of this inventory. */
+    string_pool_t strings;
+    /*
+     * The stream, property, and slot arrays; strings are accounted in their
+     * pool. Removals shrink the arrays once they are at most a quarter full
+     * and the slot table once it is at most an eighth full.
+     */
+    memory_usage_t memory;
 } audio_stream_inventory_t;
 
 /*
@@ -28,19 +114,44 @@ void audio_stream_inventory_init(audio_stream_inventory_t *inventory);
 
 /*
  * Returns a borrowed stream owned by the inventory. The caller must not free
- * or modify the stream or its strings. Any upsert(), remove(), or clear() call
- * may invalidate the returned pointer.
+ * or modify the stream. Any upsert(), remove(), or clear() call may invalidate
+ * the returned pointer.
  */
 const audio_stream_t *audio_stream_inventory_find(
     const audio_stream_inventory_t *inventory,
     uint32_t index);
 
 /*
- * Copies channel_count and all non-NULL properties into the inventory.
+ * Returns the borrowed properties of index, or NULL when inventory is NULL or
+ * index is not stored. The same invalidation rules as for find() apply, and
+ * the caller must not free or modify the properties or their strings.
+ */
+const audio_stream_properties_t *audio_stream_inventory_find_properties(
+    const audio_stream_inventory_t *inventory,
+    uint32_t index);
+
+/*
+ * Stores channel_count and all non-NULL values in the inventory, together
+ * with their lowercased forms. values is indexed by audio_stream_property_t
+ * and may be NULL when no property is known. Property strings are interned,
+ * so values already held by another stream are shared instead of copied.
  * channel_count must be greater than zero; any server-specific upper bound is
  * validated by the caller. Returns 0 on success and -1 for invalid arguments
  * or allocation failure. On failure, an existing entry with the same index
- * remains unchanged.
+ * remains unchanged. Updating an existing entry keeps its recorded volume,
+ * cork state, and deferred write; a new entry starts uncorked with an unknown
+ * volume and nothing deferred. Every successful upsert resets the property
+ * fingerprint to 0.
+ */
+int audio_stream_inventory_upsert_values(
+    audio_stream_inventory_t *inventory,
+    uint32_t index,
+    unsigned int channel_count,
+    const char *const values[AUDIO_STREAM_PROPERTY_COUNT]);
+
+/*
+ * upsert_values() for the four identity properties, leaving any other
+ * property in the table unset.
  */
 int audio_stream_inventory_upsert(audio_stream_inventory_t *inventory,
                                   uint32_t index,
@@ -50,9 +161,47 @@ int audio_stream_inventory_upsert(audio_stream_inventory_t *inventory,
                                   const char *process_binary,
                                   const char *node_name);
 
+/*
+ * Records the volume last reported for index. volume_known is zero when the
+ * server reported differing channel volumes or none at all; volume is then
+ * ignored. Returns 0 on success and -1 when inventory is NULL or index is not
+ * stored.
+ */
+int audio_stream_inventory_set_volume(audio_stream_inventory_t *inventory,
+                                      uint32_t index,
+                                      int volume_known,
+                                      uint32_t volume);
+
+/*
+ * Records whether index is corked. Returns 1 when this uncorks a stream with a
+ * deferred volume write, which clears the deferral so the caller can submit
+ * the current target once. Returns 0 on other success and -1 when inventory
+ * is NULL or index is not stored.
+ */
+int audio_stream_inventory_set_corked(audio_stream_inventory_t *inventory,
+                                      uint32_t index,
+                                      int corked);
+
+/*
+ * Records the fingerprint of the properties just stored for index. Returns 0
+ * on success and -1 when inventory is NULL or index is not stored.
+ */
+int audio_stream_inventory_set_fingerprint(
+    audio_stream_inventory_t *inventory,
+    uint32_t index,
+    uint64_t fingerprint);
+
+/*
+ * Marks that a volume write for index was held back while it is corked.
+ * Returns 0 on success and -1 when inventory is NULL or index is not stored.
+ */
+int audio_stream_inventory_defer_volume(audio_stream_inventory_t *inventory,
+                                        uint32_t index);
+
 /*
  * Returns 1 when the index was found and removed. Returns 0 when the index was
- * not found or inventory is NULL.
+ * not found or inventory is NULL. Removal may shrink the inventory's storage,
+ * which invalidates every pointer returned by find().
  */
 int audio_stream_inventory_remove(audio_stream_inventory_t *inventory,
                                   uint32_t index);
@@ -21,8 +21,38 @@ static const char* get_config_path(void) {
     return path;
 }
 
+/*
+ * Applies a "stream_grace_ms=VALUE" line. Returns 1 when line is that setting,
+ * valid or not, and 0 when it is not a setting line.
+ */
+static int load_stream_grace_setting(const char *line) {
+    size_t key_length = strlen(CONFIG_STREAM_GRACE_KEY);
+    if (strncmp(line, CONFIG_STREAM_GRACE_KEY, key_length) != 0 ||
+        line[key_length] != '=') {
+        return 0;
+    }
+
+    const char *value = line + key_length + 1;
+    char *end;
+    errno = 0;
+    unsigned long milliseconds = strtoul(value, &end, 10);
+    while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') {
+        end++;
+    }
+    if (errno == 0 && end != value && *end == '\0' && value[0] != '-' &&
+        milliseconds <= CONFIG_STREAM_GRACE_MAX_MS) {
+        config.stream_grace_ms = (unsigned int)milliseconds;
+    } else {
+        fprintf(stderr, "Ignoring invalid %s setting\n",
+                CONFIG_STREAM_GRACE_KEY);
+    }
+    return 1;
+}
+
 int load_config(void) {
     config.count = 0;  // Reset config before loading
+    config.generation++;
+    config.stream_grace_ms = 0;
     const char* config_path = get_config_path();
     FILE *f = fopen(config_path, "r");
     
@@ -36,6 +66,7 @@ int load_config(void) {
     while (fgets(line, sizeof(line), f)) {
         char name[256];
         int is_chat;
+        if (load_stream_grace_setting(line)) continue;
         if (sscanf(line, "%255[^,],%d", name, &is_chat) == 2) {
             add_application(name, is_chat);
         }
@@ -52,6 +83,9 @@ void save_config(void) {
     FILE *f = fopen(config_path, "w");
     if (!f) return;
 
+    if (config.stream_grace_ms > 0) {
+        fprintf(f, "%s=%u\n", CONFIG_STREAM_GRACE_KEY, config.stream_grace_ms);
+    }
     for (int i = 0; i < config.count; i++) {
         fprintf(f, "%s,%d\n", config.apps[i].name, config.apps[i].is_chat);
     }
@@ -65,6 +99,7 @@ int add_application(const char* name, int is_chat) {
             // Update type if different
             if (config.apps[i].is_chat != is_chat) {
                 config.apps[i].is_chat = is_chat;
+                config.generation++;
                 printf("Updated %s to %s\n", name, is_chat ? "chat" : "game");
                 return 0;
             }
@@ -79,8 +114,12 @@ int add_application(const char* name, int is_chat) {
     
     strncpy(config.apps[config.count].name, name, 255);
     config.apps[config.count].name[255] = '\0';  // Ensure null termination
+    pattern_fold_case(config.apps[config.count].folded_name,
+                      config.apps[config.count].name,
+                      sizeof(config.apps[config.count].folded_name));
     config.apps[config.count].is_chat = is_chat;
     config.count++;
+    config.generation++;
     return 0;
 }
 
@@ -92,6 +131,7 @@ int remove_application(const char* name) {
             memmove(&config.apps[i], &config.apps[i+1],
                     (config.count - i - 1) * sizeof(app_config_t));
             config.count--;
+            config.generation++;
             return 0;
         }
     }
@@ -3,20 +3,41 @@
 
 #define MAX_APPS 32
 #define CONFIG_FILE "chatwheel.conf"
+/* Setting line for config_t.stream_grace_ms, written as KEY=VALUE. */
+#define CONFIG_STREAM_GRACE_KEY "stream_grace_ms"
+/*
+ * Longest accepted grace window. Pending streams are still routed when the
+ * wheel moves, but a longer window would leave them unrouted for too long.
+ */
+#define CONFIG_STREAM_GRACE_MAX_MS 5000U
 
 typedef struct {
     char name[256];
+    /* name with ASCII letters lowercased, matched against folded properties. */
+    char folded_name[256];
     int is_chat;  // 0 for game, 1 for chat
 } app_config_t;
 
 typedef struct {
     app_config_t apps[MAX_APPS];
     int count;
+    /*
+     * Incremented by every change to apps or count, so results derived from
+     * the configuration can tell whether they are still current. Code that
+     * edits a configuration directly must increment it as well.
+     */
+    unsigned int generation;
+    /*
+     * How long a new stream may live before it is read and routed, in
+     * milliseconds. 0 handles every new stream immediately.
+     */
+    unsigned int stream_grace_ms;
 } config_t;
 
 /*
  * Loads the user configuration. A missing file is a valid empty
  * configuration. Returns 0 on success and -1 on another file I/O error.
+ * Setting lines with an invalid value are ignored and keep the default.
  */
 int load_config(void);
 void save_config(void);
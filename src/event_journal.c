@@ -0,0 +1,334 @@
+#include "event_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "application_group.h"
+
+#define EVENT_JOURNAL_MAGIC "CWJRNL\0\0"
+#define EVENT_JOURNAL_VERSION 1U
+
+static int is_power_of_two(uint64_t value) {
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+static size_t mapping_size(uint64_t capacity) {
+    return sizeof(event_journal_header_t) +
+        (size_t)capacity * sizeof(event_journal_record_t);
+}
+
+static int header_matches(const event_journal_header_t *header,
+                          uint64_t capacity) {
+    return memcmp(header->magic, EVENT_JOURNAL_MAGIC,
+                  sizeof(header->magic)) == 0 &&
+        header->version == EVENT_JOURNAL_VERSION &&
+        header->record_size == sizeof(event_journal_record_t) &&
+        header->capacity == capacity;
+}
+
+/* Creates every missing directory above the last component of path. */
+static int create_parent_directories(const char *path) {
+    char directory[512];
+    size_t length = strlen(path);
+    if (length >= sizeof(directory)) return -1;
+    memcpy(directory, path, length + 1);
+
+    for (char *separator = strchr(directory + 1, '/');
+         separator;
+         separator = strchr(separator + 1, '/')) {
+        *separator = '\0';
+        if (mkdir(directory, 0700) != 0 && errno != EEXIST) return -1;
+        *separator = '/';
+    }
+    return 0;
+}
+
+void event_journal_init(event_journal_t *journal) {
+    if (!journal) return;
+
+    journal->fd = -1;
+    journal->header = NULL;
+    journal->records = NULL;
+    journal->mapping_size = 0;
+    journal->capacity = 0;
+    journal->clock_ms = 0;
+}
+
+int event_journal_default_path(char *path, size_t size) {
+    if (!path || size == 0) return -1;
+
+    const char *state_home = getenv("XDG_STATE_HOME");
+    const char *home = getenv("HOME");
+    int length;
+    if (state_home && state_home[0] == '/') {
+        length = snprintf(path, size, "%s/chatwheel/events.journal",
+                          state_home);
+    } else if (home && home[0] != '\0') {
+        length = snprintf(path, size,
+                          "%s/.local/state/chatwheel/events.journal", home);
+    } else {
+        return -1;
+    }
+    return length > 0 && (size_t)length < size ? 0 : -1;
+}
+
+int event_journal_open(event_journal_t *journal,
+                       const char *path,
+                       size_t capacity,
+                       uint64_t now_ms) {
+    if (!journal) return -1;
+    event_journal_init(journal);
+    if (!path || !is_power_of_two(capacity) ||
+        capacity > (SIZE_MAX - sizeof(event_journal_header_t)) /
+            sizeof(event_journal_record_t)) {
+        return -1;
+    }
+    if (create_parent_directories(path) != 0) return -1;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    /* A file of another size is truncated first, which zeroes its records. */
+    size_t size = mapping_size(capacity);
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        ((uint64_t)status.st_size != size &&
+         (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0))) {
+        close(fd);
+        return -1;
+    }
+
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    event_journal_header_t *header = mapping;
+    if (!header_matches(header, capacity)) {
+        memset(mapping, 0, size);
+        memcpy(header->magic, EVENT_JOURNAL_MAGIC, sizeof(header->magic));
+        header->version = EVENT_JOURNAL_VERSION;
+        header->record_size = sizeof(event_journal_record_t);
+        header->capacity = capacity;
+    }
+
+    journal->fd = fd;
+    journal->header = header;
+    journal->records = (event_journal_record_t *)(header + 1);
+    journal->mapping_size = size;
+    journal->capacity = capacity;
+    journal->clock_ms = now_ms;
+
+    time_t wall_clock = time(NULL);
+    event_journal_append(journal,
+                         EVENT_JOURNAL_OPENED,
+                         EVENT_JOURNAL_NO_STREAM,
+                         0,
+                         wall_clock > 0 ? (uint32_t)wall_clock : 0,
+                         0);
+    return 0;
+}
+
+void event_journal_set_clock(event_journal_t *journal, uint64_t now_ms) {
+    if (journal) journal->clock_ms = now_ms;
+}
+
+void event_journal_append(event_journal_t *journal,
+                          event_journal_record_type_t type,
+                          uint32_t stream_index,
+                          uint16_t detail,
+                          uint32_t first_value,
+                          uint32_t second_value) {
+    if (!journal || !journal->header) return;
+
+    uint64_t sequence = journal->header->next_sequence;
+    journal->records[sequence & (journal->capacity - 1)] =
+        (event_journal_record_t){
+            .sequence = sequence,
+            .time_ms = journal->clock_ms,
+            .type = (uint16_t)type,
+            .detail = detail,
+            .stream_index = stream_index,
+            .values = {first_value, second_value},
+        };
+    /* A decoder reading a running journal sees only complete records. */
+    atomic_thread_fence(memory_order_release);
+    journal->header->next_sequence = sequence + 1;
+}
+
+void event_journal_close(event_journal_t *journal) {
+    if (!journal) return;
+
+    if (journal->header) munmap(journal->header, journal->mapping_size);
+    if (journal->fd >= 0) close(journal->fd);
+    event_journal_init(journal);
+}
+
+static const char *info_source_name(uint16_t source) {
+    switch (source) {
+        case EVENT_JOURNAL_INFO_SNAPSHOT:
+            return "snapshot";
+        case EVENT_JOURNAL_INFO_NEW:
+            return "new";
+        case EVENT_JOURNAL_INFO_CHANGED:
+            return "changed";
+        case EVENT_JOURNAL_INFO_RESYNC:
+            return "resync";
+        default:
+            return "unknown";
+    }
+}
+
+static void print_volume(FILE *output,
+                         const char *name,
+                         const event_journal_record_t *record) {
+    fprintf(output, "%-16s stream %u, %s, volume %u on %u channels\n",
+            name,
+            record->stream_index,
+            application_group_name((application_group_t)record->detail),
+            record->values[0],
+            record->values[1]);
+}
+
+static void print_record(FILE *output, const event_journal_record_t *record) {
+    fprintf(output, "%10" PRIu64 " %12" PRIu64 " ms  ",
+            record->sequence,
+            record->time_ms);
+
+    switch (record->type) {
+        case EVENT_JOURNAL_OPENED: {
+            time_t wall_clock = (time_t)record->values[0];
+            struct tm local;
+            char text[64] = "unknown time";
+            if (localtime_r(&wall_clock, &local)) {
+                strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S %z", &local);
+            }
+            fprintf(output, "%-16s %s\n", "opened", text);
+            break;
+        }
+        case EVENT_JOURNAL_STREAM_NEW:
+            fprintf(output, "%-16s stream %u\n", "new",
+                    record->stream_index);
+            break;
+        case EVENT_JOURNAL_STREAM_CHANGED:
+            fprintf(output, "%-16s stream %u\n", "changed",
+                    record->stream_index);
+            break;
+        case EVENT_JOURNAL_STREAM_REMOVED:
+            fprintf(output, "%-16s stream %u\n", "removed",
+                    record->stream_index);
+            break;
+        case EVENT_JOURNAL_STREAM_INFO:
+            fprintf(output, "%-16s stream %u, %s, volume %u, result %d\n",
+                    "info",
+                    record->stream_index,
+                    info_source_name(record->detail),
+                    record->values[0],
+                    (int32_t)record->values[1]);
+            break;
+        case EVENT_JOURNAL_REBUILD:
+            fprintf(output, "%-16s %s, %u applications from %u streams\n",
+                    "rebuild",
+                    record->detail ? "succeeded" : "failed",
+                    record->values[0],
+                    record->values[1]);
+            break;
+        case EVENT_JOURNAL_PLAN:
+            if (record->stream_index == EVENT_JOURNAL_NO_STREAM) {
+                fprintf(output, "%-16s all applications, %u assignments\n",
+                        "plan", record->values[0]);
+            } else {
+                fprintf(output, "%-16s stream %u, %u assignments\n",
+                        "plan", record->stream_index, record->values[0]);
+            }
+            break;
+        case EVENT_JOURNAL_VOLUME_SUBMITTED:
+            print_volume(output, "volume submitted", record);
+            break;
+        case EVENT_JOURNAL_VOLUME_DEFERRED:
+            print_volume(output, "volume deferred", record);
+            break;
+        case EVENT_JOURNAL_VOLUME_FAILED:
+            print_volume(output, "volume failed", record);
+            break;
+        default:
+            fprintf(output, "%-16s type %u, stream %u, detail %u, "
+                    "values %u %u\n",
+                    "unknown",
+                    record->type,
+                    record->stream_index,
+                    record->detail,
+                    record->values[0],
+                    record->values[1]);
+            break;
+    }
+}
+
+int event_journal_decode(const char *path, FILE *output) {
+    if (!path || !output) return -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    event_journal_header_t header;
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        !is_power_of_two(header.capacity) ||
+        header.capacity > (SIZE_MAX - sizeof(header)) /
+            sizeof(event_journal_record_t) ||
+        !header_matches(&header, header.capacity) ||
+        (uint64_t)status.st_size != mapping_size(header.capacity)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = mapping_size(header.capacity);
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return -1;
+
+    const event_journal_header_t *live = mapping;
+    const event_journal_record_t *records =
+        (const event_journal_record_t *)(live + 1);
+    uint64_t end = live->next_sequence;
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t start = end > header.capacity ? end - header.capacity : 0;
+    uint64_t skipped = 0;
+    for (uint64_t sequence = start; sequence < end; sequence++) {
+        event_journal_record_t record =
+            records[sequence & (header.capacity - 1)];
+        /*
+         * A running writer may have wrapped around onto the slot while it
+         * was copied, which leaves a record of mixed sequences.
+         */
+        atomic_thread_fence(memory_order_acquire);
+        if (record.sequence != sequence ||
+            live->next_sequence - sequence > header.capacity) {
+            skipped++;
+            continue;
+        }
+        print_record(output, &record);
+    }
+    fprintf(output, "%" PRIu64 " records, %" PRIu64 " skipped\n",
+            end - start - skipped,
+            skipped);
+
+    munmap(mapping, size);
+    return 0;
+}
@@ -0,0 +1,143 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Records kept by the daemon's journal, 2 MiB of records. */
+#define EVENT_JOURNAL_DEFAULT_CAPACITY 65536U
+/* stream_index of records that are not about one stream. */
+#define EVENT_JOURNAL_NO_STREAM UINT32_MAX
+
+typedef enum {
+    /*
+     * The journal was opened; values[0] holds the wall clock in seconds since
+     * the epoch, which dates the monotonic times of the records after it.
+     */
+    EVENT_JOURNAL_OPENED = 1,
+    /* Subscription events for stream_index. */
+    EVENT_JOURNAL_STREAM_NEW,
+    EVENT_JOURNAL_STREAM_CHANGED,
+    EVENT_JOURNAL_STREAM_REMOVED,
+    /*
+     * Server information for stream_index was recorded. detail is an
+     * event_journal_info_source_t, values[0] the highest channel volume, and
+     * values[1] the lifecycle record result as a signed integer.
+     */
+    EVENT_JOURNAL_STREAM_INFO,
+    /*
+     * The application inventory was rebuilt. detail is nonzero on success,
+     * values[0] the application count, and values[1] the stream count.
+     */
+    EVENT_JOURNAL_REBUILD,
+    /*
+     * A volume plan was built for stream_index, or for every application with
+     * EVENT_JOURNAL_NO_STREAM. values[0] is its assignment count.
+     */
+    EVENT_JOURNAL_PLAN,
+    /*
+     * One assignment of the last plan. detail is the application group,
+     * values[0] the volume, and values[1] the channel count.
+     */
+    EVENT_JOURNAL_VOLUME_SUBMITTED,
+    EVENT_JOURNAL_VOLUME_DEFERRED,
+    EVENT_JOURNAL_VOLUME_FAILED
+} event_journal_record_type_t;
+
+typedef enum {
+    EVENT_JOURNAL_INFO_SNAPSHOT,
+    EVENT_JOURNAL_INFO_NEW,
+    EVENT_JOURNAL_INFO_CHANGED,
+    /* Read by the list request that replaced a burst of events. */
+    EVENT_JOURNAL_INFO_RESYNC
+} event_journal_info_source_t;
+
+/*
+ * One fixed-size record. sequence numbers every record ever appended to a
+ * journal file, so a decoder can tell live records from overwritten ones.
+ * time_ms is the monotonic clock last passed to set_clock().
+ */
+typedef struct {
+    uint64_t sequence;
+    uint64_t time_ms;
+    uint16_t type;
+    uint16_t detail;
+    uint32_t stream_index;
+    uint32_t values[2];
+} event_journal_record_t;
+
+/* Start of a journal file; capacity records follow it. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    /* Sequence of the next record, which is stored at sequence % capacity. */
+    uint64_t next_sequence;
+    uint64_t reserved[4];
+} event_journal_header_t;
+
+/*
+ * Append-only ring of records in a memory-mapped file. Appending is a store
+ * into the shared mapping, with no system call or formatting, and the kernel
+ * writes the pages back, so the records survive a crash of the daemon. Once
+ * the ring is full each record replaces the oldest one. One process writes a
+ * journal file at a time; open() takes an exclusive lock on it.
+ */
+typedef struct {
+    int fd;
+    event_journal_header_t *header;
+    event_journal_record_t *records;
+    size_t mapping_size;
+    uint64_t capacity;
+    uint64_t clock_ms;
+} event_journal_t;
+
+/* Initializes a closed journal, on which append() does nothing. */
+void event_journal_init(event_journal_t *journal);
+
+/*
+ * Writes the default journal path, $XDG_STATE_HOME/chatwheel/events.journal
+ * or ~/.local/state/chatwheel/events.journal, to path. Returns 0 on success
+ * and -1 when no home directory is known or the path does not fit.
+ */
+int event_journal_default_path(char *path, size_t size);
+
+/*
+ * Opens the journal file at path, creating it and its parent directories
+ * when missing, and appends an EVENT_JOURNAL_OPENED record at now_ms. A file
+ * written with the same capacity keeps its records and continues their
+ * sequence; any other file is reset. capacity must be a power of two.
+ * Returns 0 on success and -1 for invalid arguments, an I/O error, or a file
+ * locked by another writer, which leaves journal closed.
+ */
+int event_journal_open(event_journal_t *journal,
+                       const char *path,
+                       size_t capacity,
+                       uint64_t now_ms);
+
+/* Sets the time stamped on the following records. */
+void event_journal_set_clock(event_journal_t *journal, uint64_t now_ms);
+
+/* Appends one record. Does nothing when journal is NULL or closed. */
+void event_journal_append(event_journal_t *journal,
+                          event_journal_record_type_t type,
+                          uint32_t stream_index,
+                          uint16_t detail,
+                          uint32_t first_value,
+                          uint32_t second_value);
+
+/* Unmaps and unlocks the journal and closes it. */
+void event_journal_close(event_journal_t *journal);
+
+/*
+ * Writes every live record of the journal file at path to output, oldest
+ * first, one line each. The file may be open by a running daemon. Records
+ * that are being overwritten are skipped and counted in the summary line.
+ * Returns 0 on success and -1 when the file cannot be read or is not a
+ * journal.
+ */
+int event_journal_decode(const char *path, FILE *output);
+
+#endif
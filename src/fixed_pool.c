@@ -0,0 +1,55 @@
+#include "fixed_pool.h"
+
+#include <string.h>
+
+void *fixed_pool_allocate(fixed_pool_t *pool, size_t size) {
+    if (!pool) return NULL;
+    if (size > pool->block_size) {
+        pool->refused_count++;
+        return NULL;
+    }
+
+    void *block = pool->free_list;
+    if (block) {
+        memcpy(&pool->free_list, block, sizeof(pool->free_list));
+    } else if (pool->next_unused < pool->block_count) {
+        block = pool->storage + pool->next_unused * pool->block_size;
+        pool->next_unused++;
+    } else {
+        pool->refused_count++;
+        return NULL;
+    }
+
+    pool->used_count++;
+    return block;
+}
+
+void *fixed_pool_allocate_zeroed(fixed_pool_t *pool,
+                                 size_t count,
+                                 size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        if (pool) pool->refused_count++;
+        return NULL;
+    }
+
+    void *block = fixed_pool_allocate(pool, count * size);
+    if (block) memset(block, 0, count * size);
+    return block;
+}
+
+void *fixed_pool_reallocate(fixed_pool_t *pool, void *block, size_t size) {
+    if (!block) return fixed_pool_allocate(pool, size);
+    if (!pool || size > pool->block_size) {
+        if (pool) pool->refused_count++;
+        return NULL;
+    }
+    return block;
+}
+
+void fixed_pool_release(fixed_pool_t *pool, void *block) {
+    if (!pool || !block) return;
+
+    memcpy(block, &pool->free_list, sizeof(pool->free_list));
+    pool->free_list = block;
+    pool->used_count--;
+}
@@ -0,0 +1,115 @@
+#ifndef FIXED_POOL_H
+#define FIXED_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Capacities of a build with -DCHATWHEEL_FIXED_CAPACITY, in which the
+ * inventories, request tracking, and volume plans take their storage from
+ * static pools instead of the heap. Each can be overridden with -D.
+ *
+ * CHATWHEEL_MAX_STREAMS bounds streams, applications, plan assignments, and
+ * streams pending in the grace window. CHATWHEEL_MAX_PROPERTY_LENGTH bounds
+ * each stream property; a stream with a longer one is not tracked.
+ * CHATWHEEL_MAX_PENDING_REQUESTS bounds stream information requests in
+ * flight. CHATWHEEL_FIXED_INSTANCES is how many of each container may be
+ * initialized at once; the daemon needs one.
+ *
+ * Stream and request counts must be powers of two, so that the containers'
+ * doubling growth ends exactly at them.
+ */
+#ifdef CHATWHEEL_FIXED_CAPACITY
+#ifndef CHATWHEEL_MAX_STREAMS
+#define CHATWHEEL_MAX_STREAMS 64
+#endif
+#ifndef CHATWHEEL_MAX_PROPERTY_LENGTH
+#define CHATWHEEL_MAX_PROPERTY_LENGTH 255
+#endif
+#ifndef CHATWHEEL_MAX_PENDING_REQUESTS
+#define CHATWHEEL_MAX_PENDING_REQUESTS 32
+#endif
+#ifndef CHATWHEEL_FIXED_INSTANCES
+#define CHATWHEEL_FIXED_INSTANCES 1
+#endif
+
+_Static_assert(CHATWHEEL_MAX_STREAMS >= 16 &&
+                   (CHATWHEEL_MAX_STREAMS & (CHATWHEEL_MAX_STREAMS - 1)) == 0,
+               "CHATWHEEL_MAX_STREAMS must be a power of two of at least 16");
+_Static_assert(CHATWHEEL_MAX_PENDING_REQUESTS >= 4 &&
+                   (CHATWHEEL_MAX_PENDING_REQUESTS &
+                    (CHATWHEEL_MAX_PENDING_REQUESTS - 1)) == 0,
+               "CHATWHEEL_MAX_PENDING_REQUESTS must be a power of two of "
+               "at least 4");
+_Static_assert(CHATWHEEL_FIXED_INSTANCES >= 1,
+               "CHATWHEEL_FIXED_INSTANCES must be at least 1");
+#endif
+
+/*
+ * Equally sized blocks in static storage. Blocks are handed out from the
+ * front once and then recycled through a free list linked through their
+ * first bytes, so allocation and release are constant time and never touch
+ * the heap. A request larger than the block size, or one made while every
+ * block is in use, fails like an exhausted heap.
+ */
+typedef struct {
+    unsigned char *storage;
+    size_t block_size;
+    size_t block_count;
+    /* Blocks at or after this position were never handed out. */
+    size_t next_unused;
+    void *free_list;
+    size_t used_count;
+    /* Requests refused because they were too large or the pool was full. */
+    uint64_t refused_count;
+} fixed_pool_t;
+
+/* Returns a block of at least size bytes, or NULL. */
+void *fixed_pool_allocate(fixed_pool_t *pool, size_t size);
+
+/* Like fixed_pool_allocate() for count elements of size, zeroed. */
+void *fixed_pool_allocate_zeroed(fixed_pool_t *pool,
+                                 size_t count,
+                                 size_t size);
+
+/*
+ * Resizes block in place, which always succeeds for sizes up to the block
+ * size, or allocates a block when block is NULL. Returns NULL and keeps
+ * block on failure, as realloc() does.
+ */
+void *fixed_pool_reallocate(fixed_pool_t *pool, void *block, size_t size);
+
+/* Returns block to pool. NULL is ignored. */
+void fixed_pool_release(fixed_pool_t *pool, void *block);
+
+/*
+ * Container allocations name the pool they come from in fixed-capacity
+ * builds. Other builds use the heap and ignore the name.
+ */
+#ifdef CHATWHEEL_FIXED_CAPACITY
+#define FIXED_POOL_BLOCK_WORDS(size) \
+    (((size) + sizeof(max_align_t) - 1) / sizeof(max_align_t))
+#define FIXED_POOL_DEFINE(name, size, count)                              \
+    static max_align_t name##_storage[FIXED_POOL_BLOCK_WORDS(size) *     \
+                                      (count)];                           \
+    static fixed_pool_t name = {                                          \
+        .storage = (unsigned char *)name##_storage,                       \
+        .block_size = FIXED_POOL_BLOCK_WORDS(size) * sizeof(max_align_t), \
+        .block_count = (count),                                           \
+    };
+#define POOL_MALLOC(name, size) fixed_pool_allocate(&(name), (size))
+#define POOL_CALLOC(name, count, size) \
+    fixed_pool_allocate_zeroed(&(name), (count), (size))
+#define POOL_REALLOC(name, block, size) \
+    fixed_pool_reallocate(&(name), (block), (size))
+#define POOL_FREE(name, block) fixed_pool_release(&(name), (block))
+#else
+#define FIXED_POOL_DEFINE(name, size, count)
+#define POOL_MALLOC(name, size) malloc(size)
+#define POOL_CALLOC(name, count, size) calloc((count), (size))
+#define POOL_REALLOC(name, block, size) realloc((block), (size))
+#define POOL_FREE(name, block) free(block)
+#endif
+
+#endif
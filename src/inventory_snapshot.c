@@ -0,0 +1,259 @@
+#include "inventory_snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Sizes of the regions that follow the header in one snapshot allocation, in
+ * the order they are laid out.
+ */
+typedef struct {
+    size_t stream_offset;
+    size_t application_offset;
+    size_t stream_index_offset;
+    size_t string_offset;
+    size_t total;
+} snapshot_layout_t;
+
+static int add_size(size_t *total, size_t size) {
+    if (size > SIZE_MAX - *total) return -1;
+    *total += size;
+    return 0;
+}
+
+static int add_array(size_t *total,
+                     size_t *offset,
+                     size_t count,
+                     size_t element_size,
+                     size_t alignment) {
+    size_t padding = (alignment - *total % alignment) % alignment;
+    if (add_size(total, padding) != 0) return -1;
+    if (count > SIZE_MAX / element_size) return -1;
+
+    *offset = *total;
+    return add_size(total, count * element_size);
+}
+
+static int add_string(size_t *total, const char *text) {
+    return text ? add_size(total, strlen(text) + 1) : 0;
+}
+
+static int measure_snapshot(const audio_stream_inventory_t *streams,
+                            const active_application_inventory_t *applications,
+                            snapshot_layout_t *layout) {
+    size_t total = sizeof(inventory_snapshot_t);
+    size_t application_count = applications ? applications->count : 0;
+    size_t stream_index_count = 0;
+    for (size_t i = 0; i < application_count; i++) {
+        if (add_size(&stream_index_count,
+                     applications->applications[i].stream_count) != 0) {
+            return -1;
+        }
+    }
+
+    if (add_array(&total,
+                  &layout->stream_offset,
+                  streams->count,
+                  sizeof(inventory_snapshot_stream_t),
+                  _Alignof(inventory_snapshot_stream_t)) != 0 ||
+        add_array(&total,
+                  &layout->application_offset,
+                  application_count,
+                  sizeof(inventory_snapshot_application_t),
+                  _Alignof(inventory_snapshot_application_t)) != 0 ||
+        add_array(&total,
+                  &layout->stream_index_offset,
+                  stream_index_count,
+                  sizeof(uint32_t),
+                  _Alignof(uint32_t)) != 0) {
+        return -1;
+    }
+
+    layout->string_offset = total;
+    for (size_t i = 0; i < streams->count; i++) {
+        const audio_stream_properties_t *properties = &streams->properties[i];
+#define MEASURE_PROPERTY(name, field, key, matched) \
+        if (add_string(&total, properties->field) != 0) return -1;
+        AUDIO_STREAM_PROPERTY_TABLE(MEASURE_PROPERTY)
+#undef MEASURE_PROPERTY
+    }
+    for (size_t i = 0; i < application_count; i++) {
+        const active_application_t *application =
+            &applications->applications[i];
+        if (add_string(&total, application->identity_value) != 0 ||
+            add_string(&total, application->display_name) != 0) {
+            return -1;
+        }
+    }
+
+    layout->total = total;
+    return 0;
+}
+
+static const char *copy_string(char **cursor, const char *text) {
+    if (!text) return NULL;
+
+    size_t size = strlen(text) + 1;
+    char *copy = *cursor;
+    memcpy(copy, text, size);
+    *cursor += size;
+    return copy;
+}
+
+static inventory_snapshot_t *build_snapshot(
+    const audio_stream_inventory_t *streams,
+    active_application_inventory_t *applications,
+    const config_t *configuration) {
+    snapshot_layout_t layout;
+    if (measure_snapshot(streams, applications, &layout) != 0) return NULL;
+
+    unsigned char *block = malloc(layout.total);
+    if (!block) return NULL;
+
+    inventory_snapshot_t *snapshot = (inventory_snapshot_t *)block;
+    inventory_snapshot_stream_t *stream_copies =
+        (inventory_snapshot_stream_t *)(block + layout.stream_offset);
+    inventory_snapshot_application_t *application_copies =
+        (inventory_snapshot_application_t *)(block +
+                                             layout.application_offset);
+    uint32_t *stream_indexes =
+        (uint32_t *)(block + layout.stream_index_offset);
+    char *cursor = (char *)(block + layout.string_offset);
+
+    for (size_t i = 0; i < streams->count; i++) {
+        const audio_stream_t *stream = &streams->streams[i];
+        const audio_stream_properties_t *properties = &streams->properties[i];
+        inventory_snapshot_stream_t *copy = &stream_copies[i];
+        copy->index = stream->index;
+        copy->volume = stream->volume;
+        copy->channel_count = stream->channel_count;
+        copy->volume_known = stream->volume_known;
+        copy->corked = stream->corked;
+#define COPY_PROPERTY(name, field, key, matched) \
+        copy->field = copy_string(&cursor, properties->field);
+        AUDIO_STREAM_PROPERTY_TABLE(COPY_PROPERTY)
+#undef COPY_PROPERTY
+    }
+
+    size_t application_count = applications ? applications->count : 0;
+    for (size_t i = 0; i < application_count; i++) {
+        active_application_t *application = &applications->applications[i];
+        application_classification_t classification =
+            application_classifier_classify_cached(
+                application,
+                streams,
+                configuration);
+        inventory_snapshot_application_t *copy = &application_copies[i];
+        copy->identity_property = application->identity_property;
+        copy->identity_value = copy_string(
+            &cursor,
+            application->identity_value);
+        copy->display_name = copy_string(&cursor, application->display_name);
+        copy->stream_indexes = stream_indexes;
+        copy->stream_count = application->stream_count;
+        copy->group = classification.group;
+        copy->matched_config_index = classification.matched_config_index;
+        if (application->stream_count > 0) {
+            memcpy(stream_indexes,
+                   application->stream_indexes,
+                   application->stream_count * sizeof(*stream_indexes));
+            stream_indexes += application->stream_count;
+        }
+    }
+
+    atomic_init(&snapshot->references, 1);
+    snapshot->sequence = 0;
+    snapshot->streams = stream_copies;
+    snapshot->stream_count = streams->count;
+    snapshot->applications = application_copies;
+    snapshot->application_count = application_count;
+    snapshot->applications_available = applications != NULL;
+    snapshot->retired_next = NULL;
+    return snapshot;
+}
+
+static void release_retired(inventory_snapshot_publisher_t *publisher) {
+    inventory_snapshot_t *snapshot = publisher->retired;
+    publisher->retired = NULL;
+    while (snapshot) {
+        inventory_snapshot_t *next = snapshot->retired_next;
+        inventory_snapshot_release(snapshot);
+        snapshot = next;
+    }
+}
+
+void inventory_snapshot_publisher_init(
+    inventory_snapshot_publisher_t *publisher) {
+    if (!publisher) return;
+
+    atomic_init(&publisher->current, NULL);
+    atomic_init(&publisher->readers, 0);
+    publisher->retired = NULL;
+    publisher->sequence = 0;
+}
+
+int inventory_snapshot_publish(inventory_snapshot_publisher_t *publisher,
+                               const audio_stream_inventory_t *streams,
+                               active_application_inventory_t *applications,
+                               const config_t *configuration) {
+    if (!publisher || !streams || !configuration) return -1;
+
+    inventory_snapshot_t *snapshot = build_snapshot(
+        streams,
+        applications,
+        configuration);
+    if (!snapshot) return -1;
+    snapshot->sequence = ++publisher->sequence;
+
+    inventory_snapshot_t *previous = atomic_exchange(
+        &publisher->current,
+        snapshot);
+    if (previous) {
+        previous->retired_next = publisher->retired;
+        publisher->retired = previous;
+    }
+
+    /*
+     * A reader that enters acquire() after this load sees the exchange above,
+     * so it can only load the new snapshot. With no reader inside, nothing
+     * retired can still be picked up, and the publisher's references go.
+     */
+    if (atomic_load(&publisher->readers) == 0) release_retired(publisher);
+    return 0;
+}
+
+inventory_snapshot_t *inventory_snapshot_acquire(
+    inventory_snapshot_publisher_t *publisher) {
+    if (!publisher) return NULL;
+
+    atomic_fetch_add(&publisher->readers, 1);
+    inventory_snapshot_t *snapshot = atomic_load(&publisher->current);
+    if (snapshot) {
+        atomic_fetch_add_explicit(
+            &snapshot->references,
+            1,
+            memory_order_relaxed);
+    }
+    atomic_fetch_sub(&publisher->readers, 1);
+    return snapshot;
+}
+
+void inventory_snapshot_release(inventory_snapshot_t *snapshot) {
+    if (!snapshot) return;
+
+    if (atomic_fetch_sub_explicit(
+            &snapshot->references,
+            1,
+            memory_order_acq_rel) == 1) {
+        free(snapshot);
+    }
+}
+
+void inventory_snapshot_publisher_clear(
+    inventory_snapshot_publisher_t *publisher) {
+    if (!publisher) return;
+
+    inventory_snapshot_release(atomic_load(&publisher->current));
+    release_retired(publisher);
+    inventory_snapshot_publisher_init(publisher);
+}
@@ -0,0 +1,117 @@
+#ifndef INVENTORY_SNAPSHOT_H
+#define INVENTORY_SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "active_application_inventory.h"
+#include "application_classifier.h"
+#include "audio_stream_inventory.h"
+#include "config.h"
+
+/* One stream as it was when the snapshot was built. */
+typedef struct {
+    uint32_t index;
+    uint32_t volume;
+    unsigned int channel_count;
+    unsigned char volume_known;
+    unsigned char corked;
+#define INVENTORY_SNAPSHOT_STREAM_FIELD(name, field, key, matched) \
+    const char *field;
+    AUDIO_STREAM_PROPERTY_TABLE(INVENTORY_SNAPSHOT_STREAM_FIELD)
+#undef INVENTORY_SNAPSHOT_STREAM_FIELD
+} inventory_snapshot_stream_t;
+
+/* One active application with the classification current at build time. */
+typedef struct {
+    application_identity_property_t identity_property;
+    const char *identity_value;
+    const char *display_name;
+    const uint32_t *stream_indexes;
+    size_t stream_count;
+    application_group_t group;
+    int matched_config_index;
+} inventory_snapshot_application_t;
+
+/*
+ * Immutable copy of the stream and application inventories. Everything,
+ * including strings, lives in the same allocation as this header, so a
+ * snapshot stays valid on any thread until its last reference is released,
+ * however the live inventories change meanwhile. sequence increases with
+ * every snapshot published by one publisher. applications_available is zero
+ * when the application inventory could not be derived; application_count is
+ * then zero as well.
+ */
+typedef struct inventory_snapshot {
+    atomic_uint references;
+    uint64_t sequence;
+    const inventory_snapshot_stream_t *streams;
+    size_t stream_count;
+    const inventory_snapshot_application_t *applications;
+    size_t application_count;
+    int applications_available;
+    /* Publisher-owned link in the list of replaced snapshots. */
+    struct inventory_snapshot *retired_next;
+} inventory_snapshot_t;
+
+/*
+ * Single-writer, many-reader publication point. Readers on any thread take
+ * the current snapshot with acquire() without locks; the writer replaces it
+ * with publish() without waiting for them. A replaced snapshot is dropped
+ * once no reader can still be between loading it and taking its reference,
+ * the grace period of RCU. All other fields are used by the writer only.
+ */
+typedef struct {
+    _Atomic(inventory_snapshot_t *) current;
+    /* Readers currently inside acquire(). */
+    atomic_uint readers;
+    /* Replaced snapshots whose publisher reference is still held. */
+    inventory_snapshot_t *retired;
+    uint64_t sequence;
+} inventory_snapshot_publisher_t;
+
+/*
+ * Initializes a new publisher or one reset by clear(), with no current
+ * snapshot. Calling init() on a publisher that holds snapshots leaks them.
+ */
+void inventory_snapshot_publisher_init(
+    inventory_snapshot_publisher_t *publisher);
+
+/*
+ * Builds a snapshot of streams and, when applications is non-NULL, of its
+ * applications classified against configuration, then makes it current.
+ * Classification goes through the applications' caches, which is why they
+ * are not const. Must only be called from the writer thread. Returns 0 on
+ * success and -1 for invalid arguments or allocation failure, which keeps
+ * the previous snapshot current.
+ */
+int inventory_snapshot_publish(inventory_snapshot_publisher_t *publisher,
+                               const audio_stream_inventory_t *streams,
+                               active_application_inventory_t *applications,
+                               const config_t *configuration);
+
+/*
+ * Returns a new reference to the current snapshot, or NULL when publisher is
+ * NULL or nothing was published. Safe on any thread concurrently with
+ * publish(); it never blocks. Each returned snapshot must be passed to
+ * release() exactly once.
+ */
+inventory_snapshot_t *inventory_snapshot_acquire(
+    inventory_snapshot_publisher_t *publisher);
+
+/*
+ * Drops one reference and frees the snapshot with its last one. Safe on any
+ * thread. NULL is ignored.
+ */
+void inventory_snapshot_release(inventory_snapshot_t *snapshot);
+
+/*
+ * Drops the publisher's references to the current and replaced snapshots and
+ * resets it. No thread may call acquire() concurrently; snapshots readers
+ * still hold stay valid until they release them.
+ */
+void inventory_snapshot_publisher_clear(
+    inventory_snapshot_publisher_t *publisher);
+
+#endif
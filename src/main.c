@@ -6,9 +6,11 @@
 #include "headset/headset.h"
 #include "mixer/mixer.h"
 #include "config.h"
+#include "event_journal.h"
 
 #define POLL_INTERVAL_MS 100
 volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t statistics_requested = 0;
 
 static void print_usage(void) {
     printf("Usage: chatwheel [OPTIONS]\n");
@@ -22,6 +24,8 @@ static void print_usage(void) {
     printf("  --list-active     List active logical applications\n");
     printf("  --status          Show current chatmix and volume status\n");
     printf("  --restart         Restart the service to apply changes\n");
+    printf("  --stats           Write service statistics to its log\n");
+    printf("  --journal [PATH]  Decode the service's event journal\n");
     printf("  --help            Show this help message\n");
 }
 
@@ -35,6 +39,11 @@ static void handle_signal(int signum) {
     running = 0;
 }
 
+static void handle_statistics_signal(int signum) {
+    (void)signum;
+    statistics_requested = 1;
+}
+
 static int print_active_audio_streams(void) {
     size_t stream_count = get_active_audio_stream_count();
     printf("Active audio streams (%zu):\n", stream_count);
@@ -47,14 +56,10 @@ static int print_active_audio_streams(void) {
         }
 
         printf("Sink input index: %u\n", stream.index);
-        printf("  application.id: %s\n",
-               stream.application_id ? stream.application_id : "(missing)");
-        printf("  application.name: %s\n",
-               stream.application_name ? stream.application_name : "(missing)");
-        printf("  application.process.binary: %s\n",
-               stream.process_binary ? stream.process_binary : "(missing)");
-        printf("  node.name: %s\n",
-               stream.node_name ? stream.node_name : "(missing)");
+#define PRINT_PROPERTY(name, field, key, matched) \
+        printf("  %s: %s\n", key, stream.field ? stream.field : "(missing)");
+        AUDIO_STREAM_PROPERTY_TABLE(PRINT_PROPERTY)
+#undef PRINT_PROPERTY
     }
 
     return 0;
@@ -78,19 +83,6 @@ static const char *identity_property_label(
     }
 }
 
-static const char *application_group_label(application_group_t group) {
-    switch (group) {
-        case APPLICATION_GROUP_UNASSIGNED:
-            return "Unassigned";
-        case APPLICATION_GROUP_GAME:
-            return "Game";
-        case APPLICATION_GROUP_CHAT:
-            return "Chat";
-        default:
-            return "Unknown";
-    }
-}
-
 static int print_active_applications(void) {
     size_t application_count = get_active_application_count();
     printf("Active applications (%zu):\n", application_count);
@@ -112,7 +104,7 @@ static int print_active_applications(void) {
         printf("  identity value: %s\n",
                application.identity_value ? application.identity_value : "(missing)");
         printf("  classification: %s\n",
-               application_group_label(application.group));
+               application_group_name(application.group));
         if (application.matched_config_index < 0) {
             printf("  matched config index (zero-based): (none)\n");
             printf("  matched config pattern: (none)\n");
@@ -252,6 +244,31 @@ int main(int argc, char *argv[]) {
             printf("Service restarted\n");
             return 0;
         }
+        else if (strcmp(argv[1], "--stats") == 0) {
+            if (system("systemctl --user kill --signal=USR1 chatwheel") != 0) {
+                fprintf(stderr, "Failed to signal the chatwheel service\n");
+                return 1;
+            }
+            printf("Statistics written to the service log\n");
+            printf("Run: journalctl --user -u chatwheel -n 5\n");
+            return 0;
+        }
+        else if (strcmp(argv[1], "--journal") == 0) {
+            char default_path[512];
+            const char *path = argc > 2 ? argv[2] : default_path;
+            if (argc <= 2 &&
+                event_journal_default_path(
+                    default_path,
+                    sizeof(default_path)) != 0) {
+                fprintf(stderr, "Failed to locate the event journal\n");
+                return 1;
+            }
+            if (event_journal_decode(path, stdout) != 0) {
+                fprintf(stderr, "Failed to read event journal %s\n", path);
+                return 1;
+            }
+            return 0;
+        }
         else if (strcmp(argv[1], "--daemon") == 0) {
             // Continue with daemon mode
         }
@@ -262,6 +279,11 @@ int main(int argc, char *argv[]) {
     }
 
     load_config();
+    char journal_path[512];
+    if (event_journal_default_path(journal_path, sizeof(journal_path)) != 0 ||
+        open_event_journal(journal_path) != 0) {
+        fprintf(stderr, "Event journal unavailable, events are not recorded\n");
+    }
     if (initialize_audio_server() != 0) {
         fprintf(stderr, "Failed to initialize audio server\n");
         return 1;
@@ -272,6 +294,7 @@ int main(int argc, char *argv[]) {
     // Set up signal handling
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
+    signal(SIGUSR1, handle_statistics_signal);
     
     printf("Monitoring chatmix value. Press Ctrl+C to exit.\n\n");
     
@@ -294,6 +317,11 @@ int main(int argc, char *argv[]) {
         // Process any pending audio server events (e.g., new app streams)
         process_audio_events();
 
+        if (statistics_requested) {
+            statistics_requested = 0;
+            print_audio_server_statistics();
+        }
+
         usleep(POLL_INTERVAL_MS * 1000);
     }
     
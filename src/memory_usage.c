@@ -0,0 +1,54 @@
+#include "memory_usage.h"
+
+void memory_usage_init(memory_usage_t *usage) {
+    if (!usage) return;
+    *usage = (memory_usage_t){0};
+}
+
+void memory_usage_set(memory_usage_t *usage, size_t bytes) {
+    if (!usage) return;
+
+    usage->bytes = bytes;
+    if (bytes > usage->peak_bytes) usage->peak_bytes = bytes;
+}
+
+void memory_usage_add(memory_usage_t *total, const memory_usage_t *usage) {
+    if (!total || !usage) return;
+
+    total->bytes += usage->bytes;
+    total->peak_bytes += usage->peak_bytes;
+    total->shrink_count += usage->shrink_count;
+}
+
+size_t memory_usage_shrunk_capacity(size_t count,
+                                    size_t capacity,
+                                    size_t minimum) {
+#ifdef CHATWHEEL_FIXED_CAPACITY
+    (void)count;
+    (void)minimum;
+    return capacity;
+#else
+    size_t target = capacity;
+    while (target > 1 && target / 2 >= minimum && count <= target / 4) {
+        target /= 2;
+    }
+    return target;
+#endif
+}
+
+int memory_usage_shrink(memory_usage_t *usage,
+                        void *container,
+                        memory_usage_resize_fn resize,
+                        size_t count,
+                        size_t capacity,
+                        size_t minimum) {
+    if (!usage || !resize) return 0;
+
+    size_t new_capacity =
+        memory_usage_shrunk_capacity(count, capacity, minimum);
+    if (new_capacity == capacity || resize(container, new_capacity) != 0) {
+        return 0;
+    }
+    usage->shrink_count++;
+    return 1;
+}
@@ -0,0 +1,54 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Heap bytes owned by one container, the most it owned at once since init(),
+ * and how often it gave memory back by shrinking.
+ */
+typedef struct {
+    size_t bytes;
+    size_t peak_bytes;
+    uint64_t shrink_count;
+} memory_usage_t;
+
+void memory_usage_init(memory_usage_t *usage);
+
+/* Records that the container now owns bytes, raising the peak if needed. */
+void memory_usage_set(memory_usage_t *usage, size_t bytes);
+
+/* Adds the bytes, peak, and shrinks of usage to total. */
+void memory_usage_add(memory_usage_t *total, const memory_usage_t *usage);
+
+/*
+ * Returns the capacity a container holding count entries should shrink to,
+ * or capacity when it should keep its storage. Containers double when full
+ * and halve only while count is at most a quarter of capacity, so a shrunk
+ * container is between a quarter and half full and a single insertion or
+ * removal never makes it grow or shrink again. The result never drops below
+ * minimum, and capacity and minimum are expected to be powers of two.
+ * Fixed-capacity builds never shrink, since their storage is static anyway.
+ */
+size_t memory_usage_shrunk_capacity(size_t count,
+                                    size_t capacity,
+                                    size_t minimum);
+
+/* Moves container's storage to capacity entries; returns 0 on success. */
+typedef int (*memory_usage_resize_fn)(void *container, size_t capacity);
+
+/*
+ * Shrinks a container holding count of capacity entries to
+ * memory_usage_shrunk_capacity() through resize and counts the shrink in
+ * usage. When resize fails the container keeps its larger storage, which is
+ * still valid. Returns 1 when the container shrank and 0 otherwise.
+ */
+int memory_usage_shrink(memory_usage_t *usage,
+                        void *container,
+                        memory_usage_resize_fn resize,
+                        size_t count,
+                        size_t capacity,
+                        size_t minimum);
+
+#endif
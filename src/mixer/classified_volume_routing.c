@@ -4,8 +4,19 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "../fixed_pool.h"
+
 #define INITIAL_ASSIGNMENT_CAPACITY 4
 
+/*
+ * A fixed-capacity plan assigns each stream at most once, and building one
+ * holds the replacement next to the destination.
+ */
+FIXED_POOL_DEFINE(assignment_pool,
+                  CHATWHEEL_MAX_STREAMS *
+                      sizeof(classified_volume_assignment_t),
+                  2 * CHATWHEEL_FIXED_INSTANCES)
+
 static int inventories_are_valid(
     const active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams) {
@@ -46,7 +57,8 @@ static int ensure_assignment_capacity(classified_volume_plan_t *plan) {
     }
     if (new_capacity > SIZE_MAX / sizeof(*plan->assignments)) return -1;
 
-    classified_volume_assignment_t *resized = realloc(
+    classified_volume_assignment_t *resized = POOL_REALLOC(
+        assignment_pool,
         plan->assignments,
         new_capacity * sizeof(*plan->assignments));
     if (!resized) return -1;
@@ -74,12 +86,12 @@ static const chatmix_volume_target_t *target_for_group(
 
 static int add_application_assignments(
     classified_volume_plan_t *plan,
-    const active_application_t *application,
+    active_application_t *application,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets) {
     application_classification_t classification =
-        application_classifier_classify(
+        application_classifier_classify_cached(
             application,
             streams,
             configuration);
@@ -111,11 +123,27 @@ static int add_application_assignments(
     return 0;
 }
 
-static int application_contains_stream(
+static int compare_stream_indexes(const void *left, const void *right) {
+    uint32_t a = *(const uint32_t *)left;
+    uint32_t b = *(const uint32_t *)right;
+    return (a > b) - (a < b);
+}
+
+/* stream_indexes is sorted, so each lookup is a binary search. */
+static int application_contains_any_stream(
     const active_application_t *application,
-    uint32_t stream_index) {
+    const uint32_t *stream_indexes,
+    size_t stream_count) {
+    if (stream_count == 0) return 0;
+
     for (size_t i = 0; i < application->stream_count; i++) {
-        if (application->stream_indexes[i] == stream_index) return 1;
+        if (bsearch(&application->stream_indexes[i],
+                    stream_indexes,
+                    stream_count,
+                    sizeof(*stream_indexes),
+                    compare_stream_indexes)) {
+            return 1;
+        }
     }
     return 0;
 }
@@ -127,15 +155,18 @@ void classified_volume_plan_init(classified_volume_plan_t *plan) {
 
 static int build_plan(
     classified_volume_plan_t *destination,
-    const active_application_inventory_t *applications,
+    active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets,
     int inventory_available,
-    int limit_to_stream,
-    uint32_t stream_index) {
+    int limit_to_streams,
+    const uint32_t *stream_indexes,
+    size_t stream_count) {
     if (!destination || !applications || !streams || !configuration ||
-        !targets || !inventories_are_valid(applications, streams)) {
+        !targets || (limit_to_streams && stream_count > 0 &&
+                     !stream_indexes) ||
+        !inventories_are_valid(applications, streams)) {
         return -1;
     }
 
@@ -144,10 +175,12 @@ static int build_plan(
 
     if (inventory_available) {
         for (size_t i = 0; i < applications->count; i++) {
-            const active_application_t *application =
+            active_application_t *application =
                 &applications->applications[i];
-            if (limit_to_stream &&
-                !application_contains_stream(application, stream_index)) {
+            if (limit_to_streams &&
+                !application_contains_any_stream(application,
+                                                 stream_indexes,
+                                                 stream_count)) {
                 continue;
             }
             if (add_application_assignments(
@@ -159,7 +192,7 @@ static int build_plan(
                 classified_volume_plan_clear(&replacement);
                 return -1;
             }
-            if (limit_to_stream) break;
+            if (limit_to_streams && stream_count == 1) break;
         }
     }
 
@@ -170,7 +203,7 @@ static int build_plan(
 
 int classified_volume_plan_build_all(
     classified_volume_plan_t *destination,
-    const active_application_inventory_t *applications,
+    active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets,
@@ -183,12 +216,13 @@ int classified_volume_plan_build_all(
         targets,
         inventory_available,
         0,
+        NULL,
         0);
 }
 
 int classified_volume_plan_build_for_stream(
     classified_volume_plan_t *destination,
-    const active_application_inventory_t *applications,
+    active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets,
@@ -202,11 +236,62 @@ int classified_volume_plan_build_for_stream(
         targets,
         inventory_available,
         1,
-        stream_index);
+        &stream_index,
+        1);
+}
+
+int classified_volume_plan_build_for_streams(
+    classified_volume_plan_t *destination,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration,
+    const chatmix_volume_targets_t *targets,
+    int inventory_available,
+    const uint32_t *stream_indexes,
+    size_t stream_count) {
+    return build_plan(
+        destination,
+        applications,
+        streams,
+        configuration,
+        targets,
+        inventory_available,
+        1,
+        stream_indexes,
+        stream_count);
+}
+
+classified_volume_disposition_t classified_volume_assignment_disposition(
+    const classified_volume_assignment_t *assignment,
+    const audio_stream_inventory_t *streams) {
+    if (!assignment || !streams) return CLASSIFIED_VOLUME_SUBMIT;
+
+    const audio_stream_t *stream = audio_stream_inventory_find(
+        streams,
+        assignment->stream_index);
+    if (stream &&
+        stream->volume_known &&
+        stream->channel_count == assignment->channel_count &&
+        stream->volume == assignment->pulse_volume) {
+        return CLASSIFIED_VOLUME_SETTLED;
+    }
+    if (stream && stream->corked) return CLASSIFIED_VOLUME_DEFERRED;
+
+    return CLASSIFIED_VOLUME_SUBMIT;
+}
+
+int classified_volume_assignment_submitted(
+    const classified_volume_assignment_t *assignment,
+    audio_stream_inventory_t *streams) {
+    if (!assignment) return -1;
+    return audio_stream_inventory_set_volume(streams,
+                                             assignment->stream_index,
+                                             0,
+                                             0);
 }
 
 void classified_volume_plan_clear(classified_volume_plan_t *plan) {
     if (!plan) return;
-    free(plan->assignments);
+    POOL_FREE(assignment_pool, plan->assignments);
     classified_volume_plan_init(plan);
 }
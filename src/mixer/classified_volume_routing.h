@@ -17,6 +17,12 @@ typedef struct {
     pa_volume_t pulse_volume;
 } classified_volume_assignment_t;
 
+typedef enum {
+    CLASSIFIED_VOLUME_SUBMIT,
+    CLASSIFIED_VOLUME_SETTLED,
+    CLASSIFIED_VOLUME_DEFERRED
+} classified_volume_disposition_t;
+
 typedef struct {
     classified_volume_assignment_t *assignments;
     size_t count;
@@ -36,6 +42,10 @@ void classified_volume_plan_init(classified_volume_plan_t *plan);
  * PulseAudio target while retaining its own channel count. Missing and
  * duplicate stream indexes are skipped.
  *
+ * Classifications are reused from and stored in each application's cache, so
+ * rebuilding a plan after a wheel movement does no pattern matching unless
+ * the configuration or the application's streams changed.
+ *
  * When inventory_available is zero, a successful build produces an empty plan
  * without classifying applications. All inputs are borrowed and no pointer is
  * retained. Destination must be initialized. Returns 0 on success and -1 for
@@ -46,7 +56,7 @@ void classified_volume_plan_init(classified_volume_plan_t *plan);
  */
 int classified_volume_plan_build_all(
     classified_volume_plan_t *destination,
-    const active_application_inventory_t *applications,
+    active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets,
@@ -60,13 +70,56 @@ int classified_volume_plan_build_all(
  */
 int classified_volume_plan_build_for_stream(
     classified_volume_plan_t *destination,
-    const active_application_inventory_t *applications,
+    active_application_inventory_t *applications,
     const audio_stream_inventory_t *streams,
     const config_t *configuration,
     const chatmix_volume_targets_t *targets,
     int inventory_available,
     uint32_t stream_index);
 
+/*
+ * Builds one plan for every active application containing any of the
+ * stream_count indexes, which must be sorted in ascending order, as the
+ * streams read in one event drain are routed together. Each application is
+ * planned once, in inventory order, however many of its streams are listed.
+ * Availability, ownership, duplicate suppression, and failure semantics match
+ * build_all().
+ */
+int classified_volume_plan_build_for_streams(
+    classified_volume_plan_t *destination,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration,
+    const chatmix_volume_targets_t *targets,
+    int inventory_available,
+    const uint32_t *stream_indexes,
+    size_t stream_count);
+
+/*
+ * Decides whether assignment still needs a server write. A stream whose
+ * recorded volume already equals the assignment's target on every channel is
+ * settled, and submitting it again would only cost another roundtrip. An
+ * unsettled corked stream is deferred; the caller applies the then-current
+ * target once when it uncorks. Missing streams, unknown volumes, and changed
+ * channel counts are submitted. NULL arguments are treated as needing
+ * submission.
+ */
+classified_volume_disposition_t classified_volume_assignment_disposition(
+    const classified_volume_assignment_t *assignment,
+    const audio_stream_inventory_t *streams);
+
+/*
+ * Records that assignment was submitted. The stream's recorded volume is
+ * unknown until the server reports it again, so a plan built in between
+ * submits its target even when that equals the volume reported before this
+ * write, as when the wheel returns to where it was before the info arrives.
+ * Returns 0 on success and -1 when an argument is NULL or the stream is not
+ * stored.
+ */
+int classified_volume_assignment_submitted(
+    const classified_volume_assignment_t *assignment,
+    audio_stream_inventory_t *streams);
+
 /* Frees owned storage. Repeated calls on an initialized plan are safe. */
 void classified_volume_plan_clear(classified_volume_plan_t *plan);
 
@@ -0,0 +1,267 @@
+#include "derived_inventory_batch.h"
+
+#include <stdlib.h>
+
+#include "../fixed_pool.h"
+
+#define INITIAL_CHANGE_CAPACITY 16
+
+#define ROUTE_FLAGS \
+    (DERIVED_INVENTORY_CHANGE_ROUTE | DERIVED_INVENTORY_CHANGE_NEW)
+
+/*
+ * A fixed-capacity drain marks each kept stream about twice, as a stream and
+ * its change usually arrive together; a longer drain rebuilds instead.
+ */
+FIXED_POOL_DEFINE(change_pool,
+                  2 * CHATWHEEL_MAX_STREAMS *
+                      sizeof(derived_inventory_change_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(route_pool,
+                  2 * CHATWHEEL_MAX_STREAMS * sizeof(uint32_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+static void update_memory_usage(derived_inventory_batch_t *batch) {
+    memory_usage_set(
+        &batch->memory,
+        batch->change_capacity * sizeof(*batch->changes) +
+            batch->route_capacity * sizeof(*batch->routes));
+}
+
+static int resize_changes(void *container, size_t new_capacity) {
+    derived_inventory_batch_t *batch = container;
+    if (new_capacity > SIZE_MAX / sizeof(*batch->changes)) return -1;
+
+    derived_inventory_change_t *changes = POOL_REALLOC(
+        change_pool,
+        batch->changes,
+        new_capacity * sizeof(*changes));
+    if (!changes) return -1;
+
+    batch->changes = changes;
+    batch->change_capacity = new_capacity;
+    update_memory_usage(batch);
+    return 0;
+}
+
+static int resize_routes(void *container, size_t new_capacity) {
+    derived_inventory_batch_t *batch = container;
+    if (new_capacity > SIZE_MAX / sizeof(*batch->routes)) return -1;
+
+    uint32_t *routes = POOL_REALLOC(route_pool,
+                                    batch->routes,
+                                    new_capacity * sizeof(*routes));
+    if (!routes) return -1;
+
+    batch->routes = routes;
+    batch->route_capacity = new_capacity;
+    update_memory_usage(batch);
+    return 0;
+}
+
+static int ensure_change_capacity(derived_inventory_batch_t *batch) {
+    if (batch->change_count < batch->change_capacity) return 0;
+
+    size_t new_capacity = INITIAL_CHANGE_CAPACITY;
+    if (batch->change_capacity > 0) {
+        if (batch->change_capacity > SIZE_MAX / 2) return -1;
+        new_capacity = batch->change_capacity * 2;
+    }
+    return resize_changes(batch, new_capacity);
+}
+
+static int compare_changes(const void *left, const void *right) {
+    uint32_t a = ((const derived_inventory_change_t *)left)->index;
+    uint32_t b = ((const derived_inventory_change_t *)right)->index;
+    return (a > b) - (a < b);
+}
+
+/* Sorts the changes by index and merges the flags of repeated indexes. */
+static void merge_changes(derived_inventory_batch_t *batch) {
+    if (batch->change_count < 2) return;
+
+    qsort(batch->changes,
+          batch->change_count,
+          sizeof(*batch->changes),
+          compare_changes);
+    size_t merged = 0;
+    for (size_t i = 1; i < batch->change_count; i++) {
+        derived_inventory_change_t *last = &batch->changes[merged];
+        if (batch->changes[i].index == last->index) {
+            last->flags |= batch->changes[i].flags;
+            continue;
+        }
+        batch->changes[++merged] = batch->changes[i];
+    }
+    batch->change_count = merged + 1;
+}
+
+/*
+ * Updates the marked streams still stored, one at a time. Each update only
+ * moves its own stream between applications and keeps applications ordered
+ * by raw stream position, so once every marked stream was updated the result
+ * equals a rebuild. Streams removed later in the drain were detached by the
+ * caller already. Stores how many were updated in *updated and returns 0, or
+ * returns -1 when one failed.
+ */
+static int update_marked_streams(derived_inventory_batch_t *batch,
+                                 active_application_inventory_t *applications,
+                                 const audio_stream_inventory_t *streams,
+                                 size_t *updated) {
+    *updated = 0;
+    for (size_t i = 0; i < batch->change_count; i++) {
+        const derived_inventory_change_t *change = &batch->changes[i];
+        if (!(change->flags & DERIVED_INVENTORY_CHANGE_UPDATE) ||
+            !audio_stream_inventory_find(streams, change->index)) {
+            continue;
+        }
+        if (active_application_inventory_upsert_stream(
+                applications,
+                streams,
+                change->index) != 0) {
+            return -1;
+        }
+        (*updated)++;
+    }
+    return 0;
+}
+
+/* Collects the stored streams to route; without room every one is routed. */
+static void collect_routes(derived_inventory_batch_t *batch,
+                           const audio_stream_inventory_t *streams) {
+    batch->route_count = 0;
+    if (batch->route_all) return;
+
+    for (size_t i = 0; i < batch->change_count; i++) {
+        const derived_inventory_change_t *change = &batch->changes[i];
+        if (!(change->flags & ROUTE_FLAGS) ||
+            !audio_stream_inventory_find(streams, change->index)) {
+            continue;
+        }
+        if (batch->route_count == batch->route_capacity &&
+            resize_routes(batch, batch->change_capacity) != 0) {
+            batch->route_all = 1;
+            batch->route_count = 0;
+            return;
+        }
+        batch->routes[batch->route_count++] = change->index;
+    }
+}
+
+void derived_inventory_batch_init(derived_inventory_batch_t *batch) {
+    if (!batch) return;
+    *batch = (derived_inventory_batch_t){0};
+}
+
+int derived_inventory_batch_mark(derived_inventory_batch_t *batch,
+                                 uint32_t index,
+                                 unsigned int flags) {
+    if (!batch) return -1;
+
+    batch->marked_count++;
+    if (flags & DERIVED_INVENTORY_CHANGE_NEW) batch->new_streams = 1;
+    /* A stream's result often follows its own event directly. */
+    if (batch->change_count > 0 &&
+        batch->changes[batch->change_count - 1].index == index) {
+        batch->changes[batch->change_count - 1].flags |= flags;
+        return 0;
+    }
+    if (ensure_change_capacity(batch) != 0) {
+        derived_inventory_batch_mark_rebuild(batch,
+                                             (flags & ROUTE_FLAGS) != 0);
+        return -1;
+    }
+
+    batch->changes[batch->change_count++] =
+        (derived_inventory_change_t){.index = index, .flags = flags};
+    return 0;
+}
+
+void derived_inventory_batch_mark_rebuild(derived_inventory_batch_t *batch,
+                                          int route_all) {
+    if (!batch) return;
+    batch->rebuild_needed = 1;
+    if (route_all) batch->route_all = 1;
+}
+
+derived_inventory_batch_result_t derived_inventory_batch_apply(
+    derived_inventory_batch_t *batch,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    derived_inventory_state_t *state) {
+    if (!batch) return DERIVED_INVENTORY_BATCH_UNCHANGED;
+    batch->route_count = 0;
+    if (!applications || !streams ||
+        !derived_inventory_state_can_rebuild(state) ||
+        (batch->change_count == 0 && !batch->rebuild_needed &&
+         !batch->route_all)) {
+        return DERIVED_INVENTORY_BATCH_UNCHANGED;
+    }
+
+    batch->drain_count++;
+    merge_changes(batch);
+    derived_inventory_batch_result_t result =
+        DERIVED_INVENTORY_BATCH_UNCHANGED;
+    if (!batch->rebuild_needed &&
+        derived_inventory_state_is_available(state)) {
+        size_t updated;
+        if (update_marked_streams(batch,
+                                  applications,
+                                  streams,
+                                  &updated) != 0) {
+            batch->rebuild_needed = 1;
+        } else if (updated > 0) {
+            batch->update_count++;
+            result = DERIVED_INVENTORY_BATCH_UPDATED;
+        }
+    }
+
+    if (batch->rebuild_needed ||
+        !derived_inventory_state_is_available(state)) {
+        int succeeded = active_application_inventory_rebuild(
+            applications,
+            streams) == 0;
+        derived_inventory_state_set_rebuild_result(state, succeeded);
+        batch->rebuild_count++;
+        if (!succeeded) batch->failed_rebuild_count++;
+        result = succeeded
+            ? DERIVED_INVENTORY_BATCH_REBUILT
+            : DERIVED_INVENTORY_BATCH_REBUILD_FAILED;
+    }
+
+    if (!derived_inventory_state_is_available(state)) return result;
+    collect_routes(batch, streams);
+    if (batch->route_all || batch->route_count > 0) batch->plan_count++;
+    return result;
+}
+
+void derived_inventory_batch_reset(derived_inventory_batch_t *batch) {
+    if (!batch) return;
+
+    memory_usage_shrink(&batch->memory,
+                        batch,
+                        resize_changes,
+                        batch->change_count,
+                        batch->change_capacity,
+                        INITIAL_CHANGE_CAPACITY);
+    memory_usage_shrink(&batch->memory,
+                        batch,
+                        resize_routes,
+                        batch->route_count,
+                        batch->route_capacity,
+                        INITIAL_CHANGE_CAPACITY);
+
+    batch->change_count = 0;
+    batch->route_count = 0;
+    batch->rebuild_needed = 0;
+    batch->route_all = 0;
+    batch->new_streams = 0;
+}
+
+void derived_inventory_batch_clear(derived_inventory_batch_t *batch) {
+    if (!batch) return;
+
+    POOL_FREE(change_pool, batch->changes);
+    POOL_FREE(route_pool, batch->routes);
+    derived_inventory_batch_init(batch);
+}
@@ -0,0 +1,109 @@
+#ifndef DERIVED_INVENTORY_BATCH_H
+#define DERIVED_INVENTORY_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../active_application_inventory.h"
+#include "../audio_stream_inventory.h"
+#include "../memory_usage.h"
+#include "sink_input_request_state.h"
+
+/* What a marked stream needs once its drain ends. */
+#define DERIVED_INVENTORY_CHANGE_UPDATE 1U
+#define DERIVED_INVENTORY_CHANGE_ROUTE 2U
+/* A new stream, which is routed as well. */
+#define DERIVED_INVENTORY_CHANGE_NEW 4U
+
+typedef struct {
+    uint32_t index;
+    unsigned int flags;
+} derived_inventory_change_t;
+
+typedef enum {
+    DERIVED_INVENTORY_BATCH_UNCHANGED,
+    DERIVED_INVENTORY_BATCH_UPDATED,
+    DERIVED_INVENTORY_BATCH_REBUILT,
+    DERIVED_INVENTORY_BATCH_REBUILD_FAILED
+} derived_inventory_batch_result_t;
+
+/*
+ * Collects the stream changes of one event drain, so the active applications
+ * are brought up to date once at its end instead of after every information
+ * result, and the streams to route are covered by one combined plan. Stored
+ * and changed streams are only marked; removals are applied by the caller as
+ * they arrive, since the removed stream's raw position is gone, and only
+ * mark a rebuild when the applications are not synchronized.
+ */
+typedef struct {
+    /* Marked streams, possibly repeated until apply() merges them. */
+    derived_inventory_change_t *changes;
+    size_t change_count;
+    size_t change_capacity;
+    /* The sorted streams to route, valid from apply() until reset(). */
+    uint32_t *routes;
+    size_t route_count;
+    size_t route_capacity;
+    int rebuild_needed;
+    int route_all;
+    int new_streams;
+    /*
+     * Changes marked, drains that applied any, incremental passes, rebuilds
+     * and failed rebuilds, and plans handed to the caller.
+     */
+    uint64_t marked_count;
+    uint64_t drain_count;
+    uint64_t update_count;
+    uint64_t rebuild_count;
+    uint64_t failed_rebuild_count;
+    uint64_t plan_count;
+    /* Both arrays, shrunk once a drain uses at most a quarter of them. */
+    memory_usage_t memory;
+} derived_inventory_batch_t;
+
+/*
+ * Initializes a new batch or one reset by clear(). Calling init() on a batch
+ * that owns storage leaks it.
+ */
+void derived_inventory_batch_init(derived_inventory_batch_t *batch);
+
+/*
+ * Marks stream index with DERIVED_INVENTORY_CHANGE_* flags. Repeated marks of
+ * an index are merged by apply(). Returns 0 on success and -1 for invalid
+ * arguments or allocation failure, after which the batch rebuilds instead.
+ */
+int derived_inventory_batch_mark(derived_inventory_batch_t *batch,
+                                 uint32_t index,
+                                 unsigned int flags);
+
+/*
+ * Requests a full rebuild at the end of the drain, and with route_all a plan
+ * for every application instead of the marked streams.
+ */
+void derived_inventory_batch_mark_rebuild(derived_inventory_batch_t *batch,
+                                          int route_all);
+
+/*
+ * Brings applications up to date with the drain's changes to streams. While
+ * state is synchronized the marked streams still stored are updated in
+ * place; any failure, a requested rebuild, or an unsynchronized state leads
+ * to one full rebuild, whose result is stored in state. Nothing is applied
+ * before the initial snapshot completed.
+ *
+ * When applications are then available, routes holds the marked streams to
+ * route, in ascending order, and route_all whether every application should
+ * be routed instead; plan_count counts each drain that left either.
+ */
+derived_inventory_batch_result_t derived_inventory_batch_apply(
+    derived_inventory_batch_t *batch,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    derived_inventory_state_t *state);
+
+/* Forgets the drain's changes and routes, keeping counters and storage. */
+void derived_inventory_batch_reset(derived_inventory_batch_t *batch);
+
+/* Frees both arrays and resets the batch, including its counters. */
+void derived_inventory_batch_clear(derived_inventory_batch_t *batch);
+
+#endif
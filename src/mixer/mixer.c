@@ -1,35 +1,47 @@
+#include <inttypes.h>
+#include <pulse/ext-stream-restore.h>
 #include <pulse/pulseaudio.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "mixer.h"
+#include "mixer_common.h"
 #include "chatmix_volume.h"
 #include "classified_volume_routing.h"
+#include "derived_inventory_batch.h"
 #include "pulse_event_drain.h"
+#include "sink_input_request_pool.h"
 #include "sink_input_request_state.h"
 #include "pulse_stream_lifecycle.h"
+#include "stream_event_throttle.h"
+#include "stream_grace_window.h"
+#include "stream_list_resync.h"
+#include "stream_restore_rules.h"
+#include "volume_reconciliation.h"
 #include "../active_application_inventory.h"
-#include "../application_classifier.h"
+#include "../application_identity.h"
 #include "../config.h"
-#include "../pattern_matcher.h"
+#include "../event_journal.h"
+#include "../fixed_pool.h"
 
 static pa_context *context = NULL;
 static pa_mainloop *mainloop = NULL;
-static chatmix_volume_targets_t last_chatmix_targets;
-static int has_valid_chatmix = 0;
-static audio_stream_inventory_t stream_inventory;
-static active_application_inventory_t application_inventory;
 static sink_input_request_tracker_t sink_input_request_tracker;
-static derived_inventory_state_t application_inventory_state;
-
-struct sink_input_info_request {
-    sink_input_request_token_t token;
-    pa_operation *operation;
-    int result_received;
-    struct sink_input_info_request *next;
-};
-
-static struct sink_input_info_request *pending_sink_input_requests = NULL;
+static derived_inventory_batch_t application_inventory_batch;
+static stream_event_throttle_t stream_event_throttle;
+static stream_restore_schedule_t stream_restore_schedule;
+static stream_restore_rule_set_t pending_stream_restore_rules;
+static pa_operation *stream_restore_operation = NULL;
+static int stream_restore_enabled = 0;
+static pa_operation *volume_reconciliation_operation = NULL;
+/* Stream events whose identity fingerprint matched, and those that did not. */
+static uint64_t identity_fingerprint_hits = 0;
+static uint64_t identity_fingerprint_misses = 0;
+static stream_grace_window_t stream_grace_window;
+static stream_list_resync_t stream_list_resync;
+static pa_operation *stream_list_resync_operation = NULL;
+
+static sink_input_request_pool_t sink_input_requests;
 
 struct snapshot_state {
     int failed;
@@ -39,6 +51,9 @@ struct snapshot_state {
 static int wait_for_operation(pa_operation *op);
 static void reap_sink_input_requests(void);
 static void subscribe_callback(pa_context *c, pa_subscription_event_type_t t, uint32_t idx, void *userdata);
+static void request_sink_input_info(pa_context *c,
+                                    uint32_t idx,
+                                    sink_input_request_intent_t intent);
 static void sink_input_event_info_cb(pa_context *ctx, const pa_sink_input_info *info, int eol, void *ud);
 static void sink_input_snapshot_cb(pa_context *ctx, const pa_sink_input_info *info, int eol, void *ud);
 
@@ -58,15 +73,38 @@ static void context_state_callback(pa_context *c, void *userdata) {
     }
 }
 
-static int record_sink_input(const pa_sink_input_info *info) {
+static int record_sink_input(const pa_sink_input_info *info,
+                             event_journal_info_source_t source) {
     if (!info) return -1;
-    if (!pa_channels_valid(info->sample_spec.channels)) return -1;
 
-    return pulse_stream_lifecycle_record(
-        &stream_inventory,
-        info->index,
-        info->sample_spec.channels,
-        info->proplist);
+    int result = pa_channels_valid(info->sample_spec.channels)
+        ? pulse_stream_lifecycle_record(
+              &stream_inventory,
+              info->index,
+              info->sample_spec.channels,
+              info->proplist,
+              &info->volume,
+              info->corked)
+        : -1;
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_STREAM_INFO,
+                         info->index,
+                         (uint16_t)source,
+                         pa_cvolume_max(&info->volume),
+                         (uint32_t)result);
+    if (result >= 0) {
+        /* PA_INVALID_INDEX, a stream without a client, is NO_CLIENT. */
+        application_identity_resolution_t name =
+            application_display_name_resolve(
+                audio_stream_inventory_find_properties(&stream_inventory,
+                                                       info->index));
+        stream_event_throttle_assign(&stream_event_throttle,
+                                     info->index,
+                                     info->client,
+                                     name.value,
+                                     monotonic_milliseconds());
+    }
+    return result;
 }
 
 static void subscribe_success_callback(pa_context *c, int success, void *userdata) {
@@ -75,10 +113,6 @@ static void subscribe_success_callback(pa_context *c, int success, void *userdat
     *subscription_succeeded = success;
 }
 
-static const char *application_group_name(application_group_t group) {
-    return group == APPLICATION_GROUP_CHAT ? "Chat" : "Game";
-}
-
 static void sink_input_volume_success_callback(pa_context *c,
                                                int success,
                                                void *userdata) {
@@ -124,56 +158,268 @@ static int set_sink_input_volume_target(pa_context *c,
     return 0;
 }
 
-static void apply_classified_volume_plan(
+/*
+ * Writes the volume of one assignment; userdata is the context. The change
+ * event of a submitted write is not the client's doing.
+ */
+static int submit_sink_input_volume(
+    const classified_volume_assignment_t *assignment,
+    void *userdata) {
+    if (set_sink_input_volume_target(userdata,
+                                     assignment->stream_index,
+                                     assignment->channel_count,
+                                     assignment->pulse_volume) != 0) {
+        return -1;
+    }
+    stream_event_throttle_expect_change(&stream_event_throttle,
+                                        assignment->stream_index,
+                                        monotonic_milliseconds());
+    return 0;
+}
+
+static void disable_stream_restore_rules(pa_context *c) {
+    if (!stream_restore_enabled) return;
+    stream_restore_enabled = 0;
+    fprintf(stderr,
+            "PulseAudio stream-restore rules unavailable, new streams keep "
+            "their restored volume: %s\n",
+            pa_strerror(pa_context_errno(c)));
+}
+
+static void stream_restore_write_callback(pa_context *c,
+                                          int success,
+                                          void *userdata) {
+    (void)userdata;
+    if (!success) disable_stream_restore_rules(c);
+}
+
+static void write_pending_stream_restore_rules(pa_context *c) {
+    size_t count = pending_stream_restore_rules.count;
+    pa_ext_stream_restore_info *entries = calloc(count, sizeof(*entries));
+    if (!entries) {
+        fprintf(stderr, "Failed to prepare PulseAudio stream-restore rules\n");
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const stream_restore_rule_t *rule =
+            &pending_stream_restore_rules.rules[i];
+        entries[i].name = rule->name;
+        pa_channel_map_init_mono(&entries[i].channel_map);
+        pa_cvolume_set(&entries[i].volume, 1, rule->pulse_volume);
+        entries[i].device = rule->device;
+        entries[i].mute = rule->muted;
+    }
+
+    pa_operation *operation = pa_ext_stream_restore_write(
+        c,
+        PA_UPDATE_REPLACE,
+        entries,
+        (unsigned)count,
+        0,
+        stream_restore_write_callback,
+        NULL);
+    if (operation) {
+        pa_operation_unref(operation);
+    } else {
+        disable_stream_restore_rules(c);
+    }
+    free(entries);
+}
+
+static void stream_restore_read_callback(
     pa_context *c,
-    const classified_volume_plan_t *plan,
-    const char *action) {
-    for (size_t i = 0; i < plan->count; i++) {
-        const classified_volume_assignment_t *assignment =
-            &plan->assignments[i];
-        if (set_sink_input_volume_target(
-                c,
-                assignment->stream_index,
-                assignment->channel_count,
-                assignment->pulse_volume) == 0) {
-            printf("\n%s PulseAudio stream %u (%s)",
-                   action,
-                   assignment->stream_index,
-                   application_group_name(assignment->group));
+    const pa_ext_stream_restore_info *info,
+    int eol,
+    void *userdata) {
+    (void)userdata;
+    if (eol < 0) {
+        disable_stream_restore_rules(c);
+        stream_restore_rule_set_clear(&pending_stream_restore_rules);
+        return;
+    }
+    if (eol == 0) {
+        if (info && info->name &&
+            stream_restore_rule_set_preserve(
+                &pending_stream_restore_rules,
+                info->name,
+                info->device,
+                info->mute) != 0) {
+            fprintf(stderr,
+                    "Failed to keep stream-restore preferences for %s\n",
+                    info->name);
         }
+        return;
     }
+
+    if (stream_restore_enabled) write_pending_stream_restore_rules(c);
+    stream_restore_rule_set_clear(&pending_stream_restore_rules);
 }
 
-static void route_all_classified_applications(
-    pa_context *c,
-    const chatmix_volume_targets_t *targets) {
-    classified_volume_plan_t plan;
-    classified_volume_plan_init(&plan);
+/*
+ * Keeps module-stream-restore entries at the current mix so new streams of
+ * known applications start at their group's volume without a correction
+ * roundtrip. Existing entries are read first so their device and mute
+ * preferences survive the rewrite. At most one batch is in flight, and
+ * batches are rate-limited by the schedule. A batch that cannot be started
+ * requests the write again, so the latest mix is retried after the interval.
+ */
+static void update_stream_restore_rules(pa_context *c) {
+    if (!c || !stream_restore_enabled || !has_valid_chatmix) return;
+
+    if (stream_restore_operation) {
+        if (pa_operation_get_state(stream_restore_operation) ==
+            PA_OPERATION_RUNNING) {
+            return;
+        }
+        pa_operation_unref(stream_restore_operation);
+        stream_restore_operation = NULL;
+    }
 
-    if (classified_volume_plan_build_all(
-            &plan,
+    uint64_t now = monotonic_milliseconds();
+    if (!stream_restore_schedule_is_due(&stream_restore_schedule, now)) {
+        return;
+    }
+    stream_restore_schedule_mark_written(&stream_restore_schedule, now);
+
+    if (stream_restore_rule_set_build(
+            &pending_stream_restore_rules,
             &application_inventory,
             &stream_inventory,
             &config,
-            targets,
+            &last_chatmix_targets,
             derived_inventory_state_is_available(
                 &application_inventory_state)) != 0) {
-        fprintf(stderr, "Failed to plan classified application volumes\n");
-        classified_volume_plan_clear(&plan);
+        fprintf(stderr, "Failed to plan PulseAudio stream-restore rules\n");
+        stream_restore_schedule_request(&stream_restore_schedule);
         return;
     }
+    if (pending_stream_restore_rules.count == 0) return;
 
-    apply_classified_volume_plan(c, &plan, "Submitted volume for");
-    classified_volume_plan_clear(&plan);
+    stream_restore_operation = pa_ext_stream_restore_read(
+        c,
+        stream_restore_read_callback,
+        NULL);
+    if (!stream_restore_operation) {
+        disable_stream_restore_rules(c);
+        stream_restore_rule_set_clear(&pending_stream_restore_rules);
+        stream_restore_schedule_request(&stream_restore_schedule);
+    }
+}
+
+static void cancel_stream_restore_rules(void) {
+    if (stream_restore_operation) {
+        if (pa_operation_get_state(stream_restore_operation) ==
+            PA_OPERATION_RUNNING) {
+            pa_operation_cancel(stream_restore_operation);
+        }
+        pa_operation_unref(stream_restore_operation);
+        stream_restore_operation = NULL;
+    }
+    stream_restore_rule_set_clear(&pending_stream_restore_rules);
 }
 
-static void route_classified_application_for_new_stream(
+static size_t route_all_classified_applications(
     pa_context *c,
-    uint32_t stream_index) {
+    const chatmix_volume_targets_t *targets) {
+    return mixer_route_all_classified_applications(targets,
+                                                   submit_sink_input_volume,
+                                                   c);
+}
+
+static void volume_reconciliation_cb(pa_context *c,
+                                     const pa_sink_input_info *info,
+                                     int eol,
+                                     void *userdata) {
+    (void)userdata;
+    if (eol < 0) {
+        fprintf(stderr,
+                "PulseAudio volume reconciliation failed: %s\n",
+                pa_strerror(pa_context_errno(c)));
+        volume_reconciliation_abandon(
+            &volume_reconciliation,
+            monotonic_milliseconds());
+        return;
+    }
+    if (eol == 0) {
+        // Streams not stored yet are recorded by their pending NEW request.
+        if (info &&
+            pulse_stream_lifecycle_record_state(
+                &stream_inventory,
+                info->index,
+                &info->volume,
+                info->corked) > 0) {
+            inventory_snapshot_stale = 1;
+        }
+        return;
+    }
+
+    size_t drifted = 0;
+    if (has_valid_chatmix &&
+        derived_inventory_state_is_available(&application_inventory_state)) {
+        drifted = route_all_classified_applications(
+            c,
+            &last_chatmix_targets);
+    }
+    volume_reconciliation_finish(
+        &volume_reconciliation,
+        monotonic_milliseconds(),
+        drifted);
+}
+
+/*
+ * Periodically refreshes the recorded volume of every stream with one list
+ * request and rewrites only the streams another client moved away from the
+ * current mix. The result is handled from the event drain, so the headset
+ * loop never waits for it.
+ */
+static void reconcile_stream_volumes(pa_context *c) {
+    if (!c) return;
+
+    if (volume_reconciliation_operation) {
+        if (pa_operation_get_state(volume_reconciliation_operation) ==
+            PA_OPERATION_RUNNING) {
+            return;
+        }
+        pa_operation_unref(volume_reconciliation_operation);
+        volume_reconciliation_operation = NULL;
+    }
+
+    uint64_t now = monotonic_milliseconds();
+    if (!mixer_reconciliation_due(now)) return;
+
+    volume_reconciliation_begin(&volume_reconciliation, now);
+    volume_reconciliation_operation = pa_context_get_sink_input_info_list(
+        c,
+        volume_reconciliation_cb,
+        NULL);
+    if (!volume_reconciliation_operation) {
+        fprintf(stderr,
+                "Failed to request PulseAudio volume reconciliation: %s\n",
+                pa_strerror(pa_context_errno(c)));
+        volume_reconciliation_abandon(&volume_reconciliation, now);
+    }
+}
+
+static void cancel_volume_reconciliation(void) {
+    if (!volume_reconciliation_operation) return;
+    if (pa_operation_get_state(volume_reconciliation_operation) ==
+        PA_OPERATION_RUNNING) {
+        pa_operation_cancel(volume_reconciliation_operation);
+    }
+    pa_operation_unref(volume_reconciliation_operation);
+    volume_reconciliation_operation = NULL;
+}
+
+/* Routes the applications of the sorted stream_indexes with one plan. */
+static void route_classified_applications_for_streams(
+    pa_context *c,
+    const uint32_t *stream_indexes,
+    size_t stream_count) {
     classified_volume_plan_t plan;
     classified_volume_plan_init(&plan);
 
-    if (classified_volume_plan_build_for_stream(
+    if (classified_volume_plan_build_for_streams(
             &plan,
             &application_inventory,
             &stream_inventory,
@@ -181,40 +427,87 @@ static void route_classified_application_for_new_stream(
             &last_chatmix_targets,
             derived_inventory_state_is_available(
                 &application_inventory_state),
-            stream_index) != 0) {
+            stream_indexes,
+            stream_count) != 0) {
         fprintf(stderr,
-                "Failed to plan classified volume for new stream %u\n",
-                stream_index);
+                "Failed to plan classified volumes for %zu streams\n",
+                stream_count);
         classified_volume_plan_clear(&plan);
         return;
     }
 
-    apply_classified_volume_plan(c, &plan, "Submitted current mix for");
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_PLAN,
+                         stream_count == 1
+                             ? stream_indexes[0]
+                             : EVENT_JOURNAL_NO_STREAM,
+                         0,
+                         (uint32_t)plan.count,
+                         0);
+    mixer_apply_classified_volume_plan(&plan, submit_sink_input_volume, c);
     classified_volume_plan_clear(&plan);
 }
 
-static int rebuild_active_applications_after_event(
-    const char *event_description,
-    uint32_t index) {
+/*
+ * Detaches a removed stream from the derived application inventory at once,
+ * since the incremental updates batched for the rest of the drain rely on
+ * every listed stream still being stored. A failed update, or a removal while
+ * the inventory is not synchronized, leaves one rebuild for the drain's end.
+ */
+static void remove_active_application_stream(uint32_t index) {
     if (!derived_inventory_state_can_rebuild(&application_inventory_state)) {
-        return -1;
+        return;
     }
+    if (derived_inventory_state_is_available(&application_inventory_state) &&
+        active_application_inventory_remove_stream(
+            &application_inventory,
+            &stream_inventory,
+            index) == 0) {
+        return;
+    }
+
+    derived_inventory_state_set_rebuild_result(&application_inventory_state,
+                                               0);
+    derived_inventory_batch_mark_rebuild(&application_inventory_batch, 0);
+}
 
-    int succeeded = active_application_inventory_rebuild(
+/*
+ * Applies the stream changes of one drain to the derived application
+ * inventory with a single incremental pass or rebuild, then routes every
+ * marked stream with one combined plan.
+ */
+static void apply_application_inventory_batch(pa_context *c) {
+    derived_inventory_batch_result_t result = derived_inventory_batch_apply(
+        &application_inventory_batch,
         &application_inventory,
-        &stream_inventory) == 0;
-    derived_inventory_state_set_rebuild_result(
-        &application_inventory_state,
-        succeeded);
-    if (!succeeded) {
+        &stream_inventory,
+        &application_inventory_state);
+    if (result == DERIVED_INVENTORY_BATCH_REBUILT ||
+        result == DERIVED_INVENTORY_BATCH_REBUILD_FAILED) {
+        journal_rebuild(result == DERIVED_INVENTORY_BATCH_REBUILT);
+    }
+    if (result == DERIVED_INVENTORY_BATCH_REBUILD_FAILED) {
         fprintf(stderr,
-                "Failed to rebuild active applications after %s stream %u\n",
-                event_description,
-                index);
-        return -1;
+                "Failed to rebuild active applications after stream "
+                "events\n");
     }
 
-    return 0;
+    const derived_inventory_batch_t *batch = &application_inventory_batch;
+    if (c && has_valid_chatmix &&
+        derived_inventory_state_is_available(&application_inventory_state) &&
+        (batch->route_all || batch->route_count > 0)) {
+        if (batch->route_all) {
+            route_all_classified_applications(c, &last_chatmix_targets);
+        } else {
+            route_classified_applications_for_streams(c,
+                                                      batch->routes,
+                                                      batch->route_count);
+        }
+        if (batch->new_streams || batch->route_all) {
+            stream_restore_schedule_request(&stream_restore_schedule);
+        }
+    }
+    derived_inventory_batch_reset(&application_inventory_batch);
 }
 
 static void sink_input_event_info_cb(
@@ -222,7 +515,7 @@ static void sink_input_event_info_cb(
     const pa_sink_input_info *info,
     int eol,
     void *ud) {
-    struct sink_input_info_request *request = ud;
+    sink_input_info_request_t *request = ud;
     if (!request ||
         !sink_input_request_tracker_is_current(
             &sink_input_request_tracker,
@@ -244,27 +537,48 @@ static void sink_input_event_info_cb(
     if (info->index != request->token.index) return;
 
     request->result_received = 1;
-    int rebuild_succeeded = 0;
-    if (record_sink_input(info) != 0) {
+    int record_result = record_sink_input(
+        info,
+        request->token.intent == SINK_INPUT_REQUEST_NEW
+            ? EVENT_JOURNAL_INFO_NEW
+            : EVENT_JOURNAL_INFO_CHANGED);
+    /* A fingerprint hit with the same volume and cork state publishes none. */
+    if (record_result < 0 ||
+        !(record_result & PULSE_STREAM_RECORD_IDENTITY_UNCHANGED) ||
+        (record_result & PULSE_STREAM_RECORD_STATE_CHANGED)) {
+        inventory_snapshot_stale = 1;
+    }
+    if (record_result < 0) {
         fprintf(stderr,
                 "Failed to %s PulseAudio stream %u\n",
                 request->token.intent == SINK_INPUT_REQUEST_NEW
                     ? "store"
                     : "update",
                 info->index);
-    } else {
-        rebuild_succeeded = rebuild_active_applications_after_event(
-            request->token.intent == SINK_INPUT_REQUEST_NEW
-                ? "new"
-                : "changed",
-            info->index) == 0;
+        return;
     }
 
-    if (request->token.intent == SINK_INPUT_REQUEST_NEW &&
-        rebuild_succeeded &&
-        derived_inventory_state_is_available(&application_inventory_state) &&
-        has_valid_chatmix) {
-        route_classified_application_for_new_stream(ctx, info->index);
+    /* Applications and routing catch up once the drain ends. */
+    unsigned int changes = 0;
+    if ((record_result & PULSE_STREAM_RECORD_IDENTITY_UNCHANGED) &&
+        derived_inventory_state_is_available(&application_inventory_state)) {
+        identity_fingerprint_hits++;
+    } else {
+        identity_fingerprint_misses++;
+        changes |= DERIVED_INVENTORY_CHANGE_UPDATE;
+    }
+    if (has_valid_chatmix) {
+        if (request->token.intent == SINK_INPUT_REQUEST_NEW) {
+            changes |= DERIVED_INVENTORY_CHANGE_NEW;
+        } else if (record_result & PULSE_STREAM_RECORD_UNCORKED_DEFERRED) {
+            changes |= DERIVED_INVENTORY_CHANGE_ROUTE;
+        }
+    }
+    /* A change that cannot be marked makes the batch rebuild instead. */
+    if (changes != 0) {
+        derived_inventory_batch_mark(&application_inventory_batch,
+                                     info->index,
+                                     changes);
     }
 }
 
@@ -278,121 +592,331 @@ static void sink_input_snapshot_cb(pa_context *ctx, const pa_sink_input_info *in
     }
     if (eol > 0 || !info) return;
 
-    if (record_sink_input(info) != 0) {
+    if (record_sink_input(info, EVENT_JOURNAL_INFO_SNAPSHOT) < 0) {
         state->failed = 1;
     }
 }
 
+/*
+ * Invalidates the information requests of a removed stream and cancels those
+ * still running, so a later stream reusing the index starts afresh.
+ */
+static void forget_sink_input_requests(uint32_t idx) {
+    sink_input_request_tracker_invalidate(&sink_input_request_tracker, idx);
+    for (sink_input_request_token_t *token =
+             sink_input_request_tracker_first_request(
+                 &sink_input_request_tracker,
+                 idx);
+         token;
+         token = token->next) {
+        sink_input_info_request_t *request =
+            sink_input_request_from_token(token);
+        if (pa_operation_get_state(request->operation) ==
+            PA_OPERATION_RUNNING) {
+            pa_operation_cancel(request->operation);
+        }
+    }
+}
+
 static void subscribe_callback(pa_context *c, pa_subscription_event_type_t t, uint32_t idx, void *userdata) {
     (void)userdata;
     // Only react to sink input events
     if ((t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) != PA_SUBSCRIPTION_EVENT_SINK_INPUT) return;
 
     pa_subscription_event_type_t type = t & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+    event_journal_append(&event_journal,
+                         type == PA_SUBSCRIPTION_EVENT_NEW
+                             ? EVENT_JOURNAL_STREAM_NEW
+                             : type == PA_SUBSCRIPTION_EVENT_REMOVE
+                                 ? EVENT_JOURNAL_STREAM_REMOVED
+                                 : EVENT_JOURNAL_STREAM_CHANGED,
+                         idx,
+                         0,
+                         0,
+                         0);
     if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
-        sink_input_request_tracker_invalidate(
-            &sink_input_request_tracker,
-            idx);
-        for (struct sink_input_info_request *request =
-                 pending_sink_input_requests;
-             request;
-             request = request->next) {
-            if (request->token.index == idx &&
-                pa_operation_get_state(request->operation) ==
-                    PA_OPERATION_RUNNING) {
-                pa_operation_cancel(request->operation);
-            }
+        stream_event_throttle_forget(&stream_event_throttle, idx);
+        /* A stream removed inside its grace window was never read. */
+        if (stream_grace_window_drop(&stream_grace_window, idx) &&
+            !audio_stream_inventory_find(&stream_inventory, idx)) {
+            return;
         }
 
+        forget_sink_input_requests(idx);
         audio_stream_inventory_remove(&stream_inventory, idx);
-        rebuild_active_applications_after_event("removed", idx);
+        remove_active_application_stream(idx);
+        inventory_snapshot_stale = 1;
         return;
     }
 
-    sink_input_request_intent_t intent;
     if (type == PA_SUBSCRIPTION_EVENT_NEW) {
-        intent = SINK_INPUT_REQUEST_NEW;
+        if (config.stream_grace_ms > 0 &&
+            stream_grace_window_add(
+                &stream_grace_window,
+                idx,
+                monotonic_milliseconds()) == 0) {
+            return;
+        }
+        request_sink_input_info(c, idx, SINK_INPUT_REQUEST_NEW);
     } else if (type == PA_SUBSCRIPTION_EVENT_CHANGE) {
-        intent = SINK_INPUT_REQUEST_CHANGE;
-    } else {
+        /* A pending stream is read in full once it is materialized. */
+        if (stream_grace_window_contains(&stream_grace_window, idx)) return;
+        /* A stream over its own or its client's budget is only sampled. */
+        if (!stream_event_throttle_admit(&stream_event_throttle,
+                                         idx,
+                                         monotonic_milliseconds())) {
+            return;
+        }
+        request_sink_input_info(c, idx, SINK_INPUT_REQUEST_CHANGE);
+    }
+}
+
+/*
+ * Reads the throttled streams whose changes are due to be sampled, and those
+ * released from the throttle with changes still unread.
+ */
+static void sample_throttled_streams(pa_context *c) {
+    if (!c) return;
+
+    uint64_t now_ms = monotonic_milliseconds();
+    uint32_t index;
+    while (stream_event_throttle_take_sample(
+               &stream_event_throttle,
+               now_ms,
+               &index)) {
+        request_sink_input_info(c, index, SINK_INPUT_REQUEST_CHANGE);
+    }
+}
+
+/*
+ * Reads and routes pending new streams that have lived for at least grace_ms.
+ * A grace_ms of 0 materializes every pending stream.
+ */
+static void materialize_pending_streams(pa_context *c, uint64_t grace_ms) {
+    if (!c) return;
+
+    uint64_t now_ms = monotonic_milliseconds();
+    uint32_t index;
+    while (stream_grace_window_take_due(
+               &stream_grace_window,
+               now_ms,
+               grace_ms,
+               &index)) {
+        request_sink_input_info(c, index, SINK_INPUT_REQUEST_NEW);
+    }
+}
+
+/*
+ * Queues a request once its operation finished or was cancelled, so reaping
+ * visits only completed requests.
+ */
+static void sink_input_request_state_cb(pa_operation *operation, void *ud) {
+    if (pa_operation_get_state(operation) == PA_OPERATION_RUNNING) return;
+    sink_input_request_pool_complete(&sink_input_requests, ud);
+}
+
+/*
+ * Requests a stream's information, unless a request for it is in flight
+ * already; the index is then marked dirty and read once more when that
+ * request completes. During a burst the stream list resync reads it instead.
+ */
+static void request_sink_input_info(pa_context *c,
+                                    uint32_t idx,
+                                    sink_input_request_intent_t intent) {
+    if (sink_input_request_tracker_coalesce(&sink_input_request_tracker,
+                                            idx,
+                                            intent) ||
+        stream_list_resync_absorb_event(&stream_list_resync)) {
         return;
     }
 
-    struct sink_input_info_request *request = calloc(1, sizeof(*request));
+    sink_input_info_request_t *request =
+        sink_input_request_pool_acquire(&sink_input_requests);
     if (!request ||
         sink_input_request_tracker_begin(
             &sink_input_request_tracker,
             idx,
             intent,
             &request->token) != 0) {
-        free(request);
+        sink_input_request_pool_release(&sink_input_requests, request);
         fprintf(stderr, "Failed to track PulseAudio stream request %u\n", idx);
         return;
     }
 
-    request->next = pending_sink_input_requests;
-    pending_sink_input_requests = request;
     request->operation = pa_context_get_sink_input_info(
         c,
         idx,
         sink_input_event_info_cb,
         request);
     if (!request->operation) {
-        pending_sink_input_requests = request->next;
         sink_input_request_tracker_finish(
             &sink_input_request_tracker,
             &request->token);
-        free(request);
+        sink_input_request_pool_release(&sink_input_requests, request);
         fprintf(stderr, "Failed to request PulseAudio stream %u\n", idx);
+        return;
     }
+    pa_operation_set_state_callback(request->operation,
+                                    sink_input_request_state_cb,
+                                    request);
 }
 
 static void reap_sink_input_requests(void) {
-    struct sink_input_info_request **position =
-        &pending_sink_input_requests;
-    while (*position) {
-        struct sink_input_info_request *request = *position;
-        if (pa_operation_get_state(request->operation) ==
-            PA_OPERATION_RUNNING) {
-            position = &request->next;
-            continue;
+    sink_input_info_request_t *request;
+    while ((request = sink_input_request_pool_take_completed(
+                &sink_input_requests))) {
+        /* Cancelled requests are stale or the daemon is shutting down. */
+        sink_input_request_intent_t follow_up_intent;
+        int has_follow_up =
+            pa_operation_get_state(request->operation) ==
+                PA_OPERATION_DONE &&
+            sink_input_request_tracker_take_follow_up(
+                &sink_input_request_tracker,
+                &request->token,
+                &follow_up_intent);
+        /* A new stream that was never read is still routed by the next. */
+        if (has_follow_up &&
+            request->token.intent == SINK_INPUT_REQUEST_NEW &&
+            !request->result_received) {
+            follow_up_intent = SINK_INPUT_REQUEST_NEW;
         }
+        uint32_t index = request->token.index;
 
-        *position = request->next;
         sink_input_request_tracker_finish(
             &sink_input_request_tracker,
             &request->token);
         pa_operation_unref(request->operation);
-        free(request);
+        sink_input_request_pool_release(&sink_input_requests, request);
+        if (has_follow_up) {
+            request_sink_input_info(context, index, follow_up_intent);
+        }
     }
 }
 
 static void cancel_and_release_sink_input_requests(void) {
-    struct sink_input_info_request *request = pending_sink_input_requests;
-    pending_sink_input_requests = NULL;
-    while (request) {
-        struct sink_input_info_request *next = request->next;
+    for (sink_input_info_request_t *request = sink_input_requests.live;
+         request;
+         request = request->live_next) {
         if (pa_operation_get_state(request->operation) ==
             PA_OPERATION_RUNNING) {
             pa_operation_cancel(request->operation);
         }
-        sink_input_request_tracker_finish(
-            &sink_input_request_tracker,
-            &request->token);
-        pa_operation_unref(request->operation);
-        free(request);
-        request = next;
+        /* Queued once, whether or not the state callback already ran. */
+        sink_input_request_pool_complete(&sink_input_requests, request);
     }
+    reap_sink_input_requests();
+}
+
+/* Drops the per-stream state of a stream the resync list no longer reports. */
+static void forget_resync_removed_stream(uint32_t index, void *userdata) {
+    (void)userdata;
+    stream_event_throttle_forget(&stream_event_throttle, index);
+    forget_sink_input_requests(index);
+}
+
+static void stream_list_resync_cb(pa_context *c,
+                                  const pa_sink_input_info *info,
+                                  int eol,
+                                  void *userdata) {
+    (void)userdata;
+    if (eol < 0) {
+        fprintf(stderr,
+                "PulseAudio stream list resync failed: %s\n",
+                pa_strerror(pa_context_errno(c)));
+        stream_list_resync_abandon(&stream_list_resync);
+        return;
+    }
+    if (eol == 0) {
+        /* Streams inside their grace window are read once they are due. */
+        if (!info ||
+            stream_grace_window_contains(&stream_grace_window, info->index)) {
+            return;
+        }
+        if (record_sink_input(info, EVENT_JOURNAL_INFO_RESYNC) < 0) {
+            fprintf(stderr, "Failed to store PulseAudio stream %u\n",
+                    info->index);
+        }
+        if (audio_stream_inventory_find(&stream_inventory, info->index)) {
+            stream_list_resync_mark_seen(&stream_list_resync, info->index);
+        }
+        return;
+    }
+
+    if (stream_list_resync.seen_incomplete) {
+        fprintf(stderr,
+                "Failed to compare PulseAudio streams, keeping removed "
+                "streams until their events arrive\n");
+    }
+    stream_list_resync_finish(&stream_list_resync,
+                              &stream_inventory,
+                              forget_resync_removed_stream,
+                              NULL);
+    inventory_snapshot_stale = 1;
+    /* The drain's batch rebuilds the applications and routes them all. */
+    derived_inventory_batch_mark_rebuild(&application_inventory_batch,
+                                         has_valid_chatmix);
+}
+
+/*
+ * Replaces the per-stream requests of a burst with one list request, diffed
+ * against the stream inventory and followed by one rebuild and one plan. The
+ * requests in flight are cancelled, since the list reports what they would
+ * have read. A list that cannot be sent is retried by the next drain.
+ */
+static void start_stream_list_resync(pa_context *c) {
+    if (!c || !stream_list_resync_should_start(&stream_list_resync)) return;
+
+    if (stream_list_resync_operation) {
+        pa_operation_unref(stream_list_resync_operation);
+        stream_list_resync_operation = NULL;
+    }
+
+    cancel_and_release_sink_input_requests();
+    stream_list_resync_operation = pa_context_get_sink_input_info_list(
+        c,
+        stream_list_resync_cb,
+        NULL);
+    if (!stream_list_resync_operation) {
+        fprintf(stderr,
+                "Failed to request PulseAudio stream list resync: %s\n",
+                pa_strerror(pa_context_errno(c)));
+        return;
+    }
+    stream_list_resync_begin(&stream_list_resync);
+}
+
+static void cancel_stream_list_resync(void) {
+    if (!stream_list_resync_operation) return;
+    if (pa_operation_get_state(stream_list_resync_operation) ==
+        PA_OPERATION_RUNNING) {
+        pa_operation_cancel(stream_list_resync_operation);
+    }
+    pa_operation_unref(stream_list_resync_operation);
+    stream_list_resync_operation = NULL;
 }
 
 int initialize_audio_server(void) {
     int ready = 0;
-    has_valid_chatmix = 0;
-    pending_sink_input_requests = NULL;
+    mixer_common_init();
+    identity_fingerprint_hits = 0;
+    identity_fingerprint_misses = 0;
+    stream_grace_window_init(&stream_grace_window);
+    stream_list_resync_init(&stream_list_resync);
+    stream_event_throttle_init(&stream_event_throttle);
+    stream_list_resync_operation = NULL;
+    sink_input_request_pool_init(&sink_input_requests);
+    stream_restore_operation = NULL;
+#ifdef CHATWHEEL_FIXED_CAPACITY
+    /* Rules are built on the heap, so new streams are corrected once read. */
+    stream_restore_enabled = 0;
+#else
+    stream_restore_enabled = 1;
+#endif
+    stream_restore_schedule_init(&stream_restore_schedule);
+    stream_restore_rule_set_init(&pending_stream_restore_rules);
+    volume_reconciliation_operation = NULL;
     sink_input_request_tracker_init(&sink_input_request_tracker);
-    derived_inventory_state_init(&application_inventory_state);
-    audio_stream_inventory_init(&stream_inventory);
-    active_application_inventory_init(&application_inventory);
+    derived_inventory_batch_init(&application_inventory_batch);
     mainloop = pa_mainloop_new();
     if (!mainloop) goto fail;
 
@@ -451,20 +975,13 @@ int initialize_audio_server(void) {
         goto fail;
     }
 
-    derived_inventory_state_mark_initial_snapshot_complete(
-        &application_inventory_state);
-    int initial_rebuild_succeeded = active_application_inventory_rebuild(
-        &application_inventory,
-        &stream_inventory) == 0;
-    derived_inventory_state_set_rebuild_result(
-        &application_inventory_state,
-        initial_rebuild_succeeded);
-    if (!initial_rebuild_succeeded) {
-        fprintf(stderr,
-                "Failed to build active application inventory from PulseAudio snapshot\n");
+    if (mixer_common_finish_initial_snapshot("PulseAudio snapshot") != 0) {
         goto fail;
     }
 
+#ifndef CHATWHEEL_FIXED_CAPACITY
+    publish_inventory_snapshot();
+#endif
     return 0;
 
 fail:
@@ -479,6 +996,10 @@ void cleanup_audio_server(void) {
         pa_context_set_subscribe_callback(context, NULL, NULL);
     }
     cancel_and_release_sink_input_requests();
+    cancel_stream_list_resync();
+    cancel_stream_restore_rules();
+    cancel_volume_reconciliation();
+    stream_restore_enabled = 0;
     if (context) {
         pa_context_disconnect(context);
         pa_context_unref(context);
@@ -489,9 +1010,12 @@ void cleanup_audio_server(void) {
         mainloop = NULL;
     }
     sink_input_request_tracker_clear(&sink_input_request_tracker);
-    active_application_inventory_clear(&application_inventory);
-    audio_stream_inventory_clear(&stream_inventory);
-    has_valid_chatmix = 0;
+    sink_input_request_pool_clear(&sink_input_requests);
+    stream_grace_window_clear(&stream_grace_window);
+    stream_list_resync_clear(&stream_list_resync);
+    stream_event_throttle_clear(&stream_event_throttle);
+    derived_inventory_batch_clear(&application_inventory_batch);
+    mixer_common_clear();
 }
 
 static int iterate_audio_mainloop(void *userdata, int block) {
@@ -506,6 +1030,8 @@ static void reap_audio_requests(void *userdata) {
 void process_audio_events(void) {
     if (!mainloop) return;
 
+    event_journal_set_clock(&event_journal, monotonic_milliseconds());
+    stream_list_resync_begin_drain(&stream_list_resync);
     pulse_event_drain_result_t result = pulse_event_drain(
         iterate_audio_mainloop,
         mainloop,
@@ -514,53 +1040,94 @@ void process_audio_events(void) {
     if (result == PULSE_EVENT_DRAIN_ERROR) {
         fprintf(stderr, "Failed to process PulseAudio events\n");
     }
-}
 
-size_t get_active_audio_stream_count(void) {
-    return stream_inventory.count;
-}
-
-int get_active_audio_stream(size_t position, audio_stream_view_t *stream) {
-    if (!stream || position >= stream_inventory.count) return -1;
-
-    const audio_stream_t *inventory_stream =
-        &stream_inventory.streams[position];
-    stream->index = inventory_stream->index;
-    stream->application_id = inventory_stream->application_id;
-    stream->application_name = inventory_stream->application_name;
-    stream->process_binary = inventory_stream->process_binary;
-    stream->node_name = inventory_stream->node_name;
-    return 0;
+    apply_application_inventory_batch(context);
+    materialize_pending_streams(context, config.stream_grace_ms);
+    sample_throttled_streams(context);
+    start_stream_list_resync(context);
+    update_stream_restore_rules(context);
+    reconcile_stream_volumes(context);
+#ifndef CHATWHEEL_FIXED_CAPACITY
+    publish_inventory_snapshot();
+#endif
 }
 
-size_t get_active_application_count(void) {
-    return derived_inventory_state_is_available(&application_inventory_state)
-        ? application_inventory.count
-        : 0;
-}
-
-int get_active_application(size_t position, active_application_view_t *view) {
-    if (!derived_inventory_state_is_available(&application_inventory_state) ||
-        !view ||
-        position >= application_inventory.count) {
-        return -1;
+void audio_backend_print_statistics(void) {
+    printf("Stream identity fingerprint: %" PRIu64
+           " hits skipped the update, %" PRIu64 " misses updated it\n",
+           identity_fingerprint_hits,
+           identity_fingerprint_misses);
+    printf("Stream information requests: %" PRIu64
+           " events coalesced into %" PRIu64 " follow-up requests\n",
+           sink_input_request_tracker.coalesced_count,
+           sink_input_request_tracker.follow_up_count);
+    printf("Stream list resync: %" PRIu64 " bursts absorbed %" PRIu64
+           " events, %" PRIu64 " lists read (%" PRIu64 " failed), %" PRIu64
+           " streams removed\n",
+           stream_list_resync.burst_count,
+           stream_list_resync.absorbed_event_count,
+           stream_list_resync.completed_count,
+           stream_list_resync.failed_count,
+           stream_list_resync.removed_stream_count);
+    printf("Derived applications: %" PRIu64 " stream changes batched over %"
+           PRIu64 " drains into %" PRIu64 " incremental passes and %" PRIu64
+           " rebuilds (%" PRIu64 " failed), %" PRIu64 " combined plans\n",
+           application_inventory_batch.marked_count,
+           application_inventory_batch.drain_count,
+           application_inventory_batch.update_count,
+           application_inventory_batch.rebuild_count,
+           application_inventory_batch.failed_rebuild_count,
+           application_inventory_batch.plan_count);
+    printf("Stream event throttle: %" PRIu64 " change events (%" PRIu64
+           " from own writes), %" PRIu64 " deferred to %" PRIu64
+           " samples; %" PRIu64 " streams and %" PRIu64
+           " clients throttled, %" PRIu64 " and %" PRIu64 " released\n",
+           stream_event_throttle.event_count,
+           stream_event_throttle.own_event_count,
+           stream_event_throttle.deferred_event_count,
+           stream_event_throttle.sample_count,
+           stream_event_throttle.throttled_stream_count,
+           stream_event_throttle.throttled_client_count,
+           stream_event_throttle.released_stream_count,
+           stream_event_throttle.released_client_count);
+    for (size_t i = 0; i < stream_event_throttle.client_count; i++) {
+        const stream_event_client_t *client =
+            &stream_event_throttle.clients[i];
+        if (client->throttle_count == 0) continue;
+        printf("  client %u (%s): throttled %" PRIu64 " times, %" PRIu64
+               " events deferred%s\n",
+               client->client,
+               client->name[0] ? client->name : "unnamed",
+               client->throttle_count,
+               client->deferred_event_count,
+               client->throttled ? ", throttled now" : "");
+    }
+    if (stream_event_throttle.forgotten_client_count > 0) {
+        printf("  %" PRIu64 " earlier clients: throttled %" PRIu64
+               " times, %" PRIu64 " events deferred\n",
+               stream_event_throttle.forgotten_client_count,
+               stream_event_throttle.forgotten_throttle_count,
+               stream_event_throttle.forgotten_deferred_event_count);
     }
+    printf("New stream grace window (%u ms): %" PRIu64 " deferred, %" PRIu64
+           " removed inside it, %" PRIu64 " materialized\n",
+           config.stream_grace_ms,
+           stream_grace_window.deferred_count,
+           stream_grace_window.dropped_count,
+           stream_grace_window.materialized_count);
+}
 
-    const active_application_t *application =
-        &application_inventory.applications[position];
-    application_classification_t classification =
-        application_classifier_classify(
-            application,
-            &stream_inventory,
-            &config);
-    view->identity_property = application->identity_property;
-    view->identity_value = application->identity_value;
-    view->display_name = application->display_name;
-    view->stream_indexes = application->stream_indexes;
-    view->stream_count = application->stream_count;
-    view->group = classification.group;
-    view->matched_config_index = classification.matched_config_index;
-    return 0;
+void audio_backend_print_memory_usage(memory_usage_t *total) {
+    print_memory_usage("sink input requests",
+                       &sink_input_request_tracker.memory,
+                       total);
+    print_memory_usage("request pool", &sink_input_requests.memory, total);
+    print_memory_usage("grace window", &stream_grace_window.memory, total);
+    print_memory_usage("list resync", &stream_list_resync.memory, total);
+    print_memory_usage("drain batch",
+                       &application_inventory_batch.memory,
+                       total);
+    print_memory_usage("event throttle", &stream_event_throttle.memory, total);
 }
 
 static int wait_for_operation(pa_operation *op) {
@@ -577,89 +1144,10 @@ static int wait_for_operation(pa_operation *op) {
     return 0;
 }
 
-static void list_apps_callback(pa_context *c, const pa_sink_input_info *i, int eol, void *userdata) {
-    (void)c;      // Suppress warning
-    (void)userdata; // Suppress warning
-    
-    if (eol > 0 || !i) return;
-
-    const char *app_name = pa_proplist_gets(i->proplist, "application.name");
-    const char *binary = pa_proplist_gets(i->proplist, "application.process.binary");
-    float volume = pa_cvolume_avg(&i->volume) * 100.0f / PA_VOLUME_NORM;
-    
-    if (app_name) {
-        printf("Application: %-20s Volume: %.0f%% [Index: %u]", app_name, volume, i->index);
-        if (binary) {
-            printf(" (Binary: %s)", binary);
-        }
-        printf("\n");
-    }
-}
-
-void adjust_volume_based_on_chatmix(float chatmix_value) {
-    chatmix_volume_targets_t targets;
-    if (chatmix_volume_targets_calculate(chatmix_value, &targets) != 0) {
-        fprintf(stderr, "Invalid ChatMix value: %.0f\n", chatmix_value);
-        return;
-    }
-
-    last_chatmix_targets = targets;
-    has_valid_chatmix = 1;
-
-    printf("\nChatmix position: %.0f%%", targets.normalized * 100);
-    printf("\nTarget volumes - Game: %.0f%% (%.0f%% logarithmic), Chat: %.0f%% (%.0f%% logarithmic)", 
-           targets.game.linear * 100, targets.game.logarithmic * 100,
-           targets.chat.linear * 100, targets.chat.logarithmic * 100);
-    
-    route_all_classified_applications(context, &targets);
-    printf("\n");
-}
-
-void list_applications(void) {
-    if (!context) {
-        printf("No PulseAudio context available\n");
-        return;
-    }
-
-    pa_operation *op = pa_context_get_sink_input_info_list(context, list_apps_callback, NULL);
-    if (op) {
-        wait_for_operation(op);
-        pa_operation_unref(op);
-    }
-}
-
-static int is_app_configured(const char* app_name) {
-    for (int i = 0; i < config.count; i++) {
-        if (pattern_matches_text(config.apps[i].name, app_name)) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-static void list_unconfigured_callback(pa_context *c, const pa_sink_input_info *i, int eol, void *userdata) {
-    (void)c;
-    (void)userdata;
-    
-    if (eol > 0 || !i) return;
-    const char *app_name = pa_proplist_gets(i->proplist, "application.name");
-    if (app_name && !is_app_configured(app_name)) {
-        printf("%s\n", app_name);
-    }
-}
-
-void list_unconfigured_applications(void) {
-    if (!context) {
-        printf("No PulseAudio context available\n");
-        return;
-    }
-
-    printf("Unconfigured applications:\n");
-    pa_operation *op = pa_context_get_sink_input_info_list(context, 
-                                                          list_unconfigured_callback, 
-                                                          NULL);
-    if (op) {
-        wait_for_operation(op);
-        pa_operation_unref(op);
-    }
+void audio_backend_apply_chatmix(const chatmix_volume_targets_t *targets) {
+    /* Pending streams are routed by their info callbacks at the new mix. */
+    materialize_pending_streams(context, 0);
+    route_all_classified_applications(context, targets);
+    stream_restore_schedule_request(&stream_restore_schedule);
+    update_stream_restore_rules(context);
 }
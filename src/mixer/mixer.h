@@ -6,13 +6,14 @@
 #include <pulse/pulseaudio.h> // Include PulseAudio or PipeWire headers as needed
 #include "../application_classifier.h"
 #include "../application_identity.h"
+#include "../inventory_snapshot.h"
 
+/* One borrowed property per AUDIO_STREAM_PROPERTY_TABLE entry. */
 typedef struct {
     uint32_t index;
-    const char *application_id;
-    const char *application_name;
-    const char *process_binary;
-    const char *node_name;
+#define AUDIO_STREAM_VIEW_FIELD(name, field, key, matched) const char *field;
+    AUDIO_STREAM_PROPERTY_TABLE(AUDIO_STREAM_VIEW_FIELD)
+#undef AUDIO_STREAM_VIEW_FIELD
 } audio_stream_view_t;
 
 typedef struct {
@@ -25,11 +26,27 @@ typedef struct {
     int matched_config_index;
 } active_application_view_t;
 
+/*
+ * Records subscription events, stream information, rebuilds, volume plans,
+ * and volume submissions of this process in the event journal at path from
+ * now on. Only one process may write a journal file; the daemon opens it
+ * before initialize_audio_server(). cleanup_audio_server() closes it.
+ * Returns 0 on success and -1 when the journal cannot be opened, in which
+ * case nothing is recorded.
+ */
+int open_event_journal(const char *path);
+
 // Initialize and cleanup
 int initialize_audio_server(void);
 void cleanup_audio_server(void);
 void process_audio_events(void);
 
+/*
+ * Writes the audio server's runtime statistics, such as drift reconciliation
+ * passes, to standard output.
+ */
+void print_audio_server_statistics(void);
+
 size_t get_active_audio_stream_count(void);
 
 /*
@@ -60,6 +77,18 @@ size_t get_active_application_count(void);
  */
 int get_active_application(size_t position, active_application_view_t *view);
 
+/*
+ * Returns a reference to the latest published inventory snapshot, or NULL
+ * before the first one. Unlike the views above, it may be called from any
+ * thread while the audio server runs and never blocks event processing. The
+ * snapshot stays valid until it is passed to inventory_snapshot_release().
+ * A new snapshot is published after each event drain that changed a stream
+ * or the configuration. Other threads must stop calling this before
+ * cleanup_audio_server(). Builds with CHATWHEEL_FIXED_CAPACITY publish no
+ * snapshots, so this always returns NULL there.
+ */
+inventory_snapshot_t *acquire_inventory_snapshot(void);
+
 // Volume control functions
 void adjust_volume_based_on_chatmix(float chatmix_value);
 
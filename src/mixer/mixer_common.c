@@ -0,0 +1,355 @@
+#include "mixer_common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "mixer.h"
+#include "../application_classifier.h"
+#include "../config.h"
+#include "../inventory_snapshot.h"
+#include "../pattern_matcher.h"
+
+audio_stream_inventory_t stream_inventory;
+active_application_inventory_t application_inventory;
+derived_inventory_state_t application_inventory_state;
+chatmix_volume_targets_t last_chatmix_targets;
+int has_valid_chatmix = 0;
+volume_reconciliation_t volume_reconciliation;
+event_journal_t event_journal = {.fd = -1};
+int inventory_snapshot_stale = 0;
+
+static inventory_snapshot_publisher_t inventory_snapshots;
+#ifndef CHATWHEEL_FIXED_CAPACITY
+static unsigned int inventory_snapshot_config_generation = 0;
+#endif
+
+uint64_t monotonic_milliseconds(void) {
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) return 0;
+    return (uint64_t)now.tv_sec * 1000U + (uint64_t)now.tv_nsec / 1000000U;
+}
+
+void mixer_common_init(void) {
+    event_journal_set_clock(&event_journal, monotonic_milliseconds());
+    has_valid_chatmix = 0;
+    volume_reconciliation_init(&volume_reconciliation, monotonic_milliseconds());
+    derived_inventory_state_init(&application_inventory_state);
+    audio_stream_inventory_init(&stream_inventory);
+    active_application_inventory_init(&application_inventory);
+    inventory_snapshot_publisher_init(&inventory_snapshots);
+    inventory_snapshot_stale = 1;
+}
+
+void mixer_common_clear(void) {
+    derived_inventory_state_init(&application_inventory_state);
+    inventory_snapshot_publisher_clear(&inventory_snapshots);
+    active_application_inventory_clear(&application_inventory);
+    audio_stream_inventory_clear(&stream_inventory);
+    has_valid_chatmix = 0;
+    event_journal_close(&event_journal);
+}
+
+void journal_rebuild(int succeeded) {
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_REBUILD,
+                         EVENT_JOURNAL_NO_STREAM,
+                         (uint16_t)(succeeded != 0),
+                         (uint32_t)application_inventory.count,
+                         (uint32_t)stream_inventory.count);
+}
+
+int mixer_common_finish_initial_snapshot(const char *server) {
+    derived_inventory_state_mark_initial_snapshot_complete(
+        &application_inventory_state);
+    int initial_rebuild_succeeded = active_application_inventory_rebuild(
+        &application_inventory,
+        &stream_inventory) == 0;
+    journal_rebuild(initial_rebuild_succeeded);
+    derived_inventory_state_set_rebuild_result(
+        &application_inventory_state,
+        initial_rebuild_succeeded);
+    if (!initial_rebuild_succeeded) {
+        fprintf(stderr,
+                "Failed to build active application inventory from %s\n",
+                server);
+        return -1;
+    }
+    return 0;
+}
+
+static void journal_volume_assignment(
+    event_journal_record_type_t type,
+    const classified_volume_assignment_t *assignment) {
+    event_journal_append(&event_journal,
+                         type,
+                         assignment->stream_index,
+                         (uint16_t)assignment->group,
+                         assignment->pulse_volume,
+                         assignment->channel_count);
+}
+
+size_t mixer_apply_classified_volume_plan(
+    const classified_volume_plan_t *plan,
+    mixer_volume_write_fn write,
+    void *userdata) {
+    size_t submitted = 0;
+    for (size_t i = 0; i < plan->count; i++) {
+        const classified_volume_assignment_t *assignment =
+            &plan->assignments[i];
+        classified_volume_disposition_t disposition =
+            classified_volume_assignment_disposition(
+                assignment,
+                &stream_inventory);
+        if (disposition == CLASSIFIED_VOLUME_SETTLED) continue;
+        if (disposition == CLASSIFIED_VOLUME_DEFERRED) {
+            audio_stream_inventory_defer_volume(
+                &stream_inventory,
+                assignment->stream_index);
+            journal_volume_assignment(EVENT_JOURNAL_VOLUME_DEFERRED,
+                                      assignment);
+            continue;
+        }
+        if (write(assignment, userdata) != 0) {
+            journal_volume_assignment(EVENT_JOURNAL_VOLUME_FAILED,
+                                      assignment);
+            continue;
+        }
+        journal_volume_assignment(EVENT_JOURNAL_VOLUME_SUBMITTED, assignment);
+        classified_volume_assignment_submitted(assignment, &stream_inventory);
+        submitted++;
+    }
+    return submitted;
+}
+
+size_t mixer_route_all_classified_applications(
+    const chatmix_volume_targets_t *targets,
+    mixer_volume_write_fn write,
+    void *userdata) {
+    classified_volume_plan_t plan;
+    classified_volume_plan_init(&plan);
+
+    if (classified_volume_plan_build_all(
+            &plan,
+            &application_inventory,
+            &stream_inventory,
+            &config,
+            targets,
+            derived_inventory_state_is_available(
+                &application_inventory_state)) != 0) {
+        fprintf(stderr, "Failed to plan classified application volumes\n");
+        classified_volume_plan_clear(&plan);
+        return 0;
+    }
+
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_PLAN,
+                         EVENT_JOURNAL_NO_STREAM,
+                         0,
+                         (uint32_t)plan.count,
+                         0);
+    size_t submitted =
+        mixer_apply_classified_volume_plan(&plan, write, userdata);
+    classified_volume_plan_clear(&plan);
+    return submitted;
+}
+
+int mixer_reconciliation_due(uint64_t now_ms) {
+    return has_valid_chatmix &&
+        derived_inventory_state_is_available(&application_inventory_state) &&
+        volume_reconciliation_should_start(&volume_reconciliation, now_ms);
+}
+
+#ifndef CHATWHEEL_FIXED_CAPACITY
+void publish_inventory_snapshot(void) {
+    if (!inventory_snapshot_stale &&
+        inventory_snapshot_config_generation == config.generation) {
+        return;
+    }
+
+    active_application_inventory_t *applications =
+        derived_inventory_state_is_available(&application_inventory_state)
+            ? &application_inventory
+            : NULL;
+    if (inventory_snapshot_publish(
+            &inventory_snapshots,
+            &stream_inventory,
+            applications,
+            &config) != 0) {
+        fprintf(stderr, "Failed to publish inventory snapshot\n");
+        inventory_snapshot_stale = 1;
+        return;
+    }
+
+    inventory_snapshot_stale = 0;
+    inventory_snapshot_config_generation = config.generation;
+}
+#endif
+
+void print_memory_usage(const char *name,
+                        const memory_usage_t *usage,
+                        memory_usage_t *total) {
+    printf("  %-22s %8zu bytes, peak %8zu, %" PRIu64 " shrinks\n",
+           name,
+           usage->bytes,
+           usage->peak_bytes,
+           usage->shrink_count);
+    memory_usage_add(total, usage);
+}
+
+int open_event_journal(const char *path) {
+    event_journal_close(&event_journal);
+    return event_journal_open(&event_journal,
+                              path,
+                              EVENT_JOURNAL_DEFAULT_CAPACITY,
+                              monotonic_milliseconds());
+}
+
+void print_audio_server_statistics(void) {
+    printf("\nVolume reconciliation: %" PRIu64 " passes, %" PRIu64
+           " failed, %" PRIu64 " drifted streams repaired\n",
+           volume_reconciliation.pass_count,
+           volume_reconciliation.failed_pass_count,
+           volume_reconciliation.drifted_stream_count);
+    printf("Last pass: %zu drifted streams in %" PRIu64
+           " ms, slowest pass: %" PRIu64 " ms\n",
+           volume_reconciliation.last_drifted_count,
+           volume_reconciliation.last_duration_ms,
+           volume_reconciliation.max_duration_ms);
+    audio_backend_print_statistics();
+
+    /* Peaks are summed per container, so the total peak is an upper bound. */
+    memory_usage_t total;
+    memory_usage_init(&total);
+    printf("Inventory memory:\n");
+    print_memory_usage("streams", &stream_inventory.memory, &total);
+    print_memory_usage("property strings",
+                       &stream_inventory.strings.memory,
+                       &total);
+    print_memory_usage("applications", &application_inventory.memory, &total);
+    audio_backend_print_memory_usage(&total);
+    print_memory_usage("total", &total, NULL);
+    fflush(stdout);
+}
+
+size_t get_active_audio_stream_count(void) {
+    return stream_inventory.count;
+}
+
+int get_active_audio_stream(size_t position, audio_stream_view_t *stream) {
+    if (!stream || position >= stream_inventory.count) return -1;
+
+    const audio_stream_properties_t *properties =
+        &stream_inventory.properties[position];
+    stream->index = stream_inventory.streams[position].index;
+#define COPY_PROPERTY(name, field, key, matched) \
+    stream->field = properties->field;
+    AUDIO_STREAM_PROPERTY_TABLE(COPY_PROPERTY)
+#undef COPY_PROPERTY
+    return 0;
+}
+
+size_t get_active_application_count(void) {
+    return derived_inventory_state_is_available(&application_inventory_state)
+        ? application_inventory.count
+        : 0;
+}
+
+int get_active_application(size_t position, active_application_view_t *view) {
+    if (!derived_inventory_state_is_available(&application_inventory_state) ||
+        !view ||
+        position >= application_inventory.count) {
+        return -1;
+    }
+
+    active_application_t *application =
+        &application_inventory.applications[position];
+    application_classification_t classification =
+        application_classifier_classify_cached(
+            application,
+            &stream_inventory,
+            &config);
+    view->identity_property = application->identity_property;
+    view->identity_value = application->identity_value;
+    view->display_name = application->display_name;
+    view->stream_indexes = application->stream_indexes;
+    view->stream_count = application->stream_count;
+    view->group = classification.group;
+    view->matched_config_index = classification.matched_config_index;
+    return 0;
+}
+
+inventory_snapshot_t *acquire_inventory_snapshot(void) {
+    return inventory_snapshot_acquire(&inventory_snapshots);
+}
+
+void adjust_volume_based_on_chatmix(float chatmix_value) {
+    chatmix_volume_targets_t targets;
+    if (chatmix_volume_targets_calculate(chatmix_value, &targets) != 0) {
+        fprintf(stderr, "Invalid ChatMix value: %.0f\n", chatmix_value);
+        return;
+    }
+
+    last_chatmix_targets = targets;
+    has_valid_chatmix = 1;
+    event_journal_set_clock(&event_journal, monotonic_milliseconds());
+
+    printf("\nChatmix position: %.0f%%", targets.normalized * 100);
+    printf("\nTarget volumes - Game: %.0f%% (%.0f%% logarithmic), Chat: %.0f%% (%.0f%% logarithmic)",
+           targets.game.linear * 100, targets.game.logarithmic * 100,
+           targets.chat.linear * 100, targets.chat.logarithmic * 100);
+
+    audio_backend_apply_chatmix(&targets);
+    printf("\n");
+}
+
+/* Nonzero once the initial server snapshot filled the inventories. */
+static int audio_server_connected(void) {
+    if (application_inventory_state.initial_snapshot_complete) return 1;
+    printf("No audio server connection available\n");
+    return 0;
+}
+
+void list_applications(void) {
+    if (!audio_server_connected()) return;
+
+    for (size_t i = 0; i < stream_inventory.count; i++) {
+        const audio_stream_t *stream = &stream_inventory.streams[i];
+        const audio_stream_properties_t *properties =
+            &stream_inventory.properties[i];
+        if (!properties->application_name) continue;
+
+        printf("Application: %-20s ", properties->application_name);
+        if (stream->volume_known) {
+            printf("Volume: %.0f%%", stream->volume * 100.0f / PA_VOLUME_NORM);
+        } else {
+            printf("Volume: mixed");
+        }
+        printf(" [Index: %u]", stream->index);
+        if (properties->process_binary) {
+            printf(" (Binary: %s)", properties->process_binary);
+        }
+        printf("\n");
+    }
+}
+
+static int is_app_configured(const char* app_name) {
+    for (int i = 0; i < config.count; i++) {
+        if (pattern_matches_text(config.apps[i].name, app_name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void list_unconfigured_applications(void) {
+    if (!audio_server_connected()) return;
+
+    printf("Unconfigured applications:\n");
+    for (size_t i = 0; i < stream_inventory.count; i++) {
+        const char *app_name = stream_inventory.properties[i].application_name;
+        if (app_name && !is_app_configured(app_name)) {
+            printf("%s\n", app_name);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef MIXER_COMMON_H
+#define MIXER_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "chatmix_volume.h"
+#include "classified_volume_routing.h"
+#include "sink_input_request_state.h"
+#include "volume_reconciliation.h"
+#include "../active_application_inventory.h"
+#include "../audio_stream_inventory.h"
+#include "../event_journal.h"
+#include "../memory_usage.h"
+
+/*
+ * State and plumbing shared by the audio backends: the stream and application
+ * inventories, volume routing, drift reconciliation scheduling, inventory
+ * snapshots, the event journal, and the mixer.h functions that only read
+ * them. Each backend (mixer.c for libpulse, pipewire_mixer.c for PipeWire)
+ * keeps its server transport and implements the audio_backend_ hooks below.
+ */
+
+extern audio_stream_inventory_t stream_inventory;
+extern active_application_inventory_t application_inventory;
+extern derived_inventory_state_t application_inventory_state;
+extern chatmix_volume_targets_t last_chatmix_targets;
+extern int has_valid_chatmix;
+extern volume_reconciliation_t volume_reconciliation;
+/* Closed unless open_event_journal() succeeded; appends then do nothing. */
+extern event_journal_t event_journal;
+/* Nonzero when the inventories changed after the last published snapshot. */
+extern int inventory_snapshot_stale;
+
+uint64_t monotonic_milliseconds(void);
+
+/* Resets the shared state; backends call it before connecting. */
+void mixer_common_init(void);
+
+/*
+ * Releases the shared state and closes the event journal; backends call it
+ * after disconnecting.
+ */
+void mixer_common_clear(void);
+
+/*
+ * Marks the initial server snapshot complete and builds the application
+ * inventory from it. Returns 0 on success and -1 after logging a failure
+ * that names server.
+ */
+int mixer_common_finish_initial_snapshot(const char *server);
+
+void journal_rebuild(int succeeded);
+
+/*
+ * Submits the volume of one assignment to the server. Returns 0 when the
+ * write was sent and -1 when it failed.
+ */
+typedef int (*mixer_volume_write_fn)(
+    const classified_volume_assignment_t *assignment,
+    void *userdata);
+
+/*
+ * Writes every assignment that is not already settled through write and
+ * defers those of corked streams, recording both in the event journal.
+ * Returns the number of submitted writes.
+ */
+size_t mixer_apply_classified_volume_plan(
+    const classified_volume_plan_t *plan,
+    mixer_volume_write_fn write,
+    void *userdata);
+
+/*
+ * Plans every application at targets and applies the plan through write.
+ * Returns the number of submitted writes.
+ */
+size_t mixer_route_all_classified_applications(
+    const chatmix_volume_targets_t *targets,
+    mixer_volume_write_fn write,
+    void *userdata);
+
+/*
+ * Returns nonzero when a drift reconciliation pass should start at now_ms,
+ * which needs a wheel position and a synchronized application inventory.
+ */
+int mixer_reconciliation_due(uint64_t now_ms);
+
+/*
+ * Publishes a snapshot when a stream or the configuration changed since the
+ * last one. A failure keeps the inventories marked stale, so the next call
+ * retries. Each snapshot is a new allocation, so fixed-capacity builds
+ * publish none.
+ */
+#ifndef CHATWHEEL_FIXED_CAPACITY
+void publish_inventory_snapshot(void);
+#endif
+
+/* Prints one statistics line for usage and adds it to total when given. */
+void print_memory_usage(const char *name,
+                        const memory_usage_t *usage,
+                        memory_usage_t *total);
+
+/*
+ * Implemented by the backend. adjust_volume_based_on_chatmix() calls
+ * apply_chatmix after storing targets as last_chatmix_targets.
+ * print_audio_server_statistics() calls print_statistics after the shared
+ * reconciliation lines and print_memory_usage after the shared inventories.
+ */
+void audio_backend_apply_chatmix(const chatmix_volume_targets_t *targets);
+void audio_backend_print_statistics(void);
+void audio_backend_print_memory_usage(memory_usage_t *total);
+
+#endif
@@ -0,0 +1,681 @@
+/*
+ * Native PipeWire backend, built with make CHATWHEEL_BACKEND=pipewire instead
+ * of mixer.c. It watches playback stream nodes through the registry and sets
+ * their Props channelVolumes directly, without the pipewire-pulse
+ * translation layer. The inventories, routing, and statistics are shared
+ * with the libpulse backend through mixer_common.c. Experimental: it has
+ * not yet been run against a real PipeWire server.
+ */
+#ifdef CHATWHEEL_FIXED_CAPACITY
+#error "The PipeWire backend does not support CHATWHEEL_FIXED_CAPACITY"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pipewire/pipewire.h>
+#include <spa/param/props.h>
+#include <spa/pod/builder.h>
+#include <spa/pod/iter.h>
+#include "mixer.h"
+#include "mixer_common.h"
+#include "pipewire_volume.h"
+#include "pulse_event_drain.h"
+
+/* Media class of the playback streams whose volumes are routed. */
+#define PIPEWIRE_PLAYBACK_STREAM_CLASS "Stream/Output/Audio"
+#define INITIAL_STREAM_NODE_CAPACITY 8
+#define INITIAL_STREAM_NODE_SLOT_CAPACITY 16
+
+/*
+ * One bound playback stream node. Its properties and channel volumes arrive
+ * in separate events, so they are kept here until both are known and the
+ * stream can be stored in the inventory. Nodes are allocated one by one
+ * because their listener hooks must not move.
+ */
+typedef struct {
+    uint32_t id;
+    struct pw_node *proxy;
+    struct spa_hook listener;
+    /* Owned copies of the properties, indexed by audio_stream_property_t. */
+    char *values[AUDIO_STREAM_PROPERTY_COUNT];
+    int info_received;
+    int corked;
+    unsigned int channel_count;
+    int volume_known;
+    uint32_t volume;
+} pipewire_stream_node_t;
+
+static int pipewire_initialized = 0;
+static struct pw_main_loop *main_loop = NULL;
+static struct pw_loop *loop = NULL;
+static struct pw_context *context = NULL;
+static struct pw_core *core = NULL;
+static struct spa_hook core_listener;
+static struct pw_registry *registry = NULL;
+static struct spa_hook registry_listener;
+/* Sequence number of the last core sync and whether its reply arrived. */
+static int pending_sync = 0;
+static int core_synced = 0;
+/* Set once the server closed the connection; there is no reconnect. */
+static int connection_failed = 0;
+static pipewire_stream_node_t **stream_nodes = NULL;
+static size_t stream_node_count = 0;
+static size_t stream_node_capacity = 0;
+/*
+ * Open-addressing index from node id to position in stream_nodes, using
+ * linear probing. Each slot holds position + 1, and 0 marks an empty slot.
+ * stream_node_slot_capacity is zero or a power of two at least twice
+ * stream_node_count.
+ */
+static size_t *stream_node_slots = NULL;
+static size_t stream_node_slot_capacity = 0;
+/*
+ * Set by the node events of one drain and handled once at its end: streams
+ * were added, removed, or renamed, and streams need routing.
+ */
+static int applications_stale = 0;
+static int routing_needed = 0;
+static uint64_t node_info_count = 0;
+static uint64_t node_volume_count = 0;
+static uint64_t volume_write_count = 0;
+static uint64_t failed_volume_write_count = 0;
+
+static size_t home_slot(uint32_t id, size_t slot_capacity) {
+    /* Node ids are handed out sequentially, so mix them before masking. */
+    id ^= id >> 16;
+    id *= 0x85ebca6bU;
+    id ^= id >> 13;
+    id *= 0xc2b2ae35U;
+    id ^= id >> 16;
+    return (size_t)id & (slot_capacity - 1);
+}
+
+/*
+ * Returns the slot holding id, or the empty slot where it would be inserted.
+ * The slot table must be allocated.
+ */
+static size_t probe_slot(uint32_t id) {
+    size_t mask = stream_node_slot_capacity - 1;
+    size_t slot = home_slot(id, stream_node_slot_capacity);
+    while (stream_node_slots[slot] != 0 &&
+           stream_nodes[stream_node_slots[slot] - 1]->id != id) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static pipewire_stream_node_t *find_stream_node(uint32_t id,
+                                                size_t *position) {
+    if (stream_node_slot_capacity == 0) return NULL;
+
+    size_t slot = probe_slot(id);
+    if (stream_node_slots[slot] == 0) return NULL;
+
+    if (position) *position = stream_node_slots[slot] - 1;
+    return stream_nodes[stream_node_slots[slot] - 1];
+}
+
+/* Rebuilds the slot table with capacity slots. */
+static int resize_slots(size_t capacity) {
+    size_t *slots = calloc(capacity, sizeof(*slots));
+    if (!slots) return -1;
+
+    free(stream_node_slots);
+    stream_node_slots = slots;
+    stream_node_slot_capacity = capacity;
+    for (size_t position = 0; position < stream_node_count; position++) {
+        stream_node_slots[probe_slot(stream_nodes[position]->id)] =
+            position + 1;
+    }
+    return 0;
+}
+
+/*
+ * Empties slot with backward-shift deletion, moving later entries of the
+ * probe run back so lookups never need tombstones.
+ */
+static void erase_slot(size_t slot) {
+    size_t mask = stream_node_slot_capacity - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+
+    while (stream_node_slots[next] != 0) {
+        size_t home = home_slot(stream_nodes[stream_node_slots[next] - 1]->id,
+                                stream_node_slot_capacity);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            stream_node_slots[hole] = stream_node_slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    stream_node_slots[hole] = 0;
+}
+
+static int append_stream_node(pipewire_stream_node_t *node) {
+    if (stream_node_count == stream_node_capacity) {
+        size_t capacity = stream_node_capacity
+            ? stream_node_capacity * 2
+            : INITIAL_STREAM_NODE_CAPACITY;
+        pipewire_stream_node_t **nodes =
+            realloc(stream_nodes, capacity * sizeof(*nodes));
+        if (!nodes) return -1;
+        stream_nodes = nodes;
+        stream_node_capacity = capacity;
+    }
+    if ((stream_node_count + 1) * 2 > stream_node_slot_capacity) {
+        size_t capacity = stream_node_slot_capacity
+            ? stream_node_slot_capacity * 2
+            : INITIAL_STREAM_NODE_SLOT_CAPACITY;
+        if (resize_slots(capacity) != 0) return -1;
+    }
+    stream_node_slots[probe_slot(node->id)] = stream_node_count + 1;
+    stream_nodes[stream_node_count++] = node;
+    return 0;
+}
+
+/*
+ * Drops the node at position from the index and moves the last node into
+ * its place.
+ */
+static void remove_stream_node(size_t position) {
+    erase_slot(probe_slot(stream_nodes[position]->id));
+    size_t last = stream_node_count - 1;
+    if (position != last) {
+        stream_node_slots[probe_slot(stream_nodes[last]->id)] = position + 1;
+        stream_nodes[position] = stream_nodes[last];
+    }
+    stream_node_count = last;
+}
+
+static void destroy_stream_node(pipewire_stream_node_t *node) {
+    spa_hook_remove(&node->listener);
+    pw_proxy_destroy((struct pw_proxy *)node->proxy);
+    for (size_t i = 0; i < AUDIO_STREAM_PROPERTY_COUNT; i++) {
+        free(node->values[i]);
+    }
+    free(node);
+}
+
+/*
+ * Stores node in the stream inventory once both its properties and channel
+ * volumes are known, then records its volume and cork state. A new stream,
+ * changed properties, or an uncorked stream with a deferred write leave
+ * routing for the end of the drain.
+ */
+static void store_stream_node(pipewire_stream_node_t *node,
+                              int identity_changed) {
+    if (!node->info_received || node->channel_count == 0) return;
+
+    const audio_stream_t *stream =
+        audio_stream_inventory_find(&stream_inventory, node->id);
+    int is_new = stream == NULL;
+    if (is_new || identity_changed ||
+        stream->channel_count != node->channel_count) {
+        int result = audio_stream_inventory_upsert_values(
+            &stream_inventory,
+            node->id,
+            node->channel_count,
+            (const char *const *)node->values);
+        event_journal_append(&event_journal,
+                             EVENT_JOURNAL_STREAM_INFO,
+                             node->id,
+                             (uint16_t)(is_new ? EVENT_JOURNAL_INFO_NEW
+                                               : EVENT_JOURNAL_INFO_CHANGED),
+                             node->volume_known ? node->volume : 0,
+                             (uint32_t)result);
+        if (result != 0) {
+            fprintf(stderr, "Failed to store PipeWire stream %u\n", node->id);
+            return;
+        }
+        applications_stale = 1;
+        routing_needed = 1;
+    } else if (stream->volume_known == (node->volume_known != 0) &&
+               (!node->volume_known || stream->volume == node->volume) &&
+               stream->corked == (node->corked != 0)) {
+        return;
+    }
+
+    audio_stream_inventory_set_volume(&stream_inventory,
+                                      node->id,
+                                      node->volume_known,
+                                      node->volume);
+    if (audio_stream_inventory_set_corked(&stream_inventory,
+                                          node->id,
+                                          node->corked) == 1) {
+        routing_needed = 1;
+    }
+    inventory_snapshot_stale = 1;
+}
+
+static void stream_node_info(void *data, const struct pw_node_info *info) {
+    pipewire_stream_node_t *node = data;
+    int identity_changed = 0;
+    node_info_count++;
+
+    if ((info->change_mask & PW_NODE_CHANGE_MASK_PROPS) && info->props) {
+        for (size_t i = 0; i < AUDIO_STREAM_PROPERTY_COUNT; i++) {
+            const char *value =
+                spa_dict_lookup(info->props, audio_stream_property_keys[i]);
+            if (value ? node->values[i] && strcmp(value, node->values[i]) == 0
+                      : !node->values[i]) {
+                continue;
+            }
+            char *copy = value ? strdup(value) : NULL;
+            if (value && !copy) {
+                fprintf(stderr,
+                        "Failed to copy PipeWire stream %u properties\n",
+                        node->id);
+                continue;
+            }
+            free(node->values[i]);
+            node->values[i] = copy;
+            identity_changed = 1;
+        }
+        node->info_received = 1;
+    }
+    if (info->change_mask & PW_NODE_CHANGE_MASK_STATE) {
+        node->corked = info->state != PW_NODE_STATE_RUNNING;
+    }
+    store_stream_node(node, identity_changed);
+}
+
+static void stream_node_param(void *data,
+                              int seq,
+                              uint32_t id,
+                              uint32_t index,
+                              uint32_t next,
+                              const struct spa_pod *param) {
+    (void)seq;
+    (void)index;
+    (void)next;
+    pipewire_stream_node_t *node = data;
+    if (id != SPA_PARAM_Props || !param) return;
+
+    const struct spa_pod_prop *prop =
+        spa_pod_find_prop(param, NULL, SPA_PROP_channelVolumes);
+    if (!prop) return;
+
+    float volumes[PA_CHANNELS_MAX];
+    uint32_t count = spa_pod_copy_array(&prop->value,
+                                        SPA_TYPE_Float,
+                                        volumes,
+                                        PA_CHANNELS_MAX);
+    if (count == 0) return;
+
+    node_volume_count++;
+    node->channel_count = count;
+    node->volume_known = pipewire_volume_uniform(volumes,
+                                                 count,
+                                                 &node->volume);
+    store_stream_node(node, 0);
+}
+
+static const struct pw_node_events stream_node_events = {
+    .version = PW_VERSION_NODE_EVENTS,
+    .info = stream_node_info,
+    .param = stream_node_param,
+};
+
+/* Binds every playback stream node and subscribes to its volumes. */
+static void registry_global(void *data,
+                            uint32_t id,
+                            uint32_t permissions,
+                            const char *type,
+                            uint32_t version,
+                            const struct spa_dict *props) {
+    (void)data;
+    (void)permissions;
+    (void)version;
+    if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0) return;
+    const char *media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+    if (!media_class ||
+        strcmp(media_class, PIPEWIRE_PLAYBACK_STREAM_CLASS) != 0) {
+        return;
+    }
+    /* Ids are unique while bound; a repeated announcement keeps the node. */
+    if (find_stream_node(id, NULL)) return;
+
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_STREAM_NEW,
+                         id,
+                         0,
+                         0,
+                         0);
+    pipewire_stream_node_t *node = calloc(1, sizeof(*node));
+    if (node) {
+        node->id = id;
+        node->proxy = pw_registry_bind(registry,
+                                       id,
+                                       PW_TYPE_INTERFACE_Node,
+                                       PW_VERSION_NODE,
+                                       0);
+    }
+    if (!node || !node->proxy || append_stream_node(node) != 0) {
+        fprintf(stderr, "Failed to track PipeWire stream %u\n", id);
+        if (node && node->proxy) {
+            pw_proxy_destroy((struct pw_proxy *)node->proxy);
+        }
+        free(node);
+        return;
+    }
+
+    pw_node_add_listener(node->proxy,
+                         &node->listener,
+                         &stream_node_events,
+                         node);
+    uint32_t params[] = {SPA_PARAM_Props};
+    pw_node_subscribe_params(node->proxy, params, 1);
+}
+
+static void registry_global_remove(void *data, uint32_t id) {
+    (void)data;
+    size_t position;
+    pipewire_stream_node_t *node = find_stream_node(id, &position);
+    if (!node) return;
+
+    event_journal_append(&event_journal,
+                         EVENT_JOURNAL_STREAM_REMOVED,
+                         id,
+                         0,
+                         0,
+                         0);
+    if (audio_stream_inventory_remove(&stream_inventory, id)) {
+        applications_stale = 1;
+        inventory_snapshot_stale = 1;
+    }
+    remove_stream_node(position);
+    destroy_stream_node(node);
+}
+
+static const struct pw_registry_events registry_events = {
+    .version = PW_VERSION_REGISTRY_EVENTS,
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+static void core_done(void *data, uint32_t id, int seq) {
+    (void)data;
+    if (id == PW_ID_CORE && seq == pending_sync) core_synced = 1;
+}
+
+static void core_error(void *data,
+                       uint32_t id,
+                       int seq,
+                       int res,
+                       const char *message) {
+    (void)data;
+    (void)seq;
+    fprintf(stderr,
+            "PipeWire error on object %u: %s\n",
+            id,
+            message ? message : spa_strerror(res));
+    if (id == PW_ID_CORE && res == -EPIPE) connection_failed = 1;
+}
+
+static const struct pw_core_events core_events = {
+    .version = PW_VERSION_CORE_EVENTS,
+    .done = core_done,
+    .error = core_error,
+};
+
+/* Waits until the server handled every request sent so far. */
+static int sync_pipewire_core(void) {
+    core_synced = 0;
+    pending_sync = pw_core_sync(core, PW_ID_CORE, pending_sync);
+    if (pending_sync < 0) return -1;
+
+    while (!core_synced) {
+        if (connection_failed || pw_loop_iterate(loop, -1) < 0) return -1;
+    }
+    return 0;
+}
+
+static int write_stream_node_volume(uint32_t id,
+                                    unsigned int channel_count,
+                                    pa_volume_t pulse_volume) {
+    pipewire_stream_node_t *node = find_stream_node(id, NULL);
+    if (!node || channel_count == 0 || channel_count > PA_CHANNELS_MAX) {
+        fprintf(stderr, "Failed to submit PipeWire stream %u volume\n", id);
+        return -1;
+    }
+
+    float volumes[PA_CHANNELS_MAX];
+    float factor = pipewire_volume_from_pulse(pulse_volume);
+    for (unsigned int i = 0; i < channel_count; i++) volumes[i] = factor;
+
+    uint8_t buffer[1024];
+    struct spa_pod_builder builder =
+        SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+    const struct spa_pod *props = spa_pod_builder_add_object(
+        &builder,
+        SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+        SPA_PROP_channelVolumes,
+        SPA_POD_Array(sizeof(float), SPA_TYPE_Float, channel_count, volumes));
+    int result = props
+        ? pw_node_set_param(node->proxy, SPA_PARAM_Props, 0, props)
+        : -ENOSPC;
+    if (result < 0) {
+        fprintf(stderr,
+                "Failed to submit PipeWire stream %u volume: %s\n",
+                id,
+                spa_strerror(result));
+        return -1;
+    }
+    return 0;
+}
+
+/* Writes the volume of one assignment and counts the outcome. */
+static int set_stream_node_volume(
+    const classified_volume_assignment_t *assignment,
+    void *userdata) {
+    (void)userdata;
+    if (write_stream_node_volume(assignment->stream_index,
+                                 assignment->channel_count,
+                                 assignment->pulse_volume) != 0) {
+        failed_volume_write_count++;
+        return -1;
+    }
+    volume_write_count++;
+    return 0;
+}
+
+static size_t route_all_classified_applications(
+    const chatmix_volume_targets_t *targets) {
+    return mixer_route_all_classified_applications(targets,
+                                                   set_stream_node_volume,
+                                                   NULL);
+}
+
+/*
+ * Rebuilds the application inventory once for all stream additions,
+ * removals, and renames of a drain, then routes every application with one
+ * plan. Settled streams are skipped by the plan, so only the new, renamed,
+ * or uncorked ones are written. A failed rebuild is retried next drain.
+ */
+static void apply_stream_node_changes(void) {
+    if (applications_stale &&
+        derived_inventory_state_can_rebuild(&application_inventory_state)) {
+        int succeeded = active_application_inventory_rebuild(
+            &application_inventory,
+            &stream_inventory) == 0;
+        journal_rebuild(succeeded);
+        derived_inventory_state_set_rebuild_result(
+            &application_inventory_state,
+            succeeded);
+        if (succeeded) {
+            applications_stale = 0;
+        } else {
+            fprintf(stderr,
+                    "Failed to rebuild active applications after PipeWire "
+                    "events\n");
+        }
+        inventory_snapshot_stale = 1;
+    }
+
+    if (routing_needed && has_valid_chatmix &&
+        derived_inventory_state_is_available(&application_inventory_state)) {
+        route_all_classified_applications(&last_chatmix_targets);
+    }
+    routing_needed = 0;
+}
+
+/*
+ * Periodically rewrites the streams another client moved away from the
+ * current mix. Subscribed nodes push every volume change, so unlike the
+ * libpulse backend a pass reads nothing from the server first.
+ */
+static void reconcile_stream_volumes(void) {
+    uint64_t now = monotonic_milliseconds();
+    if (!mixer_reconciliation_due(now)) return;
+
+    volume_reconciliation_begin(&volume_reconciliation, now);
+    size_t drifted = route_all_classified_applications(&last_chatmix_targets);
+    volume_reconciliation_finish(&volume_reconciliation,
+                                 monotonic_milliseconds(),
+                                 drifted);
+}
+
+int initialize_audio_server(void) {
+    mixer_common_init();
+    applications_stale = 0;
+    routing_needed = 0;
+    connection_failed = 0;
+    node_info_count = 0;
+    node_volume_count = 0;
+    volume_write_count = 0;
+    failed_volume_write_count = 0;
+
+    pw_init(NULL, NULL);
+    pipewire_initialized = 1;
+    main_loop = pw_main_loop_new(NULL);
+    if (!main_loop) goto fail;
+
+    loop = pw_main_loop_get_loop(main_loop);
+    pw_loop_enter(loop);
+    context = pw_context_new(loop, NULL, 0);
+    if (!context) goto fail;
+
+    core = pw_context_connect(context, NULL, 0);
+    if (!core) goto fail;
+    spa_zero(core_listener);
+    pw_core_add_listener(core, &core_listener, &core_events, NULL);
+
+    registry = pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
+    if (!registry) goto fail;
+    spa_zero(registry_listener);
+    pw_registry_add_listener(registry,
+                             &registry_listener,
+                             &registry_events,
+                             NULL);
+
+    // The first roundtrip binds the stream nodes, the second reads them.
+    if (sync_pipewire_core() != 0 || sync_pipewire_core() != 0) goto fail;
+
+    if (mixer_common_finish_initial_snapshot("PipeWire nodes") != 0) {
+        goto fail;
+    }
+    applications_stale = 0;
+    routing_needed = 0;
+
+    publish_inventory_snapshot();
+    return 0;
+
+fail:
+    cleanup_audio_server();
+    return -1;
+}
+
+void cleanup_audio_server(void) {
+    derived_inventory_state_init(&application_inventory_state);
+    for (size_t i = 0; i < stream_node_count; i++) {
+        destroy_stream_node(stream_nodes[i]);
+    }
+    free(stream_nodes);
+    stream_nodes = NULL;
+    stream_node_count = 0;
+    stream_node_capacity = 0;
+    free(stream_node_slots);
+    stream_node_slots = NULL;
+    stream_node_slot_capacity = 0;
+    if (registry) {
+        spa_hook_remove(&registry_listener);
+        pw_proxy_destroy((struct pw_proxy *)registry);
+        registry = NULL;
+    }
+    if (core) {
+        spa_hook_remove(&core_listener);
+        pw_core_disconnect(core);
+        core = NULL;
+    }
+    if (context) {
+        pw_context_destroy(context);
+        context = NULL;
+    }
+    if (main_loop) {
+        pw_loop_leave(loop);
+        pw_main_loop_destroy(main_loop);
+        main_loop = NULL;
+        loop = NULL;
+    }
+    if (pipewire_initialized) {
+        pw_deinit();
+        pipewire_initialized = 0;
+    }
+    mixer_common_clear();
+}
+
+static int iterate_pipewire_loop(void *userdata, int block) {
+    if (connection_failed) return -1;
+    int result = pw_loop_iterate(userdata, block ? -1 : 0);
+    return connection_failed ? -1 : result;
+}
+
+/* Volume writes need no acknowledgement, so there is nothing to reap. */
+static void reap_no_requests(void *userdata) {
+    (void)userdata;
+}
+
+void process_audio_events(void) {
+    if (!loop) return;
+
+    event_journal_set_clock(&event_journal, monotonic_milliseconds());
+    pulse_event_drain_result_t result = pulse_event_drain(
+        iterate_pipewire_loop,
+        loop,
+        reap_no_requests,
+        NULL);
+    if (result == PULSE_EVENT_DRAIN_ERROR) {
+        fprintf(stderr, "Failed to process PipeWire events\n");
+    }
+
+    apply_stream_node_changes();
+    reconcile_stream_volumes();
+    publish_inventory_snapshot();
+}
+
+void audio_backend_print_statistics(void) {
+    printf("PipeWire stream nodes: %zu bound, %" PRIu64 " info and %" PRIu64
+           " volume events, %" PRIu64 " volume writes (%" PRIu64
+           " failed)\n",
+           stream_node_count,
+           node_info_count,
+           node_volume_count,
+           volume_write_count,
+           failed_volume_write_count);
+}
+
+/*
+ * Stream nodes are allocated one by one outside memory_usage accounting, so
+ * only the shared inventories are reported.
+ */
+void audio_backend_print_memory_usage(memory_usage_t *total) {
+    (void)total;
+}
+
+void audio_backend_apply_chatmix(const chatmix_volume_targets_t *targets) {
+    route_all_classified_applications(targets);
+}
@@ -0,0 +1,29 @@
+#include "pipewire_volume.h"
+
+#include <math.h>
+
+float pipewire_volume_from_pulse(pa_volume_t volume) {
+    double factor = (double)volume / PA_VOLUME_NORM;
+    return (float)(factor * factor * factor);
+}
+
+pa_volume_t pipewire_volume_to_pulse(float volume) {
+    if (!(volume > 0.0f)) return PA_VOLUME_MUTED;
+
+    double pulse = cbrt((double)volume) * PA_VOLUME_NORM;
+    if (pulse >= (double)PA_VOLUME_MAX) return PA_VOLUME_MAX;
+    return (pa_volume_t)lround(pulse);
+}
+
+int pipewire_volume_uniform(const float *volumes,
+                            uint32_t count,
+                            uint32_t *volume) {
+    if (!volumes || !volume || count == 0) return 0;
+
+    pa_volume_t first = pipewire_volume_to_pulse(volumes[0]);
+    for (uint32_t i = 1; i < count; i++) {
+        if (pipewire_volume_to_pulse(volumes[i]) != first) return 0;
+    }
+    *volume = first;
+    return 1;
+}
@@ -0,0 +1,30 @@
+#ifndef PIPEWIRE_VOLUME_H
+#define PIPEWIRE_VOLUME_H
+
+#include <stdint.h>
+#include <pulse/volume.h>
+
+/*
+ * PipeWire nodes store channel volumes as linear amplitude factors, while the
+ * volume curve and the stream inventory use PulseAudio volumes, whose cube is
+ * that factor. pipewire-pulse converts the same way, so both backends record
+ * the same volume for one stream.
+ */
+float pipewire_volume_from_pulse(pa_volume_t volume);
+
+/*
+ * Converts one PipeWire channel volume. Zero, negative, and NaN factors are
+ * PA_VOLUME_MUTED, and factors beyond the PulseAudio range PA_VOLUME_MAX.
+ */
+pa_volume_t pipewire_volume_to_pulse(float volume);
+
+/*
+ * Converts count channel volumes. Returns 1 and stores the PulseAudio volume
+ * in *volume when every channel converts to the same value. Returns 0 when
+ * they differ, count is 0, or an argument is NULL; *volume is then unchanged.
+ */
+int pipewire_volume_uniform(const float *volumes,
+                            uint32_t count,
+                            uint32_t *volume);
+
+#endif
@@ -1,29 +1,124 @@
 #include "pulse_stream_lifecycle.h"
 
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t length) {
+    const unsigned char *data = bytes;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static int volume_is_uniform(const pa_cvolume *volume,
+                             unsigned int channel_count) {
+    return volume &&
+        pa_cvolume_valid(volume) &&
+        volume->channels == channel_count &&
+        pa_cvolume_channels_equal_to(volume, volume->values[0]);
+}
+
+uint64_t pulse_stream_lifecycle_fingerprint(unsigned int channel_count,
+                                            const pa_proplist *properties) {
+    uint64_t hash = hash_bytes(
+        FNV_OFFSET_BASIS,
+        &channel_count,
+        sizeof(channel_count));
+
+    for (size_t i = 0; i < AUDIO_STREAM_PROPERTY_COUNT; i++) {
+        const char *value = properties
+            ? pa_proplist_gets(properties, audio_stream_property_keys[i])
+            : NULL;
+        /* A presence marker keeps a missing value apart from an empty one. */
+        unsigned char present = value ? 1 : 0;
+        hash = hash_bytes(hash, &present, sizeof(present));
+        if (value) hash = hash_bytes(hash, value, strlen(value) + 1);
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
 int pulse_stream_lifecycle_record(audio_stream_inventory_t *inventory,
                                   uint32_t index,
                                   unsigned int channel_count,
-                                  const pa_proplist *properties) {
-    const char *application_id = NULL;
-    const char *application_name = NULL;
-    const char *process_binary = NULL;
-    const char *node_name = NULL;
+                                  const pa_proplist *properties,
+                                  const pa_cvolume *volume,
+                                  int corked) {
+    uint64_t fingerprint = pulse_stream_lifecycle_fingerprint(
+        channel_count,
+        properties);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(inventory, index);
+    if (stored && stored->property_fingerprint == fingerprint) {
+        int state_result = pulse_stream_lifecycle_record_state(
+            inventory,
+            index,
+            volume,
+            corked);
+        if (state_result < 0) return -1;
+        return state_result | PULSE_STREAM_RECORD_IDENTITY_UNCHANGED;
+    }
 
+    const char *values[AUDIO_STREAM_PROPERTY_COUNT] = {NULL};
     if (properties) {
-        application_id = pa_proplist_gets(properties, "application.id");
-        application_name = pa_proplist_gets(properties, "application.name");
-        process_binary = pa_proplist_gets(
-            properties,
-            "application.process.binary");
-        node_name = pa_proplist_gets(properties, "node.name");
+        for (size_t i = 0; i < AUDIO_STREAM_PROPERTY_COUNT; i++) {
+            values[i] = pa_proplist_gets(
+                properties,
+                audio_stream_property_keys[i]);
+        }
+    }
+
+    if (audio_stream_inventory_upsert_values(
+            inventory,
+            index,
+            channel_count,
+            values) != 0 ||
+        audio_stream_inventory_set_fingerprint(
+            inventory,
+            index,
+            fingerprint) != 0) {
+        return -1;
     }
 
-    return audio_stream_inventory_upsert(
+    return pulse_stream_lifecycle_record_state(
         inventory,
         index,
-        channel_count,
-        application_id,
-        application_name,
-        process_binary,
-        node_name);
+        volume,
+        corked);
+}
+
+int pulse_stream_lifecycle_record_state(audio_stream_inventory_t *inventory,
+                                        uint32_t index,
+                                        const pa_cvolume *volume,
+                                        int corked) {
+    const audio_stream_t *stream = audio_stream_inventory_find(
+        inventory,
+        index);
+    if (!stream) return -1;
+
+    int volume_known = volume_is_uniform(volume, stream->channel_count);
+    uint32_t recorded_volume = volume_known ? volume->values[0] : 0;
+    int state_changed = stream->volume_known != (volume_known ? 1 : 0) ||
+                        stream->volume != recorded_volume ||
+                        stream->corked != (corked ? 1 : 0);
+    if (audio_stream_inventory_set_volume(
+            inventory,
+            index,
+            volume_known,
+            recorded_volume) != 0) {
+        return -1;
+    }
+
+    int corked_result = audio_stream_inventory_set_corked(
+        inventory,
+        index,
+        corked);
+    if (corked_result < 0) return -1;
+    int result = corked_result == 1 ? PULSE_STREAM_RECORD_UNCORKED_DEFERRED : 0;
+    if (state_changed) result |= PULSE_STREAM_RECORD_STATE_CHANGED;
+    return result;
 }
@@ -2,13 +2,56 @@
 #define PULSE_STREAM_LIFECYCLE_H
 
 #include <pulse/proplist.h>
+#include <pulse/volume.h>
 #include <stdint.h>
 
 #include "../audio_stream_inventory.h"
 
+/* Bits of a successful pulse_stream_lifecycle_record() result. */
+#define PULSE_STREAM_RECORD_UNCORKED_DEFERRED 1
+#define PULSE_STREAM_RECORD_IDENTITY_UNCHANGED 2
+#define PULSE_STREAM_RECORD_STATE_CHANGED 4
+
+/*
+ * Returns a 64-bit digest of channel_count and the identity properties the
+ * inventory stores: application.id, application.name,
+ * application.process.binary, and node.name. Missing and empty values are
+ * distinguished. The result is never 0, so 0 can mark an unknown fingerprint.
+ */
+uint64_t pulse_stream_lifecycle_fingerprint(unsigned int channel_count,
+                                            const pa_proplist *properties);
+
+/*
+ * Upserts one sink input and records its current volume and cork state. A
+ * NULL volume, an invalid one, a channel count that differs from
+ * channel_count, or differing channel values record the volume as unknown.
+ *
+ * When the stream is already stored with the same fingerprint, its
+ * properties are left in place without allocating and the result includes
+ * PULSE_STREAM_RECORD_IDENTITY_UNCHANGED, so derived state does not need to
+ * be rebuilt. The result includes PULSE_STREAM_RECORD_UNCORKED_DEFERRED when
+ * the stream was uncorked while a volume write was deferred, and
+ * PULSE_STREAM_RECORD_STATE_CHANGED when its recorded volume or cork state
+ * differs from before. Returns -1 on failure.
+ */
 int pulse_stream_lifecycle_record(audio_stream_inventory_t *inventory,
                                   uint32_t index,
                                   unsigned int channel_count,
-                                  const pa_proplist *properties);
+                                  const pa_proplist *properties,
+                                  const pa_cvolume *volume,
+                                  int corked);
+
+/*
+ * Records the volume and cork state of an already stored sink input without
+ * touching its properties, using the stored channel count for the uniformity
+ * check. Returns PULSE_STREAM_RECORD_UNCORKED_DEFERRED and
+ * PULSE_STREAM_RECORD_STATE_CHANGED bits like pulse_stream_lifecycle_record();
+ * an index that is not stored returns -1 and
+ * is not added.
+ */
+int pulse_stream_lifecycle_record_state(audio_stream_inventory_t *inventory,
+                                        uint32_t index,
+                                        const pa_cvolume *volume,
+                                        int corked);
 
 #endif
@@ -0,0 +1,135 @@
+#include "sink_input_request_pool.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../fixed_pool.h"
+
+struct sink_input_request_chunk {
+    sink_input_request_chunk_t *next;
+    size_t count;
+    sink_input_info_request_t requests[];
+};
+
+/* Fixed-capacity builds take every request from a single static chunk. */
+#ifdef CHATWHEEL_FIXED_CAPACITY
+#define INITIAL_CHUNK_CAPACITY CHATWHEEL_MAX_PENDING_REQUESTS
+#else
+#define INITIAL_CHUNK_CAPACITY 8
+#endif
+
+FIXED_POOL_DEFINE(chunk_pool,
+                  sizeof(sink_input_request_chunk_t) +
+                      CHATWHEEL_MAX_PENDING_REQUESTS *
+                          sizeof(sink_input_info_request_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+/* Adds a chunk as large as the current capacity to the free list. */
+static int grow(sink_input_request_pool_t *pool) {
+    size_t count = pool->capacity > 0
+        ? pool->capacity
+        : INITIAL_CHUNK_CAPACITY;
+    if (count > (SIZE_MAX - sizeof(sink_input_request_chunk_t)) /
+            sizeof(sink_input_info_request_t)) {
+        return -1;
+    }
+
+    size_t bytes = sizeof(sink_input_request_chunk_t) +
+        count * sizeof(sink_input_info_request_t);
+    sink_input_request_chunk_t *chunk = POOL_MALLOC(chunk_pool, bytes);
+    if (!chunk) return -1;
+
+    chunk->next = pool->chunks;
+    chunk->count = count;
+    pool->chunks = chunk;
+    for (size_t i = count; i > 0; i--) {
+        chunk->requests[i - 1].queue_next = pool->free_requests;
+        pool->free_requests = &chunk->requests[i - 1];
+    }
+    pool->capacity += count;
+    memory_usage_set(&pool->memory, pool->memory.bytes + bytes);
+    return 0;
+}
+
+void sink_input_request_pool_init(sink_input_request_pool_t *pool) {
+    if (!pool) return;
+    *pool = (sink_input_request_pool_t){0};
+}
+
+sink_input_info_request_t *sink_input_request_pool_acquire(
+    sink_input_request_pool_t *pool) {
+    if (!pool) return NULL;
+    if (!pool->free_requests && grow(pool) != 0) return NULL;
+
+    sink_input_info_request_t *request = pool->free_requests;
+    pool->free_requests = request->queue_next;
+    *request = (sink_input_info_request_t){
+        .live_next = pool->live,
+    };
+    if (pool->live) pool->live->live_previous = request;
+    pool->live = request;
+    pool->live_count++;
+    return request;
+}
+
+void sink_input_request_pool_complete(sink_input_request_pool_t *pool,
+                                      sink_input_info_request_t *request) {
+    if (!pool || !request || request->completed) return;
+
+    request->completed = 1;
+    request->queue_next = NULL;
+    if (pool->completed_tail) {
+        pool->completed_tail->queue_next = request;
+    } else {
+        pool->completed_head = request;
+    }
+    pool->completed_tail = request;
+}
+
+sink_input_info_request_t *sink_input_request_pool_take_completed(
+    sink_input_request_pool_t *pool) {
+    if (!pool || !pool->completed_head) return NULL;
+
+    sink_input_info_request_t *request = pool->completed_head;
+    pool->completed_head = request->queue_next;
+    if (!pool->completed_head) pool->completed_tail = NULL;
+    request->queue_next = NULL;
+    return request;
+}
+
+void sink_input_request_pool_release(sink_input_request_pool_t *pool,
+                                     sink_input_info_request_t *request) {
+    if (!pool || !request) return;
+
+    if (request->live_previous) {
+        request->live_previous->live_next = request->live_next;
+    } else {
+        pool->live = request->live_next;
+    }
+    if (request->live_next) {
+        request->live_next->live_previous = request->live_previous;
+    }
+    pool->live_count--;
+
+    request->queue_next = pool->free_requests;
+    pool->free_requests = request;
+}
+
+sink_input_info_request_t *sink_input_request_from_token(
+    sink_input_request_token_t *token) {
+    if (!token) return NULL;
+    return (sink_input_info_request_t *)(
+        (char *)token - offsetof(sink_input_info_request_t, token));
+}
+
+void sink_input_request_pool_clear(sink_input_request_pool_t *pool) {
+    if (!pool) return;
+
+    sink_input_request_chunk_t *chunk = pool->chunks;
+    while (chunk) {
+        sink_input_request_chunk_t *next = chunk->next;
+        POOL_FREE(chunk_pool, chunk);
+        chunk = next;
+    }
+    sink_input_request_pool_init(pool);
+}
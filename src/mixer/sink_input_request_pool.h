@@ -0,0 +1,94 @@
+#ifndef SINK_INPUT_REQUEST_POOL_H
+#define SINK_INPUT_REQUEST_POOL_H
+
+#include <stddef.h>
+
+#include "sink_input_request_state.h"
+#include "../memory_usage.h"
+
+struct pa_operation;
+
+/*
+ * One stream information request in flight. token comes first, so a token
+ * found through the request tracker converts back with
+ * sink_input_request_from_token(). The links belong to the pool.
+ */
+typedef struct sink_input_info_request {
+    sink_input_request_token_t token;
+    struct pa_operation *operation;
+    int result_received;
+    /* Nonzero once the request was queued as completed. */
+    int completed;
+    /* Next request on the free list or the completion queue. */
+    struct sink_input_info_request *queue_next;
+    /* Neighbours among the acquired requests. */
+    struct sink_input_info_request *live_previous;
+    struct sink_input_info_request *live_next;
+} sink_input_info_request_t;
+
+typedef struct sink_input_request_chunk sink_input_request_chunk_t;
+
+/*
+ * Requests carved from chunks that are kept until clear(), so a request costs
+ * no allocation once the pool has grown to the peak number in flight. Each
+ * chunk doubles the capacity. Callbacks queue requests whose operations
+ * finished, so reaping visits only completed requests instead of polling
+ * every request in flight.
+ */
+typedef struct {
+    sink_input_request_chunk_t *chunks;
+    sink_input_info_request_t *free_requests;
+    sink_input_info_request_t *completed_head;
+    sink_input_info_request_t *completed_tail;
+    sink_input_info_request_t *live;
+    size_t live_count;
+    size_t capacity;
+    /* The chunks, which never shrink before clear(). */
+    memory_usage_t memory;
+} sink_input_request_pool_t;
+
+/*
+ * Initializes a new pool or one reset by clear(). Calling init() on a pool
+ * that owns chunks leaks them.
+ */
+void sink_input_request_pool_init(sink_input_request_pool_t *pool);
+
+/*
+ * Returns a zeroed request that counts as live until it is released, or NULL
+ * for invalid arguments or allocation failure.
+ */
+sink_input_info_request_t *sink_input_request_pool_acquire(
+    sink_input_request_pool_t *pool);
+
+/*
+ * Queues a live request whose operation finished, behind the requests
+ * completed before it. Repeated calls queue it once.
+ */
+void sink_input_request_pool_complete(sink_input_request_pool_t *pool,
+                                      sink_input_info_request_t *request);
+
+/*
+ * Removes and returns the oldest completed request, or NULL when none is
+ * queued. The request stays live until the caller releases it.
+ */
+sink_input_info_request_t *sink_input_request_pool_take_completed(
+    sink_input_request_pool_t *pool);
+
+/*
+ * Returns a live request to the pool. A request still queued as completed
+ * must be taken first. NULL is ignored.
+ */
+void sink_input_request_pool_release(sink_input_request_pool_t *pool,
+                                     sink_input_info_request_t *request);
+
+/* Returns the request that embeds token, or NULL for a NULL token. */
+sink_input_info_request_t *sink_input_request_from_token(
+    sink_input_request_token_t *token);
+
+/*
+ * Frees every chunk, invalidating all requests, and resets the pool.
+ * Repeated calls are safe.
+ */
+void sink_input_request_pool_clear(sink_input_request_pool_t *pool);
+
+#endif
@@ -4,79 +4,140 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../fixed_pool.h"
+
 #define INITIAL_INDEX_CAPACITY 4
 
+/*
+ * Each index in a fixed-capacity tracker has a request in flight, and the
+ * table needs a second block while it is rebuilt.
+ */
+FIXED_POOL_DEFINE(index_pool,
+                  2 * CHATWHEEL_MAX_PENDING_REQUESTS *
+                      sizeof(sink_input_index_generation_t),
+                  2 * CHATWHEEL_FIXED_INSTANCES)
+
+static size_t home_slot(uint32_t index, size_t capacity) {
+    /* Sink input indexes are sequential, so mix them before masking. */
+    index ^= index >> 16;
+    index *= 0x85ebca6bU;
+    index ^= index >> 13;
+    index *= 0xc2b2ae35U;
+    index ^= index >> 16;
+    return (size_t)index & (capacity - 1);
+}
+
+/*
+ * Returns the slot holding index, or the empty slot where it would be
+ * inserted. The table must be allocated.
+ */
+static size_t probe_slot(const sink_input_index_generation_t *indexes,
+                         size_t capacity,
+                         uint32_t index) {
+    size_t mask = capacity - 1;
+    size_t slot = home_slot(index, capacity);
+    while (indexes[slot].request_count != 0 && indexes[slot].index != index) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
 static sink_input_index_generation_t *find_index(
     const sink_input_request_tracker_t *tracker,
     uint32_t index) {
-    for (size_t i = 0; i < tracker->index_count; i++) {
-        if (tracker->indexes[i].index == index) return &tracker->indexes[i];
-    }
+    if (tracker->index_capacity == 0) return NULL;
 
-    return NULL;
+    sink_input_index_generation_t *entry = &tracker->indexes[probe_slot(
+        tracker->indexes,
+        tracker->index_capacity,
+        index)];
+    return entry->request_count != 0 ? entry : NULL;
 }
 
-static int ensure_index_capacity(sink_input_request_tracker_t *tracker) {
-    if (tracker->index_count < tracker->index_capacity) return 0;
-
-    size_t new_capacity = INITIAL_INDEX_CAPACITY;
-    if (tracker->index_capacity > 0) {
-        if (tracker->index_capacity > SIZE_MAX / 2) return -1;
-        new_capacity = tracker->index_capacity * 2;
+/* Rehashes every index into a new table of new_capacity slots. */
+static int resize_indexes(void *container, size_t new_capacity) {
+    sink_input_request_tracker_t *tracker = container;
+    sink_input_index_generation_t *indexes = POOL_CALLOC(
+        index_pool,
+        new_capacity,
+        sizeof(*indexes));
+    if (!indexes) return -1;
+
+    for (size_t i = 0; i < tracker->index_capacity; i++) {
+        const sink_input_index_generation_t *entry = &tracker->indexes[i];
+        if (entry->request_count == 0) continue;
+        indexes[probe_slot(indexes, new_capacity, entry->index)] = *entry;
     }
-    if (new_capacity > SIZE_MAX / sizeof(*tracker->indexes)) return -1;
-
-    sink_input_index_generation_t *resized = realloc(
-        tracker->indexes,
-        new_capacity * sizeof(*tracker->indexes));
-    if (!resized) return -1;
 
-    tracker->indexes = resized;
+    POOL_FREE(index_pool, tracker->indexes);
+    tracker->indexes = indexes;
     tracker->index_capacity = new_capacity;
+    memory_usage_set(
+        &tracker->memory,
+        new_capacity * sizeof(*tracker->indexes));
     return 0;
 }
 
-static int token_is_registered(
-    const sink_input_request_tracker_t *tracker,
-    const sink_input_request_token_t *token) {
-    for (const sink_input_request_token_t *current = tracker->requests;
-         current;
-         current = current->next) {
-        if (current == token) return 1;
-    }
+static int ensure_index_capacity(sink_input_request_tracker_t *tracker) {
+    if (tracker->index_count > SIZE_MAX / 4) return -1;
+    if ((tracker->index_count + 1) * 2 <= tracker->index_capacity) return 0;
 
-    return 0;
+    size_t new_capacity = tracker->index_capacity > 0
+        ? tracker->index_capacity * 2
+        : INITIAL_INDEX_CAPACITY;
+    if (new_capacity > SIZE_MAX / sizeof(*tracker->indexes)) return -1;
+    return resize_indexes(tracker, new_capacity);
 }
 
-static int index_has_requests(
-    const sink_input_request_tracker_t *tracker,
-    uint32_t index) {
-    for (const sink_input_request_token_t *token = tracker->requests;
-         token;
-         token = token->next) {
-        if (token->index == index) return 1;
+/*
+ * Empties the slot of entry with backward-shift deletion, moving later
+ * entries of the probe run back so lookups never need tombstones.
+ */
+static void erase_index(sink_input_request_tracker_t *tracker,
+                        sink_input_index_generation_t *entry) {
+    size_t mask = tracker->index_capacity - 1;
+    size_t hole = (size_t)(entry - tracker->indexes);
+    size_t next = (hole + 1) & mask;
+
+    while (tracker->indexes[next].request_count != 0) {
+        size_t home = home_slot(
+            tracker->indexes[next].index,
+            tracker->index_capacity);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            tracker->indexes[hole] = tracker->indexes[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
     }
 
-    return 0;
-}
+    tracker->indexes[hole] = (sink_input_index_generation_t){0};
+    tracker->index_count--;
 
-static void remove_unused_index(
-    sink_input_request_tracker_t *tracker,
-    uint32_t index) {
-    if (index_has_requests(tracker, index)) return;
-
-    for (size_t i = 0; i < tracker->index_count; i++) {
-        if (tracker->indexes[i].index != index) continue;
+    memory_usage_shrink(&tracker->memory,
+                        tracker,
+                        resize_indexes,
+                        tracker->index_count * 2,
+                        tracker->index_capacity,
+                        INITIAL_INDEX_CAPACITY);
+}
 
-        if (i + 1 < tracker->index_count) {
-            memmove(
-                &tracker->indexes[i],
-                &tracker->indexes[i + 1],
-                (tracker->index_count - i - 1) * sizeof(*tracker->indexes));
-        }
-        tracker->index_count--;
-        return;
+/*
+ * Unlinks a token registered for index_state and marks it as no longer
+ * current.
+ */
+static void detach_token(sink_input_index_generation_t *index_state,
+                         sink_input_request_token_t *token) {
+    if (token->previous) {
+        token->previous->next = token->next;
+    } else {
+        index_state->requests = token->next;
     }
+    if (token->next) token->next->previous = token->previous;
+
+    token->invalidated = 1;
+    token->tracker = NULL;
+    token->previous = NULL;
+    token->next = NULL;
 }
 
 void sink_input_request_tracker_init(sink_input_request_tracker_t *tracker) {
@@ -91,47 +152,91 @@ int sink_input_request_tracker_begin(
     sink_input_request_token_t *token) {
     if (!tracker || !token ||
         (intent != SINK_INPUT_REQUEST_NEW &&
-         intent != SINK_INPUT_REQUEST_CHANGE) ||
-        token_is_registered(tracker, token)) {
+         intent != SINK_INPUT_REQUEST_CHANGE)) {
         return -1;
     }
 
     sink_input_index_generation_t *index_state = find_index(tracker, index);
+    if (index_state && index_state->request_count == UINT32_MAX) return -1;
     if (!index_state) {
         if (ensure_index_capacity(tracker) != 0) return -1;
-        index_state = &tracker->indexes[tracker->index_count];
+        index_state = &tracker->indexes[probe_slot(
+            tracker->indexes,
+            tracker->index_capacity,
+            index)];
         *index_state = (sink_input_index_generation_t){
             .index = index,
             .generation = 0,
         };
         tracker->index_count++;
     }
+    index_state->request_count++;
 
     *token = (sink_input_request_token_t){
         .index = index,
         .generation = index_state->generation,
         .intent = intent,
-        .next = tracker->requests,
+        .tracker = tracker,
+        .next = index_state->requests,
     };
-    tracker->requests = token;
+    if (index_state->requests) index_state->requests->previous = token;
+    index_state->requests = token;
     return 0;
 }
 
+int sink_input_request_tracker_coalesce(
+    sink_input_request_tracker_t *tracker,
+    uint32_t index,
+    sink_input_request_intent_t intent) {
+    if (!tracker) return 0;
+
+    sink_input_index_generation_t *index_state = find_index(tracker, index);
+    /* The newest token is current whenever any token of the index is. */
+    if (!index_state ||
+        index_state->requests->generation != index_state->generation) {
+        return 0;
+    }
+
+    if (!index_state->dirty || intent == SINK_INPUT_REQUEST_NEW) {
+        index_state->dirty_intent = intent;
+    }
+    index_state->dirty = 1;
+    tracker->coalesced_count++;
+    return 1;
+}
+
+int sink_input_request_tracker_take_follow_up(
+    sink_input_request_tracker_t *tracker,
+    const sink_input_request_token_t *token,
+    sink_input_request_intent_t *intent) {
+    if (!intent || !sink_input_request_tracker_is_current(tracker, token)) {
+        return 0;
+    }
+
+    sink_input_index_generation_t *index_state = find_index(
+        tracker,
+        token->index);
+    if (!index_state->dirty) return 0;
+
+    *intent = index_state->dirty_intent;
+    index_state->dirty = 0;
+    tracker->follow_up_count++;
+    return 1;
+}
+
 void sink_input_request_tracker_invalidate(
     sink_input_request_tracker_t *tracker,
     uint32_t index) {
     if (!tracker) return;
 
-    for (sink_input_request_token_t *token = tracker->requests;
-         token;
-         token = token->next) {
-        if (token->index == index) token->invalidated = 1;
-    }
-
     sink_input_index_generation_t *index_state = find_index(tracker, index);
     if (index_state) {
-        /* Unsigned wrap is safe because all older live tokens are invalidated. */
+        /*
+         * Every registered token of the index holds an older generation now.
+         * Wrapping would take 2^64 invalidations while one request is live.
+         */
         index_state->generation++;
+        index_state->dirty = 0;
     }
 }
 
@@ -139,7 +244,7 @@ int sink_input_request_tracker_is_current(
     const sink_input_request_tracker_t *tracker,
     const sink_input_request_token_t *token) {
     if (!tracker || !token || token->invalidated ||
-        !token_is_registered(tracker, token)) {
+        token->tracker != tracker) {
         return 0;
     }
 
@@ -149,36 +254,41 @@ int sink_input_request_tracker_is_current(
     return index_state && index_state->generation == token->generation;
 }
 
+sink_input_request_token_t *sink_input_request_tracker_first_request(
+    const sink_input_request_tracker_t *tracker,
+    uint32_t index) {
+    if (!tracker) return NULL;
+
+    sink_input_index_generation_t *index_state = find_index(tracker, index);
+    return index_state ? index_state->requests : NULL;
+}
+
 void sink_input_request_tracker_finish(
     sink_input_request_tracker_t *tracker,
     sink_input_request_token_t *token) {
-    if (!tracker || !token) return;
+    if (!tracker || !token || token->tracker != tracker) return;
 
-    sink_input_request_token_t **position = &tracker->requests;
-    while (*position && *position != token) {
-        position = &(*position)->next;
-    }
-    if (!*position) return;
+    sink_input_index_generation_t *index_state = find_index(
+        tracker,
+        token->index);
+    if (!index_state) return;
 
-    uint32_t index = token->index;
-    *position = token->next;
-    token->invalidated = 1;
-    token->next = NULL;
-    remove_unused_index(tracker, index);
+    if (token->generation == index_state->generation) index_state->dirty = 0;
+    detach_token(index_state, token);
+    if (--index_state->request_count == 0) erase_index(tracker, index_state);
 }
 
 void sink_input_request_tracker_clear(sink_input_request_tracker_t *tracker) {
     if (!tracker) return;
 
-    sink_input_request_token_t *token = tracker->requests;
-    while (token) {
-        sink_input_request_token_t *next = token->next;
-        token->invalidated = 1;
-        token->next = NULL;
-        token = next;
+    for (size_t i = 0; i < tracker->index_capacity; i++) {
+        sink_input_index_generation_t *index_state = &tracker->indexes[i];
+        while (index_state->requests) {
+            detach_token(index_state, index_state->requests);
+        }
     }
 
-    free(tracker->indexes);
+    POOL_FREE(index_pool, tracker->indexes);
     sink_input_request_tracker_init(tracker);
 }
 
@@ -4,37 +4,69 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "../memory_usage.h"
+
 typedef enum {
     SINK_INPUT_REQUEST_NEW,
     SINK_INPUT_REQUEST_CHANGE
 } sink_input_request_intent_t;
 
+struct sink_input_request_tracker;
+
+/*
+ * A request for one stream's information. The caller owns the token; the
+ * tracker and the links below belong to the tracker while it is registered.
+ */
 typedef struct sink_input_request_token {
     uint32_t index;
     uint64_t generation;
     sink_input_request_intent_t intent;
     int invalidated;
+    struct sink_input_request_tracker *tracker;
+    struct sink_input_request_token *previous;
     struct sink_input_request_token *next;
 } sink_input_request_token_t;
 
+/*
+ * The current generation of an index and its request_count registered
+ * requests, linked from requests through the tokens. dirty is set when events
+ * were coalesced into the current request, with the intent the follow-up
+ * request needs. Indexes without requests are not stored.
+ */
 typedef struct {
     uint32_t index;
+    uint32_t request_count;
     uint64_t generation;
+    sink_input_request_token_t *requests;
+    int dirty;
+    sink_input_request_intent_t dirty_intent;
 } sink_input_index_generation_t;
 
 /*
  * Tracks caller-owned request tokens. Tokens must remain alive while they are
  * registered, until finish() or clear() detaches them. Index-generation storage
- * is owned by the tracker and released by clear().
+ * is owned by the tracker and released by clear(). The registered tokens of
+ * each index form a doubly linked list through the tokens themselves, so
+ * begin, invalidate, is_current, and finish take constant time however many
+ * requests are in flight.
  *
  * A tracker must be initialized before use. Its fields are implementation
  * state; manually constructed or otherwise malformed states are unsupported.
  */
-typedef struct {
+typedef struct sink_input_request_tracker {
+    /*
+     * Open-addressing table of indexes with linear probing, where a zero
+     * request_count marks an empty slot. index_capacity is zero or a power of
+     * two at least twice index_count.
+     */
     sink_input_index_generation_t *indexes;
     size_t index_count;
     size_t index_capacity;
-    sink_input_request_token_t *requests;
+    /* The index table, shrunk once it is at most a quarter full. */
+    memory_usage_t memory;
+    /* Requests coalesced into one in flight, and the follow-ups taken. */
+    uint64_t coalesced_count;
+    uint64_t follow_up_count;
 } sink_input_request_tracker_t;
 
 /*
@@ -44,7 +76,8 @@ typedef struct {
 void sink_input_request_tracker_init(sink_input_request_tracker_t *tracker);
 
 /*
- * Registers token for the index's current generation. The caller must keep
+ * Registers token for the index's current generation. token must not be
+ * registered already; its previous contents are ignored. The caller must keep
  * token alive until sink_input_request_tracker_finish() or clear() is called.
  * Returns 0 on success and -1 for invalid arguments or allocation failure.
  */
@@ -55,8 +88,33 @@ int sink_input_request_tracker_begin(
     sink_input_request_token_t *token);
 
 /*
- * Invalidates every registered request for index and advances its generation.
- * Repeated invalidation of the same index is safe.
+ * Coalesces a request for index into the current request in flight for it.
+ * When there is one, the index is marked dirty and 1 is returned; the caller
+ * sends nothing and takes the follow-up once the current request completes.
+ * A NEW intent is kept over CHANGE, so the follow-up still routes the stream.
+ * Returns 0 when the caller should send the request itself.
+ */
+int sink_input_request_tracker_coalesce(
+    sink_input_request_tracker_t *tracker,
+    uint32_t index,
+    sink_input_request_intent_t intent);
+
+/*
+ * Takes the follow-up of a dirty index once its current request token
+ * completed, clearing the mark and storing the follow-up's intent. Returns 1
+ * when the caller should send one more request for the index, and 0 when
+ * token is stale or nothing was coalesced. Call it before finish(), which
+ * drops a follow-up that was not taken.
+ */
+int sink_input_request_tracker_take_follow_up(
+    sink_input_request_tracker_t *tracker,
+    const sink_input_request_token_t *token,
+    sink_input_request_intent_t *intent);
+
+/*
+ * Invalidates every registered request for index by advancing its
+ * generation and drops its follow-up. Repeated invalidation of the same index
+ * is safe.
  */
 void sink_input_request_tracker_invalidate(
     sink_input_request_tracker_t *tracker,
@@ -68,8 +126,18 @@ int sink_input_request_tracker_is_current(
     const sink_input_request_token_t *token);
 
 /*
- * Unregisters token. Repeated calls, a token detached by clear(), and an
- * unknown token are safe no-ops.
+ * Returns the most recently registered token for index, or NULL. The other
+ * tokens of the index follow through next. The list must not be changed
+ * while it is walked.
+ */
+sink_input_request_token_t *sink_input_request_tracker_first_request(
+    const sink_input_request_tracker_t *tracker,
+    uint32_t index);
+
+/*
+ * Unregisters token, dropping the follow-up of its index if token was
+ * current. Repeated calls, a token detached by clear(), and an unknown token
+ * are safe no-ops.
  */
 void sink_input_request_tracker_finish(
     sink_input_request_tracker_t *tracker,
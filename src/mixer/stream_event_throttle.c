@@ -0,0 +1,448 @@
+#include "stream_event_throttle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fixed_pool.h"
+
+#define INITIAL_STREAM_CAPACITY 8
+#define INITIAL_CLIENT_CAPACITY 4
+#define TOKENS_PER_EVENT 1000U
+
+/*
+ * A fixed-capacity throttle tracks the kept streams, and room for twice as
+ * many clients covers one per stream plus the retained ones that left.
+ */
+FIXED_POOL_DEFINE(stream_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(stream_event_stream_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(client_pool,
+                  2 * CHATWHEEL_MAX_STREAMS * sizeof(stream_event_client_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+static void update_memory_usage(stream_event_throttle_t *throttle) {
+    memory_usage_set(
+        &throttle->memory,
+        throttle->stream_capacity * sizeof(*throttle->streams) +
+            throttle->client_capacity * sizeof(*throttle->clients));
+}
+
+static int resize_streams(void *container, size_t new_capacity) {
+    stream_event_throttle_t *throttle = container;
+    if (new_capacity > SIZE_MAX / sizeof(*throttle->streams)) return -1;
+
+    stream_event_stream_t *streams = POOL_REALLOC(
+        stream_pool,
+        throttle->streams,
+        new_capacity * sizeof(*streams));
+    if (!streams) return -1;
+
+    throttle->streams = streams;
+    throttle->stream_capacity = new_capacity;
+    update_memory_usage(throttle);
+    return 0;
+}
+
+static int resize_clients(void *container, size_t new_capacity) {
+    stream_event_throttle_t *throttle = container;
+    if (new_capacity > SIZE_MAX / sizeof(*throttle->clients)) return -1;
+
+    stream_event_client_t *clients = POOL_REALLOC(
+        client_pool,
+        throttle->clients,
+        new_capacity * sizeof(*clients));
+    if (!clients) return -1;
+
+    throttle->clients = clients;
+    throttle->client_capacity = new_capacity;
+    update_memory_usage(throttle);
+    return 0;
+}
+
+static size_t grown_capacity(size_t capacity, size_t initial_capacity) {
+    if (capacity == 0) return initial_capacity;
+    if (capacity > SIZE_MAX / 2) return 0;
+    return capacity * 2;
+}
+
+static void bucket_fill(stream_event_bucket_t *bucket,
+                        unsigned int burst,
+                        unsigned int rate,
+                        uint64_t now_ms) {
+    if (now_ms <= bucket->refilled_ms) return;
+
+    uint64_t capacity = (uint64_t)burst * TOKENS_PER_EVENT;
+    uint64_t elapsed_ms = now_ms - bucket->refilled_ms;
+    /* An event per second refills a thousandth of an event per millisecond. */
+    uint64_t gained = elapsed_ms >= capacity / rate
+        ? capacity
+        : elapsed_ms * rate;
+    bucket->tokens = capacity - bucket->tokens <= gained
+        ? capacity
+        : bucket->tokens + gained;
+    bucket->refilled_ms = now_ms;
+}
+
+static void bucket_init(stream_event_bucket_t *bucket,
+                        unsigned int burst,
+                        uint64_t now_ms) {
+    bucket->tokens = (uint64_t)burst * TOKENS_PER_EVENT;
+    bucket->refilled_ms = now_ms;
+}
+
+static int bucket_take(stream_event_bucket_t *bucket) {
+    if (bucket->tokens < TOKENS_PER_EVENT) return 0;
+    bucket->tokens -= TOKENS_PER_EVENT;
+    return 1;
+}
+
+/* Refills the stream's bucket and releases it once the bucket is full. */
+static void refresh_stream(stream_event_throttle_t *throttle,
+                           stream_event_stream_t *stream,
+                           uint64_t now_ms) {
+    bucket_fill(&stream->bucket,
+                STREAM_EVENT_THROTTLE_STREAM_BURST,
+                STREAM_EVENT_THROTTLE_STREAM_RATE,
+                now_ms);
+    if (stream->throttled &&
+        stream->bucket.tokens ==
+            (uint64_t)STREAM_EVENT_THROTTLE_STREAM_BURST * TOKENS_PER_EVENT) {
+        stream->throttled = 0;
+        throttle->released_stream_count++;
+    }
+}
+
+static void refresh_client(stream_event_throttle_t *throttle,
+                           stream_event_client_t *client,
+                           uint64_t now_ms) {
+    if (!client) return;
+
+    bucket_fill(&client->bucket,
+                STREAM_EVENT_THROTTLE_CLIENT_BURST,
+                STREAM_EVENT_THROTTLE_CLIENT_RATE,
+                now_ms);
+    if (client->throttled &&
+        client->bucket.tokens ==
+            (uint64_t)STREAM_EVENT_THROTTLE_CLIENT_BURST * TOKENS_PER_EVENT) {
+        client->throttled = 0;
+        throttle->released_client_count++;
+    }
+}
+
+/*
+ * Returns the position of index, or of the first stream after it in
+ * *position when it is not tracked.
+ */
+static int find_stream_position(const stream_event_throttle_t *throttle,
+                                uint32_t index,
+                                size_t *position) {
+    size_t low = 0;
+    size_t high = throttle->stream_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (throttle->streams[middle].index < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *position = low;
+    return low < throttle->stream_count &&
+        throttle->streams[low].index == index;
+}
+
+/* New indexes are usually the highest, so insertion mostly appends. */
+static stream_event_stream_t *find_or_add_stream(
+    stream_event_throttle_t *throttle,
+    uint32_t index,
+    uint64_t now_ms) {
+    size_t position;
+    if (find_stream_position(throttle, index, &position)) {
+        return &throttle->streams[position];
+    }
+    if (throttle->stream_count == throttle->stream_capacity) {
+        size_t new_capacity = grown_capacity(throttle->stream_capacity,
+                                             INITIAL_STREAM_CAPACITY);
+        if (new_capacity == 0 || resize_streams(throttle, new_capacity) != 0) {
+            return NULL;
+        }
+    }
+
+    memmove(&throttle->streams[position + 1],
+            &throttle->streams[position],
+            (throttle->stream_count - position) * sizeof(*throttle->streams));
+    stream_event_stream_t *stream = &throttle->streams[position];
+    *stream = (stream_event_stream_t){
+        .index = index,
+        .client = STREAM_EVENT_THROTTLE_NO_CLIENT,
+        .sampled_ms = now_ms,
+    };
+    bucket_init(&stream->bucket, STREAM_EVENT_THROTTLE_STREAM_BURST, now_ms);
+    throttle->stream_count++;
+    return stream;
+}
+
+/*
+ * Clients are few, as those without streams are capped, so a linear scan is
+ * cheaper than maintaining an index.
+ */
+static stream_event_client_t *find_client(stream_event_throttle_t *throttle,
+                                          uint32_t client) {
+    if (client == STREAM_EVENT_THROTTLE_NO_CLIENT) return NULL;
+    for (size_t i = 0; i < throttle->client_count; i++) {
+        if (throttle->clients[i].client == client) {
+            return &throttle->clients[i];
+        }
+    }
+    return NULL;
+}
+
+static stream_event_client_t *find_or_add_client(
+    stream_event_throttle_t *throttle,
+    uint32_t client,
+    uint64_t now_ms) {
+    stream_event_client_t *found = find_client(throttle, client);
+    if (found) return found;
+
+    if (throttle->client_count == throttle->client_capacity) {
+        size_t new_capacity = grown_capacity(throttle->client_capacity,
+                                             INITIAL_CLIENT_CAPACITY);
+        if (new_capacity == 0 || resize_clients(throttle, new_capacity) != 0) {
+            return NULL;
+        }
+    }
+
+    stream_event_client_t *added = &throttle->clients[throttle->client_count];
+    *added = (stream_event_client_t){.client = client};
+    bucket_init(&added->bucket, STREAM_EVENT_THROTTLE_CLIENT_BURST, now_ms);
+    throttle->client_count++;
+    return added;
+}
+
+static void remove_client(stream_event_throttle_t *throttle,
+                          size_t position) {
+    memmove(&throttle->clients[position],
+            &throttle->clients[position + 1],
+            (throttle->client_count - position - 1) *
+                sizeof(*throttle->clients));
+    throttle->client_count--;
+
+    memory_usage_shrink(&throttle->memory,
+                        throttle,
+                        resize_clients,
+                        throttle->client_count,
+                        throttle->client_capacity,
+                        INITIAL_CLIENT_CAPACITY);
+}
+
+/*
+ * Drops the throttled client that left first once more than the retained
+ * number are without streams, keeping only its counters in the totals.
+ */
+static void forget_departed_client(stream_event_throttle_t *throttle) {
+    size_t departed = 0;
+    size_t oldest = 0;
+    for (size_t i = 0; i < throttle->client_count; i++) {
+        const stream_event_client_t *client = &throttle->clients[i];
+        if (client->stream_count > 0) continue;
+        if (departed == 0 ||
+            client->departure < throttle->clients[oldest].departure) {
+            oldest = i;
+        }
+        departed++;
+    }
+    if (departed <= STREAM_EVENT_THROTTLE_RETAINED_CLIENTS) return;
+
+    const stream_event_client_t *forgotten = &throttle->clients[oldest];
+    throttle->forgotten_client_count++;
+    throttle->forgotten_throttle_count += forgotten->throttle_count;
+    throttle->forgotten_deferred_event_count +=
+        forgotten->deferred_event_count;
+    remove_client(throttle, oldest);
+}
+
+/* Drops a stream from its client, forgetting a client never throttled. */
+static void detach_client(stream_event_throttle_t *throttle,
+                          uint32_t client) {
+    stream_event_client_t *found = find_client(throttle, client);
+    if (!found) return;
+
+    if (found->stream_count > 0) found->stream_count--;
+    if (found->stream_count > 0) return;
+    if (found->throttle_count == 0) {
+        remove_client(throttle, (size_t)(found - throttle->clients));
+        return;
+    }
+
+    found->departure = ++throttle->departure_count;
+    forget_departed_client(throttle);
+}
+
+/* Takes one of the stream's expected own change events, if one is due. */
+static int take_expected_change(stream_event_stream_t *stream,
+                                uint64_t now_ms) {
+    if (stream->expected_changes == 0) return 0;
+    if (now_ms > stream->expected_ms) {
+        stream->expected_changes = 0;
+        return 0;
+    }
+    stream->expected_changes--;
+    return 1;
+}
+
+void stream_event_throttle_init(stream_event_throttle_t *throttle) {
+    if (!throttle) return;
+    *throttle = (stream_event_throttle_t){0};
+}
+
+int stream_event_throttle_assign(stream_event_throttle_t *throttle,
+                                 uint32_t index,
+                                 uint32_t client,
+                                 const char *name,
+                                 uint64_t now_ms) {
+    if (!throttle) return -1;
+
+    stream_event_stream_t *stream = find_or_add_stream(throttle,
+                                                       index,
+                                                       now_ms);
+    if (!stream) return -1;
+    if (stream->client != client) {
+        detach_client(throttle, stream->client);
+        stream->client = STREAM_EVENT_THROTTLE_NO_CLIENT;
+        if (client == STREAM_EVENT_THROTTLE_NO_CLIENT) return 0;
+
+        stream_event_client_t *added = find_or_add_client(throttle,
+                                                          client,
+                                                          now_ms);
+        if (!added) return -1;
+        added->stream_count++;
+        stream->client = client;
+    }
+
+    stream_event_client_t *owner = find_client(throttle, client);
+    if (owner && name && name[0] != '\0') {
+        snprintf(owner->name, sizeof(owner->name), "%s", name);
+    }
+    return 0;
+}
+
+int stream_event_throttle_admit(stream_event_throttle_t *throttle,
+                                uint32_t index,
+                                uint64_t now_ms) {
+    if (!throttle) return 1;
+
+    throttle->event_count++;
+    stream_event_stream_t *stream = find_or_add_stream(throttle,
+                                                       index,
+                                                       now_ms);
+    if (!stream) return 1;
+    stream_event_client_t *client = find_client(throttle, stream->client);
+    refresh_stream(throttle, stream, now_ms);
+    refresh_client(throttle, client, now_ms);
+
+    if (take_expected_change(stream, now_ms)) {
+        throttle->own_event_count++;
+    } else {
+        /* Tokens are spent while throttled too, so only a calm one refills. */
+        int stream_allowed = bucket_take(&stream->bucket);
+        int client_allowed = !client || bucket_take(&client->bucket);
+        if (!stream_allowed && !stream->throttled) {
+            stream->throttled = 1;
+            throttle->throttled_stream_count++;
+        }
+        if (!client_allowed && !client->throttled) {
+            client->throttled = 1;
+            client->throttle_count++;
+            throttle->throttled_client_count++;
+        }
+    }
+
+    if (!stream->throttled && !(client && client->throttled)) {
+        stream->sampled_ms = now_ms;
+        return 1;
+    }
+    if (!stream->pending) {
+        stream->pending = 1;
+        throttle->pending_count++;
+    }
+    throttle->deferred_event_count++;
+    if (client) client->deferred_event_count++;
+    return 0;
+}
+
+void stream_event_throttle_expect_change(stream_event_throttle_t *throttle,
+                                         uint32_t index,
+                                         uint64_t now_ms) {
+    if (!throttle) return;
+
+    stream_event_stream_t *stream = find_or_add_stream(throttle,
+                                                       index,
+                                                       now_ms);
+    if (!stream) return;
+    if (now_ms > stream->expected_ms) stream->expected_changes = 0;
+    if (stream->expected_changes < STREAM_EVENT_THROTTLE_MAX_EXPECTED) {
+        stream->expected_changes++;
+    }
+    stream->expected_ms = now_ms + STREAM_EVENT_THROTTLE_SAMPLE_MS;
+}
+
+int stream_event_throttle_take_sample(stream_event_throttle_t *throttle,
+                                      uint64_t now_ms,
+                                      uint32_t *index) {
+    if (!throttle || !index || throttle->pending_count == 0) return 0;
+
+    for (size_t i = 0; i < throttle->stream_count; i++) {
+        stream_event_stream_t *stream = &throttle->streams[i];
+        if (!stream->pending) continue;
+
+        stream_event_client_t *client = find_client(throttle, stream->client);
+        refresh_stream(throttle, stream, now_ms);
+        refresh_client(throttle, client, now_ms);
+        int throttled = stream->throttled || (client && client->throttled);
+        if (throttled &&
+            now_ms < stream->sampled_ms + STREAM_EVENT_THROTTLE_SAMPLE_MS) {
+            continue;
+        }
+
+        stream->pending = 0;
+        stream->sampled_ms = now_ms;
+        throttle->pending_count--;
+        throttle->sample_count++;
+        *index = stream->index;
+        return 1;
+    }
+    return 0;
+}
+
+void stream_event_throttle_forget(stream_event_throttle_t *throttle,
+                                  uint32_t index) {
+    if (!throttle) return;
+
+    size_t position;
+    if (!find_stream_position(throttle, index, &position)) return;
+
+    stream_event_stream_t *stream = &throttle->streams[position];
+    if (stream->pending) throttle->pending_count--;
+    detach_client(throttle, stream->client);
+    memmove(&throttle->streams[position],
+            &throttle->streams[position + 1],
+            (throttle->stream_count - position - 1) *
+                sizeof(*throttle->streams));
+    throttle->stream_count--;
+
+    memory_usage_shrink(&throttle->memory,
+                        throttle,
+                        resize_streams,
+                        throttle->stream_count,
+                        throttle->stream_capacity,
+                        INITIAL_STREAM_CAPACITY);
+}
+
+void stream_event_throttle_clear(stream_event_throttle_t *throttle) {
+    if (!throttle) return;
+
+    POOL_FREE(stream_pool, throttle->streams);
+    POOL_FREE(client_pool, throttle->clients);
+    stream_event_throttle_init(throttle);
+}
@@ -0,0 +1,166 @@
+#ifndef STREAM_EVENT_THROTTLE_H
+#define STREAM_EVENT_THROTTLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../memory_usage.h"
+
+/*
+ * Change events a stream, and all streams of one client together, may send
+ * at once, and how many per second they may keep sending, before their
+ * events are only sampled. A client that emits metadata or cork changes
+ * continuously spends its burst within seconds; a stream that is adjusted
+ * by hand never does.
+ */
+#define STREAM_EVENT_THROTTLE_STREAM_BURST 20U
+#define STREAM_EVENT_THROTTLE_STREAM_RATE 5U
+#define STREAM_EVENT_THROTTLE_CLIENT_BURST 60U
+#define STREAM_EVENT_THROTTLE_CLIENT_RATE 15U
+/* How often a throttled stream with unread changes is read. */
+#define STREAM_EVENT_THROTTLE_SAMPLE_MS 1000U
+/*
+ * Change events of the daemon's own volume writes a stream may have
+ * outstanding. They are free if they arrive within the sample interval of
+ * the last write.
+ */
+#define STREAM_EVENT_THROTTLE_MAX_EXPECTED 8U
+/*
+ * Throttled clients kept after their streams are gone, so the statistics can
+ * still name them. Older ones only add to the forgotten counters.
+ */
+#define STREAM_EVENT_THROTTLE_RETAINED_CLIENTS 8U
+
+#define STREAM_EVENT_THROTTLE_NO_CLIENT UINT32_MAX
+#define STREAM_EVENT_THROTTLE_NAME_SIZE 48
+
+/* Thousandths of an event, refilled continuously up to the burst. */
+typedef struct {
+    uint64_t tokens;
+    uint64_t refilled_ms;
+} stream_event_bucket_t;
+
+typedef struct {
+    uint32_t index;
+    uint32_t client;
+    stream_event_bucket_t bucket;
+    int throttled;
+    /* Events arrived since the stream was last read. */
+    int pending;
+    uint64_t sampled_ms;
+    /* Change events of the daemon's own writes, free until expected_ms. */
+    unsigned int expected_changes;
+    uint64_t expected_ms;
+} stream_event_stream_t;
+
+/*
+ * A client is kept while it owns streams, and afterwards only when it was
+ * ever throttled and is among the STREAM_EVENT_THROTTLE_RETAINED_CLIENTS that
+ * left last.
+ */
+typedef struct {
+    uint32_t client;
+    char name[STREAM_EVENT_THROTTLE_NAME_SIZE];
+    size_t stream_count;
+    stream_event_bucket_t bucket;
+    int throttled;
+    uint64_t throttle_count;
+    uint64_t deferred_event_count;
+    /* Orders clients without streams by when they lost their last one. */
+    uint64_t departure;
+} stream_event_client_t;
+
+/*
+ * Rations the stream information requests of change events with one token
+ * bucket per stream and one per client. An event within both budgets is
+ * handled as before. Once either runs dry, the stream's events only mark it
+ * pending and it is read at most once per sample interval, which still
+ * reports its latest state. A stream or client whose bucket refills
+ * completely, because its events stayed below the rate long enough, is
+ * handled per event again.
+ */
+typedef struct {
+    /* Sorted by index. */
+    stream_event_stream_t *streams;
+    size_t stream_count;
+    size_t stream_capacity;
+    stream_event_client_t *clients;
+    size_t client_count;
+    size_t client_capacity;
+    size_t pending_count;
+    uint64_t event_count;
+    uint64_t deferred_event_count;
+    uint64_t sample_count;
+    uint64_t throttled_stream_count;
+    uint64_t throttled_client_count;
+    uint64_t released_stream_count;
+    uint64_t released_client_count;
+    /* Change events of the daemon's own writes, which spend no tokens. */
+    uint64_t own_event_count;
+    uint64_t departure_count;
+    /* Throttled clients dropped after they left, and what they did. */
+    uint64_t forgotten_client_count;
+    uint64_t forgotten_throttle_count;
+    uint64_t forgotten_deferred_event_count;
+    /* Both arrays, shrunk once they are at most a quarter full. */
+    memory_usage_t memory;
+} stream_event_throttle_t;
+
+/*
+ * Initializes a new throttle or one reset by clear(). Calling init() on a
+ * throttle that owns storage leaks it.
+ */
+void stream_event_throttle_init(stream_event_throttle_t *throttle);
+
+/*
+ * Records that stream index belongs to client, which is named name when it is
+ * not NULL or empty. A client of STREAM_EVENT_THROTTLE_NO_CLIENT leaves the
+ * stream to its own budget. Returns 0 on success and -1 for invalid arguments
+ * or allocation failure; the stream is then accounted without its client.
+ */
+int stream_event_throttle_assign(stream_event_throttle_t *throttle,
+                                 uint32_t index,
+                                 uint32_t client,
+                                 const char *name,
+                                 uint64_t now_ms);
+
+/*
+ * Counts a change event of index at now_ms. Returns 1 when the caller should
+ * read the stream now, and 0 when the stream or its client is throttled and
+ * the stream is read by take_sample() instead. Streams that cannot be
+ * tracked are always read.
+ */
+int stream_event_throttle_admit(stream_event_throttle_t *throttle,
+                                uint32_t index,
+                                uint64_t now_ms);
+
+/*
+ * Records that the daemon wrote the volume of index at now_ms. The change
+ * event the write causes is then counted by admit() without spending the
+ * budget of the stream or its client, so routing never throttles a client,
+ * provided it arrives within STREAM_EVENT_THROTTLE_SAMPLE_MS of the last
+ * write. At most STREAM_EVENT_THROTTLE_MAX_EXPECTED such events are
+ * outstanding, since the server may merge the events of quick writes.
+ */
+void stream_event_throttle_expect_change(stream_event_throttle_t *throttle,
+                                         uint32_t index,
+                                         uint64_t now_ms);
+
+/*
+ * Takes a pending stream that is due to be read at now_ms: a throttled one
+ * sampled at least STREAM_EVENT_THROTTLE_SAMPLE_MS ago, or one released from
+ * the throttle. Stores it in *index and returns 1, or returns 0 when none is
+ * due.
+ */
+int stream_event_throttle_take_sample(stream_event_throttle_t *throttle,
+                                      uint64_t now_ms,
+                                      uint32_t *index);
+
+/* Forgets a removed stream, including a pending sample. */
+void stream_event_throttle_forget(stream_event_throttle_t *throttle,
+                                  uint32_t index);
+
+/* Frees both arrays and resets the throttle, including its counters. */
+void stream_event_throttle_clear(stream_event_throttle_t *throttle);
+
+#endif
@@ -0,0 +1,147 @@
+#include "stream_grace_window.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fixed_pool.h"
+
+#define INITIAL_GRACE_CAPACITY 4
+
+/* A fixed-capacity window holds back at most as many streams as are kept. */
+FIXED_POOL_DEFINE(entry_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(stream_grace_entry_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+static int resize_entries(void *container, size_t new_capacity) {
+    stream_grace_window_t *window = container;
+    if (new_capacity > SIZE_MAX / sizeof(*window->entries)) return -1;
+
+    stream_grace_entry_t *entries = POOL_REALLOC(
+        entry_pool,
+        window->entries,
+        new_capacity * sizeof(*entries));
+    if (!entries) return -1;
+
+    window->entries = entries;
+    window->capacity = new_capacity;
+    memory_usage_set(&window->memory, new_capacity * sizeof(*entries));
+    return 0;
+}
+
+static int ensure_capacity(stream_grace_window_t *window) {
+    if (window->count < window->capacity) return 0;
+
+    size_t new_capacity = INITIAL_GRACE_CAPACITY;
+    if (window->capacity > 0) {
+        if (window->capacity > SIZE_MAX / 2) return -1;
+        new_capacity = window->capacity * 2;
+    }
+    return resize_entries(window, new_capacity);
+}
+
+/*
+ * Short-lived streams keep the window small, so a linear scan is cheaper
+ * than maintaining an index.
+ */
+static int find_position(const stream_grace_window_t *window,
+                         uint32_t index,
+                         size_t *position) {
+    for (size_t i = 0; i < window->count; i++) {
+        if (window->entries[i].index == index) {
+            *position = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void remove_position(stream_grace_window_t *window, size_t position) {
+    size_t following = window->count - position - 1;
+    if (following > 0) {
+        memmove(&window->entries[position],
+                &window->entries[position + 1],
+                following * sizeof(*window->entries));
+    }
+    window->count--;
+
+    memory_usage_shrink(&window->memory,
+                        window,
+                        resize_entries,
+                        window->count,
+                        window->capacity,
+                        INITIAL_GRACE_CAPACITY);
+}
+
+void stream_grace_window_init(stream_grace_window_t *window) {
+    if (!window) return;
+
+    window->entries = NULL;
+    window->count = 0;
+    window->capacity = 0;
+    window->deferred_count = 0;
+    window->dropped_count = 0;
+    window->materialized_count = 0;
+    memory_usage_init(&window->memory);
+}
+
+int stream_grace_window_add(stream_grace_window_t *window,
+                            uint32_t index,
+                            uint64_t now_ms) {
+    if (!window) return -1;
+
+    size_t position;
+    if (find_position(window, index, &position)) return 0;
+    if (ensure_capacity(window) != 0) return -1;
+
+    /* Callers pass a monotonic clock, which keeps arrivals ordered. */
+    window->entries[window->count] = (stream_grace_entry_t){
+        .index = index,
+        .arrival_ms = now_ms,
+    };
+    window->count++;
+    window->deferred_count++;
+    return 0;
+}
+
+int stream_grace_window_contains(const stream_grace_window_t *window,
+                                 uint32_t index) {
+    size_t position;
+    return window && find_position(window, index, &position);
+}
+
+int stream_grace_window_drop(stream_grace_window_t *window, uint32_t index) {
+    if (!window) return 0;
+
+    size_t position;
+    if (!find_position(window, index, &position)) return 0;
+
+    remove_position(window, position);
+    window->dropped_count++;
+    return 1;
+}
+
+int stream_grace_window_take_due(stream_grace_window_t *window,
+                                 uint64_t now_ms,
+                                 uint64_t grace_ms,
+                                 uint32_t *index) {
+    if (!window || !index || window->count == 0) return 0;
+
+    const stream_grace_entry_t *oldest = &window->entries[0];
+    if (grace_ms > 0 &&
+        (now_ms < oldest->arrival_ms ||
+         now_ms - oldest->arrival_ms < grace_ms)) {
+        return 0;
+    }
+
+    *index = oldest->index;
+    remove_position(window, 0);
+    window->materialized_count++;
+    return 1;
+}
+
+void stream_grace_window_clear(stream_grace_window_t *window) {
+    if (!window) return;
+
+    POOL_FREE(entry_pool, window->entries);
+    stream_grace_window_init(window);
+}
@@ -0,0 +1,72 @@
+#ifndef STREAM_GRACE_WINDOW_H
+#define STREAM_GRACE_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../memory_usage.h"
+
+typedef struct {
+    uint32_t index;
+    uint64_t arrival_ms;
+} stream_grace_entry_t;
+
+/*
+ * New streams whose materialization is deferred until they survive the grace
+ * window. Nothing is read from the server for a pending stream, so one that
+ * is removed inside the window costs no request, inventory update, or volume
+ * write. Entries are kept in arrival order, so the oldest is always first.
+ */
+typedef struct {
+    stream_grace_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    /* Streams added, dropped inside the window, and handed out as due. */
+    uint64_t deferred_count;
+    uint64_t dropped_count;
+    uint64_t materialized_count;
+    /* The entry array, shrunk once it is at most a quarter full. */
+    memory_usage_t memory;
+} stream_grace_window_t;
+
+/*
+ * Initializes a new window or one reset by clear(). Calling init() on a window
+ * that owns entries leaks them.
+ */
+void stream_grace_window_init(stream_grace_window_t *window);
+
+/*
+ * Defers index, which arrived at now_ms. An index that is already pending
+ * keeps its first arrival. Returns 0 on success and -1 for invalid arguments
+ * or allocation failure; the caller should then materialize the stream
+ * immediately.
+ */
+int stream_grace_window_add(stream_grace_window_t *window,
+                            uint32_t index,
+                            uint64_t now_ms);
+
+/* Returns nonzero when index is pending. */
+int stream_grace_window_contains(const stream_grace_window_t *window,
+                                 uint32_t index);
+
+/*
+ * Drops a pending index whose stream was removed inside the window. Returns 1
+ * when it was pending and 0 otherwise.
+ */
+int stream_grace_window_drop(stream_grace_window_t *window, uint32_t index);
+
+/*
+ * Removes the oldest pending stream that has been pending for at least
+ * grace_ms at now_ms and stores it in *index. A grace_ms of 0 takes every
+ * pending stream, as done when the wheel moves. Returns 1 when a stream was
+ * taken and 0 when none is due.
+ */
+int stream_grace_window_take_due(stream_grace_window_t *window,
+                                 uint64_t now_ms,
+                                 uint64_t grace_ms,
+                                 uint32_t *index);
+
+/* Frees all entries and resets the window, including its counters. */
+void stream_grace_window_clear(stream_grace_window_t *window);
+
+#endif
@@ -0,0 +1,152 @@
+#include "stream_list_resync.h"
+
+#include <stdlib.h>
+
+#include "../fixed_pool.h"
+
+#define INITIAL_SEEN_CAPACITY 16
+
+/* Only streams stored in the inventory are marked as seen. */
+FIXED_POOL_DEFINE(seen_pool,
+                  CHATWHEEL_MAX_STREAMS * sizeof(uint32_t),
+                  CHATWHEEL_FIXED_INSTANCES)
+
+static int compare_indexes(const void *left, const void *right) {
+    uint32_t a = *(const uint32_t *)left;
+    uint32_t b = *(const uint32_t *)right;
+    return (a > b) - (a < b);
+}
+
+static int ensure_seen_capacity(stream_list_resync_t *resync) {
+    if (resync->seen_count < resync->seen_capacity) return 0;
+
+    size_t new_capacity = INITIAL_SEEN_CAPACITY;
+    if (resync->seen_capacity > 0) {
+        if (resync->seen_capacity > SIZE_MAX / 2 / sizeof(*resync->seen)) {
+            return -1;
+        }
+        new_capacity = resync->seen_capacity * 2;
+    }
+
+    uint32_t *seen = POOL_REALLOC(seen_pool,
+                                  resync->seen,
+                                  new_capacity * sizeof(*seen));
+    if (!seen) return -1;
+
+    resync->seen = seen;
+    resync->seen_capacity = new_capacity;
+    memory_usage_set(&resync->memory, new_capacity * sizeof(*seen));
+    return 0;
+}
+
+static void release_seen(stream_list_resync_t *resync) {
+    POOL_FREE(seen_pool, resync->seen);
+    resync->seen = NULL;
+    resync->seen_count = 0;
+    resync->seen_capacity = 0;
+    resync->seen_incomplete = 0;
+    memory_usage_set(&resync->memory, 0);
+}
+
+void stream_list_resync_init(stream_list_resync_t *resync) {
+    if (!resync) return;
+    *resync = (stream_list_resync_t){0};
+}
+
+void stream_list_resync_begin_drain(stream_list_resync_t *resync) {
+    if (!resync) return;
+    resync->drain_event_count = 0;
+}
+
+int stream_list_resync_absorb_event(stream_list_resync_t *resync) {
+    if (!resync) return 0;
+
+    if (!resync->needed && !resync->in_flight) {
+        if (resync->drain_event_count < STREAM_LIST_RESYNC_BURST_THRESHOLD) {
+            resync->drain_event_count++;
+            return 0;
+        }
+        resync->needed = 1;
+        resync->burst_count++;
+    }
+    resync->absorbed_event_count++;
+    return 1;
+}
+
+int stream_list_resync_should_start(const stream_list_resync_t *resync) {
+    return resync && resync->needed && !resync->in_flight;
+}
+
+void stream_list_resync_begin(stream_list_resync_t *resync) {
+    if (!resync) return;
+    resync->needed = 0;
+    resync->in_flight = 1;
+    resync->seen_count = 0;
+    resync->seen_incomplete = 0;
+}
+
+int stream_list_resync_mark_seen(stream_list_resync_t *resync,
+                                 uint32_t index) {
+    if (!resync || !resync->in_flight) return -1;
+    if (ensure_seen_capacity(resync) != 0) {
+        resync->seen_incomplete = 1;
+        return -1;
+    }
+
+    resync->seen[resync->seen_count++] = index;
+    return 0;
+}
+
+size_t stream_list_resync_finish(stream_list_resync_t *resync,
+                                 audio_stream_inventory_t *streams,
+                                 stream_list_resync_remove_fn removed_fn,
+                                 void *userdata) {
+    if (!resync || !resync->in_flight) return 0;
+
+    size_t removed = 0;
+    if (streams && !resync->seen_incomplete) {
+        if (resync->seen_count > 1) {
+            qsort(resync->seen,
+                  resync->seen_count,
+                  sizeof(*resync->seen),
+                  compare_indexes);
+        }
+        /* Removal keeps the order of earlier streams, so walk backwards. */
+        for (size_t position = streams->count; position > 0; position--) {
+            uint32_t index = streams->streams[position - 1].index;
+            if (resync->seen_count > 0 &&
+                bsearch(&index,
+                        resync->seen,
+                        resync->seen_count,
+                        sizeof(*resync->seen),
+                        compare_indexes)) {
+                continue;
+            }
+            if (audio_stream_inventory_remove(streams, index) != 1) continue;
+            removed++;
+            if (removed_fn) removed_fn(index, userdata);
+        }
+    }
+
+    resync->in_flight = 0;
+    resync->completed_count++;
+    resync->removed_stream_count += removed;
+    release_seen(resync);
+    return removed;
+}
+
+void stream_list_resync_abandon(stream_list_resync_t *resync) {
+    if (!resync || !resync->in_flight) return;
+
+    resync->in_flight = 0;
+    resync->needed = 1;
+    resync->failed_count++;
+    release_seen(resync);
+}
+
+void stream_list_resync_clear(stream_list_resync_t *resync) {
+    if (!resync) return;
+
+    POOL_FREE(seen_pool, resync->seen);
+    stream_list_resync_init(resync);
+}
@@ -0,0 +1,98 @@
+#ifndef STREAM_LIST_RESYNC_H
+#define STREAM_LIST_RESYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../audio_stream_inventory.h"
+#include "../memory_usage.h"
+
+/*
+ * Stream events that may send their own information request in one drain
+ * before the rest are covered by a single list request instead.
+ */
+#define STREAM_LIST_RESYNC_BURST_THRESHOLD 32U
+
+/* Called for each stream finish() removed, after it left the inventory. */
+typedef void (*stream_list_resync_remove_fn)(uint32_t index, void *userdata);
+
+/*
+ * Detects bursts of stream events, as at session start, game launch, or a
+ * server restart, and replaces their per-stream requests with one list
+ * request whose result is diffed against the stream inventory. Every event
+ * of a drain counts; past the threshold, and until the list result arrives,
+ * events are absorbed because the list reports their effect. The server
+ * answers the list in one reply, so an event received before it is already
+ * reflected there.
+ */
+typedef struct {
+    unsigned int drain_event_count;
+    /* A burst was detected and its list request is not sent yet. */
+    int needed;
+    int in_flight;
+    /* Indexes of stored streams the list reported, sorted by finish(). */
+    uint32_t *seen;
+    size_t seen_count;
+    size_t seen_capacity;
+    /* A seen index could not be stored, so finish() removes nothing. */
+    int seen_incomplete;
+    uint64_t burst_count;
+    uint64_t absorbed_event_count;
+    uint64_t completed_count;
+    uint64_t failed_count;
+    uint64_t removed_stream_count;
+    /* The seen array, which is freed after each list. */
+    memory_usage_t memory;
+} stream_list_resync_t;
+
+/*
+ * Initializes a new resync or one reset by clear(). Calling init() on a
+ * resync that owns storage leaks it.
+ */
+void stream_list_resync_init(stream_list_resync_t *resync);
+
+/* Starts counting the events of a new drain. */
+void stream_list_resync_begin_drain(stream_list_resync_t *resync);
+
+/*
+ * Counts an event that would send an information request. Returns 1 when a
+ * list request covers it instead, so the caller sends nothing, and 0 when
+ * the caller should send its own request.
+ */
+int stream_list_resync_absorb_event(stream_list_resync_t *resync);
+
+/* Returns nonzero when a burst needs its list request sent. */
+int stream_list_resync_should_start(const stream_list_resync_t *resync);
+
+/* Records that the list request was sent. */
+void stream_list_resync_begin(stream_list_resync_t *resync);
+
+/*
+ * Records that the list reported index, which is stored in the inventory.
+ * Returns 0 on success and -1 for invalid arguments or allocation failure;
+ * finish() then keeps every stream.
+ */
+int stream_list_resync_mark_seen(stream_list_resync_t *resync, uint32_t index);
+
+/*
+ * Completes the list in flight by removing every stream of streams that it
+ * did not report, and returns how many were removed. When removed is not
+ * NULL, it is called with userdata for each of them, so the caller can drop
+ * the state it keeps per stream as for a removal event. Calls without a list
+ * in flight remove nothing.
+ */
+size_t stream_list_resync_finish(stream_list_resync_t *resync,
+                                 audio_stream_inventory_t *streams,
+                                 stream_list_resync_remove_fn removed,
+                                 void *userdata);
+
+/*
+ * Ends the list in flight without results. The absorbed events are still
+ * unread, so the list is sent again by the next drain.
+ */
+void stream_list_resync_abandon(stream_list_resync_t *resync);
+
+/* Frees the seen indexes and resets the resync, including its counters. */
+void stream_list_resync_clear(stream_list_resync_t *resync);
+
+#endif
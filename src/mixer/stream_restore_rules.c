@@ -0,0 +1,238 @@
+#include "stream_restore_rules.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../pattern_matcher.h"
+
+#define INITIAL_RULE_CAPACITY 4
+#define APPLICATION_ID_RULE_PREFIX "sink-input-by-application-id:"
+#define APPLICATION_NAME_RULE_PREFIX "sink-input-by-application-name:"
+
+static int ensure_rule_capacity(stream_restore_rule_set_t *rules) {
+    if (rules->count < rules->capacity) return 0;
+
+    size_t new_capacity = INITIAL_RULE_CAPACITY;
+    if (rules->capacity > 0) {
+        if (rules->capacity > SIZE_MAX / 2) return -1;
+        new_capacity = rules->capacity * 2;
+    }
+    if (new_capacity > SIZE_MAX / sizeof(*rules->rules)) return -1;
+
+    stream_restore_rule_t *resized = realloc(
+        rules->rules,
+        new_capacity * sizeof(*rules->rules));
+    if (!resized) return -1;
+
+    rules->rules = resized;
+    rules->capacity = new_capacity;
+    return 0;
+}
+
+static int rule_set_contains(const stream_restore_rule_set_t *rules,
+                             const char *name) {
+    for (size_t i = 0; i < rules->count; i++) {
+        if (strcmp(rules->rules[i].name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+static const chatmix_volume_target_t *target_for_group(
+    application_group_t group,
+    const chatmix_volume_targets_t *targets) {
+    if (group == APPLICATION_GROUP_GAME) return &targets->game;
+    if (group == APPLICATION_GROUP_CHAT) return &targets->chat;
+    return NULL;
+}
+
+static int add_rule(stream_restore_rule_set_t *rules,
+                    const char *prefix,
+                    const char *value,
+                    application_group_t group,
+                    const chatmix_volume_targets_t *targets) {
+    const chatmix_volume_target_t *target = target_for_group(group, targets);
+    if (!target || !value || value[0] == '\0') return 0;
+
+    size_t prefix_length = strlen(prefix);
+    size_t value_length = strlen(value);
+    if (value_length > SIZE_MAX - prefix_length - 1) return -1;
+
+    char *name = malloc(prefix_length + value_length + 1);
+    if (!name) return -1;
+    memcpy(name, prefix, prefix_length);
+    memcpy(name + prefix_length, value, value_length + 1);
+
+    if (rule_set_contains(rules, name)) {
+        free(name);
+        return 0;
+    }
+    if (ensure_rule_capacity(rules) != 0) {
+        free(name);
+        return -1;
+    }
+
+    rules->rules[rules->count] = (stream_restore_rule_t){
+        .name = name,
+        .group = group,
+        .pulse_volume = target->pulse,
+    };
+    rules->count++;
+    return 0;
+}
+
+static const char *rule_prefix_for_identity(
+    application_identity_property_t property) {
+    if (property == APPLICATION_IDENTITY_PROPERTY_APPLICATION_ID) {
+        return APPLICATION_ID_RULE_PREFIX;
+    }
+    if (property == APPLICATION_IDENTITY_PROPERTY_APPLICATION_NAME) {
+        return APPLICATION_NAME_RULE_PREFIX;
+    }
+    return NULL;
+}
+
+static int is_literal_pattern(const char *pattern) {
+    return pattern[0] != '\0' && !strchr(pattern, '*') && !strchr(pattern, '?');
+}
+
+static application_group_t group_for_name(const config_t *configuration,
+                                          const char *name) {
+    for (int i = 0; i < configuration->count; i++) {
+        const app_config_t *entry = &configuration->apps[i];
+        if (pattern_matches_text(entry->name, name)) {
+            return entry->is_chat != 0
+                ? APPLICATION_GROUP_CHAT
+                : APPLICATION_GROUP_GAME;
+        }
+    }
+    return APPLICATION_GROUP_UNASSIGNED;
+}
+
+void stream_restore_rule_set_init(stream_restore_rule_set_t *rules) {
+    if (!rules) return;
+    *rules = (stream_restore_rule_set_t){0};
+}
+
+int stream_restore_rule_set_build(
+    stream_restore_rule_set_t *destination,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration,
+    const chatmix_volume_targets_t *targets,
+    int inventory_available) {
+    if (!destination || !applications || !streams || !configuration ||
+        !targets || configuration->count < 0 ||
+        configuration->count > MAX_APPS) {
+        return -1;
+    }
+
+    stream_restore_rule_set_t replacement;
+    stream_restore_rule_set_init(&replacement);
+
+    if (inventory_available) {
+        for (size_t i = 0; i < applications->count; i++) {
+            active_application_t *application =
+                &applications->applications[i];
+            const char *prefix = rule_prefix_for_identity(
+                application->identity_property);
+            if (!prefix) continue;
+
+            application_classification_t classification =
+                application_classifier_classify_cached(
+                    application,
+                    streams,
+                    configuration);
+            if (add_rule(&replacement,
+                         prefix,
+                         application->identity_value,
+                         classification.group,
+                         targets) != 0) {
+                goto fail;
+            }
+        }
+    }
+
+    for (int i = 0; i < configuration->count; i++) {
+        const char *pattern = configuration->apps[i].name;
+        if (!is_literal_pattern(pattern)) continue;
+
+        if (add_rule(&replacement,
+                     APPLICATION_NAME_RULE_PREFIX,
+                     pattern,
+                     group_for_name(configuration, pattern),
+                     targets) != 0) {
+            goto fail;
+        }
+    }
+
+    stream_restore_rule_set_clear(destination);
+    *destination = replacement;
+    return 0;
+
+fail:
+    stream_restore_rule_set_clear(&replacement);
+    return -1;
+}
+
+int stream_restore_rule_set_preserve(stream_restore_rule_set_t *rules,
+                                     const char *name,
+                                     const char *device,
+                                     int muted) {
+    if (!rules || !name) return -1;
+
+    for (size_t i = 0; i < rules->count; i++) {
+        stream_restore_rule_t *rule = &rules->rules[i];
+        if (strcmp(rule->name, name) != 0) continue;
+
+        char *device_copy = NULL;
+        if (device && device[0] != '\0') {
+            device_copy = strdup(device);
+            if (!device_copy) return -1;
+        }
+        free(rule->device);
+        rule->device = device_copy;
+        rule->muted = muted ? 1 : 0;
+        return 0;
+    }
+
+    return 0;
+}
+
+void stream_restore_rule_set_clear(stream_restore_rule_set_t *rules) {
+    if (!rules) return;
+
+    for (size_t i = 0; i < rules->count; i++) {
+        free(rules->rules[i].name);
+        free(rules->rules[i].device);
+    }
+    free(rules->rules);
+    stream_restore_rule_set_init(rules);
+}
+
+void stream_restore_schedule_init(stream_restore_schedule_t *schedule) {
+    if (!schedule) return;
+    *schedule = (stream_restore_schedule_t){0};
+}
+
+void stream_restore_schedule_request(stream_restore_schedule_t *schedule) {
+    if (!schedule) return;
+    schedule->pending = 1;
+}
+
+int stream_restore_schedule_is_due(const stream_restore_schedule_t *schedule,
+                                   uint64_t now_ms) {
+    if (!schedule || !schedule->pending) return 0;
+    if (!schedule->has_written) return 1;
+    if (now_ms < schedule->last_write_ms) return 1;
+    return now_ms - schedule->last_write_ms >=
+        STREAM_RESTORE_WRITE_INTERVAL_MS;
+}
+
+void stream_restore_schedule_mark_written(stream_restore_schedule_t *schedule,
+                                          uint64_t now_ms) {
+    if (!schedule) return;
+    schedule->pending = 0;
+    schedule->has_written = 1;
+    schedule->last_write_ms = now_ms;
+}
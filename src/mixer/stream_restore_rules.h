@@ -0,0 +1,106 @@
+#ifndef STREAM_RESTORE_RULES_H
+#define STREAM_RESTORE_RULES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../active_application_inventory.h"
+#include "../application_classifier.h"
+#include "../audio_stream_inventory.h"
+#include "../config.h"
+#include "chatmix_volume.h"
+
+/*
+ * Minimum time between two module-stream-restore writes. Wheel movement
+ * inside the interval is coalesced into one trailing write.
+ */
+#define STREAM_RESTORE_WRITE_INTERVAL_MS 500U
+
+typedef struct {
+    /*
+     * Owned module-stream-restore entry name, such as
+     * "sink-input-by-application-name:Discord".
+     */
+    char *name;
+    application_group_t group;
+    pa_volume_t pulse_volume;
+    /* Owned preferred sink carried over from the existing entry, or NULL. */
+    char *device;
+    int muted;
+} stream_restore_rule_t;
+
+typedef struct {
+    stream_restore_rule_t *rules;
+    size_t count;
+    size_t capacity;
+} stream_restore_rule_set_t;
+
+typedef struct {
+    uint64_t last_write_ms;
+    int has_written;
+    int pending;
+} stream_restore_schedule_t;
+
+/*
+ * Initializes a new rule set or one reset by clear(). Calling init() on a set
+ * that still owns storage would leak that storage.
+ */
+void stream_restore_rule_set_init(stream_restore_rule_set_t *rules);
+
+/*
+ * Builds one restore rule per classified identity that module-stream-restore
+ * can key on. Active applications identified by application.id or
+ * application.name contribute their exact identity value. Configuration
+ * patterns without '*' or '?' additionally contribute an application.name
+ * rule, so applications that are not running yet also start at the current
+ * mix. The group of a pattern rule is the first configuration entry matching
+ * that name, like classification of a running stream. Streams identified only
+ * by process binary or node name cannot be expressed as restore rules and are
+ * skipped. Duplicate rule names keep their first occurrence.
+ *
+ * All inputs are borrowed; classifications are cached on the applications as
+ * for classified_volume_plan_build_all(). When inventory_available is zero, only pattern
+ * rules are built. Destination must be initialized. Returns 0 on success and
+ * -1 for invalid arguments or allocation failure; failure leaves destination
+ * intact.
+ */
+int stream_restore_rule_set_build(
+    stream_restore_rule_set_t *destination,
+    active_application_inventory_t *applications,
+    const audio_stream_inventory_t *streams,
+    const config_t *configuration,
+    const chatmix_volume_targets_t *targets,
+    int inventory_available);
+
+/*
+ * Copies the device and mute preference of an existing restore entry into the
+ * rule with the same name, so rewriting the entry only changes its volume.
+ * Names without a rule are ignored. Returns 0 on success and -1 for invalid
+ * arguments or allocation failure; failure leaves the rule unchanged.
+ */
+int stream_restore_rule_set_preserve(stream_restore_rule_set_t *rules,
+                                     const char *name,
+                                     const char *device,
+                                     int muted);
+
+/* Frees owned storage. Repeated calls on an initialized set are safe. */
+void stream_restore_rule_set_clear(stream_restore_rule_set_t *rules);
+
+void stream_restore_schedule_init(stream_restore_schedule_t *schedule);
+
+/* Records that the current rules no longer match the wheel or inventory. */
+void stream_restore_schedule_request(stream_restore_schedule_t *schedule);
+
+/*
+ * Returns nonzero when a requested write may be submitted at now_ms. The
+ * first write is due immediately; later writes wait for
+ * STREAM_RESTORE_WRITE_INTERVAL_MS after the previous one.
+ */
+int stream_restore_schedule_is_due(const stream_restore_schedule_t *schedule,
+                                   uint64_t now_ms);
+
+/* Clears the pending request and starts a new rate-limit interval. */
+void stream_restore_schedule_mark_written(stream_restore_schedule_t *schedule,
+                                          uint64_t now_ms);
+
+#endif
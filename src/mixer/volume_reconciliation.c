@@ -0,0 +1,56 @@
+#include "volume_reconciliation.h"
+
+static uint64_t elapsed_ms(uint64_t start_ms, uint64_t now_ms) {
+    return now_ms >= start_ms ? now_ms - start_ms : 0;
+}
+
+static void schedule_next_pass(volume_reconciliation_t *reconciliation,
+                               uint64_t now_ms) {
+    reconciliation->in_flight = 0;
+    reconciliation->next_due_ms = now_ms + VOLUME_RECONCILIATION_INTERVAL_MS;
+}
+
+void volume_reconciliation_init(volume_reconciliation_t *reconciliation,
+                                uint64_t now_ms) {
+    if (!reconciliation) return;
+    *reconciliation = (volume_reconciliation_t){0};
+    schedule_next_pass(reconciliation, now_ms);
+}
+
+int volume_reconciliation_should_start(
+    const volume_reconciliation_t *reconciliation,
+    uint64_t now_ms) {
+    return reconciliation &&
+        !reconciliation->in_flight &&
+        now_ms >= reconciliation->next_due_ms;
+}
+
+void volume_reconciliation_begin(volume_reconciliation_t *reconciliation,
+                                 uint64_t now_ms) {
+    if (!reconciliation) return;
+    reconciliation->in_flight = 1;
+    reconciliation->started_ms = now_ms;
+}
+
+void volume_reconciliation_finish(volume_reconciliation_t *reconciliation,
+                                  uint64_t now_ms,
+                                  size_t drifted_count) {
+    if (!reconciliation || !reconciliation->in_flight) return;
+
+    uint64_t duration_ms = elapsed_ms(reconciliation->started_ms, now_ms);
+    reconciliation->pass_count++;
+    reconciliation->drifted_stream_count += drifted_count;
+    reconciliation->last_drifted_count = drifted_count;
+    reconciliation->last_duration_ms = duration_ms;
+    if (duration_ms > reconciliation->max_duration_ms) {
+        reconciliation->max_duration_ms = duration_ms;
+    }
+    schedule_next_pass(reconciliation, now_ms);
+}
+
+void volume_reconciliation_abandon(volume_reconciliation_t *reconciliation,
+                                   uint64_t now_ms) {
+    if (!reconciliation || !reconciliation->in_flight) return;
+    reconciliation->failed_pass_count++;
+    schedule_next_pass(reconciliation, now_ms);
+}
@@ -0,0 +1,57 @@
+#ifndef VOLUME_RECONCILIATION_H
+#define VOLUME_RECONCILIATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Time between the end of one drift reconciliation pass and the start of the
+ * next. Each pass costs one sink-input list request, so it is kept far below
+ * the wheel polling rate.
+ */
+#define VOLUME_RECONCILIATION_INTERVAL_MS 30000U
+
+/*
+ * Schedules low-frequency drift reconciliation passes and records their
+ * results. A pass is asynchronous: begin() is called when its list request is
+ * submitted and finish() or abandon() when the result arrives, so the caller
+ * never waits for the server. At most one pass is in flight.
+ */
+typedef struct {
+    uint64_t next_due_ms;
+    uint64_t started_ms;
+    int in_flight;
+    uint64_t pass_count;
+    uint64_t failed_pass_count;
+    uint64_t drifted_stream_count;
+    size_t last_drifted_count;
+    uint64_t last_duration_ms;
+    uint64_t max_duration_ms;
+} volume_reconciliation_t;
+
+/* Initializes state with the first pass due one interval after now_ms. */
+void volume_reconciliation_init(volume_reconciliation_t *reconciliation,
+                                uint64_t now_ms);
+
+/* Returns nonzero when no pass is in flight and the next one is due. */
+int volume_reconciliation_should_start(
+    const volume_reconciliation_t *reconciliation,
+    uint64_t now_ms);
+
+void volume_reconciliation_begin(volume_reconciliation_t *reconciliation,
+                                 uint64_t now_ms);
+
+/*
+ * Completes the in-flight pass, recording how many streams were found away
+ * from their planned volume and how long the pass took. Calls without a pass
+ * in flight are ignored.
+ */
+void volume_reconciliation_finish(volume_reconciliation_t *reconciliation,
+                                  uint64_t now_ms,
+                                  size_t drifted_count);
+
+/* Ends the in-flight pass without results and schedules the next one. */
+void volume_reconciliation_abandon(volume_reconciliation_t *reconciliation,
+                                   uint64_t now_ms);
+
+#endif
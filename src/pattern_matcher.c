@@ -42,3 +42,61 @@ int pattern_matches_text(const char *pattern, const char *text) {
 
     return *pattern_position == '\0' && *text_position == '\0';
 }
+
+void pattern_fold_case(char *destination, const char *source, size_t size) {
+    if (!destination || size == 0) return;
+
+    size_t length = 0;
+    if (source) {
+        while (length + 1 < size && source[length]) {
+            unsigned char byte = (unsigned char)source[length];
+            destination[length] = (char)(byte >= 'A' && byte <= 'Z'
+                ? byte - 'A' + 'a'
+                : byte);
+            length++;
+        }
+    }
+    destination[length] = '\0';
+}
+
+int pattern_matches_folded_text(const char *folded_pattern,
+                                const char *folded_text) {
+    if (!folded_pattern || !folded_text) return 0;
+
+    if (!strpbrk(folded_pattern, "*?")) {
+        return strcmp(folded_pattern, folded_text) == 0;
+    }
+
+    /*
+     * Greedy matching that remembers the last '*': on a mismatch the star is
+     * retried one text byte further, which never needs deeper backtracking.
+     */
+    const char *pattern_position = folded_pattern;
+    const char *text_position = folded_text;
+    const char *star_pattern = NULL;
+    const char *star_text = NULL;
+
+    while (*text_position) {
+        if (*pattern_position == '*') {
+            while (*pattern_position == '*') pattern_position++;
+            if (!*pattern_position) return 1;
+            star_pattern = pattern_position;
+            star_text = text_position;
+            continue;
+        }
+        if (*pattern_position &&
+            (*pattern_position == '?' ||
+             *pattern_position == *text_position)) {
+            pattern_position++;
+            text_position++;
+            continue;
+        }
+        if (!star_pattern) return 0;
+
+        pattern_position = star_pattern;
+        text_position = ++star_text;
+    }
+
+    while (*pattern_position == '*') pattern_position++;
+    return *pattern_position == '\0';
+}
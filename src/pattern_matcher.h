@@ -1,6 +1,8 @@
 #ifndef PATTERN_MATCHER_H
 #define PATTERN_MATCHER_H
 
+#include <stddef.h>
+
 /*
  * Returns 1 when text matches pattern and 0 otherwise. Matching is
  * case-insensitive; '*' matches zero or more characters and '?' matches
@@ -9,4 +11,18 @@
  */
 int pattern_matches_text(const char *pattern, const char *text);
 
+/*
+ * Copies source into destination with ASCII letters lowercased, truncating it
+ * to size - 1 bytes. destination is always terminated when size is nonzero.
+ */
+void pattern_fold_case(char *destination, const char *source, size_t size);
+
+/*
+ * Same result as pattern_matches_text() for a pattern and text that were both
+ * folded with pattern_fold_case() or an equivalent lowercasing, comparing
+ * plain bytes instead of folding each character again.
+ */
+int pattern_matches_folded_text(const char *folded_pattern,
+                                const char *folded_text);
+
 #endif
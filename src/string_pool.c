@@ -0,0 +1,259 @@
+#include "string_pool.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixed_pool.h"
+
+#define INITIAL_SLOT_CAPACITY 16
+
+struct string_pool_entry {
+    size_t references;
+    uint32_t hash;
+    size_t length;
+    char text[];
+};
+
+/*
+ * Fixed-capacity storage for the pool of each stream inventory. A stream
+ * holds at most eight strings, its values and their folded forms, and an
+ * upsert interns one more stream's worth before it replaces or refuses the
+ * old. The slot table needs a second block while it is rebuilt.
+ */
+#define FIXED_ENTRY_COUNT (8 * (CHATWHEEL_MAX_STREAMS + 1))
+FIXED_POOL_DEFINE(entry_pool,
+                  sizeof(string_pool_entry_t) +
+                      CHATWHEEL_MAX_PROPERTY_LENGTH + 1,
+                  FIXED_ENTRY_COUNT * CHATWHEEL_FIXED_INSTANCES)
+FIXED_POOL_DEFINE(slot_pool,
+                  4 * FIXED_ENTRY_COUNT * sizeof(string_pool_entry_t *),
+                  2 * CHATWHEEL_FIXED_INSTANCES)
+
+static unsigned char fold_byte(unsigned char byte, int fold) {
+    return fold && byte >= 'A' && byte <= 'Z' ? byte - 'A' + 'a' : byte;
+}
+
+static uint32_t hash_text(const char *text, size_t length, int fold) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= fold_byte((unsigned char)text[i], fold);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static int stored_text_equals(const char *stored,
+                              const char *text,
+                              size_t length,
+                              int fold) {
+    if (!fold) return memcmp(stored, text, length) == 0;
+    for (size_t i = 0; i < length; i++) {
+        if ((unsigned char)stored[i] !=
+            fold_byte((unsigned char)text[i], 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static string_pool_entry_t *entry_for_handle(const char *handle) {
+    return (string_pool_entry_t *)(
+        (char *)(uintptr_t)handle - offsetof(string_pool_entry_t, text));
+}
+
+static size_t entry_size(size_t length) {
+    return sizeof(string_pool_entry_t) + length + 1;
+}
+
+/* Finds text as it would be stored, lowercased first when fold is set. */
+static size_t find_text_slot(const string_pool_t *pool,
+                             const char *text,
+                             size_t length,
+                             int fold,
+                             uint32_t hash) {
+    size_t mask = pool->slot_capacity - 1;
+    size_t slot = hash & mask;
+    while (pool->slots[slot]) {
+        const string_pool_entry_t *entry = pool->slots[slot];
+        if (entry->hash == hash &&
+            entry->length == length &&
+            stored_text_equals(entry->text, text, length, fold)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void update_memory(string_pool_t *pool) {
+    memory_usage_set(
+        &pool->memory,
+        pool->bytes + pool->slot_capacity * sizeof(*pool->slots));
+}
+
+/* Rehashes every entry into a new table of new_capacity slots. */
+static int resize_slots(void *container, size_t new_capacity) {
+    string_pool_t *pool = container;
+    string_pool_entry_t **slots =
+        POOL_CALLOC(slot_pool, new_capacity, sizeof(*slots));
+    if (!slots) return -1;
+
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < pool->slot_capacity; i++) {
+        string_pool_entry_t *entry = pool->slots[i];
+        if (!entry) continue;
+
+        size_t slot = entry->hash & mask;
+        while (slots[slot]) slot = (slot + 1) & mask;
+        slots[slot] = entry;
+    }
+
+    POOL_FREE(slot_pool, pool->slots);
+    pool->slots = slots;
+    pool->slot_capacity = new_capacity;
+    update_memory(pool);
+    return 0;
+}
+
+static int ensure_slot_capacity(string_pool_t *pool, size_t entry_count) {
+    if (entry_count > SIZE_MAX / 2) return -1;
+    if (entry_count * 2 <= pool->slot_capacity) return 0;
+
+    size_t new_capacity = pool->slot_capacity > 0
+        ? pool->slot_capacity
+        : INITIAL_SLOT_CAPACITY;
+    while (new_capacity < entry_count * 2) {
+        if (new_capacity > SIZE_MAX / 2) return -1;
+        new_capacity *= 2;
+    }
+    return resize_slots(pool, new_capacity);
+}
+
+static void shrink_slots(string_pool_t *pool) {
+    memory_usage_shrink(&pool->memory,
+                        pool,
+                        resize_slots,
+                        pool->count * 2,
+                        pool->slot_capacity,
+                        INITIAL_SLOT_CAPACITY);
+}
+
+/*
+ * Empties slot with backward-shift deletion so lookups never need
+ * tombstones.
+ */
+static void erase_slot(string_pool_t *pool, size_t slot) {
+    size_t mask = pool->slot_capacity - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+
+    while (pool->slots[next]) {
+        size_t home = pool->slots[next]->hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            pool->slots[hole] = pool->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    pool->slots[hole] = NULL;
+}
+
+void string_pool_init(string_pool_t *pool) {
+    if (!pool) return;
+    *pool = (string_pool_t){0};
+}
+
+static int intern_text(string_pool_t *pool,
+                       const char *text,
+                       int fold,
+                       const char **handle) {
+    if (!handle) return -1;
+    *handle = NULL;
+    if (!pool) return -1;
+    if (!text) return 0;
+
+    size_t length = strlen(text);
+    if (length > SIZE_MAX - sizeof(string_pool_entry_t) - 1) return -1;
+#ifdef CHATWHEEL_FIXED_CAPACITY
+    if (length > CHATWHEEL_MAX_PROPERTY_LENGTH) return -1;
+#endif
+    uint32_t hash = hash_text(text, length, fold);
+
+    if (pool->slot_capacity > 0) {
+        string_pool_entry_t *existing =
+            pool->slots[find_text_slot(pool, text, length, fold, hash)];
+        if (existing) {
+            existing->references++;
+            *handle = existing->text;
+            return 0;
+        }
+    }
+
+    if (ensure_slot_capacity(pool, pool->count + 1) != 0) return -1;
+
+    string_pool_entry_t *entry = POOL_MALLOC(entry_pool, entry_size(length));
+    if (!entry) return -1;
+    entry->references = 1;
+    entry->hash = hash;
+    entry->length = length;
+    memcpy(entry->text, text, length + 1);
+    for (size_t i = 0; fold && i < length; i++) {
+        entry->text[i] = (char)fold_byte((unsigned char)text[i], 1);
+    }
+
+    pool->slots[find_text_slot(pool, text, length, fold, hash)] = entry;
+    pool->count++;
+    pool->bytes += entry_size(length);
+    pool->allocation_count++;
+    update_memory(pool);
+    *handle = entry->text;
+    return 0;
+}
+
+int string_pool_intern(string_pool_t *pool,
+                       const char *text,
+                       const char **handle) {
+    return intern_text(pool, text, 0, handle);
+}
+
+int string_pool_intern_folded(string_pool_t *pool,
+                              const char *text,
+                              const char **handle) {
+    return intern_text(pool, text, 1, handle);
+}
+
+void string_pool_release(string_pool_t *pool, const char *handle) {
+    if (!pool || !handle || pool->slot_capacity == 0) return;
+
+    string_pool_entry_t *entry = entry_for_handle(handle);
+    if (entry->references > 1) {
+        entry->references--;
+        return;
+    }
+
+    size_t mask = pool->slot_capacity - 1;
+    size_t slot = entry->hash & mask;
+    while (pool->slots[slot] != entry) {
+        if (!pool->slots[slot]) return;
+        slot = (slot + 1) & mask;
+    }
+
+    erase_slot(pool, slot);
+    pool->count--;
+    pool->bytes -= entry_size(entry->length);
+    POOL_FREE(entry_pool, entry);
+    update_memory(pool);
+    shrink_slots(pool);
+}
+
+void string_pool_clear(string_pool_t *pool) {
+    if (!pool) return;
+
+    for (size_t i = 0; i < pool->slot_capacity; i++) {
+        POOL_FREE(entry_pool, pool->slots[i]);
+    }
+    POOL_FREE(slot_pool, pool->slots);
+    string_pool_init(pool);
+}
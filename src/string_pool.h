@@ -0,0 +1,76 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memory_usage.h"
+
+typedef struct string_pool_entry string_pool_entry_t;
+
+/*
+ * Reference-counted set of immutable strings. Interning equal text returns
+ * the same handle, so two handles from one pool are equal strings exactly
+ * when the pointers are equal. Each handle is a NUL-terminated string that
+ * stays valid until its last reference is released or the pool is cleared.
+ */
+typedef struct {
+    /*
+     * Open-addressing table of entries with linear probing. slot_capacity is
+     * zero or a power of two at least twice count.
+     */
+    string_pool_entry_t **slots;
+    size_t slot_capacity;
+    /* Number of distinct strings currently stored. */
+    size_t count;
+    /* Heap bytes held by stored strings, including per-entry headers. */
+    size_t bytes;
+    /* Total string allocations made since init(). */
+    uint64_t allocation_count;
+    /*
+     * Stored strings plus the slot table. The table shrinks when releases
+     * leave it at most an eighth full.
+     */
+    memory_usage_t memory;
+} string_pool_t;
+
+/*
+ * Initializes a new pool or one reset by clear(). Calling init() on a pool
+ * that still owns strings would leak them.
+ */
+void string_pool_init(string_pool_t *pool);
+
+/*
+ * Stores one reference to text in *handle, copying text only when the pool
+ * does not hold it yet. A NULL text stores NULL and succeeds. Returns 0 on
+ * success and -1 for invalid arguments or allocation failure; failure stores
+ * NULL and leaves the pool unchanged. Fixed-capacity builds also refuse text
+ * longer than CHATWHEEL_MAX_PROPERTY_LENGTH.
+ */
+int string_pool_intern(string_pool_t *pool,
+                       const char *text,
+                       const char **handle);
+
+/*
+ * Like string_pool_intern(), but stores text with ASCII letters lowercased.
+ * Text that is already lowercase yields the same handle as
+ * string_pool_intern(), so folding costs no allocation for it.
+ */
+int string_pool_intern_folded(string_pool_t *pool,
+                              const char *text,
+                              const char **handle);
+
+/*
+ * Drops one reference taken by string_pool_intern() or
+ * string_pool_intern_folded() and frees the string with its last reference.
+ * NULL handles are ignored.
+ */
+void string_pool_release(string_pool_t *pool, const char *handle);
+
+/*
+ * Frees every string regardless of outstanding references, invalidating all
+ * handles. Repeated calls on an initialized pool are safe.
+ */
+void string_pool_clear(string_pool_t *pool);
+
+#endif
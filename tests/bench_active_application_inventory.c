@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "active_application_inventory.h"
+#include "application_classifier.h"
+#include "pattern_matcher.h"
+
+/*
+ * Measures a full active_application_inventory_rebuild() at increasing stream
+ * counts, once with four streams per application and once with one
+ * application per stream, which is the worst case for identity grouping.
+ * A second pass classifies every application against a full configuration
+ * the way each wheel movement does, with and without the cached result.
+ */
+
+#define REBUILD_ROUNDS_TARGET 20000U
+#define CLASSIFY_ROUNDS_TARGET 20000U
+
+static const size_t stream_counts[] = {10, 100, 1000, 10000};
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static void fill_streams(audio_stream_inventory_t *streams,
+                         size_t count,
+                         size_t streams_per_application) {
+    for (size_t i = 0; i < count; i++) {
+        char name[48];
+        snprintf(name, sizeof(name), "Application %zu",
+                 i % (count / streams_per_application));
+        int result = audio_stream_inventory_upsert(
+            streams,
+            (uint32_t)i,
+            2,
+            NULL,
+            name,
+            "bench",
+            "bench-node");
+        assert(result == 0);
+        (void)result;
+    }
+}
+
+static double bench_rebuild(size_t count, size_t streams_per_application) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    fill_streams(&streams, count, streams_per_application);
+
+    unsigned int rounds = (unsigned int)(REBUILD_ROUNDS_TARGET / count);
+    if (rounds == 0) rounds = 1;
+
+    uint64_t start = now_nanoseconds();
+    for (unsigned int round = 0; round < rounds; round++) {
+        int result = active_application_inventory_rebuild(
+            &applications,
+            &streams);
+        assert(result == 0);
+        (void)result;
+    }
+    uint64_t end = now_nanoseconds();
+    assert(applications.count == count / streams_per_application);
+
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+    return (double)(end - start) / (double)rounds / 1000.0;
+}
+
+/* Classifies every application per round; returns microseconds per round. */
+static double bench_classify(active_application_inventory_t *applications,
+                             const audio_stream_inventory_t *streams,
+                             const config_t *configuration,
+                             int cached) {
+    unsigned int rounds =
+        (unsigned int)(CLASSIFY_ROUNDS_TARGET / applications->count);
+    if (rounds == 0) rounds = 1;
+
+    size_t classified = 0;
+    uint64_t start = now_nanoseconds();
+    for (unsigned int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < applications->count; i++) {
+            active_application_t *application =
+                &applications->applications[i];
+            application_classification_t result = cached
+                ? application_classifier_classify_cached(
+                      application,
+                      streams,
+                      configuration)
+                : application_classifier_classify(
+                      application,
+                      streams,
+                      configuration);
+            if (result.group != APPLICATION_GROUP_UNASSIGNED) classified++;
+        }
+    }
+    uint64_t end = now_nanoseconds();
+    assert(classified > 0);
+    (void)classified;
+    return (double)(end - start) / (double)rounds / 1000.0;
+}
+
+static void bench_classification(size_t count) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    fill_streams(&streams, count, 1);
+    int result = active_application_inventory_rebuild(&applications, &streams);
+    assert(result == 0);
+    (void)result;
+
+    /*
+     * Only the last entry matches, so every other pattern is tried first. The
+     * leading '*' makes each miss scan the whole property, as a substring
+     * pattern from a user's config would.
+     */
+    config_t configuration = {0};
+    for (int i = 0; i < MAX_APPS; i++) {
+        snprintf(configuration.apps[i].name,
+                 sizeof(configuration.apps[i].name),
+                 i + 1 < MAX_APPS ? "*Unconfigured Game %d*" : "Application *",
+                 i);
+        pattern_fold_case(configuration.apps[i].folded_name,
+                          configuration.apps[i].name,
+                          sizeof(configuration.apps[i].folded_name));
+        configuration.apps[i].is_chat = i % 2;
+    }
+    configuration.count = MAX_APPS;
+    configuration.generation = 1;
+
+    double uncached = bench_classify(
+        &applications,
+        &streams,
+        &configuration,
+        0);
+    /* Fill the caches, as the first wheel movement after a change would. */
+    bench_classify(&applications, &streams, &configuration, 1);
+    double cached = bench_classify(&applications, &streams, &configuration, 1);
+    printf("%6zu applications: %10.1f us classified, %8.1f us cached\n",
+           count,
+           uncached,
+           cached);
+
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+}
+
+int main(void) {
+    printf("active_application_inventory_rebuild (per rebuild):\n");
+    for (size_t i = 0; i < sizeof(stream_counts) / sizeof(*stream_counts);
+         i++) {
+        size_t count = stream_counts[i];
+        printf("%6zu streams: %10.1f us grouped by 4, "
+               "%10.1f us one per application\n",
+               count,
+               bench_rebuild(count, count >= 4 ? 4 : 1),
+               bench_rebuild(count, 1));
+    }
+
+    printf("\nclassification per wheel movement (%d config entries):\n",
+           MAX_APPS);
+    for (size_t i = 0; i < sizeof(stream_counts) / sizeof(*stream_counts);
+         i++) {
+        bench_classification(stream_counts[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "config.h"
+#include "headset/headset.h"
+#include "inventory_snapshot.h"
+#include "mixer/chatmix_volume.h"
+#include "mixer/mixer.h"
+
+/*
+ * Measures the per-tick volume latency of the backend this binary is linked
+ * with on the running audio server. Each tick moves the ChatMix position
+ * between two points and then processes audio events until every uncorked
+ * stream of a configured game or chat application reports its new target,
+ * as seen through the published inventory snapshot. At least one such
+ * application must be playing. The backend logs every tick to standard
+ * output, so results are written to standard error.
+ */
+
+#ifndef BENCH_AUDIO_BACKEND
+#define BENCH_AUDIO_BACKEND "unknown"
+#endif
+
+#define TICK_COUNT 200U
+#define TICK_TIMEOUT_NS 1000000000ULL
+#define POLL_INTERVAL_NS 100000L
+
+static uint64_t monotonic_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static const inventory_snapshot_stream_t *find_stream(
+    const inventory_snapshot_t *snapshot,
+    uint32_t index) {
+    for (size_t i = 0; i < snapshot->stream_count; i++) {
+        if (snapshot->streams[i].index == index) return &snapshot->streams[i];
+    }
+    return NULL;
+}
+
+/*
+ * Returns the number of uncorked classified streams when all of them report
+ * their target, and 0 while any does not or no snapshot is available.
+ */
+static size_t settled_stream_count(const chatmix_volume_targets_t *targets) {
+    inventory_snapshot_t *snapshot = acquire_inventory_snapshot();
+    if (!snapshot) return 0;
+
+    size_t settled = 0;
+    int pending = !snapshot->applications_available;
+    for (size_t i = 0; !pending && i < snapshot->application_count; i++) {
+        const inventory_snapshot_application_t *application =
+            &snapshot->applications[i];
+        if (application->group == APPLICATION_GROUP_UNASSIGNED) continue;
+        uint32_t target = application->group == APPLICATION_GROUP_GAME
+            ? targets->game.pulse
+            : targets->chat.pulse;
+        for (size_t j = 0; j < application->stream_count; j++) {
+            const inventory_snapshot_stream_t *stream =
+                find_stream(snapshot, application->stream_indexes[j]);
+            if (!stream || stream->corked) continue;
+            if (!stream->volume_known || stream->volume != target) {
+                pending = 1;
+                break;
+            }
+            settled++;
+        }
+    }
+    inventory_snapshot_release(snapshot);
+    return pending ? 0 : settled;
+}
+
+static int compare_durations(const void *left, const void *right) {
+    uint64_t a = *(const uint64_t *)left;
+    uint64_t b = *(const uint64_t *)right;
+    return (a > b) - (a < b);
+}
+
+static double milliseconds(uint64_t nanoseconds) {
+    return (double)nanoseconds / 1000000.0;
+}
+
+int main(void) {
+    static const float positions[] = {CHATMIX_MIN + 32, CHATMIX_MAX - 32};
+    static uint64_t durations[TICK_COUNT];
+    const struct timespec poll_interval = {0, POLL_INTERVAL_NS};
+
+    if (load_config() != 0) {
+        fprintf(stderr, "Failed to load the configuration\n");
+        return 1;
+    }
+    if (initialize_audio_server() != 0) {
+        fprintf(stderr, "Failed to initialize the %s backend\n",
+                BENCH_AUDIO_BACKEND);
+        return 1;
+    }
+
+    unsigned int timeouts = 0;
+    size_t stream_count = 0;
+    for (unsigned int tick = 0; tick < TICK_COUNT; tick++) {
+        chatmix_volume_targets_t targets;
+        float position = positions[tick % 2];
+        chatmix_volume_targets_calculate(position, &targets);
+
+        uint64_t start = monotonic_nanoseconds();
+        adjust_volume_based_on_chatmix(position);
+        size_t settled = 0;
+        uint64_t elapsed = 0;
+        while ((settled = settled_stream_count(&targets)) == 0 &&
+               elapsed < TICK_TIMEOUT_NS) {
+            nanosleep(&poll_interval, NULL);
+            process_audio_events();
+            elapsed = monotonic_nanoseconds() - start;
+        }
+        durations[tick] = monotonic_nanoseconds() - start;
+        if (settled == 0) timeouts++;
+        if (settled > stream_count) stream_count = settled;
+    }
+    cleanup_audio_server();
+
+    if (stream_count == 0) {
+        fprintf(stderr,
+                "%s backend: no playing game or chat stream settled\n",
+                BENCH_AUDIO_BACKEND);
+        return 1;
+    }
+
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < TICK_COUNT; i++) total += durations[i];
+    qsort(durations, TICK_COUNT, sizeof(durations[0]), compare_durations);
+    fprintf(stderr,
+            "%s backend: %u ticks over %zu streams, mean %.3f ms, "
+            "p50 %.3f ms, p99 %.3f ms, max %.3f ms, %u timed out\n",
+            BENCH_AUDIO_BACKEND,
+            TICK_COUNT,
+            stream_count,
+            milliseconds(total / TICK_COUNT),
+            milliseconds(durations[TICK_COUNT / 2]),
+            milliseconds(durations[TICK_COUNT * 99 / 100]),
+            milliseconds(durations[TICK_COUNT - 1]),
+            timeouts);
+    return 0;
+}
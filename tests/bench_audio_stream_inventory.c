@@ -0,0 +1,321 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_stream_inventory.h"
+
+/*
+ * Measures audio_stream_inventory operations at increasing stream counts.
+ * Each size inserts every stream, looks each one up repeatedly, updates each
+ * one as a CHANGE event would, and removes them in a scrambled order. A
+ * second pass checks every stream against a volume target the way each
+ * routing tick does. A third pass replays stream churn from a few clients and
+ * compares property allocations and memory with one copy per stream and
+ * property.
+ */
+
+#define LOOKUP_ROUNDS 64U
+#define TICK_ROUNDS 64U
+#define CHURN_CLIENTS 8U
+#define CHURN_LIVE_STREAMS 256U
+#define CHURN_EVENTS 100000U
+/* Approximate allocator bookkeeping per separate heap block. */
+#define MALLOC_OVERHEAD_BYTES 16U
+
+static const size_t stream_counts[] = {10, 100, 1000, 10000};
+static const size_t tick_stream_counts[] = {100, 10000, 100000, 1000000};
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static double per_operation(uint64_t start, uint64_t end, size_t operations) {
+    return (double)(end - start) / (double)operations;
+}
+
+static uint32_t stream_index_at(size_t position) {
+    /* Sparse, increasing indexes like a long-running server hands out. */
+    return (uint32_t)(position * 7U + 100U);
+}
+
+static void bench_stream_count(size_t count) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    uint64_t start = now_nanoseconds();
+    for (size_t i = 0; i < count; i++) {
+        int result = audio_stream_inventory_upsert(
+            &inventory,
+            stream_index_at(i),
+            2,
+            "org.example.Bench",
+            "Bench",
+            "bench",
+            "bench-node");
+        assert(result == 0);
+        (void)result;
+    }
+    uint64_t inserted = now_nanoseconds();
+
+    size_t found = 0;
+    for (unsigned int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (size_t i = 0; i < count; i++) {
+            if (audio_stream_inventory_find(&inventory, stream_index_at(i))) {
+                found++;
+            }
+        }
+    }
+    uint64_t looked_up = now_nanoseconds();
+    assert(found == count * LOOKUP_ROUNDS);
+
+    for (size_t i = 0; i < count; i++) {
+        int result = audio_stream_inventory_upsert(
+            &inventory,
+            stream_index_at(i),
+            2,
+            "org.example.Bench",
+            "Bench",
+            "bench",
+            "bench-node");
+        assert(result == 0);
+        (void)result;
+    }
+    uint64_t updated = now_nanoseconds();
+
+    /* 7919 is prime and coprime to every measured count. */
+    for (size_t i = 0; i < count; i++) {
+        size_t position = (i * 7919U) % count;
+        int removed = audio_stream_inventory_remove(
+            &inventory,
+            stream_index_at(position));
+        assert(removed == 1);
+        (void)removed;
+    }
+    uint64_t removed = now_nanoseconds();
+    assert(inventory.count == 0);
+
+    printf("%6zu streams: insert %8.1f ns, find %8.1f ns, "
+           "update %8.1f ns, remove %10.1f ns\n",
+           count,
+           per_operation(start, inserted, count),
+           per_operation(inserted, looked_up, count * LOOKUP_ROUNDS),
+           per_operation(looked_up, updated, count),
+           per_operation(updated, removed, count));
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void bench_routing_tick(size_t count) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    for (size_t i = 0; i < count; i++) {
+        int result = audio_stream_inventory_upsert(
+            &inventory,
+            stream_index_at(i),
+            2,
+            "org.example.Bench",
+            "Bench",
+            "bench",
+            "bench-node");
+        assert(result == 0);
+        result = audio_stream_inventory_set_volume(
+            &inventory,
+            stream_index_at(i),
+            1,
+            (uint32_t)(i % 4));
+        assert(result == 0);
+        (void)result;
+    }
+
+    /*
+     * Mirrors classified_volume_assignment_disposition(): find the stream,
+     * then compare its volume, channel count, and cork state to the target.
+     */
+    size_t settled = 0;
+    uint64_t start = now_nanoseconds();
+    for (unsigned int round = 0; round < TICK_ROUNDS; round++) {
+        for (size_t i = 0; i < count; i++) {
+            const audio_stream_t *stream = audio_stream_inventory_find(
+                &inventory,
+                stream_index_at(i));
+            if (stream->volume_known &&
+                stream->channel_count == 2 &&
+                stream->volume == round % 4) {
+                settled++;
+            } else if (stream->corked) {
+                settled--;
+            }
+        }
+    }
+    uint64_t end = now_nanoseconds();
+    assert(settled == count * TICK_ROUNDS / 4);
+
+    printf("%7zu streams: %6.1f ns per stream, %10.1f us per tick\n",
+           count,
+           per_operation(start, end, count * TICK_ROUNDS),
+           per_operation(start, end, TICK_ROUNDS) / 1000.0);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+typedef struct {
+    const char *application_id;
+    const char *application_name;
+    const char *process_binary;
+    const char *node_name;
+} bench_client_t;
+
+static const bench_client_t churn_clients[CHURN_CLIENTS] = {
+    {"org.mozilla.firefox", "Firefox", "firefox", "Firefox"},
+    {"com.discordapp.Discord", "Discord", "Discord", "Discord"},
+    {NULL, "Counter-Strike 2", "cs2", "Counter-Strike 2"},
+    {"com.spotify.Client", "Spotify", "spotify", "spotify"},
+    {NULL, "WEBRTC VoiceEngine", "Discord", "webrtc-voice"},
+    {"org.gnome.Nautilus", "Files", "nautilus", "nautilus"},
+    {NULL, "Steam", "steamwebhelper", "Steam Voice Settings"},
+    {NULL, "wine64-preloader", "wine64-preloader", "wine-stream"},
+};
+
+static size_t nullable_length(const char *text) {
+    return text ? strlen(text) + 1 : 0;
+}
+
+static size_t copied_property_bytes(const bench_client_t *client,
+                                    size_t *allocations) {
+    const char *properties[] = {
+        client->application_id,
+        client->application_name,
+        client->process_binary,
+        client->node_name,
+    };
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizeof(properties) / sizeof(*properties); i++) {
+        if (!properties[i]) continue;
+        bytes += nullable_length(properties[i]) + MALLOC_OVERHEAD_BYTES;
+        (*allocations)++;
+    }
+    return bytes;
+}
+
+static void bench_property_churn(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    uint32_t next_index = 0;
+    uint32_t random_state = 1U;
+    size_t copied_allocations = 0;
+    size_t copied_bytes = 0;
+    size_t peak_copied_bytes = 0;
+    size_t peak_pool_bytes = 0;
+
+    for (uint32_t event = 0; event < CHURN_EVENTS; event++) {
+        random_state = random_state * 1664525U + 1013904223U;
+        uint32_t choice = random_state >> 8;
+        const audio_stream_t *stream = NULL;
+        const audio_stream_properties_t *properties = NULL;
+
+        if (inventory.count < CHURN_LIVE_STREAMS || choice % 3 == 0) {
+            const bench_client_t *client =
+                &churn_clients[choice % CHURN_CLIENTS];
+            int result = audio_stream_inventory_upsert(
+                &inventory,
+                next_index++,
+                2,
+                client->application_id,
+                client->application_name,
+                client->process_binary,
+                client->node_name);
+            assert(result == 0);
+            (void)result;
+            copied_bytes += copied_property_bytes(client,
+                                                  &copied_allocations);
+        } else if (choice % 3 == 1) {
+            /* CHANGE: the same properties are reported again. */
+            stream = &inventory.streams[choice % inventory.count];
+            properties = &inventory.properties[choice % inventory.count];
+            bench_client_t client = {
+                properties->application_id,
+                properties->application_name,
+                properties->process_binary,
+                properties->node_name,
+            };
+            size_t ignored = 0;
+            copied_bytes -= copied_property_bytes(&client, &ignored);
+            copied_bytes += copied_property_bytes(&client,
+                                                  &copied_allocations);
+            int result = audio_stream_inventory_upsert(
+                &inventory,
+                stream->index,
+                2,
+                client.application_id,
+                client.application_name,
+                client.process_binary,
+                client.node_name);
+            assert(result == 0);
+            (void)result;
+        } else {
+            stream = &inventory.streams[choice % inventory.count];
+            properties = &inventory.properties[choice % inventory.count];
+            bench_client_t client = {
+                properties->application_id,
+                properties->application_name,
+                properties->process_binary,
+                properties->node_name,
+            };
+            size_t ignored = 0;
+            copied_bytes -= copied_property_bytes(&client, &ignored);
+            int removed = audio_stream_inventory_remove(
+                &inventory,
+                stream->index);
+            assert(removed == 1);
+            (void)removed;
+        }
+
+        size_t pool_bytes = inventory.strings.bytes +
+            inventory.strings.count * MALLOC_OVERHEAD_BYTES +
+            inventory.strings.slot_capacity *
+                sizeof(*inventory.strings.slots);
+        if (copied_bytes > peak_copied_bytes) {
+            peak_copied_bytes = copied_bytes;
+        }
+        if (pool_bytes > peak_pool_bytes) peak_pool_bytes = pool_bytes;
+    }
+
+    printf("\nproperty churn (%u events, %u clients, ~%u live streams):\n",
+           CHURN_EVENTS,
+           CHURN_CLIENTS,
+           CHURN_LIVE_STREAMS);
+    printf("  string allocations: %zu copied, %" PRIu64 " interned\n",
+           copied_allocations,
+           inventory.strings.allocation_count);
+    printf("  peak property memory: %zu bytes copied, %zu bytes interned\n",
+           peak_copied_bytes,
+           peak_pool_bytes);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+int main(void) {
+    printf("audio_stream_inventory (per operation):\n");
+    for (size_t i = 0; i < sizeof(stream_counts) / sizeof(*stream_counts);
+         i++) {
+        bench_stream_count(stream_counts[i]);
+    }
+    printf("\nrouting tick volume check (%zu-byte stream record):\n",
+           sizeof(audio_stream_t));
+    for (size_t i = 0;
+         i < sizeof(tick_stream_counts) / sizeof(*tick_stream_counts);
+         i++) {
+        bench_routing_tick(tick_stream_counts[i]);
+    }
+    bench_property_churn();
+    return 0;
+}
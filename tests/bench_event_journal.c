@@ -0,0 +1,91 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "application_group.h"
+#include "event_journal.h"
+
+/*
+ * Compares recording one submitted volume in the event journal with the
+ * printf() line apply_classified_volume_plan() wrote for it before, sent to
+ * /dev/null so no terminal or log speed is measured.
+ */
+
+#define SUBMISSION_COUNT 1000000U
+#define ROUND_COUNT 5
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t time_printf(FILE *output) {
+    uint64_t start = now_nanoseconds();
+    for (uint32_t i = 0; i < SUBMISSION_COUNT; i++) {
+        fprintf(output,
+                "\n%s PulseAudio stream %u (%s)",
+                "Submitted volume for",
+                i % 64,
+                i % 2 == 0 ? "Chat" : "Game");
+    }
+    fflush(output);
+    return now_nanoseconds() - start;
+}
+
+static uint64_t time_journal(event_journal_t *journal) {
+    uint64_t start = now_nanoseconds();
+    for (uint32_t i = 0; i < SUBMISSION_COUNT; i++) {
+        event_journal_append(journal,
+                             EVENT_JOURNAL_VOLUME_SUBMITTED,
+                             i % 64,
+                             i % 2 == 0 ? APPLICATION_GROUP_CHAT
+                                        : APPLICATION_GROUP_GAME,
+                             32768,
+                             2);
+    }
+    return now_nanoseconds() - start;
+}
+
+int main(void) {
+    char directory[] = "/tmp/chatwheel-bench-XXXXXX";
+    assert(mkdtemp(directory) != NULL);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/events.journal", directory);
+
+    event_journal_t journal;
+    int result = event_journal_open(
+        &journal, path, EVENT_JOURNAL_DEFAULT_CAPACITY, 0);
+    assert(result == 0);
+    FILE *null_output = fopen("/dev/null", "w");
+    assert(null_output != NULL);
+    (void)result;
+
+    uint64_t best_printf = UINT64_MAX;
+    uint64_t best_journal = UINT64_MAX;
+    for (int round = 0; round < ROUND_COUNT; round++) {
+        uint64_t printf_time = time_printf(null_output);
+        uint64_t journal_time = time_journal(&journal);
+        if (printf_time < best_printf) best_printf = printf_time;
+        if (journal_time < best_journal) best_journal = journal_time;
+    }
+
+    printf("volume submission record (%u per round, best of %d):\n",
+           SUBMISSION_COUNT,
+           ROUND_COUNT);
+    printf("  printf to /dev/null: %6.1f ns per submission\n",
+           (double)best_printf / SUBMISSION_COUNT);
+    printf("  event journal:       %6.1f ns per submission\n",
+           (double)best_journal / SUBMISSION_COUNT);
+
+    fclose(null_output);
+    event_journal_close(&journal);
+    unlink(path);
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,326 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mixer/sink_input_request_pool.h"
+
+/*
+ * Replays subscription traffic with thousands of stream information requests
+ * in flight. Every step one request completes, a new one is sent, and every
+ * eighth step a stream is removed and its requests cancelled; requests are
+ * reaped after each step as after a mainloop iteration. The mixer's former
+ * handling, a calloc() per request on a list that is polled on every reap
+ * and scanned on every removal, is compared with the request pool, whose
+ * operations queue themselves on completion and whose removals cancel
+ * through the tracker's per-index requests.
+ */
+
+#define STEP_COUNT 20000U
+#define REMOVE_INTERVAL 8U
+#define REQUESTS_PER_INDEX 4U
+
+enum {
+    OPERATION_RUNNING,
+    OPERATION_DONE,
+    OPERATION_CANCELLED,
+};
+
+/* Stands in for libpulse's operation and its state callback. */
+struct pa_operation {
+    int state;
+    void (*state_callback)(struct pa_operation *operation, void *userdata);
+    void *userdata;
+    /* Position among the running operations, to complete one at random. */
+    size_t running_slot;
+    struct pa_operation *next_free;
+};
+
+typedef struct {
+    struct pa_operation *operations;
+    struct pa_operation *free_operations;
+    struct pa_operation **running;
+    size_t running_count;
+    uint32_t random_state;
+} server_t;
+
+typedef struct {
+    uint64_t nanoseconds;
+    uint64_t requests_visited;
+    uint64_t cancelled;
+} replay_cost_t;
+
+struct legacy_request {
+    sink_input_request_token_t token;
+    struct pa_operation *operation;
+    int result_received;
+    struct legacy_request *next;
+};
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1103515245U + 12345U;
+    return *state >> 8;
+}
+
+static void server_init(server_t *server, size_t capacity) {
+    server->operations = calloc(capacity, sizeof(*server->operations));
+    server->running = calloc(capacity, sizeof(*server->running));
+    assert(server->operations && server->running);
+    server->free_operations = NULL;
+    for (size_t i = capacity; i > 0; i--) {
+        server->operations[i - 1].next_free = server->free_operations;
+        server->free_operations = &server->operations[i - 1];
+    }
+    server->running_count = 0;
+    server->random_state = 2024;
+}
+
+static void server_clear(server_t *server) {
+    free(server->operations);
+    free(server->running);
+}
+
+static struct pa_operation *server_send(server_t *server, void *userdata) {
+    struct pa_operation *operation = server->free_operations;
+    assert(operation);
+    server->free_operations = operation->next_free;
+    operation->state = OPERATION_RUNNING;
+    operation->state_callback = NULL;
+    operation->userdata = userdata;
+    operation->running_slot = server->running_count;
+    server->running[server->running_count++] = operation;
+    return operation;
+}
+
+static void server_finish(server_t *server,
+                          struct pa_operation *operation,
+                          int state) {
+    size_t slot = operation->running_slot;
+    server->running[slot] = server->running[--server->running_count];
+    server->running[slot]->running_slot = slot;
+    operation->state = state;
+    if (operation->state_callback) {
+        operation->state_callback(operation, operation->userdata);
+    }
+}
+
+static void server_complete_random(server_t *server) {
+    size_t slot = next_random(&server->random_state) % server->running_count;
+    server_finish(server, server->running[slot], OPERATION_DONE);
+}
+
+static void server_release(server_t *server, struct pa_operation *operation) {
+    operation->next_free = server->free_operations;
+    server->free_operations = operation;
+}
+
+static uint32_t random_index(server_t *server, size_t pending) {
+    return next_random(&server->random_state) %
+        (uint32_t)(pending / REQUESTS_PER_INDEX);
+}
+
+static void legacy_send(server_t *server,
+                        sink_input_request_tracker_t *tracker,
+                        struct legacy_request **pending,
+                        uint32_t index) {
+    struct legacy_request *request = calloc(1, sizeof(*request));
+    assert(request);
+    int result = sink_input_request_tracker_begin(
+        tracker, index, SINK_INPUT_REQUEST_CHANGE, &request->token);
+    assert(result == 0);
+    (void)result;
+    request->next = *pending;
+    *pending = request;
+    request->operation = server_send(server, request);
+}
+
+static void legacy_reap(server_t *server,
+                        sink_input_request_tracker_t *tracker,
+                        struct legacy_request **pending,
+                        replay_cost_t *cost) {
+    struct legacy_request **position = pending;
+    while (*position) {
+        struct legacy_request *request = *position;
+        cost->requests_visited++;
+        if (request->operation->state == OPERATION_RUNNING) {
+            position = &request->next;
+            continue;
+        }
+
+        *position = request->next;
+        sink_input_request_tracker_finish(tracker, &request->token);
+        server_release(server, request->operation);
+        free(request);
+    }
+}
+
+static replay_cost_t replay_legacy(size_t pending_count) {
+    server_t server;
+    sink_input_request_tracker_t tracker;
+    struct legacy_request *pending = NULL;
+    replay_cost_t cost = {0};
+    server_init(&server, pending_count + 1);
+    sink_input_request_tracker_init(&tracker);
+    for (size_t i = 0; i < pending_count; i++) {
+        legacy_send(&server, &tracker, &pending,
+                    random_index(&server, pending_count));
+    }
+
+    uint64_t start = now_nanoseconds();
+    for (uint32_t step = 0; step < STEP_COUNT; step++) {
+        server_complete_random(&server);
+        legacy_reap(&server, &tracker, &pending, &cost);
+        if (step % REMOVE_INTERVAL == 0) {
+            uint32_t index = random_index(&server, pending_count);
+            sink_input_request_tracker_invalidate(&tracker, index);
+            for (struct legacy_request *request = pending;
+                 request;
+                 request = request->next) {
+                cost.requests_visited++;
+                if (request->token.index == index &&
+                    request->operation->state == OPERATION_RUNNING) {
+                    server_finish(&server,
+                                  request->operation,
+                                  OPERATION_CANCELLED);
+                    cost.cancelled++;
+                }
+            }
+            legacy_reap(&server, &tracker, &pending, &cost);
+        }
+        /* New requests keep the number in flight steady. */
+        while (server.running_count < pending_count) {
+            legacy_send(&server, &tracker, &pending,
+                        random_index(&server, pending_count));
+        }
+    }
+    cost.nanoseconds = now_nanoseconds() - start;
+
+    legacy_reap(&server, &tracker, &pending, &cost);
+    while (pending) {
+        struct legacy_request *next = pending->next;
+        sink_input_request_tracker_finish(&tracker, &pending->token);
+        free(pending);
+        pending = next;
+    }
+    sink_input_request_tracker_clear(&tracker);
+    server_clear(&server);
+    return cost;
+}
+
+/* The daemon's pool is static as well. */
+static sink_input_request_pool_t *completion_pool;
+
+static void pooled_state_cb(struct pa_operation *operation, void *userdata) {
+    if (operation->state == OPERATION_RUNNING) return;
+    sink_input_request_pool_complete(completion_pool, userdata);
+}
+
+static void pooled_send(server_t *server,
+                        sink_input_request_tracker_t *tracker,
+                        sink_input_request_pool_t *pool,
+                        uint32_t index) {
+    sink_input_info_request_t *request = sink_input_request_pool_acquire(pool);
+    assert(request);
+    int result = sink_input_request_tracker_begin(
+        tracker, index, SINK_INPUT_REQUEST_CHANGE, &request->token);
+    assert(result == 0);
+    (void)result;
+    request->operation = server_send(server, request);
+    request->operation->state_callback = pooled_state_cb;
+}
+
+static void pooled_reap(server_t *server,
+                        sink_input_request_tracker_t *tracker,
+                        sink_input_request_pool_t *pool,
+                        replay_cost_t *cost) {
+    sink_input_info_request_t *request;
+    while ((request = sink_input_request_pool_take_completed(pool))) {
+        cost->requests_visited++;
+        sink_input_request_tracker_finish(tracker, &request->token);
+        server_release(server, request->operation);
+        sink_input_request_pool_release(pool, request);
+    }
+}
+
+static replay_cost_t replay_pooled(size_t pending_count) {
+    server_t server;
+    sink_input_request_tracker_t tracker;
+    sink_input_request_pool_t pool;
+    replay_cost_t cost = {0};
+    server_init(&server, pending_count + 1);
+    sink_input_request_tracker_init(&tracker);
+    sink_input_request_pool_init(&pool);
+    completion_pool = &pool;
+    for (size_t i = 0; i < pending_count; i++) {
+        pooled_send(&server, &tracker, &pool,
+                    random_index(&server, pending_count));
+    }
+
+    uint64_t start = now_nanoseconds();
+    for (uint32_t step = 0; step < STEP_COUNT; step++) {
+        server_complete_random(&server);
+        pooled_reap(&server, &tracker, &pool, &cost);
+        if (step % REMOVE_INTERVAL == 0) {
+            uint32_t index = random_index(&server, pending_count);
+            sink_input_request_tracker_invalidate(&tracker, index);
+            for (sink_input_request_token_t *token =
+                     sink_input_request_tracker_first_request(&tracker,
+                                                              index);
+                 token;
+                 token = token->next) {
+                sink_input_info_request_t *request =
+                    sink_input_request_from_token(token);
+                cost.requests_visited++;
+                if (request->operation->state == OPERATION_RUNNING) {
+                    server_finish(&server,
+                                  request->operation,
+                                  OPERATION_CANCELLED);
+                    cost.cancelled++;
+                }
+            }
+            pooled_reap(&server, &tracker, &pool, &cost);
+        }
+        while (server.running_count < pending_count) {
+            pooled_send(&server, &tracker, &pool,
+                        random_index(&server, pending_count));
+        }
+    }
+    cost.nanoseconds = now_nanoseconds() - start;
+
+    sink_input_request_tracker_clear(&tracker);
+    sink_input_request_pool_clear(&pool);
+    server_clear(&server);
+    return cost;
+}
+
+int main(void) {
+    static const size_t pending_counts[] = {64, 1024, 4096, 16384};
+
+    printf("request reaping over %u steps, a removal every %u steps:\n",
+           STEP_COUNT,
+           REMOVE_INTERVAL);
+    for (size_t i = 0; i < sizeof(pending_counts) / sizeof(*pending_counts);
+         i++) {
+        size_t pending_count = pending_counts[i];
+        replay_cost_t legacy = replay_legacy(pending_count);
+        replay_cost_t pooled = replay_pooled(pending_count);
+        assert(legacy.cancelled == pooled.cancelled);
+        printf("%6zu in flight: list %9.1f ns/step, %10.1f visits/step; "
+               "pool %6.1f ns/step, %4.1f visits/step\n",
+               pending_count,
+               (double)legacy.nanoseconds / STEP_COUNT,
+               (double)legacy.requests_visited / STEP_COUNT,
+               (double)pooled.nanoseconds / STEP_COUNT,
+               (double)pooled.requests_visited / STEP_COUNT);
+    }
+    return 0;
+}
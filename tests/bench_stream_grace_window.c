@@ -0,0 +1,209 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "active_application_inventory.h"
+#include "mixer/stream_grace_window.h"
+
+/*
+ * Replays synthetic churn traces of new and removed sink inputs, once handling
+ * every new stream immediately and once through a grace window. Each
+ * materialized stream costs one info request, an inventory and application
+ * update, and one volume write; its removal costs another update. The timed
+ * work is the inventory side, and the server roundtrips are counted.
+ */
+
+#define TRACE_STREAM_COUNT 20000U
+#define POLL_INTERVAL_MS 100U
+#define GRACE_MS 250U
+#define RESIDENT_STREAM_COUNT 64U
+#define SHORT_LIFETIME_MIN_MS 20U
+#define SHORT_LIFETIME_SPAN_MS 380U
+#define LONG_LIFETIME_MS 600000U
+
+typedef struct {
+    uint64_t time_ms;
+    uint32_t index;
+    int is_new;
+} trace_event_t;
+
+typedef struct {
+    const char *name;
+    /* Share of streams with a short lifetime, in percent. */
+    unsigned int short_percent;
+    /* Mean gap between new streams. */
+    unsigned int arrival_gap_ms;
+} trace_shape_t;
+
+typedef struct {
+    uint64_t nanoseconds;
+    uint64_t info_requests;
+    uint64_t volume_writes;
+} replay_cost_t;
+
+static const trace_shape_t trace_shapes[] = {
+    {"notification blips", 95, 40},
+    {"game sound effects", 70, 10},
+    {"long-lived streams", 5, 200},
+};
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1103515245U + 12345U;
+    return *state >> 8;
+}
+
+static int compare_events(const void *left, const void *right) {
+    const trace_event_t *a = left;
+    const trace_event_t *b = right;
+    if (a->time_ms != b->time_ms) return a->time_ms < b->time_ms ? -1 : 1;
+    /* A stream's NEW sorts before its REMOVE at the same millisecond. */
+    return b->is_new - a->is_new;
+}
+
+static trace_event_t *build_trace(const trace_shape_t *shape, size_t *count) {
+    trace_event_t *events = malloc(
+        2 * TRACE_STREAM_COUNT * sizeof(*events));
+    assert(events);
+
+    uint32_t random_state = 2024;
+    uint64_t arrival_ms = 0;
+    for (uint32_t i = 0; i < TRACE_STREAM_COUNT; i++) {
+        arrival_ms += next_random(&random_state) %
+            (2 * shape->arrival_gap_ms + 1);
+        int is_short =
+            next_random(&random_state) % 100 < shape->short_percent;
+        uint64_t lifetime_ms = is_short
+            ? SHORT_LIFETIME_MIN_MS +
+                  next_random(&random_state) % SHORT_LIFETIME_SPAN_MS
+            : LONG_LIFETIME_MS;
+        uint32_t index = RESIDENT_STREAM_COUNT + i;
+        events[2 * i] = (trace_event_t){arrival_ms, index, 1};
+        events[2 * i + 1] =
+            (trace_event_t){arrival_ms + lifetime_ms, index, 0};
+    }
+
+    *count = 2 * TRACE_STREAM_COUNT;
+    qsort(events, *count, sizeof(*events), compare_events);
+    return events;
+}
+
+static void materialize(audio_stream_inventory_t *streams,
+                        active_application_inventory_t *applications,
+                        uint32_t index,
+                        replay_cost_t *cost) {
+    char name[32];
+    snprintf(name, sizeof(name), "Effect %u", index % 8);
+    int result = audio_stream_inventory_upsert(
+        streams, index, 2, NULL, name, "game", NULL);
+    assert(result == 0);
+    result = active_application_inventory_upsert_stream(
+        applications, streams, index);
+    assert(result == 0);
+    (void)result;
+    cost->info_requests++;
+    cost->volume_writes++;
+}
+
+static void dematerialize(audio_stream_inventory_t *streams,
+                          active_application_inventory_t *applications,
+                          uint32_t index) {
+    audio_stream_inventory_remove(streams, index);
+    int result = active_application_inventory_remove_stream(
+        applications, streams, index);
+    assert(result == 0);
+    (void)result;
+}
+
+static replay_cost_t replay(const trace_event_t *events,
+                            size_t count,
+                            unsigned int grace_ms) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    stream_grace_window_t window;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    stream_grace_window_init(&window);
+    replay_cost_t cost = {0};
+
+    for (uint32_t i = 0; i < RESIDENT_STREAM_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Resident %u", i);
+        int result = audio_stream_inventory_upsert(
+            &streams, i, 2, NULL, name, NULL, NULL);
+        assert(result == 0);
+        (void)result;
+    }
+    int result = active_application_inventory_rebuild(&applications, &streams);
+    assert(result == 0);
+    (void)result;
+
+    uint64_t start = now_nanoseconds();
+    uint64_t next_poll_ms = POLL_INTERVAL_MS;
+    for (size_t i = 0; i < count; i++) {
+        const trace_event_t *event = &events[i];
+        /* The daemon materializes due streams once per poll. */
+        while (grace_ms > 0 && next_poll_ms <= event->time_ms) {
+            uint32_t index;
+            while (stream_grace_window_take_due(
+                       &window, next_poll_ms, grace_ms, &index)) {
+                materialize(&streams, &applications, index, &cost);
+            }
+            next_poll_ms += POLL_INTERVAL_MS;
+        }
+
+        if (event->is_new) {
+            if (grace_ms > 0 &&
+                stream_grace_window_add(
+                    &window, event->index, event->time_ms) == 0) {
+                continue;
+            }
+            materialize(&streams, &applications, event->index, &cost);
+        } else if (!stream_grace_window_drop(&window, event->index)) {
+            dematerialize(&streams, &applications, event->index);
+        }
+    }
+    cost.nanoseconds = now_nanoseconds() - start;
+
+    stream_grace_window_clear(&window);
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+    return cost;
+}
+
+int main(void) {
+    printf("churn replay of %u new streams "
+           "(%u resident, %u ms grace window):\n",
+           TRACE_STREAM_COUNT,
+           RESIDENT_STREAM_COUNT,
+           GRACE_MS);
+    for (size_t i = 0; i < sizeof(trace_shapes) / sizeof(*trace_shapes);
+         i++) {
+        const trace_shape_t *shape = &trace_shapes[i];
+        size_t count;
+        trace_event_t *events = build_trace(shape, &count);
+        replay_cost_t eager = replay(events, count, 0);
+        replay_cost_t deferred = replay(events, count, GRACE_MS);
+        printf("%-20s (%2u%% short): immediate %8.1f us, %6llu requests; "
+               "deferred %8.1f us, %6llu requests\n",
+               shape->name,
+               shape->short_percent,
+               (double)eager.nanoseconds / 1000.0,
+               (unsigned long long)(eager.info_requests +
+                                    eager.volume_writes),
+               (double)deferred.nanoseconds / 1000.0,
+               (unsigned long long)(deferred.info_requests +
+                                    deferred.volume_writes));
+        free(events);
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "active_application_inventory.h"
+#include "mixer/stream_list_resync.h"
+
+/*
+ * Replays synthetic bursts of stream events that arrive in one drain, once
+ * reading every stream with its own information request and once through the
+ * stream list resync. Per-stream handling costs a roundtrip per stream, with
+ * further events of a stream coalesced into one follow-up, an incremental
+ * application update per result, and a volume plan per new stream. The
+ * resync sends the first events on their own, then reads every stream with
+ * one list request and follows it with one rebuild and one plan. The timed
+ * work is the inventory side, and roundtrips and plans are counted.
+ */
+
+#define RESIDENT_STREAM_COUNT 64U
+#define ROUND_COUNT 200U
+
+typedef enum {
+    BURST_NEW,
+    BURST_CHANGE,
+    BURST_REMOVE,
+} burst_event_type_t;
+
+typedef struct {
+    burst_event_type_t type;
+    uint32_t index;
+} burst_event_t;
+
+typedef struct {
+    const char *name;
+    /* New streams, changes spread over them, and residents removed first. */
+    uint32_t new_count;
+    uint32_t change_count;
+    int restart;
+} burst_shape_t;
+
+typedef struct {
+    uint64_t nanoseconds;
+    uint64_t roundtrips;
+    uint64_t plans;
+} replay_cost_t;
+
+static const burst_shape_t burst_shapes[] = {
+    {"session start", 256, 0, 0},
+    {"game launch", 48, 192, 0},
+    {"server restart", RESIDENT_STREAM_COUNT, 0, 1},
+    {"small change", 8, 8, 0},
+};
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static burst_event_t *build_burst(const burst_shape_t *shape, size_t *count) {
+    size_t capacity = (shape->restart ? RESIDENT_STREAM_COUNT : 0) +
+        shape->new_count + shape->change_count;
+    burst_event_t *events = malloc(capacity * sizeof(*events));
+    assert(events);
+
+    size_t position = 0;
+    if (shape->restart) {
+        for (uint32_t i = 0; i < RESIDENT_STREAM_COUNT; i++) {
+            events[position++] = (burst_event_t){BURST_REMOVE, i};
+        }
+    }
+    for (uint32_t i = 0; i < shape->new_count; i++) {
+        uint32_t index = RESIDENT_STREAM_COUNT + i;
+        events[position++] = (burst_event_t){BURST_NEW, index};
+        /* Changes follow their stream, as when it starts playing. */
+        uint32_t changes = shape->change_count / shape->new_count;
+        if (i < shape->change_count % shape->new_count) changes++;
+        for (uint32_t j = 0; j < changes; j++) {
+            events[position++] = (burst_event_t){BURST_CHANGE, index};
+        }
+    }
+    assert(position == capacity);
+    *count = position;
+    return events;
+}
+
+static void store_stream(audio_stream_inventory_t *streams, uint32_t index) {
+    char name[32];
+    snprintf(name, sizeof(name), "Application %u", index % 24);
+    int result = audio_stream_inventory_upsert(
+        streams, index, 2, NULL, name, "bench", NULL);
+    assert(result == 0);
+    (void)result;
+}
+
+static void fill_residents(audio_stream_inventory_t *streams,
+                           active_application_inventory_t *applications) {
+    for (uint32_t i = 0; i < RESIDENT_STREAM_COUNT; i++) {
+        store_stream(streams, i);
+    }
+    int result = active_application_inventory_rebuild(applications, streams);
+    assert(result == 0);
+    (void)result;
+}
+
+/* Reads the stream the way one information request result does. */
+static void read_stream(audio_stream_inventory_t *streams,
+                        active_application_inventory_t *applications,
+                        uint32_t index) {
+    store_stream(streams, index);
+    int result = active_application_inventory_upsert_stream(
+        applications, streams, index);
+    assert(result == 0);
+    (void)result;
+}
+
+static void remove_stream(audio_stream_inventory_t *streams,
+                          active_application_inventory_t *applications,
+                          uint32_t index) {
+    audio_stream_inventory_remove(streams, index);
+    int result = active_application_inventory_remove_stream(
+        applications, streams, index);
+    assert(result == 0);
+    (void)result;
+}
+
+/*
+ * Marks index as having a request in flight. Returns 1 for the first event
+ * of the index, which sends the request, and 2 for the second, which costs
+ * the follow-up; later events cost nothing.
+ */
+static unsigned int note_request(unsigned char *in_flight, uint32_t index) {
+    if (in_flight[index] < 2) in_flight[index]++;
+    else return 0;
+    return in_flight[index];
+}
+
+static replay_cost_t replay_per_stream(const burst_event_t *events,
+                                       size_t count,
+                                       uint32_t index_limit) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    unsigned char *in_flight = calloc(index_limit, 1);
+    assert(in_flight);
+    replay_cost_t cost = {0};
+
+    for (unsigned int round = 0; round < ROUND_COUNT; round++) {
+        fill_residents(&streams, &applications);
+        for (uint32_t i = 0; i < index_limit; i++) in_flight[i] = 0;
+
+        uint64_t start = now_nanoseconds();
+        for (size_t i = 0; i < count; i++) {
+            const burst_event_t *event = &events[i];
+            if (event->type == BURST_REMOVE) {
+                remove_stream(&streams, &applications, event->index);
+                continue;
+            }
+            unsigned int request = note_request(in_flight, event->index);
+            if (request == 0) continue;
+            cost.roundtrips++;
+            read_stream(&streams, &applications, event->index);
+            if (event->type == BURST_NEW) cost.plans++;
+        }
+        cost.nanoseconds += now_nanoseconds() - start;
+
+        active_application_inventory_clear(&applications);
+        audio_stream_inventory_clear(&streams);
+    }
+    free(in_flight);
+    return cost;
+}
+
+static replay_cost_t replay_resync(const burst_event_t *events,
+                                   size_t count,
+                                   uint32_t index_limit) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    stream_list_resync_t resync;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    stream_list_resync_init(&resync);
+    unsigned char *in_flight = calloc(index_limit, 1);
+    unsigned char *on_server = calloc(index_limit, 1);
+    assert(in_flight && on_server);
+    replay_cost_t cost = {0};
+
+    for (unsigned int round = 0; round < ROUND_COUNT; round++) {
+        fill_residents(&streams, &applications);
+        for (uint32_t i = 0; i < index_limit; i++) {
+            in_flight[i] = 0;
+            on_server[i] = i < RESIDENT_STREAM_COUNT;
+        }
+
+        uint64_t start = now_nanoseconds();
+        stream_list_resync_begin_drain(&resync);
+        for (size_t i = 0; i < count; i++) {
+            const burst_event_t *event = &events[i];
+            if (event->type == BURST_REMOVE) {
+                on_server[event->index] = 0;
+                remove_stream(&streams, &applications, event->index);
+                continue;
+            }
+            on_server[event->index] = 1;
+            if (in_flight[event->index] > 0) {
+                note_request(in_flight, event->index);
+                continue;
+            }
+            if (stream_list_resync_absorb_event(&resync)) continue;
+            note_request(in_flight, event->index);
+            cost.roundtrips++;
+            read_stream(&streams, &applications, event->index);
+            if (event->type == BURST_NEW) cost.plans++;
+        }
+        /* Follow-ups of the requests sent are absorbed as well. */
+        for (uint32_t i = 0; i < index_limit; i++) {
+            if (in_flight[i] < 2) continue;
+            if (stream_list_resync_absorb_event(&resync)) continue;
+            cost.roundtrips++;
+            read_stream(&streams, &applications, i);
+        }
+
+        if (stream_list_resync_should_start(&resync)) {
+            stream_list_resync_begin(&resync);
+            cost.roundtrips++;
+            for (uint32_t index = 0; index < index_limit; index++) {
+                if (!on_server[index]) continue;
+                store_stream(&streams, index);
+                int result = stream_list_resync_mark_seen(&resync, index);
+                assert(result == 0);
+                (void)result;
+            }
+            stream_list_resync_finish(&resync, &streams, NULL, NULL);
+            int result = active_application_inventory_rebuild(
+                &applications, &streams);
+            assert(result == 0);
+            (void)result;
+            cost.plans++;
+        }
+        cost.nanoseconds += now_nanoseconds() - start;
+
+        active_application_inventory_clear(&applications);
+        audio_stream_inventory_clear(&streams);
+    }
+    stream_list_resync_clear(&resync);
+    free(in_flight);
+    free(on_server);
+    return cost;
+}
+
+int main(void) {
+    printf("bursts of stream events in one drain "
+           "(%u resident streams, threshold %u):\n",
+           RESIDENT_STREAM_COUNT,
+           STREAM_LIST_RESYNC_BURST_THRESHOLD);
+    for (size_t i = 0; i < sizeof(burst_shapes) / sizeof(*burst_shapes);
+         i++) {
+        const burst_shape_t *shape = &burst_shapes[i];
+        size_t count;
+        burst_event_t *events = build_burst(shape, &count);
+        uint32_t index_limit = RESIDENT_STREAM_COUNT + shape->new_count;
+        replay_cost_t per_stream =
+            replay_per_stream(events, count, index_limit);
+        replay_cost_t resync = replay_resync(events, count, index_limit);
+        printf("%-15s (%3zu events): per stream %7.1f us, %3llu roundtrips, "
+               "%3llu plans; resync %7.1f us, %3llu roundtrips, "
+               "%3llu plans\n",
+               shape->name,
+               count,
+               (double)per_stream.nanoseconds / ROUND_COUNT / 1000.0,
+               (unsigned long long)(per_stream.roundtrips / ROUND_COUNT),
+               (unsigned long long)(per_stream.plans / ROUND_COUNT),
+               (double)resync.nanoseconds / ROUND_COUNT / 1000.0,
+               (unsigned long long)(resync.roundtrips / ROUND_COUNT),
+               (unsigned long long)(resync.plans / ROUND_COUNT));
+        free(events);
+    }
+    return 0;
+}
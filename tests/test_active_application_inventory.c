@@ -362,6 +362,40 @@ static void test_application_array_grows(void) {
     audio_stream_inventory_clear(&streams);
 }
 
+static void test_interleaved_streams_group_in_first_occurrence_order(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+
+    for (uint32_t index = 0; index < 1000; index++) {
+        char application_name[32];
+        int length = snprintf(
+            application_name,
+            sizeof(application_name),
+            "Application %u",
+            (index * 7U) % 250U);
+        assert(length > 0 && (size_t)length < sizeof(application_name));
+        add_stream(&streams, index, NULL, application_name, NULL, NULL);
+    }
+    assert(active_application_inventory_rebuild(&applications, &streams) == 0);
+    assert(applications.count == 250);
+
+    for (size_t position = 0; position < applications.count; position++) {
+        const active_application_t *application =
+            active_application_inventory_get(&applications, position);
+        assert(application->stream_count == 4);
+        assert(application->stream_indexes[0] == position);
+        for (size_t i = 1; i < application->stream_count; i++) {
+            assert(application->stream_indexes[i] ==
+                   application->stream_indexes[i - 1] + 250U);
+        }
+    }
+
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+}
+
 static void test_rebuild_replaces_old_state_and_handles_invalid_source(void) {
     audio_stream_inventory_t streams;
     active_application_inventory_t applications;
@@ -449,6 +483,307 @@ static void test_cleanup_and_null_contracts(void) {
     audio_stream_inventory_clear(&streams);
 }
 
+typedef struct {
+    const char *application_id;
+    const char *application_name;
+    const char *process_binary;
+    const char *node_name;
+} property_set_t;
+
+/*
+ * Property sets that share identities while differing in display names, fall
+ * back through every identity property, or have no identity at all.
+ */
+static const property_set_t differential_properties[] = {
+    {"org.example.Player", "Player", "player", "player-node"},
+    {"org.example.Player", "Player Voice", "player", "voice-node"},
+    {NULL, "Game", "wine64-preloader", "game-node"},
+    {NULL, "Other Game", "wine64-preloader", "other-node"},
+    {NULL, NULL, "wine64-preloader", "binary-node"},
+    {NULL, NULL, NULL, "node-only"},
+    {NULL, "", "", "node-only"},
+    {NULL, "node-only", NULL, NULL},
+    {NULL, NULL, NULL, NULL},
+    {"", "", "", ""},
+};
+
+#define DIFFERENTIAL_PROPERTY_SET_COUNT \
+    (sizeof(differential_properties) / sizeof(*differential_properties))
+#define DIFFERENTIAL_INDEX_RANGE 24U
+#define DIFFERENTIAL_EVENTS 4000U
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+static void assert_inventories_equal(
+    const active_application_inventory_t *incremental,
+    const active_application_inventory_t *rebuilt) {
+    assert(incremental->count == rebuilt->count);
+    for (size_t i = 0; i < rebuilt->count; i++) {
+        const active_application_t *left = &incremental->applications[i];
+        const active_application_t *right = &rebuilt->applications[i];
+        assert(left->identity_property == right->identity_property);
+        assert(strcmp(left->identity_value, right->identity_value) == 0);
+        assert(strcmp(left->display_name, right->display_name) == 0);
+        assert(left->stream_count == right->stream_count);
+        for (size_t j = 0; j < right->stream_count; j++) {
+            assert(left->stream_indexes[j] == right->stream_indexes[j]);
+        }
+    }
+}
+
+static int is_in_strings(const active_application_inventory_t *inventory,
+                         const char *text) {
+    return text >= inventory->strings &&
+        text + strlen(text) < inventory->strings + inventory->string_used;
+}
+
+static void test_rebuild_lays_out_one_arena(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+
+    add_stream(&streams, 1, "org.example.Game", "Game", NULL, NULL);
+    add_stream(&streams, 2, NULL, "Voice", NULL, NULL);
+    add_stream(&streams, 3, "org.example.Game", "Game Audio", NULL, NULL);
+    add_stream(&streams, 4, NULL, NULL, "player", NULL);
+
+    assert(active_application_inventory_rebuild(&applications, &streams) == 0);
+    assert(applications.count == 3);
+    assert(applications.capacity == 3);
+    assert((void *)applications.stream_indexes ==
+           (void *)(applications.applications + applications.capacity));
+    assert((void *)applications.strings ==
+           (void *)(applications.stream_indexes +
+                    applications.stream_index_capacity));
+
+    const uint32_t *next_span = applications.stream_indexes;
+    for (size_t i = 0; i < applications.count; i++) {
+        const active_application_t *application =
+            &applications.applications[i];
+        assert(application->stream_indexes == next_span);
+        assert(application->stream_count < application->stream_capacity);
+        assert(is_in_strings(&applications, application->identity_value));
+        assert(is_in_strings(&applications, application->display_name));
+        next_span += application->stream_capacity;
+    }
+    assert(next_span ==
+           applications.stream_indexes + applications.stream_index_used);
+    assert(applications.stream_index_used ==
+           applications.stream_index_capacity);
+    assert(applications.string_used == applications.string_capacity);
+    assert(applications.applications[0].stream_count == 2);
+    assert(applications.applications[0].stream_indexes[1] == 3);
+
+    active_application_inventory_clear(&applications);
+    assert(applications.applications == NULL);
+    assert(applications.stream_indexes == NULL);
+    assert(applications.strings == NULL);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_incremental_growth_relocates_arena(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    active_application_inventory_t rebuilt;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    active_application_inventory_init(&rebuilt);
+
+    add_stream(&streams, 0, NULL, "Grower", NULL, NULL);
+    add_stream(&streams, 1, NULL, "Neighbour", NULL, NULL);
+    assert(active_application_inventory_rebuild(&applications, &streams) == 0);
+
+    for (uint32_t index = 2; index < 200; index++) {
+        const char *name = index % 2 == 0 ? "Grower" : "Neighbour";
+        if (index % 10 == 0) name = "Short-lived";
+        add_stream(&streams, index, NULL, name, NULL, NULL);
+        assert(active_application_inventory_upsert_stream(
+                   &applications,
+                   &streams,
+                   index) == 0);
+        if (index % 10 == 0) {
+            assert(audio_stream_inventory_remove(&streams, index) == 1);
+            assert(active_application_inventory_remove_stream(
+                       &applications,
+                       &streams,
+                       index) == 0);
+        }
+
+        assert(applications.stream_index_used <=
+               applications.stream_index_capacity);
+        assert(applications.string_used <= applications.string_capacity);
+        for (size_t i = 0; i < applications.count; i++) {
+            const active_application_t *application =
+                &applications.applications[i];
+            assert(application->stream_indexes >=
+                   applications.stream_indexes);
+            assert(application->stream_indexes +
+                       application->stream_capacity <=
+                   applications.stream_indexes +
+                       applications.stream_index_used);
+            assert(is_in_strings(&applications, application->display_name));
+        }
+    }
+
+    assert(active_application_inventory_rebuild(&rebuilt, &streams) == 0);
+    assert_inventories_equal(&applications, &rebuilt);
+    assert(applications.count == 2);
+    /* Dropped spans are reclaimed, so the arena stays near the live size. */
+    assert(applications.stream_index_capacity <=
+           4 * rebuilt.stream_index_capacity);
+
+    active_application_inventory_clear(&rebuilt);
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_mass_removal_compacts_arena(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    active_application_inventory_t rebuilt;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    active_application_inventory_init(&rebuilt);
+
+    for (uint32_t index = 0; index < 128; index++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Application %u", index % 64);
+        add_stream(&streams, index, NULL, name, NULL, NULL);
+        assert(active_application_inventory_upsert_stream(
+                   &applications,
+                   &streams,
+                   index) == 0);
+    }
+    assert(applications.count == 64);
+    size_t grown_capacity = applications.capacity;
+    size_t grown_index_capacity = applications.stream_index_capacity;
+    size_t peak_bytes = applications.memory.peak_bytes;
+    assert(applications.memory.bytes > 0);
+    assert(peak_bytes >= applications.memory.bytes);
+
+    for (uint32_t index = 0; index < 124; index++) {
+        assert(audio_stream_inventory_remove(&streams, index) == 1);
+        assert(active_application_inventory_remove_stream(
+                   &applications,
+                   &streams,
+                   index) == 0);
+    }
+    assert(applications.count == 4);
+    assert(applications.capacity < grown_capacity);
+    assert(applications.stream_index_capacity < grown_index_capacity);
+    assert(applications.memory.bytes < peak_bytes);
+    assert(applications.memory.peak_bytes == peak_bytes);
+    assert(applications.memory.shrink_count > 0);
+
+    assert(active_application_inventory_rebuild(&rebuilt, &streams) == 0);
+    assert_inventories_equal(&applications, &rebuilt);
+
+    active_application_inventory_clear(&rebuilt);
+    active_application_inventory_clear(&applications);
+    assert(applications.memory.bytes == 0);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_incremental_updates_match_full_rebuild(void) {
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        audio_stream_inventory_t streams;
+        active_application_inventory_t incremental;
+        active_application_inventory_t rebuilt;
+        audio_stream_inventory_init(&streams);
+        active_application_inventory_init(&incremental);
+        active_application_inventory_init(&rebuilt);
+        uint32_t random_state = seed;
+
+        for (uint32_t event = 0; event < DIFFERENTIAL_EVENTS; event++) {
+            uint32_t index =
+                next_random(&random_state) % DIFFERENTIAL_INDEX_RANGE;
+            if (next_random(&random_state) % 4 == 0) {
+                audio_stream_inventory_remove(&streams, index);
+                assert(active_application_inventory_remove_stream(
+                           &incremental,
+                           &streams,
+                           index) == 0);
+            } else {
+                const property_set_t *properties = &differential_properties[
+                    next_random(&random_state) %
+                    DIFFERENTIAL_PROPERTY_SET_COUNT];
+                add_stream(&streams,
+                           index,
+                           properties->application_id,
+                           properties->application_name,
+                           properties->process_binary,
+                           properties->node_name);
+                assert(active_application_inventory_upsert_stream(
+                           &incremental,
+                           &streams,
+                           index) == 0);
+            }
+
+            assert(active_application_inventory_rebuild(
+                       &rebuilt,
+                       &streams) == 0);
+            assert_inventories_equal(&incremental, &rebuilt);
+        }
+
+        active_application_inventory_clear(&rebuilt);
+        active_application_inventory_clear(&incremental);
+        audio_stream_inventory_clear(&streams);
+    }
+}
+
+static void test_incremental_contracts(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+
+    assert(active_application_inventory_upsert_stream(
+               &applications, &streams, 1) == -1);
+    assert(active_application_inventory_upsert_stream(
+               NULL, &streams, 1) == -1);
+    assert(active_application_inventory_upsert_stream(
+               &applications, NULL, 1) == -1);
+    assert(active_application_inventory_remove_stream(
+               &applications, &streams, 1) == 0);
+    assert(active_application_inventory_remove_stream(
+               NULL, &streams, 1) == -1);
+    assert(active_application_inventory_remove_stream(
+               &applications, NULL, 1) == -1);
+
+    add_stream(&streams, 5, NULL, "First", "shared", NULL);
+    add_stream(&streams, 6, NULL, NULL, "shared", NULL);
+    add_stream(&streams, 7, NULL, "Second", NULL, NULL);
+    assert(active_application_inventory_rebuild(&applications, &streams) == 0);
+
+    add_stream(&streams, 5, NULL, NULL, "shared", "renamed-node");
+    assert(active_application_inventory_upsert_stream(
+               &applications, &streams, 5) == 0);
+    assert(applications.count == 2);
+    const active_application_t *shared =
+        active_application_inventory_get(&applications, 0);
+    assert(shared->identity_property ==
+           APPLICATION_IDENTITY_PROPERTY_PROCESS_BINARY);
+    assert(strcmp(shared->display_name, "renamed-node") == 0);
+    assert(shared->stream_count == 2);
+    assert(shared->stream_indexes[0] == 5);
+    assert(shared->stream_indexes[1] == 6);
+
+    assert(audio_stream_inventory_remove(&streams, 5) == 1);
+    assert(active_application_inventory_remove_stream(
+               &applications, &streams, 5) == 0);
+    shared = active_application_inventory_get(&applications, 0);
+    assert(strcmp(shared->display_name, "shared") == 0);
+    assert(shared->stream_count == 1);
+    assert(shared->stream_indexes[0] == 6);
+
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+}
+
 int main(void) {
     test_empty_stream_inventory_builds_empty_application_inventory();
     test_one_stream_creates_owned_application();
@@ -462,8 +797,14 @@ int main(void) {
     test_duplicate_stream_index_is_not_added_twice();
     test_streams_without_identity_are_skipped();
     test_application_array_grows();
+    test_interleaved_streams_group_in_first_occurrence_order();
     test_rebuild_replaces_old_state_and_handles_invalid_source();
     test_cleanup_and_null_contracts();
+    test_rebuild_lays_out_one_arena();
+    test_incremental_growth_relocates_arena();
+    test_mass_removal_compacts_arena();
+    test_incremental_updates_match_full_rebuild();
+    test_incremental_contracts();
 
     printf("active_application_inventory tests passed\n");
     return 0;
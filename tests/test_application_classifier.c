@@ -1,4 +1,5 @@
 #include "application_classifier.h"
+#include "pattern_matcher.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -51,8 +52,10 @@ static void config_add(config_t *configuration,
 
     app_config_t *entry = &configuration->apps[configuration->count];
     memcpy(entry->name, pattern, pattern_length + 1);
+    pattern_fold_case(entry->folded_name, pattern, sizeof(entry->folded_name));
     entry->is_chat = is_chat;
     configuration->count++;
+    configuration->generation++;
 }
 
 static const active_application_t *find_application(
@@ -547,6 +550,96 @@ static void test_proton_application_classification(void) {
     fixture_clear(&fixture);
 }
 
+static void test_cached_classification_tracks_config_and_streams(void) {
+    classifier_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(&fixture, 1, NULL, "Discord", "discord", NULL);
+    fixture_rebuild_applications(&fixture);
+    active_application_t *application = &fixture.applications.applications[0];
+    assert(application->classification.configuration == NULL);
+
+    config_t configuration = {0};
+    config_add(&configuration, "discord", 1);
+    application_classification_t result =
+        application_classifier_classify_cached(
+            application,
+            &fixture.streams,
+            &configuration);
+    assert(result.group == APPLICATION_GROUP_CHAT);
+    assert(result.matched_config_index == 0);
+    assert(application->classification.configuration == &configuration);
+    assert(application->classification.generation ==
+           configuration.generation);
+
+    /* An edit that skips the generation is not seen, proving reuse. */
+    configuration.apps[0].is_chat = 0;
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &configuration);
+    assert(result.group == APPLICATION_GROUP_CHAT);
+    configuration.generation++;
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &configuration);
+    assert(result.group == APPLICATION_GROUP_GAME);
+
+    config_t other_configuration = {0};
+    other_configuration.generation = configuration.generation;
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &other_configuration);
+    assert(result.group == APPLICATION_GROUP_UNASSIGNED);
+    assert(result.matched_config_index == -1);
+
+    config_t voice_configuration = {0};
+    config_add(&voice_configuration, "voice-*", 1);
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &voice_configuration);
+    assert(result.group == APPLICATION_GROUP_UNASSIGNED);
+
+    fixture_add_stream(&fixture, 2, NULL, "Discord", NULL, "voice-node");
+    assert(active_application_inventory_upsert_stream(
+               &fixture.applications,
+               &fixture.streams,
+               2) == 0);
+    application = &fixture.applications.applications[0];
+    assert(application->classification.configuration == NULL);
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &voice_configuration);
+    assert(result.group == APPLICATION_GROUP_CHAT);
+
+    assert(audio_stream_inventory_remove(&fixture.streams, 2) == 1);
+    assert(active_application_inventory_remove_stream(
+               &fixture.applications,
+               &fixture.streams,
+               2) == 0);
+    application = &fixture.applications.applications[0];
+    assert(application->classification.configuration == NULL);
+
+    voice_configuration.count = -1;
+    result = application_classifier_classify_cached(
+        application,
+        &fixture.streams,
+        &voice_configuration);
+    assert(result.group == APPLICATION_GROUP_UNASSIGNED);
+    assert(application->classification.configuration == NULL);
+    result = application_classifier_classify_cached(
+        NULL,
+        &fixture.streams,
+        &configuration);
+    assert(result.group == APPLICATION_GROUP_UNASSIGNED);
+    assert(result.matched_config_index == -1);
+
+    fixture_clear(&fixture);
+}
+
 int main(void) {
     test_invalid_inputs_and_empty_config();
     test_malformed_inventory_structures();
@@ -557,6 +650,7 @@ int main(void) {
     test_missing_and_later_stream_indexes();
     test_configuration_precedence();
     test_proton_application_classification();
+    test_cached_classification_tracks_config_and_streams();
     printf("application_classifier tests passed\n");
     return 0;
 }
@@ -13,7 +13,7 @@ static void assert_resolution(
 }
 
 static void test_identity_uses_each_fallback_level(void) {
-    audio_stream_t stream = {
+    audio_stream_properties_t stream = {
         .application_id = "org.example.Player",
         .application_name = "Example Player",
         .process_binary = "example-player",
@@ -45,7 +45,7 @@ static void test_identity_uses_each_fallback_level(void) {
 }
 
 static void test_identity_ignores_empty_strings(void) {
-    audio_stream_t stream = {
+    audio_stream_properties_t stream = {
         .application_id = "",
         .application_name = "",
         .process_binary = "",
@@ -65,7 +65,7 @@ static void test_identity_ignores_empty_strings(void) {
 }
 
 static void test_identity_handles_all_missing_input(void) {
-    audio_stream_t stream = {0};
+    audio_stream_properties_t stream = {0};
 
     assert_resolution(
         application_identity_resolve(&stream),
@@ -78,11 +78,11 @@ static void test_identity_handles_all_missing_input(void) {
 }
 
 static void test_proton_streams_use_distinct_application_names(void) {
-    audio_stream_t first_game = {
+    audio_stream_properties_t first_game = {
         .application_name = "Game One",
         .process_binary = "wine64-preloader",
     };
-    audio_stream_t second_game = {
+    audio_stream_properties_t second_game = {
         .application_name = "Game Two",
         .process_binary = "wine64-preloader",
     };
@@ -104,7 +104,7 @@ static void test_proton_streams_use_distinct_application_names(void) {
 }
 
 static void test_minecraft_stream_uses_node_name(void) {
-    audio_stream_t stream = {
+    audio_stream_properties_t stream = {
         .node_name = "java",
     };
 
@@ -115,7 +115,7 @@ static void test_minecraft_stream_uses_node_name(void) {
 }
 
 static void test_display_name_uses_its_own_fallback_order(void) {
-    audio_stream_t stream = {
+    audio_stream_properties_t stream = {
         .application_id = "org.example.Player",
         .application_name = "Example Player",
         .process_binary = "example-player",
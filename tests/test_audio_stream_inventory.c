@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -10,9 +11,11 @@ static void test_init_and_find_empty_inventory(void) {
     audio_stream_inventory_init(&inventory);
 
     assert(inventory.streams == NULL);
+    assert(inventory.properties == NULL);
     assert(inventory.count == 0);
     assert(inventory.capacity == 0);
     assert(audio_stream_inventory_find(&inventory, 1) == NULL);
+    assert(audio_stream_inventory_find_properties(&inventory, 1) == NULL);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -20,8 +23,12 @@ static void test_init_and_find_empty_inventory(void) {
 static void test_null_inventory_contract(void) {
     audio_stream_inventory_init(NULL);
     assert(audio_stream_inventory_find(NULL, 1) == NULL);
+    assert(audio_stream_inventory_find_properties(NULL, 1) == NULL);
     assert(audio_stream_inventory_upsert(
                NULL, 1, 2, "org.example.App", "Application", "binary", "node") == -1);
+    assert(audio_stream_inventory_set_volume(NULL, 1, 1, 100) == -1);
+    assert(audio_stream_inventory_set_corked(NULL, 1, 1) == -1);
+    assert(audio_stream_inventory_defer_volume(NULL, 1) == -1);
     assert(audio_stream_inventory_remove(NULL, 1) == 0);
     audio_stream_inventory_clear(NULL);
 }
@@ -51,12 +58,14 @@ static void test_upsert_adds_and_updates_owned_strings(void) {
     node_name[0] = 'X';
 
     const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 42);
+    const audio_stream_properties_t *properties =
+        audio_stream_inventory_find_properties(&inventory, 42);
     assert(stream != NULL);
     assert(stream->channel_count == 2);
-    assert(strcmp(stream->application_id, "org.mozilla.firefox") == 0);
-    assert(strcmp(stream->application_name, "Firefox") == 0);
-    assert(strcmp(stream->process_binary, "firefox") == 0);
-    assert(strcmp(stream->node_name, "Firefox") == 0);
+    assert(strcmp(properties->application_id, "org.mozilla.firefox") == 0);
+    assert(strcmp(properties->application_name, "Firefox") == 0);
+    assert(strcmp(properties->process_binary, "firefox") == 0);
+    assert(strcmp(properties->node_name, "Firefox") == 0);
 
     assert(audio_stream_inventory_upsert(
                &inventory,
@@ -69,32 +78,43 @@ static void test_upsert_adds_and_updates_owned_strings(void) {
     assert(inventory.count == 1);
 
     stream = audio_stream_inventory_find(&inventory, 42);
+    properties = audio_stream_inventory_find_properties(&inventory, 42);
     assert(stream != NULL);
     assert(stream->channel_count == 6);
-    assert(strcmp(stream->application_id, "com.discordapp.Discord") == 0);
-    assert(strcmp(stream->application_name, "Discord") == 0);
-    assert(strcmp(stream->process_binary, "Discord") == 0);
-    assert(strcmp(stream->node_name, "discord-node") == 0);
+    assert(strcmp(properties->application_id, "com.discordapp.Discord") == 0);
+    assert(strcmp(properties->application_name, "Discord") == 0);
+    assert(strcmp(properties->process_binary, "Discord") == 0);
+    assert(strcmp(properties->node_name, "discord-node") == 0);
+    assert(strcmp(properties->folded_application_id,
+                  "com.discordapp.discord") == 0);
+    assert(strcmp(properties->folded_application_name, "discord") == 0);
+    assert(properties->folded_process_binary ==
+           properties->folded_application_name);
+    assert(properties->folded_node_name == properties->node_name);
 
     assert(audio_stream_inventory_upsert(
                &inventory, 42, 1, NULL, NULL, "discord-bin", NULL) == 0);
     assert(inventory.count == 1);
 
     stream = audio_stream_inventory_find(&inventory, 42);
+    properties = audio_stream_inventory_find_properties(&inventory, 42);
     assert(stream != NULL);
     assert(stream->channel_count == 1);
-    assert(stream->application_id == NULL);
-    assert(stream->application_name == NULL);
-    assert(strcmp(stream->process_binary, "discord-bin") == 0);
-    assert(stream->node_name == NULL);
+    assert(properties->application_id == NULL);
+    assert(properties->application_name == NULL);
+    assert(strcmp(properties->process_binary, "discord-bin") == 0);
+    assert(properties->node_name == NULL);
+    assert(properties->folded_application_id == NULL);
+    assert(properties->folded_process_binary == properties->process_binary);
 
     assert(audio_stream_inventory_upsert(
                &inventory, 42, 0, "invalid", NULL, NULL, NULL) == -1);
     stream = audio_stream_inventory_find(&inventory, 42);
+    properties = audio_stream_inventory_find_properties(&inventory, 42);
     assert(stream != NULL);
     assert(stream->channel_count == 1);
-    assert(stream->application_id == NULL);
-    assert(strcmp(stream->process_binary, "discord-bin") == 0);
+    assert(properties->application_id == NULL);
+    assert(strcmp(properties->process_binary, "discord-bin") == 0);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -108,12 +128,14 @@ static void test_null_properties_are_supported(void) {
                &inventory, 7, 1, NULL, NULL, NULL, NULL) == 0);
 
     const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 7);
+    const audio_stream_properties_t *properties =
+        audio_stream_inventory_find_properties(&inventory, 7);
     assert(stream != NULL);
     assert(stream->channel_count == 1);
-    assert(stream->application_id == NULL);
-    assert(stream->application_name == NULL);
-    assert(stream->process_binary == NULL);
-    assert(stream->node_name == NULL);
+    assert(properties->application_id == NULL);
+    assert(properties->application_name == NULL);
+    assert(properties->process_binary == NULL);
+    assert(properties->node_name == NULL);
 
     assert(audio_stream_inventory_upsert(
                &inventory,
@@ -124,12 +146,60 @@ static void test_null_properties_are_supported(void) {
                NULL,
                "music-node") == 0);
     stream = audio_stream_inventory_find(&inventory, 7);
+    properties = audio_stream_inventory_find_properties(&inventory, 7);
     assert(stream != NULL);
     assert(stream->channel_count == 2);
-    assert(strcmp(stream->application_id, "org.example.Player") == 0);
-    assert(strcmp(stream->application_name, "Music Player") == 0);
-    assert(stream->process_binary == NULL);
-    assert(strcmp(stream->node_name, "music-node") == 0);
+    assert(strcmp(properties->application_id, "org.example.Player") == 0);
+    assert(strcmp(properties->application_name, "Music Player") == 0);
+    assert(properties->process_binary == NULL);
+    assert(strcmp(properties->node_name, "music-node") == 0);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_upsert_values_follows_property_table(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    assert(strcmp(
+               audio_stream_property_keys[AUDIO_STREAM_PROPERTY_APPLICATION_ID],
+               "application.id") == 0);
+    assert(strcmp(
+               audio_stream_property_keys[AUDIO_STREAM_PROPERTY_PROCESS_BINARY],
+               "application.process.binary") == 0);
+
+    const char *values[AUDIO_STREAM_PROPERTY_COUNT] = {NULL};
+    values[AUDIO_STREAM_PROPERTY_APPLICATION_NAME] = "Firefox";
+    values[AUDIO_STREAM_PROPERTY_NODE_NAME] = "firefox-node";
+    assert(audio_stream_inventory_upsert_values(
+               &inventory, 7, 2, values) == 0);
+
+    const audio_stream_properties_t *properties =
+        audio_stream_inventory_find_properties(&inventory, 7);
+    assert(properties != NULL);
+    assert(properties->application_id == NULL);
+    assert(strcmp(properties->application_name, "Firefox") == 0);
+    assert(strcmp(properties->folded_application_name, "firefox") == 0);
+    assert(properties->process_binary == NULL);
+    assert(strcmp(properties->node_name, "firefox-node") == 0);
+
+    /* The identity wrapper stores the same layout as the table form. */
+    assert(audio_stream_inventory_upsert(
+               &inventory, 8, 2, NULL, "Firefox", NULL, "firefox-node") == 0);
+    const audio_stream_properties_t *wrapped =
+        audio_stream_inventory_find_properties(&inventory, 8);
+    assert(wrapped->application_name == properties->application_name);
+    assert(wrapped->node_name == properties->node_name);
+
+    assert(audio_stream_inventory_upsert_values(&inventory, 9, 1, NULL) == 0);
+    properties = audio_stream_inventory_find_properties(&inventory, 9);
+    assert(properties->application_name == NULL);
+    assert(properties->folded_node_name == NULL);
+
+    assert(audio_stream_inventory_upsert_values(NULL, 10, 1, values) == -1);
+    assert(audio_stream_inventory_upsert_values(&inventory, 10, 0, values) ==
+           -1);
+    assert(inventory.count == 3);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -177,16 +247,20 @@ static void test_remove_releases_entry_and_preserves_others(void) {
     assert(audio_stream_inventory_remove(&inventory, 20) == 1);
     assert(inventory.count == 2);
     const audio_stream_t *first = audio_stream_inventory_find(&inventory, 10);
+    const audio_stream_properties_t *first_properties =
+        audio_stream_inventory_find_properties(&inventory, 10);
     assert(first != NULL);
     assert(first->channel_count == 1);
-    assert(strcmp(first->application_id, "id.one") == 0);
-    assert(strcmp(first->node_name, "node-one") == 0);
+    assert(strcmp(first_properties->application_id, "id.one") == 0);
+    assert(strcmp(first_properties->node_name, "node-one") == 0);
     assert(audio_stream_inventory_find(&inventory, 20) == NULL);
     const audio_stream_t *third = audio_stream_inventory_find(&inventory, 30);
+    const audio_stream_properties_t *third_properties =
+        audio_stream_inventory_find_properties(&inventory, 30);
     assert(third != NULL);
     assert(third->channel_count == 6);
-    assert(strcmp(third->application_id, "id.three") == 0);
-    assert(strcmp(third->node_name, "node-three") == 0);
+    assert(strcmp(third_properties->application_id, "id.three") == 0);
+    assert(strcmp(third_properties->node_name, "node-three") == 0);
 
     assert(audio_stream_inventory_remove(&inventory, 20) == 0);
     assert(inventory.count == 2);
@@ -194,6 +268,249 @@ static void test_remove_releases_entry_and_preserves_others(void) {
     audio_stream_inventory_clear(&inventory);
 }
 
+static void test_removals_shrink_storage_and_keep_peak(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+    assert(inventory.memory.bytes == 0);
+
+    for (uint32_t index = 0; index < 100; index++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Stream %u", index);
+        assert(audio_stream_inventory_upsert(
+                   &inventory, index, 2, NULL, name, NULL, NULL) == 0);
+    }
+    size_t grown_capacity = inventory.capacity;
+    size_t grown_slot_capacity = inventory.slot_capacity;
+    size_t peak_bytes = inventory.memory.bytes;
+    assert(inventory.memory.peak_bytes == peak_bytes);
+    assert(inventory.strings.memory.bytes > 0);
+
+    for (uint32_t index = 0; index < 95; index++) {
+        assert(audio_stream_inventory_remove(&inventory, index) == 1);
+    }
+    assert(inventory.count == 5);
+    assert(inventory.capacity < grown_capacity);
+    assert(inventory.capacity >= inventory.count);
+    assert(inventory.slot_capacity < grown_slot_capacity);
+    assert(inventory.slot_capacity >= inventory.count * 2);
+    assert(inventory.memory.bytes < peak_bytes);
+    assert(inventory.memory.peak_bytes == peak_bytes);
+    assert(inventory.memory.shrink_count > 0);
+    assert(inventory.strings.memory.bytes <
+           inventory.strings.memory.peak_bytes);
+
+    for (uint32_t index = 95; index < 100; index++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Stream %u", index);
+        const audio_stream_properties_t *properties =
+            audio_stream_inventory_find_properties(&inventory, index);
+        assert(properties != NULL);
+        assert(strcmp(properties->application_name, name) == 0);
+    }
+
+    /* Storage settles between a quarter and half full, so churn is cheap. */
+    uint64_t shrink_count = inventory.memory.shrink_count;
+    for (int round = 0; round < 10; round++) {
+        assert(audio_stream_inventory_upsert(
+                   &inventory, 500, 2, NULL, "Churn", NULL, NULL) == 0);
+        assert(audio_stream_inventory_remove(&inventory, 500) == 1);
+    }
+    assert(inventory.memory.shrink_count == shrink_count);
+
+    audio_stream_inventory_clear(&inventory);
+    assert(inventory.memory.bytes == 0);
+    assert(inventory.memory.peak_bytes == 0);
+}
+
+static void test_volume_survives_updates_but_not_reinsertion(void) {
+    audio_stream_inventory_t inventory;
+
+    audio_stream_inventory_init(&inventory);
+    assert(audio_stream_inventory_set_volume(&inventory, 8, 1, 100) == -1);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 8, 2, NULL, "Player", NULL, NULL) == 0);
+
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 8);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
+
+    assert(audio_stream_inventory_set_volume(&inventory, 8, 1, 100) == 0);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 8, 2, NULL, "Renamed Player", NULL, NULL) == 0);
+    stream = audio_stream_inventory_find(&inventory, 8);
+    assert(stream != NULL);
+    assert(stream->volume_known);
+    assert(stream->volume == 100);
+
+    assert(audio_stream_inventory_set_volume(&inventory, 8, 0, 200) == 0);
+    stream = audio_stream_inventory_find(&inventory, 8);
+    assert(!stream->volume_known);
+    assert(stream->volume == 0);
+
+    assert(audio_stream_inventory_set_volume(&inventory, 8, 1, 300) == 0);
+    assert(audio_stream_inventory_remove(&inventory, 8) == 1);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 8, 2, NULL, "Player", NULL, NULL) == 0);
+    stream = audio_stream_inventory_find(&inventory, 8);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_deferred_volume_is_released_by_uncork(void) {
+    audio_stream_inventory_t inventory;
+
+    audio_stream_inventory_init(&inventory);
+    assert(audio_stream_inventory_set_corked(&inventory, 9, 1) == -1);
+    assert(audio_stream_inventory_defer_volume(&inventory, 9) == -1);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 9, 2, NULL, "Browser", NULL, NULL) == 0);
+
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 9);
+    assert(!stream->corked);
+    assert(!stream->volume_deferred);
+
+    assert(audio_stream_inventory_set_corked(&inventory, 9, 1) == 0);
+    assert(audio_stream_inventory_defer_volume(&inventory, 9) == 0);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 9, 2, NULL, "Browser tab", NULL, NULL) == 0);
+    stream = audio_stream_inventory_find(&inventory, 9);
+    assert(stream->corked);
+    assert(stream->volume_deferred);
+
+    assert(audio_stream_inventory_set_corked(&inventory, 9, 1) == 0);
+    assert(stream->volume_deferred);
+    assert(audio_stream_inventory_set_corked(&inventory, 9, 0) == 1);
+    assert(!stream->corked);
+    assert(!stream->volume_deferred);
+    assert(audio_stream_inventory_set_corked(&inventory, 9, 0) == 0);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_equal_properties_share_interned_strings(void) {
+    audio_stream_inventory_t inventory;
+
+    audio_stream_inventory_init(&inventory);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 1, 2, NULL, "Game", "game", "game-node") == 0);
+    assert(audio_stream_inventory_upsert(
+               &inventory, 2, 2, NULL, "Game", "game", "game-voice") == 0);
+    assert(inventory.strings.count == 4);
+
+    const audio_stream_t *first = audio_stream_inventory_find(&inventory, 1);
+    const audio_stream_properties_t *first_properties =
+        audio_stream_inventory_find_properties(&inventory, 1);
+    const audio_stream_t *second = audio_stream_inventory_find(&inventory, 2);
+    const audio_stream_properties_t *second_properties =
+        audio_stream_inventory_find_properties(&inventory, 2);
+    assert(first != NULL && second != NULL);
+    assert(first_properties->application_name ==
+           second_properties->application_name);
+    assert(first_properties->process_binary ==
+           second_properties->process_binary);
+    assert(first_properties->node_name != second_properties->node_name);
+
+    uint64_t allocations = inventory.strings.allocation_count;
+    assert(audio_stream_inventory_upsert(
+               &inventory, 1, 2, NULL, "Game", "game", "game-node") == 0);
+    assert(inventory.strings.allocation_count == allocations);
+
+    assert(audio_stream_inventory_remove(&inventory, 1) == 1);
+    assert(inventory.strings.count == 3);
+    second = audio_stream_inventory_find(&inventory, 2);
+    second_properties = audio_stream_inventory_find_properties(&inventory, 2);
+    assert(second != NULL);
+    assert(strcmp(second_properties->application_name, "Game") == 0);
+    assert(strcmp(second_properties->process_binary, "game") == 0);
+
+    assert(audio_stream_inventory_remove(&inventory, 2) == 1);
+    assert(inventory.strings.count == 0);
+    assert(inventory.strings.bytes == 0);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+#define CHURN_INDEX_RANGE 512U
+#define CHURN_OPERATIONS 20000U
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+static void test_index_matches_ordered_reference_under_churn(void) {
+    audio_stream_inventory_t inventory;
+    uint32_t reference[CHURN_INDEX_RANGE];
+    size_t reference_count = 0;
+    uint32_t random_state = 12345U;
+
+    audio_stream_inventory_init(&inventory);
+
+    for (uint32_t operation = 0; operation < CHURN_OPERATIONS; operation++) {
+        uint32_t index = next_random(&random_state) % CHURN_INDEX_RANGE;
+        /* Spread keys so they collide in the low bits of the slot table. */
+        uint32_t stream_index = index * 1024U;
+        size_t position = reference_count;
+        for (size_t i = 0; i < reference_count; i++) {
+            if (reference[i] == stream_index) position = i;
+        }
+
+        if (next_random(&random_state) % 3 == 0) {
+            int removed = audio_stream_inventory_remove(
+                &inventory,
+                stream_index);
+            assert(removed == (position < reference_count));
+            if (removed) {
+                memmove(&reference[position],
+                        &reference[position + 1],
+                        (reference_count - position - 1) *
+                            sizeof(*reference));
+                reference_count--;
+            }
+        } else {
+            assert(audio_stream_inventory_upsert(
+                       &inventory,
+                       stream_index,
+                       (operation % 8) + 1,
+                       NULL,
+                       NULL,
+                       NULL,
+                       NULL) == 0);
+            if (position == reference_count) {
+                reference[reference_count] = stream_index;
+                reference_count++;
+            }
+            const audio_stream_t *stream = audio_stream_inventory_find(
+                &inventory,
+                stream_index);
+            assert(stream != NULL);
+            assert(stream->channel_count == (operation % 8) + 1);
+        }
+
+        assert(inventory.count == reference_count);
+        assert(inventory.slot_capacity >= inventory.count * 2);
+    }
+
+    for (size_t i = 0; i < reference_count; i++) {
+        assert(inventory.streams[i].index == reference[i]);
+        assert(audio_stream_inventory_find(&inventory, reference[i]) ==
+               &inventory.streams[i]);
+        assert(audio_stream_inventory_find_properties(
+                   &inventory,
+                   reference[i]) == &inventory.properties[i]);
+    }
+    for (uint32_t index = 0; index < CHURN_INDEX_RANGE; index++) {
+        const audio_stream_t *stream = audio_stream_inventory_find(
+            &inventory,
+            index * 1024U + 1U);
+        assert(stream == NULL);
+    }
+
+    audio_stream_inventory_clear(&inventory);
+}
+
 static void test_clear_resets_inventory(void) {
     audio_stream_inventory_t inventory;
 
@@ -212,6 +529,8 @@ static void test_clear_resets_inventory(void) {
     assert(inventory.streams == NULL);
     assert(inventory.count == 0);
     assert(inventory.capacity == 0);
+    assert(inventory.slots == NULL);
+    assert(inventory.slot_capacity == 0);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -221,8 +540,14 @@ int main(void) {
     test_null_inventory_contract();
     test_upsert_adds_and_updates_owned_strings();
     test_null_properties_are_supported();
+    test_upsert_values_follows_property_table();
     test_inventory_grows();
     test_remove_releases_entry_and_preserves_others();
+    test_removals_shrink_storage_and_keep_peak();
+    test_volume_survives_updates_but_not_reinsertion();
+    test_deferred_volume_is_released_by_uncork();
+    test_equal_properties_share_interned_strings();
+    test_index_matches_ordered_reference_under_churn();
     test_clear_resets_inventory();
 
     printf("audio_stream_inventory tests passed\n");
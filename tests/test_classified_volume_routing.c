@@ -1,4 +1,5 @@
 #include "mixer/classified_volume_routing.h"
+#include "pattern_matcher.h"
 
 #include <assert.h>
 #include <pulse/sample.h>
@@ -71,8 +72,10 @@ static void config_add(config_t *configuration,
 
     app_config_t *entry = &configuration->apps[configuration->count];
     memcpy(entry->name, pattern, length + 1);
+    pattern_fold_case(entry->folded_name, pattern, sizeof(entry->folded_name));
     entry->is_chat = is_chat;
     configuration->count++;
+    configuration->generation++;
 }
 
 static chatmix_volume_targets_t calculate_targets(float raw) {
@@ -303,6 +306,73 @@ static void test_new_stream_routes_complete_containing_application(void) {
     fixture_clear(&fixture);
 }
 
+static void test_drain_streams_route_in_one_plan(void) {
+    routing_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(
+        &fixture, 40, "org.example.Voice", "Voice", "voice", NULL);
+    fixture_add_stream(
+        &fixture, 41, "org.example.Game", "Game", "game", NULL);
+    fixture_add_stream(
+        &fixture, 42, "org.example.Voice", "Voice", "voice", NULL);
+    fixture_add_stream(
+        &fixture, 43, "org.example.Music", "Music", "music", NULL);
+    fixture_add_stream(
+        &fixture, 44, "org.example.Other", "Other", "other", NULL);
+    fixture_rebuild(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "org.example.Voice", 1);
+    config_add(&configuration, "org.example.Game", 0);
+    config_add(&configuration, "org.example.Music", 0);
+    chatmix_volume_targets_t targets = calculate_targets(30.0f);
+    classified_volume_plan_t plan;
+    classified_volume_plan_init(&plan);
+
+    /* Both Voice streams are listed, yet the application is planned once. */
+    const uint32_t drained[] = {40, 42, 43, 44, 99};
+    assert(classified_volume_plan_build_for_streams(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1,
+               drained,
+               sizeof(drained) / sizeof(*drained)) == 0);
+    assert(plan.count == 3);
+    expect_assignment_at(
+        &plan, 0, 40, 2, APPLICATION_GROUP_CHAT, targets.chat.pulse);
+    expect_assignment_at(
+        &plan, 1, 42, 2, APPLICATION_GROUP_CHAT, targets.chat.pulse);
+    expect_assignment_at(
+        &plan, 2, 43, 2, APPLICATION_GROUP_GAME, targets.game.pulse);
+    assert(find_assignment(&plan, 41) == NULL);
+
+    assert(classified_volume_plan_build_for_streams(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1,
+               NULL,
+               0) == 0);
+    assert(plan.count == 0);
+    assert(classified_volume_plan_build_for_streams(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1,
+               NULL,
+               1) == -1);
+
+    classified_volume_plan_clear(&plan);
+    fixture_clear(&fixture);
+}
+
 static void test_unavailable_inventory_produces_no_assignments(void) {
     routing_fixture_t fixture;
     fixture_init(&fixture);
@@ -746,16 +816,153 @@ static void test_proton_identity_and_java_fallback(void) {
     fixture_clear(&fixture);
 }
 
+static void test_settled_streams_skip_submission(void) {
+    routing_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(&fixture, 60, NULL, "Game", NULL, NULL);
+    fixture_add_stream(&fixture, 61, NULL, "Game", NULL, NULL);
+    fixture_add_stream_with_channel_count(
+        &fixture, 62, 6, NULL, "Game", NULL, NULL);
+    fixture_rebuild(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Game", 0);
+    chatmix_volume_targets_t targets = calculate_targets(40.0f);
+    classified_volume_plan_t plan;
+    classified_volume_plan_init(&plan);
+    assert(classified_volume_plan_build_all(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+    assert(plan.count == 3);
+
+    assert(audio_stream_inventory_set_volume(
+               &fixture.streams, 60, 1, targets.game.pulse) == 0);
+    assert(audio_stream_inventory_set_volume(
+               &fixture.streams, 61, 1, targets.game.pulse + 1) == 0);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 60),
+               &fixture.streams) == CLASSIFIED_VOLUME_SETTLED);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 61),
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 62),
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+
+    assert(audio_stream_inventory_set_corked(&fixture.streams, 60, 1) == 0);
+    assert(audio_stream_inventory_set_corked(&fixture.streams, 61, 1) == 0);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 60),
+               &fixture.streams) == CLASSIFIED_VOLUME_SETTLED);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 61),
+               &fixture.streams) == CLASSIFIED_VOLUME_DEFERRED);
+    assert(audio_stream_inventory_set_corked(&fixture.streams, 60, 0) == 0);
+    assert(audio_stream_inventory_set_corked(&fixture.streams, 61, 0) == 0);
+
+    fixture_add_stream_with_channel_count(
+        &fixture, 60, 1, NULL, "Game", NULL, NULL);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 60),
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+
+    assert(audio_stream_inventory_remove(&fixture.streams, 61) == 1);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 61),
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+    assert(classified_volume_assignment_disposition(
+               NULL,
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+    assert(classified_volume_assignment_disposition(
+               find_assignment(&plan, 60),
+               NULL) == CLASSIFIED_VOLUME_SUBMIT);
+
+    classified_volume_plan_clear(&plan);
+    fixture_clear(&fixture);
+}
+
+static void test_returning_target_is_submitted_before_info(void) {
+    routing_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(&fixture, 70, NULL, "Game", NULL, NULL);
+    fixture_rebuild(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Game", 0);
+    chatmix_volume_targets_t first = calculate_targets(40.0f);
+    chatmix_volume_targets_t second = calculate_targets(90.0f);
+    assert(first.game.pulse != second.game.pulse);
+    classified_volume_plan_t plan;
+    classified_volume_plan_init(&plan);
+
+    /* The server reports A, the wheel moves to B and writes it. */
+    assert(audio_stream_inventory_set_volume(
+               &fixture.streams, 70, 1, first.game.pulse) == 0);
+    assert(classified_volume_plan_build_all(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &second,
+               1) == 0);
+    const classified_volume_assignment_t *assignment =
+        find_assignment(&plan, 70);
+    assert(classified_volume_assignment_disposition(
+               assignment,
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+    assert(classified_volume_assignment_submitted(assignment,
+                                                  &fixture.streams) == 0);
+
+    /* Back at A before the info of B arrives, A is written again. */
+    assert(classified_volume_plan_build_all(
+               &plan,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &first,
+               1) == 0);
+    assignment = find_assignment(&plan, 70);
+    assert(classified_volume_assignment_disposition(
+               assignment,
+               &fixture.streams) == CLASSIFIED_VOLUME_SUBMIT);
+    assert(classified_volume_assignment_submitted(assignment,
+                                                  &fixture.streams) == 0);
+
+    /* Once the server reports A, it is settled again. */
+    assert(audio_stream_inventory_set_volume(
+               &fixture.streams, 70, 1, first.game.pulse) == 0);
+    assert(classified_volume_assignment_disposition(
+               assignment,
+               &fixture.streams) == CLASSIFIED_VOLUME_SETTLED);
+
+    assert(classified_volume_assignment_submitted(NULL,
+                                                  &fixture.streams) == -1);
+    assert(classified_volume_assignment_submitted(assignment, NULL) == -1);
+    assert(audio_stream_inventory_remove(&fixture.streams, 70) == 1);
+    assert(classified_volume_assignment_submitted(assignment,
+                                                  &fixture.streams) == -1);
+
+    classified_volume_plan_clear(&plan);
+    fixture_clear(&fixture);
+}
+
 int main(void) {
     test_all_groups_and_aggregated_streams();
     test_first_config_entry_wins();
     test_missing_indexes_and_duplicate_suppression();
     test_new_stream_routes_complete_containing_application();
+    test_drain_streams_route_in_one_plan();
     test_unavailable_inventory_produces_no_assignments();
     test_empty_inventories_and_configuration();
     test_invalid_inputs_preserve_populated_plan();
     test_assignment_growth_clear_reuse_and_replacement();
     test_proton_identity_and_java_fallback();
+    test_settled_streams_skip_submission();
+    test_returning_target_is_submitted_before_info();
 
     printf("classified_volume_routing tests passed\n");
     return 0;
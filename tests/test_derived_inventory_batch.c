@@ -0,0 +1,365 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mixer/derived_inventory_batch.h"
+
+typedef struct {
+    const char *application_id;
+    const char *application_name;
+    const char *process_binary;
+    const char *node_name;
+} property_set_t;
+
+/*
+ * Property sets that share identities while differing in display names, fall
+ * back through every identity property, or have no identity at all.
+ */
+static const property_set_t drain_properties[] = {
+    {"org.example.Player", "Player", "player", "player-node"},
+    {"org.example.Player", "Player Voice", "player", "voice-node"},
+    {NULL, "Game", "wine64-preloader", "game-node"},
+    {NULL, "Other Game", "wine64-preloader", "other-node"},
+    {NULL, NULL, "wine64-preloader", "binary-node"},
+    {NULL, NULL, NULL, "node-only"},
+    {NULL, NULL, NULL, NULL},
+};
+
+#define DRAIN_PROPERTY_SET_COUNT \
+    (sizeof(drain_properties) / sizeof(*drain_properties))
+#define DRAIN_INDEX_RANGE 32U
+#define DRAIN_COUNT 400U
+
+typedef struct {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    derived_inventory_state_t state;
+    derived_inventory_batch_t batch;
+} batch_fixture_t;
+
+static void fixture_init(batch_fixture_t *fixture) {
+    audio_stream_inventory_init(&fixture->streams);
+    active_application_inventory_init(&fixture->applications);
+    derived_inventory_state_init(&fixture->state);
+    derived_inventory_batch_init(&fixture->batch);
+}
+
+/* Completes the initial snapshot with a rebuild, as the daemon does. */
+static void fixture_synchronize(batch_fixture_t *fixture) {
+    derived_inventory_state_mark_initial_snapshot_complete(&fixture->state);
+    assert(active_application_inventory_rebuild(
+               &fixture->applications,
+               &fixture->streams) == 0);
+    derived_inventory_state_set_rebuild_result(&fixture->state, 1);
+}
+
+static void fixture_clear(batch_fixture_t *fixture) {
+    derived_inventory_batch_clear(&fixture->batch);
+    active_application_inventory_clear(&fixture->applications);
+    audio_stream_inventory_clear(&fixture->streams);
+}
+
+static void store_stream(batch_fixture_t *fixture,
+                         uint32_t index,
+                         const property_set_t *properties) {
+    assert(audio_stream_inventory_upsert(
+               &fixture->streams,
+               index,
+               2,
+               properties->application_id,
+               properties->application_name,
+               properties->process_binary,
+               properties->node_name) == 0);
+}
+
+static derived_inventory_batch_result_t apply_drain(batch_fixture_t *fixture) {
+    return derived_inventory_batch_apply(&fixture->batch,
+                                         &fixture->applications,
+                                         &fixture->streams,
+                                         &fixture->state);
+}
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+static void assert_matches_rebuild(const batch_fixture_t *fixture) {
+    active_application_inventory_t rebuilt;
+    active_application_inventory_init(&rebuilt);
+    assert(active_application_inventory_rebuild(
+               &rebuilt,
+               &fixture->streams) == 0);
+
+    const active_application_inventory_t *batched = &fixture->applications;
+    assert(batched->count == rebuilt.count);
+    for (size_t i = 0; i < rebuilt.count; i++) {
+        const active_application_t *left = &batched->applications[i];
+        const active_application_t *right = &rebuilt.applications[i];
+        assert(left->identity_property == right->identity_property);
+        assert(strcmp(left->identity_value, right->identity_value) == 0);
+        assert(strcmp(left->display_name, right->display_name) == 0);
+        assert(left->stream_count == right->stream_count);
+        for (size_t j = 0; j < right->stream_count; j++) {
+            assert(left->stream_indexes[j] == right->stream_indexes[j]);
+        }
+    }
+    active_application_inventory_clear(&rebuilt);
+}
+
+static void test_supported_null_arguments(void) {
+    batch_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_synchronize(&fixture);
+
+    derived_inventory_batch_init(NULL);
+    assert(derived_inventory_batch_mark(NULL, 1, 0) == -1);
+    derived_inventory_batch_mark_rebuild(NULL, 1);
+    assert(derived_inventory_batch_apply(NULL,
+                                         &fixture.applications,
+                                         &fixture.streams,
+                                         &fixture.state) ==
+           DERIVED_INVENTORY_BATCH_UNCHANGED);
+    derived_inventory_batch_mark_rebuild(&fixture.batch, 0);
+    assert(derived_inventory_batch_apply(&fixture.batch,
+                                         NULL,
+                                         &fixture.streams,
+                                         &fixture.state) ==
+           DERIVED_INVENTORY_BATCH_UNCHANGED);
+    assert(derived_inventory_batch_apply(&fixture.batch,
+                                         &fixture.applications,
+                                         &fixture.streams,
+                                         NULL) ==
+           DERIVED_INVENTORY_BATCH_UNCHANGED);
+    derived_inventory_batch_reset(NULL);
+    derived_inventory_batch_clear(NULL);
+
+    assert(fixture.batch.rebuild_count == 0);
+    fixture_clear(&fixture);
+}
+
+static void test_nothing_applies_before_initial_snapshot(void) {
+    batch_fixture_t fixture;
+    fixture_init(&fixture);
+    store_stream(&fixture, 1, &drain_properties[0]);
+
+    assert(derived_inventory_batch_mark(
+               &fixture.batch,
+               1,
+               DERIVED_INVENTORY_CHANGE_UPDATE |
+                   DERIVED_INVENTORY_CHANGE_NEW) == 0);
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UNCHANGED);
+    assert(fixture.applications.count == 0);
+    assert(fixture.batch.route_count == 0);
+    assert(fixture.batch.drain_count == 0);
+    derived_inventory_batch_reset(&fixture.batch);
+
+    /* An empty drain applies nothing either. */
+    fixture_synchronize(&fixture);
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UNCHANGED);
+    assert(fixture.batch.drain_count == 0);
+    fixture_clear(&fixture);
+}
+
+static void test_drain_updates_once_and_routes_together(void) {
+    batch_fixture_t fixture;
+    fixture_init(&fixture);
+    store_stream(&fixture, 2, &drain_properties[5]);
+    fixture_synchronize(&fixture);
+
+    /* Each new stream's result is marked twice, as after a follow-up. */
+    static const uint32_t arrivals[] = {9, 3, 7, 3, 5, 9, 1};
+    for (size_t i = 0; i < sizeof(arrivals) / sizeof(*arrivals); i++) {
+        store_stream(&fixture, arrivals[i], &drain_properties[i % 4]);
+        assert(derived_inventory_batch_mark(
+                   &fixture.batch,
+                   arrivals[i],
+                   DERIVED_INVENTORY_CHANGE_UPDATE |
+                       DERIVED_INVENTORY_CHANGE_NEW) == 0);
+    }
+    /* An uncorked stream is only routed. */
+    assert(derived_inventory_batch_mark(&fixture.batch,
+                                        2,
+                                        DERIVED_INVENTORY_CHANGE_ROUTE) == 0);
+    assert(fixture.applications.count == 1);
+    assert(fixture.batch.new_streams);
+
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UPDATED);
+    assert_matches_rebuild(&fixture);
+    assert(fixture.batch.update_count == 1);
+    assert(fixture.batch.rebuild_count == 0);
+    assert(fixture.batch.plan_count == 1);
+    assert(!fixture.batch.route_all);
+    static const uint32_t expected_routes[] = {1, 2, 3, 5, 7, 9};
+    assert(fixture.batch.route_count ==
+           sizeof(expected_routes) / sizeof(*expected_routes));
+    for (size_t i = 0; i < fixture.batch.route_count; i++) {
+        assert(fixture.batch.routes[i] == expected_routes[i]);
+    }
+
+    derived_inventory_batch_reset(&fixture.batch);
+    assert(fixture.batch.change_count == 0);
+    assert(fixture.batch.route_count == 0);
+    assert(!fixture.batch.new_streams);
+    assert(fixture.batch.marked_count == 8);
+    fixture_clear(&fixture);
+}
+
+static void test_removed_and_unsynchronized_streams_rebuild(void) {
+    batch_fixture_t fixture;
+    fixture_init(&fixture);
+    store_stream(&fixture, 1, &drain_properties[0]);
+    store_stream(&fixture, 2, &drain_properties[2]);
+    fixture_synchronize(&fixture);
+
+    /* A stream removed after it was marked is neither updated nor routed. */
+    assert(derived_inventory_batch_mark(&fixture.batch,
+                                        3,
+                                        DERIVED_INVENTORY_CHANGE_UPDATE |
+                                            DERIVED_INVENTORY_CHANGE_NEW) ==
+           0);
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UNCHANGED);
+    assert(fixture.batch.route_count == 0);
+    assert(fixture.batch.plan_count == 0);
+    derived_inventory_batch_reset(&fixture.batch);
+
+    /* A failed removal leaves the applications for one rebuild. */
+    derived_inventory_state_set_rebuild_result(&fixture.state, 0);
+    audio_stream_inventory_remove(&fixture.streams, 1);
+    derived_inventory_batch_mark_rebuild(&fixture.batch, 0);
+    store_stream(&fixture, 4, &drain_properties[1]);
+    assert(derived_inventory_batch_mark(&fixture.batch,
+                                        4,
+                                        DERIVED_INVENTORY_CHANGE_UPDATE |
+                                            DERIVED_INVENTORY_CHANGE_NEW) ==
+           0);
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_REBUILT);
+    assert(derived_inventory_state_is_available(&fixture.state));
+    assert_matches_rebuild(&fixture);
+    assert(fixture.batch.rebuild_count == 1);
+    assert(fixture.batch.route_count == 1);
+    assert(fixture.batch.routes[0] == 4);
+    derived_inventory_batch_reset(&fixture.batch);
+
+    /* A list resync routes every application. */
+    derived_inventory_batch_mark_rebuild(&fixture.batch, 1);
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_REBUILT);
+    assert(fixture.batch.route_all);
+    assert(fixture.batch.route_count == 0);
+    assert(fixture.batch.plan_count == 2);
+    assert(fixture.batch.rebuild_count == 2);
+    derived_inventory_batch_reset(&fixture.batch);
+    assert(!fixture.batch.route_all);
+    fixture_clear(&fixture);
+}
+
+/*
+ * Replays random drains: removals detach their stream at once, as the mixer
+ * does, and stored streams are only marked. Every drain must end equal to a
+ * full rebuild, with at most one rebuild per drain.
+ */
+static void test_random_drains_match_full_rebuild(void) {
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        batch_fixture_t fixture;
+        fixture_init(&fixture);
+        fixture_synchronize(&fixture);
+        uint32_t random_state = seed;
+
+        for (uint32_t drain = 0; drain < DRAIN_COUNT; drain++) {
+            uint32_t event_count = 1 + next_random(&random_state) % 40;
+            for (uint32_t event = 0; event < event_count; event++) {
+                uint32_t index =
+                    next_random(&random_state) % DRAIN_INDEX_RANGE;
+                if (next_random(&random_state) % 4 == 0) {
+                    audio_stream_inventory_remove(&fixture.streams, index);
+                    if (!derived_inventory_state_is_available(
+                            &fixture.state) ||
+                        active_application_inventory_remove_stream(
+                            &fixture.applications,
+                            &fixture.streams,
+                            index) != 0) {
+                        derived_inventory_batch_mark_rebuild(
+                            &fixture.batch,
+                            0);
+                        derived_inventory_state_set_rebuild_result(
+                            &fixture.state,
+                            0);
+                    }
+                    continue;
+                }
+                store_stream(&fixture,
+                             index,
+                             &drain_properties[next_random(&random_state) %
+                                               DRAIN_PROPERTY_SET_COUNT]);
+                assert(derived_inventory_batch_mark(
+                           &fixture.batch,
+                           index,
+                           DERIVED_INVENTORY_CHANGE_UPDATE) == 0);
+            }
+
+            uint64_t rebuilds = fixture.batch.rebuild_count;
+            assert(apply_drain(&fixture) !=
+                   DERIVED_INVENTORY_BATCH_REBUILD_FAILED);
+            assert(fixture.batch.rebuild_count <= rebuilds + 1);
+            assert(derived_inventory_state_is_available(&fixture.state));
+            assert_matches_rebuild(&fixture);
+            derived_inventory_batch_reset(&fixture.batch);
+        }
+
+        assert(fixture.batch.update_count > 0);
+        assert(fixture.batch.rebuild_count < fixture.batch.drain_count);
+        fixture_clear(&fixture);
+    }
+}
+
+static void test_storage_shrinks_after_large_drain(void) {
+    batch_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_synchronize(&fixture);
+
+    for (uint32_t index = 0; index < 256; index++) {
+        store_stream(&fixture, index, &drain_properties[index % 2]);
+        assert(derived_inventory_batch_mark(
+                   &fixture.batch,
+                   index,
+                   DERIVED_INVENTORY_CHANGE_UPDATE |
+                       DERIVED_INVENTORY_CHANGE_NEW) == 0);
+    }
+    assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UPDATED);
+    assert(fixture.batch.route_count == 256);
+    size_t peak = fixture.batch.memory.bytes;
+    assert(peak > 0);
+    derived_inventory_batch_reset(&fixture.batch);
+
+    /* A quiet drain gives the storage back. */
+    for (int drain = 0; drain < 8; drain++) {
+        assert(derived_inventory_batch_mark(
+                   &fixture.batch,
+                   7,
+                   DERIVED_INVENTORY_CHANGE_UPDATE) == 0);
+        assert(apply_drain(&fixture) == DERIVED_INVENTORY_BATCH_UPDATED);
+        derived_inventory_batch_reset(&fixture.batch);
+    }
+    assert(fixture.batch.memory.bytes < peak);
+    assert(fixture.batch.memory.peak_bytes == peak);
+    assert(fixture.batch.memory.shrink_count > 0);
+
+    derived_inventory_batch_clear(&fixture.batch);
+    assert(fixture.batch.changes == NULL);
+    assert(fixture.batch.routes == NULL);
+    assert(fixture.batch.memory.bytes == 0);
+    assert(fixture.batch.marked_count == 0);
+    fixture_clear(&fixture);
+}
+
+int main(void) {
+    test_supported_null_arguments();
+    test_nothing_applies_before_initial_snapshot();
+    test_drain_updates_once_and_routes_together();
+    test_removed_and_unsynchronized_streams_rebuild();
+    test_random_drains_match_full_rebuild();
+    test_storage_shrinks_after_large_drain();
+    printf("derived_inventory_batch tests passed\n");
+    return 0;
+}
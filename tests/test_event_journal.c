@@ -0,0 +1,201 @@
+#include "event_journal.h"
+#include "application_group.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char directory[] = "/tmp/chatwheel-journal-XXXXXX";
+
+static void journal_path(char *path, size_t size, const char *name) {
+    int length = snprintf(path, size, "%s/%s", directory, name);
+    assert(length > 0 && (size_t)length < size);
+}
+
+/* Decodes the journal at path into a NUL-terminated heap string. */
+static char *decode(const char *path) {
+    FILE *output = tmpfile();
+    assert(output != NULL);
+    assert(event_journal_decode(path, output) == 0);
+
+    long length = ftell(output);
+    assert(length >= 0);
+    char *text = malloc((size_t)length + 1);
+    assert(text != NULL);
+    rewind(output);
+    assert(fread(text, 1, (size_t)length, output) == (size_t)length);
+    text[length] = '\0';
+    fclose(output);
+    return text;
+}
+
+static size_t count_lines(const char *text) {
+    size_t lines = 0;
+    for (; *text; text++) {
+        if (*text == '\n') lines++;
+    }
+    return lines;
+}
+
+static void test_records_are_decoded_in_order(void) {
+    char path[256];
+    journal_path(path, sizeof(path), "nested/state/events.journal");
+
+    event_journal_t journal;
+    event_journal_init(&journal);
+    assert(event_journal_open(&journal, path, 16, 1000) == 0);
+    event_journal_append(&journal, EVENT_JOURNAL_STREAM_NEW, 42, 0, 0, 0);
+    event_journal_set_clock(&journal, 1250);
+    event_journal_append(&journal, EVENT_JOURNAL_STREAM_INFO, 42,
+                         EVENT_JOURNAL_INFO_NEW, 65536, (uint32_t)-1);
+    event_journal_append(&journal, EVENT_JOURNAL_REBUILD,
+                         EVENT_JOURNAL_NO_STREAM, 1, 3, 5);
+    event_journal_append(&journal, EVENT_JOURNAL_PLAN, 42, 0, 2, 0);
+    event_journal_append(&journal, EVENT_JOURNAL_VOLUME_SUBMITTED, 42,
+                         APPLICATION_GROUP_CHAT, 32768, 2);
+    event_journal_append(&journal, EVENT_JOURNAL_VOLUME_DEFERRED, 43,
+                         APPLICATION_GROUP_GAME, 16384, 6);
+    event_journal_append(&journal, EVENT_JOURNAL_STREAM_REMOVED, 42, 0, 0, 0);
+    assert(journal.header->next_sequence == 8);
+
+    /* The mapping is shared, so a reader sees records before close(). */
+    char *text = decode(path);
+    assert(count_lines(text) == 9);
+    assert(strstr(text, "opened") != NULL);
+    const char *new_stream =
+        strstr(text, "1000 ms  new              stream 42");
+    const char *info = strstr(
+        text, "1250 ms  info             stream 42, new, volume 65536, "
+              "result -1");
+    const char *rebuild = strstr(
+        text, "rebuild          succeeded, 3 applications from 5 streams");
+    const char *plan = strstr(text, "plan             stream 42, 2 assign");
+    const char *submitted = strstr(
+        text, "volume submitted stream 42, Chat, volume 32768 on 2 channels");
+    const char *deferred = strstr(
+        text, "volume deferred  stream 43, Game, volume 16384 on 6 channels");
+    const char *removed = strstr(text, "removed          stream 42");
+    assert(new_stream && info && rebuild && plan && submitted && deferred &&
+           removed);
+    assert(new_stream < info && info < rebuild && rebuild < plan &&
+           plan < submitted && submitted < deferred && deferred < removed);
+    assert(strstr(text, "8 records, 0 skipped\n") != NULL);
+    free(text);
+
+    event_journal_close(&journal);
+    assert(journal.header == NULL);
+    assert(journal.fd == -1);
+    event_journal_append(&journal, EVENT_JOURNAL_STREAM_NEW, 1, 0, 0, 0);
+    unlink(path);
+}
+
+static void test_reopen_continues_and_ring_keeps_newest(void) {
+    char path[256];
+    journal_path(path, sizeof(path), "ring.journal");
+
+    event_journal_t journal;
+    assert(event_journal_open(&journal, path, 8, 0) == 0);
+    event_journal_append(&journal, EVENT_JOURNAL_STREAM_NEW, 1, 0, 0, 0);
+    event_journal_close(&journal);
+
+    assert(event_journal_open(&journal, path, 8, 0) == 0);
+    assert(journal.header->next_sequence == 3);
+    for (uint32_t index = 100; index < 120; index++) {
+        event_journal_append(&journal, EVENT_JOURNAL_STREAM_CHANGED, index,
+                             0, 0, 0);
+    }
+    assert(journal.header->next_sequence == 23);
+    event_journal_close(&journal);
+
+    char *text = decode(path);
+    assert(count_lines(text) == 9);
+    assert(strstr(text, "stream 111\n") == NULL);
+    assert(strstr(text, "        15 ") != NULL);
+    assert(strstr(text, "changed          stream 112\n") != NULL);
+    assert(strstr(text, "changed          stream 119\n") != NULL);
+    assert(strstr(text, "8 records, 0 skipped\n") != NULL);
+    free(text);
+
+    /* Another capacity starts a new journal. */
+    assert(event_journal_open(&journal, path, 4, 0) == 0);
+    assert(journal.header->next_sequence == 1);
+    event_journal_close(&journal);
+    unlink(path);
+}
+
+static void test_second_writer_is_refused(void) {
+    char path[256];
+    journal_path(path, sizeof(path), "locked.journal");
+
+    event_journal_t first;
+    event_journal_t second;
+    assert(event_journal_open(&first, path, 4, 0) == 0);
+    assert(event_journal_open(&second, path, 4, 0) == -1);
+    assert(second.header == NULL);
+    event_journal_append(&second, EVENT_JOURNAL_STREAM_NEW, 1, 0, 0, 0);
+    assert(first.header->next_sequence == 1);
+
+    event_journal_close(&first);
+    assert(event_journal_open(&second, path, 4, 0) == 0);
+    event_journal_close(&second);
+    unlink(path);
+}
+
+static void test_invalid_arguments_and_files(void) {
+    char path[256];
+    journal_path(path, sizeof(path), "invalid.journal");
+    event_journal_t journal;
+
+    assert(event_journal_open(NULL, path, 4, 0) == -1);
+    assert(event_journal_open(&journal, NULL, 4, 0) == -1);
+    assert(event_journal_open(&journal, path, 0, 0) == -1);
+    assert(event_journal_open(&journal, path, 6, 0) == -1);
+    assert(access(path, F_OK) != 0);
+    event_journal_append(NULL, EVENT_JOURNAL_STREAM_NEW, 1, 0, 0, 0);
+    event_journal_set_clock(NULL, 0);
+    event_journal_init(NULL);
+    event_journal_close(NULL);
+
+    assert(event_journal_decode(path, stdout) == -1);
+    assert(event_journal_decode(NULL, stdout) == -1);
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fputs("not a journal, but long enough to hold a journal header..\n",
+          file);
+    fclose(file);
+    assert(event_journal_decode(path, stdout) == -1);
+    unlink(path);
+
+    char default_path[512];
+    assert(setenv("XDG_STATE_HOME", "/state", 1) == 0);
+    assert(event_journal_default_path(default_path,
+                                      sizeof(default_path)) == 0);
+    assert(strcmp(default_path, "/state/chatwheel/events.journal") == 0);
+    assert(unsetenv("XDG_STATE_HOME") == 0);
+    assert(setenv("HOME", "/home/user", 1) == 0);
+    assert(event_journal_default_path(default_path,
+                                      sizeof(default_path)) == 0);
+    assert(strcmp(default_path,
+                  "/home/user/.local/state/chatwheel/events.journal") == 0);
+    assert(event_journal_default_path(default_path, 8) == -1);
+    assert(event_journal_default_path(NULL, 8) == -1);
+}
+
+int main(void) {
+    assert(mkdtemp(directory) != NULL);
+    test_records_are_decoded_in_order();
+    test_reopen_continues_and_ring_keeps_newest();
+    test_second_writer_is_refused();
+    test_invalid_arguments_and_files();
+
+    char nested[256];
+    journal_path(nested, sizeof(nested), "nested/state");
+    rmdir(nested);
+    journal_path(nested, sizeof(nested), "nested");
+    rmdir(nested);
+    rmdir(directory);
+    printf("event_journal tests passed\n");
+    return 0;
+}
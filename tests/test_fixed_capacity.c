@@ -0,0 +1,328 @@
+#include "active_application_inventory.h"
+#include "audio_stream_inventory.h"
+#include "fixed_pool.h"
+#include "mixer/classified_volume_routing.h"
+#include "mixer/sink_input_request_pool.h"
+#include "mixer/stream_grace_window.h"
+#include "pattern_matcher.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Built with -DCHATWHEEL_FIXED_CAPACITY and small capacities, and linked with
+ * the heap functions wrapped, so every heap call the containers make is
+ * counted.
+ */
+
+#ifndef CHATWHEEL_FIXED_CAPACITY
+#error "test_fixed_capacity must be built with -DCHATWHEEL_FIXED_CAPACITY"
+#endif
+
+#define MAX_STREAMS CHATWHEEL_MAX_STREAMS
+#define MAX_LENGTH CHATWHEEL_MAX_PROPERTY_LENGTH
+#define MAX_REQUESTS CHATWHEEL_MAX_PENDING_REQUESTS
+
+static size_t heap_calls = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *block, size_t size);
+void __real_free(void *block);
+
+void *__wrap_malloc(size_t size) {
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *block, size_t size) {
+    heap_calls++;
+    return __real_realloc(block, size);
+}
+
+void __wrap_free(void *block) {
+    if (block) heap_calls++;
+    __real_free(block);
+}
+
+typedef struct {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    sink_input_request_tracker_t tracker;
+    sink_input_request_pool_t requests;
+    stream_grace_window_t grace;
+    classified_volume_plan_t plan;
+    config_t configuration;
+    chatmix_volume_targets_t targets;
+} daemon_state_t;
+
+static void config_add(config_t *configuration,
+                       const char *pattern,
+                       int is_chat) {
+    app_config_t *entry = &configuration->apps[configuration->count];
+    snprintf(entry->name, sizeof(entry->name), "%s", pattern);
+    pattern_fold_case(entry->folded_name, pattern, sizeof(entry->folded_name));
+    entry->is_chat = is_chat;
+    configuration->count++;
+    configuration->generation++;
+}
+
+static void state_init(daemon_state_t *state) {
+    audio_stream_inventory_init(&state->streams);
+    active_application_inventory_init(&state->applications);
+    sink_input_request_tracker_init(&state->tracker);
+    sink_input_request_pool_init(&state->requests);
+    stream_grace_window_init(&state->grace);
+    classified_volume_plan_init(&state->plan);
+    state->configuration = (config_t){0};
+    config_add(&state->configuration, "chat-*", 1);
+    config_add(&state->configuration, "game-*", 0);
+    assert(chatmix_volume_targets_calculate(40.0f, &state->targets) == 0);
+}
+
+static void state_clear(daemon_state_t *state) {
+    classified_volume_plan_clear(&state->plan);
+    stream_grace_window_clear(&state->grace);
+    sink_input_request_tracker_clear(&state->tracker);
+    sink_input_request_pool_clear(&state->requests);
+    active_application_inventory_clear(&state->applications);
+    audio_stream_inventory_clear(&state->streams);
+}
+
+/* Writes a property of exactly MAX_LENGTH bytes starting with prefix-number. */
+static void make_property(char text[MAX_LENGTH + 1],
+                          const char *prefix,
+                          unsigned int number) {
+    memset(text, '.', MAX_LENGTH);
+    int length = snprintf(text, MAX_LENGTH + 1, "%s-%u", prefix, number);
+    assert(length > 0 && length < MAX_LENGTH);
+    text[length] = '.';
+    text[MAX_LENGTH] = '\0';
+}
+
+static int upsert_stream(daemon_state_t *state,
+                         uint32_t index,
+                         unsigned int application) {
+    char id[MAX_LENGTH + 1];
+    char name[MAX_LENGTH + 1];
+    char binary[MAX_LENGTH + 1];
+    char node[MAX_LENGTH + 1];
+    const char *group = application % 2 == 0 ? "chat" : "game";
+    make_property(id, group, application);
+    make_property(name, "Name", application);
+    make_property(binary, "binary", application);
+    make_property(node, "node", index);
+    return audio_stream_inventory_upsert(
+        &state->streams, index, 2, id, name, binary, node);
+}
+
+static void build_plan(daemon_state_t *state, size_t expected_count) {
+    assert(classified_volume_plan_build_all(
+               &state->plan,
+               &state->applications,
+               &state->streams,
+               &state->configuration,
+               &state->targets,
+               1) == 0);
+    assert(state->plan.count == expected_count);
+}
+
+static void exercise_requests(daemon_state_t *state, uint32_t first_index) {
+    sink_input_info_request_t *requests[MAX_REQUESTS];
+    for (uint32_t i = 0; i < MAX_REQUESTS; i++) {
+        requests[i] = sink_input_request_pool_acquire(&state->requests);
+        assert(requests[i]);
+        assert(sink_input_request_tracker_begin(
+                   &state->tracker,
+                   first_index + i,
+                   SINK_INPUT_REQUEST_NEW,
+                   &requests[i]->token) == 0);
+    }
+    sink_input_request_tracker_invalidate(&state->tracker, first_index);
+    assert(!sink_input_request_tracker_is_current(&state->tracker,
+                                                  &requests[0]->token));
+    for (uint32_t i = 0; i < MAX_REQUESTS; i++) {
+        sink_input_request_pool_complete(&state->requests, requests[i]);
+    }
+    sink_input_info_request_t *request;
+    while ((request = sink_input_request_pool_take_completed(
+                &state->requests))) {
+        sink_input_request_tracker_finish(&state->tracker, &request->token);
+        sink_input_request_pool_release(&state->requests, request);
+    }
+    assert(state->tracker.index_count == 0);
+    assert(state->requests.live_count == 0);
+}
+
+static void test_steady_state_uses_no_heap(void) {
+    daemon_state_t state;
+    heap_calls = 0;
+    state_init(&state);
+
+    for (unsigned int round = 0; round < 40; round++) {
+        uint32_t base = round * 100;
+        /* Alternate between one application per stream and a few shared. */
+        unsigned int applications = round % 2 == 0 ? MAX_STREAMS : 3;
+
+        for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+            assert(stream_grace_window_add(&state.grace, base + i,
+                                           round * 1000 + i) == 0);
+        }
+        uint32_t index;
+        uint32_t taken = 0;
+        while (stream_grace_window_take_due(&state.grace,
+                                            round * 1000 + MAX_STREAMS,
+                                            0,
+                                            &index)) {
+            assert(upsert_stream(&state, index,
+                                 (index - base) % applications) == 0);
+            taken++;
+        }
+        assert(taken == MAX_STREAMS);
+        assert(state.streams.count == MAX_STREAMS);
+
+        assert(active_application_inventory_rebuild(&state.applications,
+                                                    &state.streams) == 0);
+        assert(state.applications.count == applications);
+        build_plan(&state, MAX_STREAMS);
+        exercise_requests(&state, base);
+
+        /* Move every stream to another application incrementally. */
+        for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+            assert(upsert_stream(&state, base + i,
+                                 (i + round + 1) % MAX_STREAMS) == 0);
+            assert(active_application_inventory_upsert_stream(
+                       &state.applications,
+                       &state.streams,
+                       base + i) == 0);
+        }
+        build_plan(&state, MAX_STREAMS);
+
+        for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+            uint32_t removed = base + (i * 7) % MAX_STREAMS;
+            assert(audio_stream_inventory_remove(&state.streams, removed));
+            assert(active_application_inventory_remove_stream(
+                       &state.applications,
+                       &state.streams,
+                       removed) == 0);
+        }
+        assert(state.streams.count == 0);
+        assert(state.applications.count == 0);
+        build_plan(&state, 0);
+    }
+
+    state_clear(&state);
+    assert(heap_calls == 0);
+}
+
+static void test_overflow_is_refused_without_losing_state(void) {
+    daemon_state_t state;
+    heap_calls = 0;
+    state_init(&state);
+
+    for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+        assert(upsert_stream(&state, i, i) == 0);
+    }
+    assert(upsert_stream(&state, MAX_STREAMS, 0) == -1);
+    assert(state.streams.count == MAX_STREAMS);
+    assert(audio_stream_inventory_find(&state.streams, MAX_STREAMS) == NULL);
+    for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+        assert(audio_stream_inventory_find(&state.streams, i) != NULL);
+    }
+    assert(active_application_inventory_rebuild(&state.applications,
+                                                &state.streams) == 0);
+    assert(state.applications.count == MAX_STREAMS);
+    build_plan(&state, MAX_STREAMS);
+
+    /* Updating a stream at capacity still works. */
+    assert(upsert_stream(&state, 3, 4) == 0);
+    assert(active_application_inventory_upsert_stream(
+               &state.applications, &state.streams, 3) == 0);
+
+    /* A property longer than the pool's strings is refused the same way. */
+    char long_text[MAX_LENGTH + 2];
+    memset(long_text, 'x', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = '\0';
+    assert(audio_stream_inventory_remove(&state.streams, 0));
+    assert(audio_stream_inventory_upsert(&state.streams, 0, 2, long_text,
+                                         NULL, NULL, NULL) == -1);
+    assert(state.streams.count == MAX_STREAMS - 1);
+
+    /* Removing a stream makes room for the next one. */
+    assert(upsert_stream(&state, MAX_STREAMS, 0) == 0);
+    assert(state.streams.count == MAX_STREAMS);
+
+    sink_input_request_token_t tokens[MAX_REQUESTS + 1];
+    for (uint32_t i = 0; i < MAX_REQUESTS; i++) {
+        assert(sink_input_request_tracker_begin(
+                   &state.tracker, i, SINK_INPUT_REQUEST_NEW,
+                   &tokens[i]) == 0);
+    }
+    assert(sink_input_request_tracker_begin(
+               &state.tracker, MAX_REQUESTS, SINK_INPUT_REQUEST_NEW,
+               &tokens[MAX_REQUESTS]) == -1);
+    /* Another request for a tracked index needs no new storage. */
+    assert(sink_input_request_tracker_begin(
+               &state.tracker, 0, SINK_INPUT_REQUEST_CHANGE,
+               &tokens[MAX_REQUESTS]) == 0);
+    for (uint32_t i = 0; i <= MAX_REQUESTS; i++) {
+        sink_input_request_tracker_finish(&state.tracker, &tokens[i]);
+    }
+
+    sink_input_info_request_t *requests[MAX_REQUESTS];
+    for (uint32_t i = 0; i < MAX_REQUESTS; i++) {
+        requests[i] = sink_input_request_pool_acquire(&state.requests);
+        assert(requests[i]);
+    }
+    assert(sink_input_request_pool_acquire(&state.requests) == NULL);
+    assert(state.requests.live_count == MAX_REQUESTS);
+    sink_input_request_pool_release(&state.requests, requests[1]);
+    assert(sink_input_request_pool_acquire(&state.requests) == requests[1]);
+
+    for (uint32_t i = 0; i < MAX_STREAMS; i++) {
+        assert(stream_grace_window_add(&state.grace, 1000 + i, 0) == 0);
+    }
+    assert(stream_grace_window_add(&state.grace, 2000, 0) == -1);
+    assert(stream_grace_window_contains(&state.grace, 1000));
+    assert(stream_grace_window_drop(&state.grace, 1000) == 1);
+    assert(stream_grace_window_add(&state.grace, 2000, 0) == 0);
+
+    state_clear(&state);
+    assert(heap_calls == 0);
+}
+
+static void test_pool_reuses_released_blocks(void) {
+    FIXED_POOL_DEFINE(pool, 24, 2)
+    heap_calls = 0;
+
+    assert(pool.block_size == 32);
+    void *first = POOL_MALLOC(pool, 24);
+    void *second = POOL_CALLOC(pool, 4, 8);
+    assert(first && second && first != second);
+    assert(POOL_MALLOC(pool, 1) == NULL);
+    assert(POOL_REALLOC(pool, first, 33) == NULL);
+    assert(POOL_REALLOC(pool, first, 32) == first);
+    assert(pool.used_count == 2);
+    assert(pool.refused_count == 2);
+
+    POOL_FREE(pool, first);
+    POOL_FREE(pool, NULL);
+    void *reused = POOL_CALLOC(pool, 1, 32);
+    assert(reused == first);
+    assert(memcmp(reused, (char[32]){0}, 32) == 0);
+    assert(heap_calls == 0);
+}
+
+int main(void) {
+    test_pool_reuses_released_blocks();
+    test_steady_state_uses_no_heap();
+    test_overflow_is_refused_without_losing_state();
+    printf("fixed_capacity tests passed\n");
+    return 0;
+}
@@ -0,0 +1,274 @@
+#include "inventory_snapshot.h"
+#include "pattern_matcher.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define READER_THREAD_COUNT 4
+#define CONCURRENT_PUBLISH_COUNT 2000
+#define MAX_CONCURRENT_STREAMS 8
+
+static void config_add(config_t *configuration,
+                       const char *pattern,
+                       int is_chat) {
+    assert(configuration->count >= 0);
+    assert(configuration->count < MAX_APPS);
+    size_t length = strlen(pattern);
+    assert(length < sizeof(configuration->apps[0].name));
+
+    app_config_t *entry = &configuration->apps[configuration->count];
+    memcpy(entry->name, pattern, length + 1);
+    pattern_fold_case(entry->folded_name, pattern, sizeof(entry->folded_name));
+    entry->is_chat = is_chat;
+    configuration->count++;
+    configuration->generation++;
+}
+
+static const inventory_snapshot_application_t *find_application(
+    const inventory_snapshot_t *snapshot,
+    const char *display_name) {
+    for (size_t i = 0; i < snapshot->application_count; i++) {
+        if (strcmp(snapshot->applications[i].display_name,
+                   display_name) == 0) {
+            return &snapshot->applications[i];
+        }
+    }
+    return NULL;
+}
+
+static void test_empty_publisher_and_invalid_arguments(void) {
+    inventory_snapshot_publisher_t publisher;
+    inventory_snapshot_publisher_init(&publisher);
+    audio_stream_inventory_t streams;
+    audio_stream_inventory_init(&streams);
+    config_t configuration = {0};
+
+    assert(inventory_snapshot_acquire(&publisher) == NULL);
+    assert(inventory_snapshot_acquire(NULL) == NULL);
+    assert(inventory_snapshot_publish(
+               NULL, &streams, NULL, &configuration) == -1);
+    assert(inventory_snapshot_publish(
+               &publisher, NULL, NULL, &configuration) == -1);
+    assert(inventory_snapshot_publish(&publisher, &streams, NULL, NULL) == -1);
+    assert(inventory_snapshot_acquire(&publisher) == NULL);
+    inventory_snapshot_release(NULL);
+    inventory_snapshot_publisher_init(NULL);
+    inventory_snapshot_publisher_clear(NULL);
+
+    assert(inventory_snapshot_publish(
+               &publisher, &streams, NULL, &configuration) == 0);
+    inventory_snapshot_t *snapshot = inventory_snapshot_acquire(&publisher);
+    assert(snapshot != NULL);
+    assert(snapshot->sequence == 1);
+    assert(snapshot->stream_count == 0);
+    assert(snapshot->application_count == 0);
+    assert(!snapshot->applications_available);
+    inventory_snapshot_release(snapshot);
+
+    inventory_snapshot_publisher_clear(&publisher);
+    assert(inventory_snapshot_acquire(&publisher) == NULL);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_snapshot_copies_inventories(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    assert(audio_stream_inventory_upsert(
+               &streams, 10, 2, NULL, "Discord", "discord", NULL) == 0);
+    assert(audio_stream_inventory_upsert(
+               &streams, 11, 2, NULL, "Discord", "discord", NULL) == 0);
+    assert(audio_stream_inventory_upsert(
+               &streams, 12, 6, "game.id", "Game", NULL, "game-node") == 0);
+    assert(audio_stream_inventory_set_volume(&streams, 12, 1, 4096) == 0);
+    assert(audio_stream_inventory_set_corked(&streams, 11, 1) == 0);
+    assert(active_application_inventory_rebuild(
+               &applications, &streams) == 0);
+
+    config_t configuration = {0};
+    config_add(&configuration, "discord", 1);
+
+    inventory_snapshot_publisher_t publisher;
+    inventory_snapshot_publisher_init(&publisher);
+    assert(inventory_snapshot_publish(
+               &publisher, &streams, &applications, &configuration) == 0);
+    inventory_snapshot_t *snapshot = inventory_snapshot_acquire(&publisher);
+    assert(snapshot != NULL);
+    assert(snapshot->applications_available);
+    assert(snapshot->stream_count == 3);
+    assert(snapshot->application_count == 2);
+
+    const inventory_snapshot_stream_t *game = &snapshot->streams[2];
+    assert(game->index == 12);
+    assert(game->channel_count == 6);
+    assert(game->volume_known);
+    assert(game->volume == 4096);
+    assert(!game->corked);
+    assert(strcmp(game->application_id, "game.id") == 0);
+    assert(game->process_binary == NULL);
+    assert(game->application_id !=
+           audio_stream_inventory_find_properties(&streams, 12)
+               ->application_id);
+    assert(snapshot->streams[1].corked);
+
+    const inventory_snapshot_application_t *discord =
+        find_application(snapshot, "Discord");
+    assert(discord != NULL);
+    assert(discord->group == APPLICATION_GROUP_CHAT);
+    assert(discord->matched_config_index == 0);
+    assert(discord->stream_count == 2);
+    assert(discord->stream_indexes[0] == 10);
+    assert(discord->stream_indexes[1] == 11);
+    const inventory_snapshot_application_t *game_application =
+        find_application(snapshot, "Game");
+    assert(game_application != NULL);
+    assert(game_application->group == APPLICATION_GROUP_UNASSIGNED);
+    assert(game_application->stream_count == 1);
+    assert(game_application->stream_indexes[0] == 12);
+    assert(strcmp(game_application->identity_value, "game.id") == 0);
+
+    /* The snapshot outlives every change to the live inventories. */
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+    inventory_snapshot_publisher_clear(&publisher);
+    assert(strcmp(game->node_name, "game-node") == 0);
+    assert(strcmp(discord->identity_value, "Discord") == 0);
+    inventory_snapshot_release(snapshot);
+}
+
+static void test_held_snapshot_survives_replacement(void) {
+    audio_stream_inventory_t streams;
+    audio_stream_inventory_init(&streams);
+    config_t configuration = {0};
+    inventory_snapshot_publisher_t publisher;
+    inventory_snapshot_publisher_init(&publisher);
+
+    assert(audio_stream_inventory_upsert(
+               &streams, 1, 2, NULL, "First", NULL, NULL) == 0);
+    assert(inventory_snapshot_publish(
+               &publisher, &streams, NULL, &configuration) == 0);
+    inventory_snapshot_t *first = inventory_snapshot_acquire(&publisher);
+
+    assert(audio_stream_inventory_upsert(
+               &streams, 1, 2, NULL, "Second", NULL, NULL) == 0);
+    assert(audio_stream_inventory_upsert(
+               &streams, 2, 2, NULL, "Other", NULL, NULL) == 0);
+    assert(inventory_snapshot_publish(
+               &publisher, &streams, NULL, &configuration) == 0);
+    inventory_snapshot_t *second = inventory_snapshot_acquire(&publisher);
+    inventory_snapshot_t *again = inventory_snapshot_acquire(&publisher);
+
+    assert(first != second);
+    assert(again == second);
+    assert(first->sequence == 1);
+    assert(second->sequence == 2);
+    assert(first->stream_count == 1);
+    assert(strcmp(first->streams[0].application_name, "First") == 0);
+    assert(second->stream_count == 2);
+    assert(strcmp(second->streams[0].application_name, "Second") == 0);
+    assert(publisher.retired == NULL);
+
+    inventory_snapshot_release(again);
+    inventory_snapshot_release(second);
+    inventory_snapshot_publisher_clear(&publisher);
+    assert(strcmp(first->streams[0].application_name, "First") == 0);
+    inventory_snapshot_release(first);
+    audio_stream_inventory_clear(&streams);
+}
+
+typedef struct {
+    inventory_snapshot_publisher_t *publisher;
+    atomic_int *stop;
+} reader_context_t;
+
+/*
+ * Checks every snapshot against the shape the writer gives the sequence
+ * number, which a torn or freed snapshot would not keep.
+ */
+static void *read_snapshots(void *argument) {
+    reader_context_t *reader = argument;
+    uint64_t last_sequence = 0;
+
+    while (!atomic_load(reader->stop)) {
+        inventory_snapshot_t *snapshot =
+            inventory_snapshot_acquire(reader->publisher);
+        if (!snapshot) continue;
+
+        assert(snapshot->sequence >= last_sequence);
+        last_sequence = snapshot->sequence;
+        size_t expected = (size_t)(snapshot->sequence %
+                                   MAX_CONCURRENT_STREAMS) + 1;
+        assert(snapshot->stream_count == expected);
+        assert(snapshot->application_count == expected);
+        for (size_t i = 0; i < snapshot->stream_count; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "App %zu", i);
+            assert(snapshot->streams[i].index == (uint32_t)i);
+            assert(strcmp(snapshot->streams[i].application_name, name) == 0);
+        }
+        inventory_snapshot_release(snapshot);
+    }
+    return NULL;
+}
+
+static void test_concurrent_readers_see_whole_snapshots(void) {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+    audio_stream_inventory_init(&streams);
+    active_application_inventory_init(&applications);
+    config_t configuration = {0};
+    inventory_snapshot_publisher_t publisher;
+    inventory_snapshot_publisher_init(&publisher);
+    atomic_int stop;
+    atomic_init(&stop, 0);
+
+    pthread_t threads[READER_THREAD_COUNT];
+    reader_context_t readers[READER_THREAD_COUNT];
+    for (int i = 0; i < READER_THREAD_COUNT; i++) {
+        readers[i] = (reader_context_t){&publisher, &stop};
+        assert(pthread_create(
+                   &threads[i], NULL, read_snapshots, &readers[i]) == 0);
+    }
+
+    for (uint64_t sequence = 1;
+         sequence <= CONCURRENT_PUBLISH_COUNT;
+         sequence++) {
+        size_t count = (size_t)(sequence % MAX_CONCURRENT_STREAMS) + 1;
+        while (streams.count > count) {
+            assert(audio_stream_inventory_remove(
+                       &streams, (uint32_t)(streams.count - 1)) == 1);
+        }
+        for (size_t i = 0; i < count; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "App %zu", i);
+            assert(audio_stream_inventory_upsert(
+                       &streams, (uint32_t)i, 2, NULL, name, NULL, NULL) == 0);
+        }
+        assert(active_application_inventory_rebuild(
+                   &applications, &streams) == 0);
+        assert(inventory_snapshot_publish(
+                   &publisher, &streams, &applications, &configuration) == 0);
+    }
+
+    atomic_store(&stop, 1);
+    for (int i = 0; i < READER_THREAD_COUNT; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    inventory_snapshot_publisher_clear(&publisher);
+    active_application_inventory_clear(&applications);
+    audio_stream_inventory_clear(&streams);
+}
+
+int main(void) {
+    test_empty_publisher_and_invalid_arguments();
+    test_snapshot_copies_inventories();
+    test_held_snapshot_survives_replacement();
+    test_concurrent_readers_see_whole_snapshots();
+    printf("inventory_snapshot tests passed\n");
+    return 0;
+}
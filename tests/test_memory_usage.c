@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "memory_usage.h"
+
+static void test_set_tracks_peak(void) {
+    memory_usage_t usage;
+    memory_usage_init(&usage);
+    assert(usage.bytes == 0);
+    assert(usage.peak_bytes == 0);
+    assert(usage.shrink_count == 0);
+
+    memory_usage_set(&usage, 512);
+    memory_usage_set(&usage, 2048);
+    memory_usage_set(&usage, 128);
+    assert(usage.bytes == 128);
+    assert(usage.peak_bytes == 2048);
+
+    memory_usage_t total;
+    memory_usage_init(&total);
+    usage.shrink_count = 3;
+    memory_usage_add(&total, &usage);
+    memory_usage_add(&total, &usage);
+    assert(total.bytes == 256);
+    assert(total.peak_bytes == 4096);
+    assert(total.shrink_count == 6);
+}
+
+static void test_shrink_policy_has_hysteresis(void) {
+    /* Nothing shrinks while more than a quarter of the capacity is used. */
+    assert(memory_usage_shrunk_capacity(17, 64, 4) == 64);
+    assert(memory_usage_shrunk_capacity(16, 64, 4) == 32);
+    /* Halving repeats, so a drained container shrinks in one step. */
+    assert(memory_usage_shrunk_capacity(2, 64, 4) == 4);
+    assert(memory_usage_shrunk_capacity(0, 64, 4) == 4);
+    assert(memory_usage_shrunk_capacity(0, 64, 16) == 16);
+
+    /* A shrunk container needs to double its count before growing again. */
+    size_t capacity = memory_usage_shrunk_capacity(16, 64, 4);
+    assert(memory_usage_shrunk_capacity(16, capacity, 4) == capacity);
+    assert(memory_usage_shrunk_capacity(9, capacity, 4) == capacity);
+
+    assert(memory_usage_shrunk_capacity(0, 4, 4) == 4);
+    assert(memory_usage_shrunk_capacity(0, 0, 0) == 0);
+    assert(memory_usage_shrunk_capacity(0, 1, 0) == 1);
+}
+
+typedef struct {
+    size_t capacity;
+    int fail;
+    int calls;
+} resizable_t;
+
+static int resize_resizable(void *container, size_t capacity) {
+    resizable_t *resizable = container;
+    resizable->calls++;
+    if (resizable->fail) return -1;
+    resizable->capacity = capacity;
+    return 0;
+}
+
+static void test_shrink_counts_only_successful_resizes(void) {
+    memory_usage_t usage;
+    memory_usage_init(&usage);
+    resizable_t resizable = {.capacity = 64};
+
+    /* Not due: resize is not called. */
+    assert(memory_usage_shrink(&usage, &resizable, resize_resizable,
+                               17, resizable.capacity, 4) == 0);
+    assert(resizable.calls == 0);
+
+    resizable.fail = 1;
+    assert(memory_usage_shrink(&usage, &resizable, resize_resizable,
+                               16, resizable.capacity, 4) == 0);
+    assert(resizable.calls == 1);
+    assert(resizable.capacity == 64);
+    assert(usage.shrink_count == 0);
+
+    resizable.fail = 0;
+    assert(memory_usage_shrink(&usage, &resizable, resize_resizable,
+                               16, resizable.capacity, 4) == 1);
+    assert(resizable.capacity == 32);
+    assert(usage.shrink_count == 1);
+
+    assert(memory_usage_shrink(NULL, &resizable, resize_resizable,
+                               0, resizable.capacity, 4) == 0);
+    assert(memory_usage_shrink(&usage, &resizable, NULL,
+                               0, resizable.capacity, 4) == 0);
+    assert(resizable.capacity == 32);
+}
+
+static void test_null_arguments(void) {
+    memory_usage_t usage;
+    memory_usage_init(&usage);
+
+    memory_usage_init(NULL);
+    memory_usage_set(NULL, 10);
+    memory_usage_add(NULL, &usage);
+    memory_usage_add(&usage, NULL);
+    assert(usage.bytes == 0);
+}
+
+int main(void) {
+    test_set_tracks_peak();
+    test_shrink_policy_has_hysteresis();
+    test_shrink_counts_only_successful_resizes();
+    test_null_arguments();
+    printf("memory_usage tests passed\n");
+    return 0;
+}
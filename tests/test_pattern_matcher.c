@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 static void expect_match(const char *pattern, const char *text, int expected) {
     assert(pattern_matches_text(pattern, text) == expected);
@@ -60,6 +61,67 @@ static void test_pattern_text_direction(void) {
     expect_match("Discord Canary", "Discord*", 0);
 }
 
+static void test_fold_case(void) {
+    char folded[8];
+    pattern_fold_case(folded, "DisCord-2", sizeof(folded));
+    assert(strcmp(folded, "discord") == 0);
+    pattern_fold_case(folded, NULL, sizeof(folded));
+    assert(folded[0] == '\0');
+    pattern_fold_case(folded, "\xc4Z", sizeof(folded));
+    assert(strcmp(folded, "\xc4z") == 0);
+}
+
+static void test_folded_matching(void) {
+    assert(pattern_matches_folded_text("discord", "discord"));
+    assert(!pattern_matches_folded_text("discord", "Discord"));
+    assert(pattern_matches_folded_text("*cord", "discord"));
+    assert(pattern_matches_folded_text("d?s*d", "discord"));
+    assert(pattern_matches_folded_text("*a*b", "aaab"));
+    assert(!pattern_matches_folded_text("*a*b", "aaba"));
+    assert(pattern_matches_folded_text("**", ""));
+    assert(!pattern_matches_folded_text("?", ""));
+    assert(!pattern_matches_folded_text(NULL, "discord"));
+    assert(!pattern_matches_folded_text("discord", NULL));
+}
+
+/*
+ * Folding both sides and matching bytes must agree with the case-insensitive
+ * matcher on every pattern and text.
+ */
+static void test_folded_matching_agrees_with_text_matching(void) {
+    static const char alphabet[] = "aAbB*?";
+    unsigned int seed = 12345;
+
+    for (int round = 0; round < 20000; round++) {
+        char pattern[8];
+        char text[10];
+        char folded_pattern[sizeof(pattern)];
+        char folded_text[sizeof(text)];
+
+        seed = seed * 1103515245U + 12345U;
+        size_t pattern_length = (seed >> 16) % sizeof(pattern);
+        for (size_t i = 0; i < pattern_length; i++) {
+            seed = seed * 1103515245U + 12345U;
+            pattern[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+        }
+        pattern[pattern_length] = '\0';
+
+        seed = seed * 1103515245U + 12345U;
+        size_t text_length = (seed >> 16) % sizeof(text);
+        for (size_t i = 0; i < text_length; i++) {
+            seed = seed * 1103515245U + 12345U;
+            /* Text uses letters only; wildcards belong to the pattern. */
+            text[i] = alphabet[(seed >> 16) % 4];
+        }
+        text[text_length] = '\0';
+
+        pattern_fold_case(folded_pattern, pattern, sizeof(folded_pattern));
+        pattern_fold_case(folded_text, text, sizeof(folded_text));
+        assert(pattern_matches_text(pattern, text) ==
+               pattern_matches_folded_text(folded_pattern, folded_text));
+    }
+}
+
 int main(void) {
     test_exact_matching();
     test_asterisk_matching();
@@ -67,6 +129,9 @@ int main(void) {
     test_empty_and_null_inputs();
     test_application_patterns();
     test_pattern_text_direction();
+    test_fold_case();
+    test_folded_matching();
+    test_folded_matching_agrees_with_text_matching();
     printf("pattern_matcher tests passed\n");
     return 0;
 }
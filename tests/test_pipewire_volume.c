@@ -0,0 +1,57 @@
+#include "mixer/pipewire_volume.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+static void test_written_volumes_read_back_unchanged(void) {
+    for (pa_volume_t volume = PA_VOLUME_MUTED;
+         volume <= PA_VOLUME_NORM * 2;
+         volume++) {
+        assert(pipewire_volume_to_pulse(pipewire_volume_from_pulse(volume)) ==
+               volume);
+    }
+}
+
+static void test_cubic_scale_matches_pipewire_pulse(void) {
+    assert(pipewire_volume_from_pulse(PA_VOLUME_MUTED) == 0.0f);
+    assert(pipewire_volume_from_pulse(PA_VOLUME_NORM) == 1.0f);
+    assert(pipewire_volume_from_pulse(PA_VOLUME_NORM / 2) == 0.125f);
+    assert(pipewire_volume_to_pulse(1.0f) == PA_VOLUME_NORM);
+    assert(pipewire_volume_to_pulse(0.125f) == PA_VOLUME_NORM / 2);
+}
+
+static void test_out_of_range_factors_are_clamped(void) {
+    assert(pipewire_volume_to_pulse(0.0f) == PA_VOLUME_MUTED);
+    assert(pipewire_volume_to_pulse(-1.0f) == PA_VOLUME_MUTED);
+    assert(pipewire_volume_to_pulse(NAN) == PA_VOLUME_MUTED);
+    assert(pipewire_volume_to_pulse(INFINITY) == PA_VOLUME_MAX);
+    assert(pipewire_volume_to_pulse(1e30f) == PA_VOLUME_MAX);
+}
+
+static void test_uniform_requires_equal_channels(void) {
+    uint32_t volume = 7;
+    float half = pipewire_volume_from_pulse(PA_VOLUME_NORM / 2);
+    float stereo[] = {half, half};
+    float uneven[] = {half, 1.0f};
+
+    assert(pipewire_volume_uniform(stereo, 2, &volume) == 1);
+    assert(volume == PA_VOLUME_NORM / 2);
+
+    volume = 7;
+    assert(pipewire_volume_uniform(uneven, 2, &volume) == 0);
+    assert(pipewire_volume_uniform(stereo, 0, &volume) == 0);
+    assert(pipewire_volume_uniform(NULL, 2, &volume) == 0);
+    assert(volume == 7);
+    assert(pipewire_volume_uniform(stereo, 2, NULL) == 0);
+}
+
+int main(void) {
+    test_written_volumes_read_back_unchanged();
+    test_cubic_scale_matches_pipewire_pulse();
+    test_out_of_range_factors_are_clamped();
+    test_uniform_requires_equal_channels();
+
+    printf("pipewire_volume tests passed\n");
+    return 0;
+}
@@ -50,16 +50,19 @@ static void test_initial_snapshot_copies_pulse_properties(void) {
         "Firefox",
         "firefox",
         "Firefox");
-    assert(pulse_stream_lifecycle_record(&inventory, 42, 2, properties) == 0);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 42, 2, properties, NULL, 0) == 0);
     pa_proplist_free(properties);
 
     const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 42);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(&inventory, 42);
     assert(stream != NULL);
     assert(stream->channel_count == 2);
-    assert(strcmp(stream->application_id, "org.mozilla.firefox") == 0);
-    assert(strcmp(stream->application_name, "Firefox") == 0);
-    assert(strcmp(stream->process_binary, "firefox") == 0);
-    assert(strcmp(stream->node_name, "Firefox") == 0);
+    assert(strcmp(stored->application_id, "org.mozilla.firefox") == 0);
+    assert(strcmp(stored->application_name, "Firefox") == 0);
+    assert(strcmp(stored->process_binary, "firefox") == 0);
+    assert(strcmp(stored->node_name, "Firefox") == 0);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -74,7 +77,7 @@ static void test_snapshot_and_events_upsert_the_same_stream(void) {
         "Discord",
         "discord-node");
     assert(pulse_stream_lifecycle_record(
-               &inventory, 10, 2, snapshot_properties) == 0);
+               &inventory, 10, 2, snapshot_properties, NULL, 0) == 0);
     pa_proplist_free(snapshot_properties);
 
     pa_proplist *new_properties = create_properties(
@@ -83,7 +86,7 @@ static void test_snapshot_and_events_upsert_the_same_stream(void) {
         "Discord",
         "discord-node");
     assert(pulse_stream_lifecycle_record(
-               &inventory, 10, 1, new_properties) == 0);
+               &inventory, 10, 1, new_properties, NULL, 0) == 0);
     pa_proplist_free(new_properties);
     assert(inventory.count == 1);
 
@@ -93,16 +96,18 @@ static void test_snapshot_and_events_upsert_the_same_stream(void) {
         "discord",
         "discord-voice-node");
     assert(pulse_stream_lifecycle_record(
-               &inventory, 10, 6, changed_properties) == 0);
+               &inventory, 10, 6, changed_properties, NULL, 0) == 0);
     pa_proplist_free(changed_properties);
 
     const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 10);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(&inventory, 10);
     assert(stream != NULL);
     assert(stream->channel_count == 6);
-    assert(strcmp(stream->application_id, "com.discordapp.Discord.canary") == 0);
-    assert(strcmp(stream->application_name, "Discord Voice") == 0);
-    assert(strcmp(stream->process_binary, "discord") == 0);
-    assert(strcmp(stream->node_name, "discord-voice-node") == 0);
+    assert(strcmp(stored->application_id, "com.discordapp.Discord.canary") == 0);
+    assert(strcmp(stored->application_name, "Discord Voice") == 0);
+    assert(strcmp(stored->process_binary, "discord") == 0);
+    assert(strcmp(stored->node_name, "discord-voice-node") == 0);
     assert(inventory.count == 1);
 
     assert(audio_stream_inventory_remove(&inventory, 10) == 1);
@@ -120,7 +125,8 @@ static void test_quickly_removed_unassigned_stream_does_not_remain(void) {
         "Unconfigured Player",
         NULL,
         "unconfigured-node");
-    assert(pulse_stream_lifecycle_record(&inventory, 77, 2, properties) == 0);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 77, 2, properties, NULL, 0) == 0);
     pa_proplist_free(properties);
     assert(audio_stream_inventory_find(&inventory, 77) != NULL);
 
@@ -136,15 +142,219 @@ static void test_missing_proplist_is_recorded_with_null_properties(void) {
     audio_stream_inventory_t inventory;
     audio_stream_inventory_init(&inventory);
 
-    assert(pulse_stream_lifecycle_record(&inventory, 99, 1, NULL) == 0);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 99, 1, NULL, NULL, 0) == 0);
 
     const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 99);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(&inventory, 99);
     assert(stream != NULL);
     assert(stream->channel_count == 1);
-    assert(stream->application_id == NULL);
-    assert(stream->application_name == NULL);
-    assert(stream->process_binary == NULL);
-    assert(stream->node_name == NULL);
+    assert(stored->application_id == NULL);
+    assert(stored->application_name == NULL);
+    assert(stored->process_binary == NULL);
+    assert(stored->node_name == NULL);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_uniform_volume_is_recorded(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    pa_cvolume volume;
+    pa_cvolume_set(&volume, 2, PA_VOLUME_NORM / 2);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, &volume, 0) ==
+           PULSE_STREAM_RECORD_STATE_CHANGED);
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 5);
+    assert(stream != NULL);
+    assert(stream->volume_known);
+    assert(stream->volume == PA_VOLUME_NORM / 2);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, &volume, 0) ==
+           PULSE_STREAM_RECORD_IDENTITY_UNCHANGED);
+
+    volume.values[1] = PA_VOLUME_NORM;
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, &volume, 0) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    stream = audio_stream_inventory_find(&inventory, 5);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
+
+    pa_cvolume_set(&volume, 1, PA_VOLUME_NORM);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, &volume, 0) ==
+           PULSE_STREAM_RECORD_IDENTITY_UNCHANGED);
+    stream = audio_stream_inventory_find(&inventory, 5);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
+
+    pa_cvolume_set(&volume, 2, PA_VOLUME_MUTED);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, &volume, 0) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 5, 2, NULL, NULL, 0) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    stream = audio_stream_inventory_find(&inventory, 5);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_uncork_reports_deferred_volume_once(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 1) ==
+           PULSE_STREAM_RECORD_STATE_CHANGED);
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 6);
+    assert(stream != NULL);
+    assert(stream->corked);
+
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 0) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 1) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    assert(audio_stream_inventory_defer_volume(&inventory, 6) == 0);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 1) ==
+           PULSE_STREAM_RECORD_IDENTITY_UNCHANGED);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 0) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_UNCORKED_DEFERRED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    stream = audio_stream_inventory_find(&inventory, 6);
+    assert(stream != NULL);
+    assert(!stream->corked);
+    assert(!stream->volume_deferred);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 6, 2, NULL, NULL, 0) ==
+           PULSE_STREAM_RECORD_IDENTITY_UNCHANGED);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_unchanged_identity_skips_property_update(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    pa_proplist *properties = create_properties(
+        "org.example.Game", "Game", "game", "game-node");
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 9, 2, properties, NULL, 0) == 0);
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 9);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(&inventory, 9);
+    assert(stream != NULL);
+    const char *application_name = stored->application_name;
+    uint64_t allocations = inventory.strings.allocation_count;
+
+    assert(pa_proplist_sets(properties, "media.name", "Level 2") == 0);
+    pa_cvolume volume;
+    pa_cvolume_set(&volume, 2, PA_VOLUME_NORM / 2);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 9, 2, properties, &volume, 1) ==
+           (PULSE_STREAM_RECORD_IDENTITY_UNCHANGED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    stream = audio_stream_inventory_find(&inventory, 9);
+    stored = audio_stream_inventory_find_properties(&inventory, 9);
+    assert(stored->application_name == application_name);
+    assert(inventory.strings.allocation_count == allocations);
+    assert(stream->volume_known);
+    assert(stream->volume == PA_VOLUME_NORM / 2);
+    assert(stream->corked);
+
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 9, 6, properties, NULL, 0) ==
+           PULSE_STREAM_RECORD_STATE_CHANGED);
+    assert(pa_proplist_sets(properties, "node.name", "game-node-2") == 0);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 9, 6, properties, NULL, 0) == 0);
+    stream = audio_stream_inventory_find(&inventory, 9);
+    stored = audio_stream_inventory_find_properties(&inventory, 9);
+    assert(strcmp(stored->node_name, "game-node-2") == 0);
+    pa_proplist_free(properties);
+
+    audio_stream_inventory_clear(&inventory);
+}
+
+static void test_fingerprint_separates_missing_and_empty_values(void) {
+    pa_proplist *missing = create_properties(NULL, "Game", NULL, NULL);
+    pa_proplist *empty = create_properties("", "Game", NULL, NULL);
+    pa_proplist *moved = create_properties(NULL, NULL, "Game", NULL);
+
+    uint64_t missing_fingerprint =
+        pulse_stream_lifecycle_fingerprint(2, missing);
+    assert(missing_fingerprint != 0);
+    assert(missing_fingerprint ==
+           pulse_stream_lifecycle_fingerprint(2, missing));
+    assert(missing_fingerprint !=
+           pulse_stream_lifecycle_fingerprint(2, empty));
+    assert(missing_fingerprint !=
+           pulse_stream_lifecycle_fingerprint(2, moved));
+    assert(missing_fingerprint !=
+           pulse_stream_lifecycle_fingerprint(1, missing));
+    assert(pulse_stream_lifecycle_fingerprint(2, NULL) != 0);
+
+    pa_proplist_free(moved);
+    pa_proplist_free(empty);
+    pa_proplist_free(missing);
+}
+
+static void test_state_update_keeps_properties(void) {
+    audio_stream_inventory_t inventory;
+    audio_stream_inventory_init(&inventory);
+
+    pa_cvolume volume;
+    pa_cvolume_set(&volume, 2, PA_VOLUME_NORM / 4);
+    assert(pulse_stream_lifecycle_record_state(
+               &inventory, 8, &volume, 0) == -1);
+    assert(audio_stream_inventory_find(&inventory, 8) == NULL);
+
+    pa_proplist *properties = create_properties(
+        NULL, "Discord", NULL, NULL);
+    assert(pulse_stream_lifecycle_record(
+               &inventory, 8, 2, properties, NULL, 1) ==
+           PULSE_STREAM_RECORD_STATE_CHANGED);
+    pa_proplist_free(properties);
+    assert(audio_stream_inventory_defer_volume(&inventory, 8) == 0);
+
+    assert(pulse_stream_lifecycle_record_state(
+               &inventory, 8, &volume, 0) ==
+           (PULSE_STREAM_RECORD_UNCORKED_DEFERRED |
+            PULSE_STREAM_RECORD_STATE_CHANGED));
+    const audio_stream_t *stream = audio_stream_inventory_find(&inventory, 8);
+    const audio_stream_properties_t *stored =
+        audio_stream_inventory_find_properties(&inventory, 8);
+    assert(stream != NULL);
+    assert(strcmp(stored->application_name, "Discord") == 0);
+    assert(stream->volume_known);
+    assert(stream->volume == PA_VOLUME_NORM / 4);
+    assert(!stream->corked);
+
+    assert(pulse_stream_lifecycle_record_state(
+               &inventory, 8, &volume, 0) == 0);
+    pa_cvolume_set(&volume, 1, PA_VOLUME_NORM);
+    assert(pulse_stream_lifecycle_record_state(
+               &inventory, 8, &volume, 0) ==
+           PULSE_STREAM_RECORD_STATE_CHANGED);
+    stream = audio_stream_inventory_find(&inventory, 8);
+    stored = audio_stream_inventory_find_properties(&inventory, 8);
+    assert(stream != NULL);
+    assert(!stream->volume_known);
 
     audio_stream_inventory_clear(&inventory);
 }
@@ -154,6 +364,11 @@ int main(void) {
     test_snapshot_and_events_upsert_the_same_stream();
     test_quickly_removed_unassigned_stream_does_not_remain();
     test_missing_proplist_is_recorded_with_null_properties();
+    test_uniform_volume_is_recorded();
+    test_uncork_reports_deferred_volume_once();
+    test_unchanged_identity_skips_property_update();
+    test_fingerprint_separates_missing_and_empty_values();
+    test_state_update_keeps_properties();
 
     printf("pulse_stream_lifecycle tests passed\n");
     return 0;
@@ -0,0 +1,244 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mixer/sink_input_request_pool.h"
+
+static void assert_pool_is_cleared(const sink_input_request_pool_t *pool) {
+    assert(pool->chunks == NULL);
+    assert(pool->free_requests == NULL);
+    assert(pool->completed_head == NULL);
+    assert(pool->completed_tail == NULL);
+    assert(pool->live == NULL);
+    assert(pool->live_count == 0);
+    assert(pool->capacity == 0);
+    assert(pool->memory.bytes == 0);
+}
+
+static size_t count_live(const sink_input_request_pool_t *pool) {
+    size_t count = 0;
+    const sink_input_info_request_t *previous = NULL;
+    for (const sink_input_info_request_t *request = pool->live;
+         request;
+         request = request->live_next) {
+        assert(request->live_previous == previous);
+        previous = request;
+        count++;
+    }
+    return count;
+}
+
+static void test_supported_null_arguments(void) {
+    sink_input_request_pool_t pool;
+    sink_input_request_pool_init(&pool);
+
+    sink_input_request_pool_init(NULL);
+    assert(sink_input_request_pool_acquire(NULL) == NULL);
+    sink_input_request_pool_complete(NULL, NULL);
+    sink_input_request_pool_complete(&pool, NULL);
+    assert(sink_input_request_pool_take_completed(NULL) == NULL);
+    assert(sink_input_request_pool_take_completed(&pool) == NULL);
+    sink_input_request_pool_release(NULL, NULL);
+    sink_input_request_pool_release(&pool, NULL);
+    assert(sink_input_request_from_token(NULL) == NULL);
+    sink_input_request_pool_clear(NULL);
+
+    assert_pool_is_cleared(&pool);
+    sink_input_request_pool_clear(&pool);
+}
+
+static void test_released_requests_are_reused_without_growth(void) {
+    sink_input_request_pool_t pool;
+    sink_input_request_pool_init(&pool);
+
+    sink_input_info_request_t *first = sink_input_request_pool_acquire(&pool);
+    assert(first);
+    size_t capacity = pool.capacity;
+    size_t bytes = pool.memory.bytes;
+    assert(capacity > 0 && bytes > 0);
+    first->result_received = 1;
+    first->token.index = 7;
+    sink_input_request_pool_release(&pool, first);
+    assert(pool.live_count == 0);
+    assert(pool.live == NULL);
+
+    for (int round = 0; round < 100; round++) {
+        sink_input_info_request_t *request =
+            sink_input_request_pool_acquire(&pool);
+        assert(request == first);
+        assert(request->result_received == 0);
+        assert(request->token.index == 0);
+        assert(request->completed == 0);
+        assert(request->operation == NULL);
+        sink_input_request_pool_release(&pool, request);
+    }
+    assert(pool.capacity == capacity);
+    assert(pool.memory.bytes == bytes);
+
+    sink_input_request_pool_clear(&pool);
+    assert_pool_is_cleared(&pool);
+}
+
+static void test_growth_doubles_and_keeps_live_requests(void) {
+    enum { REQUEST_COUNT = 1000 };
+    sink_input_request_pool_t pool;
+    sink_input_info_request_t *requests[REQUEST_COUNT];
+    sink_input_request_pool_init(&pool);
+
+    size_t chunk_count = 0;
+    size_t capacity = 0;
+    for (uint32_t i = 0; i < REQUEST_COUNT; i++) {
+        requests[i] = sink_input_request_pool_acquire(&pool);
+        assert(requests[i]);
+        requests[i]->token.index = i;
+        if (pool.capacity != capacity) {
+            assert(capacity == 0 || pool.capacity == 2 * capacity);
+            capacity = pool.capacity;
+            chunk_count++;
+        }
+    }
+    assert(pool.live_count == REQUEST_COUNT);
+    assert(count_live(&pool) == REQUEST_COUNT);
+    assert(chunk_count < 10);
+    assert(pool.memory.peak_bytes == pool.memory.bytes);
+
+    /* Releasing from both ends and the middle keeps the live list linked. */
+    for (uint32_t i = 0; i < REQUEST_COUNT; i += 3) {
+        sink_input_request_pool_release(&pool, requests[i]);
+    }
+    assert(count_live(&pool) == pool.live_count);
+    for (uint32_t i = 0; i < REQUEST_COUNT; i++) {
+        if (i % 3 != 0) {
+            assert(requests[i]->token.index == i);
+            sink_input_request_pool_release(&pool, requests[i]);
+        }
+    }
+    assert(pool.live_count == 0);
+    assert(pool.live == NULL);
+
+    /* Every request comes back from the free list before the pool grows. */
+    for (uint32_t i = 0; i < capacity; i++) {
+        assert(sink_input_request_pool_acquire(&pool));
+    }
+    assert(pool.capacity == capacity);
+
+    sink_input_request_pool_clear(&pool);
+    assert_pool_is_cleared(&pool);
+}
+
+static void test_completion_queue_is_fifo_and_queues_once(void) {
+    sink_input_request_pool_t pool;
+    sink_input_info_request_t *requests[5];
+    sink_input_request_pool_init(&pool);
+
+    for (int i = 0; i < 5; i++) {
+        requests[i] = sink_input_request_pool_acquire(&pool);
+        assert(requests[i]);
+    }
+    sink_input_request_pool_complete(&pool, requests[3]);
+    sink_input_request_pool_complete(&pool, requests[1]);
+    sink_input_request_pool_complete(&pool, requests[3]);
+    sink_input_request_pool_complete(&pool, requests[4]);
+    assert(requests[3]->completed);
+    assert(!requests[0]->completed);
+
+    assert(sink_input_request_pool_take_completed(&pool) == requests[3]);
+    sink_input_request_pool_release(&pool, requests[3]);
+    assert(sink_input_request_pool_take_completed(&pool) == requests[1]);
+    sink_input_request_pool_release(&pool, requests[1]);
+
+    /* A request completed while others are queued goes behind them. */
+    sink_input_request_pool_complete(&pool, requests[0]);
+    assert(sink_input_request_pool_take_completed(&pool) == requests[4]);
+    assert(sink_input_request_pool_take_completed(&pool) == requests[0]);
+    assert(sink_input_request_pool_take_completed(&pool) == NULL);
+    assert(pool.completed_tail == NULL);
+
+    /* Taken requests stay live until released. */
+    assert(pool.live_count == 3);
+    assert(count_live(&pool) == 3);
+
+    sink_input_request_pool_complete(&pool, requests[2]);
+    sink_input_request_pool_clear(&pool);
+    assert_pool_is_cleared(&pool);
+}
+
+static void test_tracker_tokens_lead_back_to_requests(void) {
+    sink_input_request_pool_t pool;
+    sink_input_request_tracker_t tracker;
+    sink_input_request_pool_init(&pool);
+    sink_input_request_tracker_init(&tracker);
+
+    sink_input_info_request_t *first = sink_input_request_pool_acquire(&pool);
+    sink_input_info_request_t *second =
+        sink_input_request_pool_acquire(&pool);
+    sink_input_info_request_t *other = sink_input_request_pool_acquire(&pool);
+    assert(first && second && other);
+    assert(sink_input_request_tracker_begin(
+               &tracker, 9, SINK_INPUT_REQUEST_NEW, &first->token) == 0);
+    assert(sink_input_request_tracker_begin(
+               &tracker, 4, SINK_INPUT_REQUEST_NEW, &other->token) == 0);
+    assert(sink_input_request_tracker_begin(
+               &tracker, 9, SINK_INPUT_REQUEST_CHANGE, &second->token) == 0);
+
+    /* A removal completes exactly the requests for its index. */
+    sink_input_request_tracker_invalidate(&tracker, 9);
+    size_t found = 0;
+    for (sink_input_request_token_t *token =
+             sink_input_request_tracker_first_request(&tracker, 9);
+         token;
+         token = token->next) {
+        sink_input_info_request_t *request =
+            sink_input_request_from_token(token);
+        assert(request == first || request == second);
+        sink_input_request_pool_complete(&pool, request);
+        found++;
+    }
+    assert(found == 2);
+
+    sink_input_info_request_t *request;
+    while ((request = sink_input_request_pool_take_completed(&pool))) {
+        assert(!sink_input_request_tracker_is_current(&tracker,
+                                                      &request->token));
+        sink_input_request_tracker_finish(&tracker, &request->token);
+        sink_input_request_pool_release(&pool, request);
+    }
+    assert(sink_input_request_tracker_first_request(&tracker, 9) == NULL);
+    assert(sink_input_request_tracker_is_current(&tracker, &other->token));
+    assert(pool.live == other);
+
+    sink_input_request_tracker_finish(&tracker, &other->token);
+    sink_input_request_pool_release(&pool, other);
+    assert(tracker.index_count == 0);
+    sink_input_request_tracker_clear(&tracker);
+    sink_input_request_pool_clear(&pool);
+}
+
+static void test_clear_with_live_requests_and_reuse(void) {
+    sink_input_request_pool_t pool;
+    sink_input_request_pool_init(&pool);
+
+    for (int cycle = 0; cycle < 50; cycle++) {
+        for (int i = 0; i < 20 + cycle; i++) {
+            sink_input_info_request_t *request =
+                sink_input_request_pool_acquire(&pool);
+            assert(request);
+            if (i % 2 == 0) sink_input_request_pool_complete(&pool, request);
+        }
+        assert(pool.live_count == (size_t)(20 + cycle));
+        sink_input_request_pool_clear(&pool);
+        assert_pool_is_cleared(&pool);
+        sink_input_request_pool_clear(&pool);
+    }
+}
+
+int main(void) {
+    test_supported_null_arguments();
+    test_released_requests_are_reused_without_growth();
+    test_growth_doubles_and_keeps_live_requests();
+    test_completion_queue_is_fifo_and_queues_once();
+    test_tracker_tokens_lead_back_to_requests();
+    test_clear_with_live_requests_and_reuse();
+    printf("sink_input_request_pool tests passed\n");
+    return 0;
+}
@@ -9,7 +9,16 @@ static void assert_tracker_is_cleared(
     assert(tracker->indexes == NULL);
     assert(tracker->index_count == 0);
     assert(tracker->index_capacity == 0);
-    assert(tracker->requests == NULL);
+}
+
+static sink_input_index_generation_t *find_index_state(
+    sink_input_request_tracker_t *tracker,
+    uint32_t index) {
+    for (size_t i = 0; i < tracker->index_capacity; i++) {
+        sink_input_index_generation_t *entry = &tracker->indexes[i];
+        if (entry->request_count != 0 && entry->index == index) return entry;
+    }
+    return NULL;
 }
 
 static void test_supported_null_arguments(void) {
@@ -29,6 +38,15 @@ static void test_supported_null_arguments(void) {
     assert(!sink_input_request_tracker_is_current(&tracker, NULL));
     sink_input_request_tracker_finish(NULL, &token);
     sink_input_request_tracker_finish(&tracker, NULL);
+    assert(sink_input_request_tracker_coalesce(
+               NULL, 1, SINK_INPUT_REQUEST_NEW) == 0);
+    sink_input_request_intent_t intent;
+    assert(sink_input_request_tracker_take_follow_up(
+               NULL, &token, &intent) == 0);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, NULL, &intent) == 0);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &token, NULL) == 0);
     sink_input_request_tracker_clear(NULL);
 
     derived_inventory_state_init(NULL);
@@ -116,6 +134,90 @@ static void test_pending_new_and_change_preserve_intent(void) {
     sink_input_request_tracker_clear(&tracker);
 }
 
+static void test_events_coalesce_into_one_follow_up(void) {
+    sink_input_request_tracker_t tracker;
+    sink_input_request_token_t request;
+    sink_input_request_token_t follow_up;
+    sink_input_request_intent_t intent;
+    sink_input_request_tracker_init(&tracker);
+
+    /* Nothing in flight, so the caller sends the request itself. */
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE) == 0);
+    assert(sink_input_request_tracker_begin(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE, &request) == 0);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &request, &intent) == 0);
+
+    for (int i = 0; i < 10; i++) {
+        assert(sink_input_request_tracker_coalesce(
+                   &tracker, 60, SINK_INPUT_REQUEST_CHANGE) == 1);
+    }
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 61, SINK_INPUT_REQUEST_CHANGE) == 0);
+    assert(tracker.coalesced_count == 10);
+
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &request, &intent) == 1);
+    assert(intent == SINK_INPUT_REQUEST_CHANGE);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &request, &intent) == 0);
+    assert(tracker.follow_up_count == 1);
+    sink_input_request_tracker_finish(&tracker, &request);
+
+    /* A NEW intent survives later CHANGE events. */
+    assert(sink_input_request_tracker_begin(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE, &follow_up) == 0);
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 60, SINK_INPUT_REQUEST_NEW) == 1);
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE) == 1);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &follow_up, &intent) == 1);
+    assert(intent == SINK_INPUT_REQUEST_NEW);
+
+    /* finish() drops a follow-up that was not taken. */
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE) == 1);
+    sink_input_request_tracker_finish(&tracker, &follow_up);
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 60, SINK_INPUT_REQUEST_CHANGE) == 0);
+    assert(tracker.index_count == 0);
+    sink_input_request_tracker_clear(&tracker);
+}
+
+static void test_removal_drops_follow_up(void) {
+    sink_input_request_tracker_t tracker;
+    sink_input_request_token_t removed;
+    sink_input_request_token_t reused;
+    sink_input_request_intent_t intent;
+    sink_input_request_tracker_init(&tracker);
+
+    assert(sink_input_request_tracker_begin(
+               &tracker, 70, SINK_INPUT_REQUEST_NEW, &removed) == 0);
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 70, SINK_INPUT_REQUEST_CHANGE) == 1);
+    sink_input_request_tracker_invalidate(&tracker, 70);
+
+    /* A stale request neither absorbs events nor yields a follow-up. */
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 70, SINK_INPUT_REQUEST_NEW) == 0);
+    assert(sink_input_request_tracker_begin(
+               &tracker, 70, SINK_INPUT_REQUEST_NEW, &reused) == 0);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &removed, &intent) == 0);
+    assert(sink_input_request_tracker_coalesce(
+               &tracker, 70, SINK_INPUT_REQUEST_CHANGE) == 1);
+
+    /* Finishing the stale request keeps the current one's follow-up. */
+    sink_input_request_tracker_finish(&tracker, &removed);
+    assert(sink_input_request_tracker_take_follow_up(
+               &tracker, &reused, &intent) == 1);
+    assert(intent == SINK_INPUT_REQUEST_CHANGE);
+    sink_input_request_tracker_finish(&tracker, &reused);
+    sink_input_request_tracker_clear(&tracker);
+}
+
 static void test_remove_invalidates_same_index_only(void) {
     sink_input_request_tracker_t tracker;
     sink_input_request_token_t first_new;
@@ -130,13 +232,28 @@ static void test_remove_invalidates_same_index_only(void) {
     assert(sink_input_request_tracker_begin(
                &tracker, 51, SINK_INPUT_REQUEST_NEW, &second_index) == 0);
 
+    /* Each index lists its own requests, newest first. */
+    assert(sink_input_request_tracker_first_request(&tracker, 50) ==
+           &first_change);
+    assert(first_change.next == &first_new);
+    assert(first_new.next == NULL);
+    assert(sink_input_request_tracker_first_request(&tracker, 51) ==
+           &second_index);
+    assert(second_index.next == NULL);
+    assert(sink_input_request_tracker_first_request(&tracker, 52) == NULL);
+    assert(sink_input_request_tracker_first_request(NULL, 50) == NULL);
+
     sink_input_request_tracker_invalidate(&tracker, 50);
     assert(!sink_input_request_tracker_is_current(&tracker, &first_new));
     assert(!sink_input_request_tracker_is_current(&tracker, &first_change));
     assert(sink_input_request_tracker_is_current(&tracker, &second_index));
 
-    sink_input_request_tracker_finish(&tracker, &first_new);
     sink_input_request_tracker_finish(&tracker, &first_change);
+    assert(sink_input_request_tracker_first_request(&tracker, 50) ==
+           &first_new);
+    assert(first_new.previous == NULL);
+    sink_input_request_tracker_finish(&tracker, &first_new);
+    assert(sink_input_request_tracker_first_request(&tracker, 50) == NULL);
     sink_input_request_tracker_finish(&tracker, &second_index);
     sink_input_request_tracker_clear(&tracker);
 }
@@ -150,12 +267,15 @@ static void test_generation_wrap_keeps_old_request_invalid(void) {
     assert(sink_input_request_tracker_begin(
                &tracker, 60, SINK_INPUT_REQUEST_NEW, &old_request) == 0);
     assert(tracker.index_count == 1);
-    tracker.indexes[0].generation = UINT64_MAX;
+    sink_input_index_generation_t *index_state = find_index_state(
+        &tracker,
+        60);
+    index_state->generation = UINT64_MAX;
     old_request.generation = UINT64_MAX;
     assert(sink_input_request_tracker_is_current(&tracker, &old_request));
 
     sink_input_request_tracker_invalidate(&tracker, 60);
-    assert(tracker.indexes[0].generation == 0);
+    assert(index_state->generation == 0);
     assert(sink_input_request_tracker_begin(
                &tracker, 60, SINK_INPUT_REQUEST_NEW, &new_request) == 0);
     assert(new_request.generation == 0);
@@ -234,6 +354,8 @@ static void test_index_growth_and_nontrivial_finish_order(void) {
 
     assert(tracker.index_count == REQUEST_COUNT);
     assert(tracker.index_capacity >= REQUEST_COUNT);
+    size_t peak_bytes = tracker.memory.bytes;
+    assert(tracker.memory.peak_bytes == peak_bytes);
 
     for (size_t i = 0; i < REQUEST_COUNT; i++) {
         size_t finished_index = finish_order[i];
@@ -255,6 +377,12 @@ static void test_index_growth_and_nontrivial_finish_order(void) {
         }
     }
 
+    /* The index array shrinks back once the requests have finished. */
+    assert(tracker.index_capacity == 4);
+    assert(tracker.memory.bytes < peak_bytes);
+    assert(tracker.memory.peak_bytes == peak_bytes);
+    assert(tracker.memory.shrink_count > 0);
+
     sink_input_request_tracker_clear(&tracker);
     assert_tracker_is_cleared(&tracker);
 }
@@ -305,6 +433,52 @@ static void test_repeated_invalidation_and_finish(void) {
     assert_tracker_is_cleared(&tracker);
 }
 
+static void test_many_indexes_with_interleaved_finishes(void) {
+    enum { INDEX_COUNT = 300, REQUEST_COUNT = 900 };
+    sink_input_request_tracker_t tracker;
+    static sink_input_request_token_t requests[REQUEST_COUNT];
+    static int finished[REQUEST_COUNT];
+    sink_input_request_tracker_init(&tracker);
+
+    /* Three requests per index, with indexes spread like server indexes. */
+    for (size_t i = 0; i < REQUEST_COUNT; i++) {
+        uint32_t index = (uint32_t)(i % INDEX_COUNT) * 64;
+        assert(sink_input_request_tracker_begin(
+                   &tracker,
+                   index,
+                   SINK_INPUT_REQUEST_CHANGE,
+                   &requests[i]) == 0);
+    }
+    assert(tracker.index_count == INDEX_COUNT);
+    assert(tracker.index_capacity >= INDEX_COUNT * 2);
+
+    for (uint32_t index = 0; index < INDEX_COUNT * 64; index += 128) {
+        sink_input_request_tracker_invalidate(&tracker, index);
+    }
+
+    /* Finish in a scattered order, checking the rest after each step. */
+    for (size_t step = 0; step < REQUEST_COUNT; step++) {
+        size_t finished_request = (step * 7) % REQUEST_COUNT;
+        sink_input_request_tracker_finish(
+            &tracker,
+            &requests[finished_request]);
+        finished[finished_request] = 1;
+
+        if (step % 50 != 0) continue;
+        for (size_t i = 0; i < REQUEST_COUNT; i++) {
+            int invalidated = (i % INDEX_COUNT) % 2 == 0;
+            assert(sink_input_request_tracker_is_current(
+                       &tracker,
+                       &requests[i]) == (!finished[i] && !invalidated));
+        }
+    }
+    assert(tracker.index_count == 0);
+    assert(tracker.index_capacity == 4);
+
+    sink_input_request_tracker_clear(&tracker);
+    assert_tracker_is_cleared(&tracker);
+}
+
 static void test_repeated_tracker_lifecycle_cycles(void) {
     sink_input_request_tracker_t tracker;
     sink_input_request_tracker_init(&tracker);
@@ -381,11 +555,14 @@ int main(void) {
     test_remove_rejects_late_result();
     test_new_after_index_reuse_is_accepted();
     test_pending_new_and_change_preserve_intent();
+    test_events_coalesce_into_one_follow_up();
+    test_removal_drops_follow_up();
     test_remove_invalidates_same_index_only();
     test_generation_wrap_keeps_old_request_invalid();
     test_clear_with_live_tokens_and_reuse();
     test_index_growth_and_nontrivial_finish_order();
     test_repeated_invalidation_and_finish();
+    test_many_indexes_with_interleaved_finishes();
     test_repeated_tracker_lifecycle_cycles();
     test_derived_inventory_failure_and_recovery();
     test_repeated_derived_inventory_cycles();
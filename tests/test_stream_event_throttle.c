@@ -0,0 +1,388 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mixer/stream_event_throttle.h"
+
+/* Milliseconds a throttled bucket takes to refill completely. */
+#define STREAM_REFILL_MS \
+    (1000U * STREAM_EVENT_THROTTLE_STREAM_BURST / \
+     STREAM_EVENT_THROTTLE_STREAM_RATE)
+#define CLIENT_REFILL_MS \
+    (1000U * STREAM_EVENT_THROTTLE_CLIENT_BURST / \
+     STREAM_EVENT_THROTTLE_CLIENT_RATE)
+
+static void assert_throttle_is_cleared(
+    const stream_event_throttle_t *throttle) {
+    assert(throttle->streams == NULL);
+    assert(throttle->stream_count == 0);
+    assert(throttle->stream_capacity == 0);
+    assert(throttle->clients == NULL);
+    assert(throttle->client_count == 0);
+    assert(throttle->client_capacity == 0);
+    assert(throttle->pending_count == 0);
+    assert(throttle->event_count == 0);
+    assert(throttle->throttled_client_count == 0);
+    assert(throttle->memory.bytes == 0);
+}
+
+/* Sends the stream's whole burst at now_ms, all of which is admitted. */
+static void spend_stream_burst(stream_event_throttle_t *throttle,
+                               uint32_t index,
+                               uint64_t now_ms) {
+    for (unsigned int i = 0; i < STREAM_EVENT_THROTTLE_STREAM_BURST; i++) {
+        assert(stream_event_throttle_admit(throttle, index, now_ms) == 1);
+    }
+}
+
+static void test_supported_null_arguments(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    uint32_t index = 0;
+
+    stream_event_throttle_init(NULL);
+    assert(stream_event_throttle_assign(NULL, 1, 2, "Player", 0) == -1);
+    assert(stream_event_throttle_admit(NULL, 1, 0) == 1);
+    assert(stream_event_throttle_take_sample(NULL, 0, &index) == 0);
+    assert(stream_event_throttle_take_sample(&throttle, 0, NULL) == 0);
+    assert(stream_event_throttle_take_sample(&throttle, 0, &index) == 0);
+    stream_event_throttle_expect_change(NULL, 1, 0);
+    stream_event_throttle_forget(NULL, 1);
+    stream_event_throttle_forget(&throttle, 1);
+    stream_event_throttle_clear(NULL);
+
+    assert_throttle_is_cleared(&throttle);
+    stream_event_throttle_clear(&throttle);
+}
+
+static void test_calm_streams_are_read_per_event(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    assert(stream_event_throttle_assign(&throttle, 3, 7, "Voice", 0) == 0);
+
+    /* Slightly below the stream rate, every event is read for a minute. */
+    uint64_t interval_ms = 1000U / STREAM_EVENT_THROTTLE_STREAM_RATE + 10U;
+    for (uint64_t now_ms = 0; now_ms < 60000U; now_ms += interval_ms) {
+        assert(stream_event_throttle_admit(&throttle, 3, now_ms) == 1);
+    }
+    assert(throttle.throttled_stream_count == 0);
+    assert(throttle.deferred_event_count == 0);
+    assert(throttle.pending_count == 0);
+
+    stream_event_throttle_clear(&throttle);
+}
+
+static void test_spamming_stream_is_sampled_until_calm(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    uint32_t index = 0;
+
+    spend_stream_burst(&throttle, 5, 1000);
+    assert(stream_event_throttle_admit(&throttle, 5, 1000) == 0);
+    assert(throttle.throttled_stream_count == 1);
+    assert(throttle.pending_count == 1);
+
+    /* The stream was read when its last event was admitted. */
+    assert(stream_event_throttle_take_sample(&throttle, 1999, &index) == 0);
+    assert(stream_event_throttle_take_sample(&throttle, 2000, &index) == 1);
+    assert(index == 5);
+    assert(throttle.pending_count == 0);
+    assert(stream_event_throttle_take_sample(&throttle, 2000, &index) == 0);
+
+    /* Continued spam stays sampled, once per interval. */
+    uint64_t now_ms = 2000;
+    size_t samples = 0;
+    for (; now_ms < 12000; now_ms += 20) {
+        assert(stream_event_throttle_admit(&throttle, 5, now_ms) == 0);
+        samples += (size_t)stream_event_throttle_take_sample(&throttle,
+                                                             now_ms,
+                                                             &index);
+    }
+    assert(samples == 9);
+    assert(throttle.throttled_stream_count == 1);
+    assert(throttle.deferred_event_count == 1 + 500);
+
+    /* Quiet for a full refill, the pending stream is read and released. */
+    now_ms += STREAM_REFILL_MS;
+    assert(stream_event_throttle_take_sample(&throttle, now_ms, &index) == 1);
+    assert(throttle.released_stream_count == 1);
+    assert(stream_event_throttle_admit(&throttle, 5, now_ms) == 1);
+    assert(throttle.sample_count == 11);
+
+    stream_event_throttle_clear(&throttle);
+}
+
+static void test_client_budget_covers_all_its_streams(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    uint32_t index = 0;
+
+    /* Eight streams of one client, each within its own rate. */
+    for (uint32_t stream = 10; stream < 18; stream++) {
+        assert(stream_event_throttle_assign(&throttle,
+                                            stream,
+                                            42,
+                                            "Electron Helper",
+                                            0) == 0);
+    }
+    assert(stream_event_throttle_assign(&throttle, 30, 43, "Voice", 0) == 0);
+    assert(throttle.client_count == 2);
+
+    uint64_t now_ms = 0;
+    int deferred = 0;
+    while (!deferred) {
+        now_ms += 250;
+        for (uint32_t stream = 10; stream < 18 && !deferred; stream++) {
+            deferred = stream_event_throttle_admit(&throttle,
+                                                   stream,
+                                                   now_ms) == 0;
+        }
+        assert(now_ms < 10000);
+    }
+    assert(throttle.throttled_stream_count == 0);
+    assert(throttle.throttled_client_count == 1);
+    const stream_event_client_t *spammer = &throttle.clients[0];
+    assert(spammer->client == 42);
+    assert(spammer->throttled);
+    assert(spammer->throttle_count == 1);
+    assert(strcmp(spammer->name, "Electron Helper") == 0);
+
+    /* Other clients and every other stream of the throttled one. */
+    assert(stream_event_throttle_admit(&throttle, 30, now_ms) == 1);
+    assert(stream_event_throttle_admit(&throttle, 10, now_ms) == 0);
+    assert(spammer->deferred_event_count == 2);
+
+    /* After a full refill the client is read per event again. */
+    now_ms += CLIENT_REFILL_MS;
+    size_t pending = throttle.pending_count;
+    assert(pending > 0);
+    size_t samples = 0;
+    while (stream_event_throttle_take_sample(&throttle, now_ms, &index)) {
+        assert(index >= 10 && index < 18);
+        samples++;
+    }
+    assert(samples == pending);
+    assert(!spammer->throttled);
+    assert(throttle.released_client_count == 1);
+    assert(stream_event_throttle_admit(&throttle, 11, now_ms) == 1);
+
+    stream_event_throttle_clear(&throttle);
+}
+
+static void test_forget_drops_streams_and_quiet_clients(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    uint32_t index = 0;
+
+    assert(stream_event_throttle_assign(&throttle, 1, 5, "Quiet", 0) == 0);
+    assert(stream_event_throttle_assign(&throttle, 2, 6, "Noisy", 0) == 0);
+    assert(stream_event_throttle_assign(&throttle, 3, 6, NULL, 0) == 0);
+    assert(stream_event_throttle_assign(&throttle, 8, 6, NULL, 0) == 0);
+    assert(strcmp(throttle.clients[1].name, "Noisy") == 0);
+    assert(throttle.clients[1].stream_count == 3);
+
+    spend_stream_burst(&throttle, 2, 0);
+    spend_stream_burst(&throttle, 3, 0);
+    spend_stream_burst(&throttle, 8, 0);
+    assert(stream_event_throttle_admit(&throttle, 2, 1) == 0);
+    assert(stream_event_throttle_admit(&throttle, 3, 1) == 0);
+    assert(throttle.clients[1].throttled);
+    assert(throttle.pending_count == 2);
+
+    /* A removed stream's pending sample is dropped. */
+    stream_event_throttle_forget(&throttle, 2);
+    assert(throttle.pending_count == 1);
+    assert(throttle.stream_count == 3);
+
+    /* A throttled client outlives its streams so it can be reported. */
+    stream_event_throttle_forget(&throttle, 3);
+    stream_event_throttle_forget(&throttle, 8);
+    stream_event_throttle_forget(&throttle, 1);
+    assert(throttle.pending_count == 0);
+    assert(throttle.stream_count == 0);
+    assert(throttle.client_count == 1);
+    assert(throttle.clients[0].client == 6);
+    assert(throttle.clients[0].stream_count == 0);
+    assert(stream_event_throttle_take_sample(&throttle, 5000, &index) == 0);
+
+    /* A stream moved to another client leaves its old one. */
+    assert(stream_event_throttle_assign(&throttle, 4, 6, "Noisy", 0) == 0);
+    assert(stream_event_throttle_assign(&throttle, 4, 7, "Moved", 0) == 0);
+    assert(throttle.client_count == 2);
+    assert(throttle.clients[0].stream_count == 0);
+    assert(stream_event_throttle_assign(
+               &throttle,
+               4,
+               STREAM_EVENT_THROTTLE_NO_CLIENT,
+               "Clientless",
+               0) == 0);
+    assert(throttle.client_count == 1);
+    assert(throttle.streams[0].client == STREAM_EVENT_THROTTLE_NO_CLIENT);
+
+    stream_event_throttle_clear(&throttle);
+    assert_throttle_is_cleared(&throttle);
+}
+
+static void test_routed_writes_do_not_trip_the_throttle(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+
+    /* The wheel turns for a minute and every write causes a change event. */
+    for (uint32_t stream = 20; stream < 28; stream++) {
+        assert(stream_event_throttle_assign(&throttle,
+                                            stream,
+                                            9,
+                                            "Voice",
+                                            0) == 0);
+    }
+    for (uint64_t now_ms = 0; now_ms < 60000U; now_ms += 100) {
+        for (uint32_t stream = 20; stream < 28; stream++) {
+            stream_event_throttle_expect_change(&throttle, stream, now_ms);
+        }
+        for (uint32_t stream = 20; stream < 28; stream++) {
+            assert(stream_event_throttle_admit(&throttle,
+                                               stream,
+                                               now_ms + 5) == 1);
+        }
+    }
+    assert(throttle.own_event_count == 8 * 600);
+    assert(throttle.throttled_stream_count == 0);
+    assert(throttle.throttled_client_count == 0);
+    assert(throttle.deferred_event_count == 0);
+    assert(throttle.clients[0].throttle_count == 0);
+
+    /* The server merged two events, so one expected event is left over. */
+    stream_event_throttle_expect_change(&throttle, 20, 70000);
+    stream_event_throttle_expect_change(&throttle, 20, 70000);
+    assert(stream_event_throttle_admit(&throttle, 20, 70010) == 1);
+    assert(throttle.own_event_count == 8 * 600 + 1);
+    /* Once the sample interval passed, it is no longer free. */
+    uint64_t late_ms = 70000 + STREAM_EVENT_THROTTLE_SAMPLE_MS + 1;
+    spend_stream_burst(&throttle, 20, late_ms);
+    assert(throttle.own_event_count == 8 * 600 + 1);
+    assert(stream_event_throttle_admit(&throttle, 20, late_ms) == 0);
+
+    /* Expected events are capped, so writes cannot hide a flood. */
+    for (unsigned int i = 0; i < 100; i++) {
+        stream_event_throttle_expect_change(&throttle, 21, 80000);
+    }
+    for (unsigned int i = 0; i < STREAM_EVENT_THROTTLE_MAX_EXPECTED; i++) {
+        assert(stream_event_throttle_admit(&throttle, 21, 80000) == 1);
+    }
+    spend_stream_burst(&throttle, 21, 80000);
+    assert(stream_event_throttle_admit(&throttle, 21, 80000) == 0);
+
+    stream_event_throttle_clear(&throttle);
+}
+
+/* Throttles client through its four streams first to first + 3. */
+static void throttle_client(stream_event_throttle_t *throttle,
+                            uint32_t client,
+                            uint32_t first,
+                            uint64_t now_ms) {
+    for (uint32_t stream = first; stream < first + 4; stream++) {
+        assert(stream_event_throttle_assign(throttle,
+                                            stream,
+                                            client,
+                                            "Helper",
+                                            now_ms) == 0);
+    }
+    /* Three stream bursts spend the whole client burst. */
+    for (uint32_t stream = first; stream < first + 3; stream++) {
+        spend_stream_burst(throttle, stream, now_ms);
+    }
+    assert(stream_event_throttle_admit(throttle, first + 3, now_ms) == 0);
+}
+
+static void forget_client_streams(stream_event_throttle_t *throttle,
+                                  uint32_t first) {
+    for (uint32_t stream = first; stream < first + 4; stream++) {
+        stream_event_throttle_forget(throttle, stream);
+    }
+}
+
+static void test_departed_clients_are_capped(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+    const size_t retained = STREAM_EVENT_THROTTLE_RETAINED_CLIENTS;
+
+    throttle_client(&throttle, 300, 900, 0);
+    /* Each client throttles once and leaves, as helpers restarting do. */
+    uint64_t now_ms = 0;
+    for (uint32_t client = 100; client < 140; client++) {
+        throttle_client(&throttle, client, client * 4, now_ms);
+        forget_client_streams(&throttle, client * 4);
+        now_ms += 10;
+    }
+    assert(throttle.throttled_client_count == 41);
+    assert(throttle.client_count == retained + 1);
+    assert(throttle.forgotten_client_count == 40 - retained);
+    assert(throttle.forgotten_throttle_count == 40 - retained);
+    assert(throttle.forgotten_deferred_event_count == 40 - retained);
+    for (size_t i = 0; i < throttle.client_count; i++) {
+        uint32_t client = throttle.clients[i].client;
+        assert(client == 300 || client >= 140 - retained);
+    }
+
+    /* Once the live client leaves too, the oldest one that left goes. */
+    forget_client_streams(&throttle, 900);
+    assert(throttle.client_count == retained);
+    assert(throttle.forgotten_client_count == 41 - retained);
+    int kept = 0;
+    for (size_t i = 0; i < throttle.client_count; i++) {
+        uint32_t client = throttle.clients[i].client;
+        assert(client == 300 || client > 140 - retained);
+        kept |= client == 300;
+    }
+    assert(kept);
+
+    /* A client that returns is no longer counted as departed. */
+    assert(stream_event_throttle_assign(&throttle, 5, 300, NULL, now_ms) == 0);
+    throttle_client(&throttle, 400, 1000, now_ms);
+    forget_client_streams(&throttle, 1000);
+    assert(throttle.client_count == retained + 1);
+    assert(throttle.forgotten_client_count == 41 - retained);
+
+    stream_event_throttle_clear(&throttle);
+    assert_throttle_is_cleared(&throttle);
+}
+
+static void test_streams_stay_sorted_and_shrink(void) {
+    stream_event_throttle_t throttle;
+    stream_event_throttle_init(&throttle);
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t index = (i * 37U) % 256U;
+        assert(stream_event_throttle_admit(&throttle, index, 0) == 1);
+    }
+    assert(throttle.stream_count == 256);
+    for (size_t i = 1; i < throttle.stream_count; i++) {
+        assert(throttle.streams[i - 1].index < throttle.streams[i].index);
+    }
+    size_t peak = throttle.memory.bytes;
+
+    for (uint32_t index = 0; index < 250; index++) {
+        stream_event_throttle_forget(&throttle, index);
+    }
+    assert(throttle.stream_count == 6);
+    assert(throttle.streams[0].index == 250);
+    assert(throttle.memory.bytes < peak);
+    assert(throttle.memory.peak_bytes == peak);
+    assert(throttle.memory.shrink_count > 0);
+
+    stream_event_throttle_clear(&throttle);
+}
+
+int main(void) {
+    test_supported_null_arguments();
+    test_calm_streams_are_read_per_event();
+    test_spamming_stream_is_sampled_until_calm();
+    test_client_budget_covers_all_its_streams();
+    test_forget_drops_streams_and_quiet_clients();
+    test_routed_writes_do_not_trip_the_throttle();
+    test_departed_clients_are_capped();
+    test_streams_stay_sorted_and_shrink();
+    printf("stream_event_throttle tests passed\n");
+    return 0;
+}
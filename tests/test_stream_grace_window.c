@@ -0,0 +1,120 @@
+#include "mixer/stream_grace_window.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+static void test_streams_become_due_in_arrival_order(void) {
+    stream_grace_window_t window;
+    stream_grace_window_init(&window);
+
+    assert(stream_grace_window_add(&window, 7, 1000) == 0);
+    assert(stream_grace_window_add(&window, 3, 1040) == 0);
+    assert(stream_grace_window_add(&window, 7, 1090) == 0);
+    assert(window.count == 2);
+    assert(window.deferred_count == 2);
+    assert(stream_grace_window_contains(&window, 7));
+    assert(stream_grace_window_contains(&window, 3));
+    assert(!stream_grace_window_contains(&window, 4));
+
+    uint32_t index = 99;
+    assert(!stream_grace_window_take_due(&window, 1249, 250, &index));
+    assert(index == 99);
+    /* A repeated NEW keeps the first arrival, so 7 is due at 1250. */
+    assert(stream_grace_window_take_due(&window, 1250, 250, &index));
+    assert(index == 7);
+    assert(!stream_grace_window_take_due(&window, 1250, 250, &index));
+    assert(stream_grace_window_take_due(&window, 1290, 250, &index));
+    assert(index == 3);
+    assert(window.count == 0);
+    assert(window.materialized_count == 2);
+    assert(window.dropped_count == 0);
+
+    stream_grace_window_clear(&window);
+}
+
+static void test_removal_inside_window_drops_stream(void) {
+    stream_grace_window_t window;
+    stream_grace_window_init(&window);
+
+    for (uint32_t index = 0; index < 10; index++) {
+        assert(stream_grace_window_add(&window, index, 100 + index) == 0);
+    }
+    assert(window.capacity >= 10);
+    size_t peak_bytes = window.memory.bytes;
+    assert(window.memory.peak_bytes == peak_bytes);
+    assert(stream_grace_window_drop(&window, 0) == 1);
+    assert(stream_grace_window_drop(&window, 5) == 1);
+    assert(stream_grace_window_drop(&window, 5) == 0);
+    assert(stream_grace_window_drop(&window, 42) == 0);
+    assert(window.count == 8);
+    assert(window.dropped_count == 2);
+    assert(!stream_grace_window_contains(&window, 5));
+
+    uint32_t expected[] = {1, 2, 3, 4, 6, 7, 8, 9};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); i++) {
+        uint32_t index;
+        assert(stream_grace_window_take_due(&window, 1000, 100, &index));
+        assert(index == expected[i]);
+    }
+    assert(window.count == 0);
+    assert(window.materialized_count == 8);
+    assert(window.capacity == 4);
+    assert(window.memory.bytes < peak_bytes);
+    assert(window.memory.peak_bytes == peak_bytes);
+    assert(window.memory.shrink_count > 0);
+
+    stream_grace_window_clear(&window);
+}
+
+static void test_zero_grace_takes_every_stream(void) {
+    stream_grace_window_t window;
+    stream_grace_window_init(&window);
+
+    assert(stream_grace_window_add(&window, 1, 500) == 0);
+    assert(stream_grace_window_add(&window, 2, 600) == 0);
+
+    uint32_t index;
+    /* The wheel moved before either stream survived its window. */
+    assert(stream_grace_window_take_due(&window, 510, 0, &index));
+    assert(index == 1);
+    assert(stream_grace_window_take_due(&window, 510, 0, &index));
+    assert(index == 2);
+    assert(!stream_grace_window_take_due(&window, 510, 0, &index));
+
+    /* A clock older than the arrival never makes a stream due early. */
+    assert(stream_grace_window_add(&window, 3, 700) == 0);
+    assert(!stream_grace_window_take_due(&window, 600, 50, &index));
+
+    stream_grace_window_clear(&window);
+    assert(window.entries == NULL);
+    assert(window.count == 0);
+    assert(window.deferred_count == 0);
+}
+
+static void test_null_arguments(void) {
+    stream_grace_window_t window;
+    stream_grace_window_init(&window);
+    uint32_t index;
+
+    assert(stream_grace_window_add(NULL, 1, 0) == -1);
+    assert(!stream_grace_window_contains(NULL, 1));
+    assert(stream_grace_window_drop(NULL, 1) == 0);
+    assert(!stream_grace_window_take_due(NULL, 0, 0, &index));
+    assert(stream_grace_window_add(&window, 1, 0) == 0);
+    assert(!stream_grace_window_take_due(&window, 0, 0, NULL));
+    assert(window.count == 1);
+    stream_grace_window_init(NULL);
+    stream_grace_window_clear(NULL);
+
+    stream_grace_window_clear(&window);
+    stream_grace_window_clear(&window);
+}
+
+int main(void) {
+    test_streams_become_due_in_arrival_order();
+    test_removal_inside_window_drops_stream();
+    test_zero_grace_takes_every_stream();
+    test_null_arguments();
+    printf("stream_grace_window tests passed\n");
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mixer/stream_list_resync.h"
+
+static void assert_resync_is_cleared(const stream_list_resync_t *resync) {
+    assert(resync->drain_event_count == 0);
+    assert(!resync->needed);
+    assert(!resync->in_flight);
+    assert(resync->seen == NULL);
+    assert(resync->seen_count == 0);
+    assert(resync->seen_capacity == 0);
+    assert(resync->burst_count == 0);
+    assert(resync->absorbed_event_count == 0);
+    assert(resync->memory.bytes == 0);
+}
+
+static void store_streams(audio_stream_inventory_t *streams,
+                          uint32_t first_index,
+                          uint32_t count) {
+    for (uint32_t index = first_index; index < first_index + count; index++) {
+        assert(audio_stream_inventory_upsert(
+                   streams, index, 2, NULL, "Application", NULL, NULL) == 0);
+    }
+}
+
+typedef struct {
+    uint32_t indexes[64];
+    size_t count;
+} removed_streams_t;
+
+/* Records a removed stream, which has already left the inventory. */
+static void record_removed(uint32_t index, void *userdata) {
+    removed_streams_t *removed = userdata;
+    assert(removed->count < 64);
+    removed->indexes[removed->count++] = index;
+}
+
+/* Sends events until the burst threshold is crossed. */
+static void cross_threshold(stream_list_resync_t *resync) {
+    for (unsigned int i = 0; i < STREAM_LIST_RESYNC_BURST_THRESHOLD; i++) {
+        assert(stream_list_resync_absorb_event(resync) == 0);
+        assert(!stream_list_resync_should_start(resync));
+    }
+    assert(stream_list_resync_absorb_event(resync) == 1);
+}
+
+static void test_supported_null_arguments(void) {
+    stream_list_resync_t resync;
+    audio_stream_inventory_t streams;
+    stream_list_resync_init(&resync);
+    audio_stream_inventory_init(&streams);
+
+    stream_list_resync_init(NULL);
+    stream_list_resync_begin_drain(NULL);
+    assert(stream_list_resync_absorb_event(NULL) == 0);
+    assert(!stream_list_resync_should_start(NULL));
+    stream_list_resync_begin(NULL);
+    assert(stream_list_resync_mark_seen(NULL, 1) == -1);
+    assert(stream_list_resync_mark_seen(&resync, 1) == -1);
+    assert(stream_list_resync_finish(NULL, &streams, NULL, NULL) == 0);
+    assert(stream_list_resync_finish(&resync, &streams, NULL, NULL) == 0);
+    stream_list_resync_abandon(NULL);
+    stream_list_resync_abandon(&resync);
+    stream_list_resync_clear(NULL);
+
+    assert_resync_is_cleared(&resync);
+    assert(resync.completed_count == 0);
+    assert(resync.failed_count == 0);
+    stream_list_resync_clear(&resync);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_events_below_threshold_send_requests(void) {
+    stream_list_resync_t resync;
+    stream_list_resync_init(&resync);
+
+    for (int drain = 0; drain < 10; drain++) {
+        stream_list_resync_begin_drain(&resync);
+        for (unsigned int i = 0; i < STREAM_LIST_RESYNC_BURST_THRESHOLD; i++) {
+            assert(stream_list_resync_absorb_event(&resync) == 0);
+        }
+    }
+    assert(!stream_list_resync_should_start(&resync));
+    assert(resync.burst_count == 0);
+    assert(resync.absorbed_event_count == 0);
+    stream_list_resync_clear(&resync);
+}
+
+static void test_burst_absorbs_events_until_list_completes(void) {
+    stream_list_resync_t resync;
+    audio_stream_inventory_t streams;
+    stream_list_resync_init(&resync);
+    audio_stream_inventory_init(&streams);
+
+    stream_list_resync_begin_drain(&resync);
+    cross_threshold(&resync);
+    assert(stream_list_resync_absorb_event(&resync) == 1);
+    assert(stream_list_resync_should_start(&resync));
+    assert(resync.burst_count == 1);
+
+    /* Events stay absorbed in later drains while the list is in flight. */
+    stream_list_resync_begin(&resync);
+    assert(!stream_list_resync_should_start(&resync));
+    stream_list_resync_begin_drain(&resync);
+    assert(stream_list_resync_absorb_event(&resync) == 1);
+    assert(resync.absorbed_event_count == 3);
+
+    assert(stream_list_resync_finish(&resync, &streams, NULL, NULL) == 0);
+    assert(resync.completed_count == 1);
+    assert(stream_list_resync_absorb_event(&resync) == 0);
+    assert(resync.burst_count == 1);
+
+    stream_list_resync_clear(&resync);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_finish_removes_streams_the_list_missed(void) {
+    stream_list_resync_t resync;
+    audio_stream_inventory_t streams;
+    stream_list_resync_init(&resync);
+    audio_stream_inventory_init(&streams);
+    store_streams(&streams, 100, 50);
+
+    stream_list_resync_begin_drain(&resync);
+    cross_threshold(&resync);
+    stream_list_resync_begin(&resync);
+    /* The list reports every third stream, in no particular order. */
+    for (uint32_t i = 50; i > 0; i--) {
+        uint32_t index = 100 + i - 1;
+        if ((i - 1) % 3 == 0) {
+            assert(stream_list_resync_mark_seen(&resync, index) == 0);
+        }
+    }
+    assert(resync.memory.bytes > 0);
+
+    removed_streams_t removed = {.count = 0};
+    assert(stream_list_resync_finish(&resync,
+                                     &streams,
+                                     record_removed,
+                                     &removed) == 33);
+    assert(streams.count == 17);
+    assert(removed.count == 33);
+    for (size_t i = 0; i < removed.count; i++) {
+        uint32_t index = removed.indexes[i];
+        assert(index >= 100 && index < 150);
+        assert((index - 100) % 3 != 0);
+        assert(audio_stream_inventory_find(&streams, index) == NULL);
+    }
+    for (uint32_t i = 0; i < 50; i++) {
+        assert((audio_stream_inventory_find(&streams, 100 + i) != NULL) ==
+               (i % 3 == 0));
+    }
+    /* The surviving streams keep their order. */
+    for (size_t position = 1; position < streams.count; position++) {
+        assert(streams.streams[position - 1].index <
+               streams.streams[position].index);
+    }
+    assert(resync.removed_stream_count == 33);
+    assert(resync.seen == NULL);
+    assert(resync.memory.bytes == 0);
+    assert(resync.memory.peak_bytes > 0);
+
+    /* An empty list removes every stream. */
+    stream_list_resync_begin_drain(&resync);
+    cross_threshold(&resync);
+    stream_list_resync_begin(&resync);
+    assert(stream_list_resync_finish(&resync, &streams, NULL, NULL) == 17);
+    assert(streams.count == 0);
+
+    stream_list_resync_clear(&resync);
+    audio_stream_inventory_clear(&streams);
+}
+
+static void test_abandoned_list_is_sent_again(void) {
+    stream_list_resync_t resync;
+    audio_stream_inventory_t streams;
+    stream_list_resync_init(&resync);
+    audio_stream_inventory_init(&streams);
+    store_streams(&streams, 1, 4);
+
+    stream_list_resync_begin_drain(&resync);
+    cross_threshold(&resync);
+    stream_list_resync_begin(&resync);
+    assert(stream_list_resync_mark_seen(&resync, 1) == 0);
+    stream_list_resync_abandon(&resync);
+    assert(resync.failed_count == 1);
+    assert(resync.seen == NULL);
+
+    /* The absorbed events are unread, so a new drain keeps absorbing. */
+    stream_list_resync_begin_drain(&resync);
+    assert(stream_list_resync_should_start(&resync));
+    assert(stream_list_resync_absorb_event(&resync) == 1);
+    assert(stream_list_resync_finish(&resync, &streams, NULL, NULL) == 0);
+    assert(streams.count == 4);
+
+    stream_list_resync_begin(&resync);
+    for (uint32_t index = 1; index <= 4; index++) {
+        assert(stream_list_resync_mark_seen(&resync, index) == 0);
+    }
+    assert(stream_list_resync_finish(&resync, &streams, NULL, NULL) == 0);
+    assert(streams.count == 4);
+    assert(resync.completed_count == 1);
+    assert(resync.burst_count == 1);
+
+    stream_list_resync_clear(&resync);
+    assert_resync_is_cleared(&resync);
+    audio_stream_inventory_clear(&streams);
+}
+
+int main(void) {
+    test_supported_null_arguments();
+    test_events_below_threshold_send_requests();
+    test_burst_absorbs_events_until_list_completes();
+    test_finish_removes_streams_the_list_missed();
+    test_abandoned_list_is_sent_again();
+    printf("stream_list_resync tests passed\n");
+    return 0;
+}
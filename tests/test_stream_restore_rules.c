@@ -0,0 +1,340 @@
+#include "mixer/stream_restore_rules.h"
+#include "pattern_matcher.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    audio_stream_inventory_t streams;
+    active_application_inventory_t applications;
+} rules_fixture_t;
+
+static void fixture_init(rules_fixture_t *fixture) {
+    audio_stream_inventory_init(&fixture->streams);
+    active_application_inventory_init(&fixture->applications);
+}
+
+static void fixture_clear(rules_fixture_t *fixture) {
+    active_application_inventory_clear(&fixture->applications);
+    audio_stream_inventory_clear(&fixture->streams);
+}
+
+static void fixture_add_stream(rules_fixture_t *fixture,
+                               uint32_t index,
+                               const char *application_id,
+                               const char *application_name,
+                               const char *process_binary,
+                               const char *node_name) {
+    assert(audio_stream_inventory_upsert(
+               &fixture->streams,
+               index,
+               2,
+               application_id,
+               application_name,
+               process_binary,
+               node_name) == 0);
+}
+
+static void fixture_rebuild(rules_fixture_t *fixture) {
+    assert(active_application_inventory_rebuild(
+               &fixture->applications,
+               &fixture->streams) == 0);
+}
+
+static void config_add(config_t *configuration,
+                       const char *pattern,
+                       int is_chat) {
+    assert(configuration->count >= 0);
+    assert(configuration->count < MAX_APPS);
+    size_t length = strlen(pattern);
+    assert(length < sizeof(configuration->apps[0].name));
+
+    app_config_t *entry = &configuration->apps[configuration->count];
+    memcpy(entry->name, pattern, length + 1);
+    pattern_fold_case(entry->folded_name, pattern, sizeof(entry->folded_name));
+    entry->is_chat = is_chat;
+    configuration->count++;
+    configuration->generation++;
+}
+
+static chatmix_volume_targets_t calculate_targets(float raw) {
+    chatmix_volume_targets_t targets;
+    assert(chatmix_volume_targets_calculate(raw, &targets) == 0);
+    return targets;
+}
+
+static const stream_restore_rule_t *find_rule(
+    const stream_restore_rule_set_t *rules,
+    const char *name) {
+    for (size_t i = 0; i < rules->count; i++) {
+        if (strcmp(rules->rules[i].name, name) == 0) return &rules->rules[i];
+    }
+    return NULL;
+}
+
+static void expect_rule(const stream_restore_rule_set_t *rules,
+                        const char *name,
+                        application_group_t expected_group,
+                        pa_volume_t expected_volume) {
+    const stream_restore_rule_t *rule = find_rule(rules, name);
+    assert(rule != NULL);
+    assert(rule->group == expected_group);
+    assert(rule->pulse_volume == expected_volume);
+    assert(rule->device == NULL);
+    assert(rule->muted == 0);
+}
+
+static void test_active_identities_and_literal_patterns(void) {
+    rules_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(
+        &fixture, 1, "com.discordapp.Discord", "Discord", NULL, NULL);
+    fixture_add_stream(&fixture, 2, NULL, "Counter-Strike 2", NULL, NULL);
+    fixture_add_stream(&fixture, 3, NULL, NULL, "wine64-preloader", NULL);
+    fixture_add_stream(&fixture, 4, NULL, "Music", NULL, NULL);
+    fixture_rebuild(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Discord", 1);
+    config_add(&configuration, "Counter-Strike*", 0);
+    config_add(&configuration, "wine64-preloader", 0);
+    config_add(&configuration, "TeamSpeak", 1);
+    chatmix_volume_targets_t targets = calculate_targets(32.0f);
+
+    stream_restore_rule_set_t rules;
+    stream_restore_rule_set_init(&rules);
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+
+    expect_rule(&rules,
+                "sink-input-by-application-id:com.discordapp.Discord",
+                APPLICATION_GROUP_CHAT,
+                targets.chat.pulse);
+    expect_rule(&rules,
+                "sink-input-by-application-name:Counter-Strike 2",
+                APPLICATION_GROUP_GAME,
+                targets.game.pulse);
+    expect_rule(&rules,
+                "sink-input-by-application-name:Discord",
+                APPLICATION_GROUP_CHAT,
+                targets.chat.pulse);
+    expect_rule(&rules,
+                "sink-input-by-application-name:wine64-preloader",
+                APPLICATION_GROUP_GAME,
+                targets.game.pulse);
+    expect_rule(&rules,
+                "sink-input-by-application-name:TeamSpeak",
+                APPLICATION_GROUP_CHAT,
+                targets.chat.pulse);
+    assert(find_rule(&rules, "sink-input-by-application-name:Music") == NULL);
+    assert(find_rule(
+               &rules,
+               "sink-input-by-application-name:Counter-Strike*") == NULL);
+    assert(rules.count == 5);
+
+    stream_restore_rule_set_clear(&rules);
+    fixture_clear(&fixture);
+}
+
+static void test_earlier_pattern_decides_literal_group(void) {
+    rules_fixture_t fixture;
+    fixture_init(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Disc*", 0);
+    config_add(&configuration, "Discord", 1);
+    config_add(&configuration, "Discord", 1);
+    chatmix_volume_targets_t targets = calculate_targets(96.0f);
+
+    stream_restore_rule_set_t rules;
+    stream_restore_rule_set_init(&rules);
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+    assert(rules.count == 1);
+    expect_rule(&rules,
+                "sink-input-by-application-name:Discord",
+                APPLICATION_GROUP_GAME,
+                targets.game.pulse);
+
+    stream_restore_rule_set_clear(&rules);
+    fixture_clear(&fixture);
+}
+
+static void test_unavailable_inventory_uses_patterns_only(void) {
+    rules_fixture_t fixture;
+    fixture_init(&fixture);
+    fixture_add_stream(&fixture, 5, "org.example.Game", NULL, NULL, NULL);
+    fixture_rebuild(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "org.example.*", 0);
+    chatmix_volume_targets_t targets = calculate_targets(64.0f);
+
+    stream_restore_rule_set_t rules;
+    stream_restore_rule_set_init(&rules);
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               0) == 0);
+    assert(rules.count == 0);
+
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+    assert(rules.count == 1);
+    expect_rule(&rules,
+                "sink-input-by-application-id:org.example.Game",
+                APPLICATION_GROUP_GAME,
+                targets.game.pulse);
+
+    stream_restore_rule_set_clear(&rules);
+    fixture_clear(&fixture);
+}
+
+static void test_preserve_keeps_device_and_mute(void) {
+    rules_fixture_t fixture;
+    fixture_init(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Discord", 1);
+    chatmix_volume_targets_t targets = calculate_targets(64.0f);
+
+    stream_restore_rule_set_t rules;
+    stream_restore_rule_set_init(&rules);
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+
+    const char *name = "sink-input-by-application-name:Discord";
+    assert(stream_restore_rule_set_preserve(
+               &rules, name, "alsa_output.headset", 1) == 0);
+    const stream_restore_rule_t *rule = find_rule(&rules, name);
+    assert(rule != NULL);
+    assert(strcmp(rule->device, "alsa_output.headset") == 0);
+    assert(rule->muted == 1);
+    assert(rule->pulse_volume == targets.chat.pulse);
+
+    assert(stream_restore_rule_set_preserve(&rules, name, "", 0) == 0);
+    assert(rule->device == NULL);
+    assert(rule->muted == 0);
+
+    assert(stream_restore_rule_set_preserve(
+               &rules,
+               "sink-input-by-application-name:Other",
+               "sink",
+               1) == 0);
+    assert(stream_restore_rule_set_preserve(NULL, name, NULL, 0) == -1);
+    assert(stream_restore_rule_set_preserve(&rules, NULL, NULL, 0) == -1);
+
+    stream_restore_rule_set_clear(&rules);
+    stream_restore_rule_set_clear(&rules);
+    assert(rules.rules == NULL);
+    assert(rules.count == 0);
+    fixture_clear(&fixture);
+}
+
+static void test_invalid_build_preserves_destination(void) {
+    rules_fixture_t fixture;
+    fixture_init(&fixture);
+
+    config_t configuration = {0};
+    config_add(&configuration, "Discord", 1);
+    chatmix_volume_targets_t targets = calculate_targets(64.0f);
+
+    stream_restore_rule_set_t rules;
+    stream_restore_rule_set_init(&rules);
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == 0);
+    const stream_restore_rule_t *previous = rules.rules;
+
+    configuration.count = MAX_APPS + 1;
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               &targets,
+               1) == -1);
+    configuration.count = 1;
+    assert(stream_restore_rule_set_build(
+               &rules,
+               &fixture.applications,
+               &fixture.streams,
+               &configuration,
+               NULL,
+               1) == -1);
+    assert(rules.rules == previous);
+    assert(rules.count == 1);
+
+    stream_restore_rule_set_clear(&rules);
+    fixture_clear(&fixture);
+}
+
+static void test_schedule_rate_limits_and_coalesces(void) {
+    stream_restore_schedule_t schedule;
+    stream_restore_schedule_init(&schedule);
+
+    assert(!stream_restore_schedule_is_due(&schedule, 0));
+    stream_restore_schedule_request(&schedule);
+    assert(stream_restore_schedule_is_due(&schedule, 1000));
+    stream_restore_schedule_mark_written(&schedule, 1000);
+    assert(!stream_restore_schedule_is_due(&schedule, 1001));
+
+    stream_restore_schedule_request(&schedule);
+    stream_restore_schedule_request(&schedule);
+    assert(!stream_restore_schedule_is_due(
+        &schedule,
+        1000 + STREAM_RESTORE_WRITE_INTERVAL_MS - 1));
+    assert(stream_restore_schedule_is_due(
+        &schedule,
+        1000 + STREAM_RESTORE_WRITE_INTERVAL_MS));
+    stream_restore_schedule_mark_written(
+        &schedule,
+        1000 + STREAM_RESTORE_WRITE_INTERVAL_MS);
+    assert(!stream_restore_schedule_is_due(&schedule, UINT64_MAX));
+
+    stream_restore_schedule_init(NULL);
+    stream_restore_schedule_request(NULL);
+    stream_restore_schedule_mark_written(NULL, 0);
+    assert(!stream_restore_schedule_is_due(NULL, 0));
+}
+
+int main(void) {
+    test_active_identities_and_literal_patterns();
+    test_earlier_pattern_decides_literal_group();
+    test_unavailable_inventory_uses_patterns_only();
+    test_preserve_keeps_device_and_mute();
+    test_invalid_build_preserves_destination();
+    test_schedule_rate_limits_and_coalesces();
+
+    printf("stream_restore_rules tests passed\n");
+    return 0;
+}
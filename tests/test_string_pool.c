@@ -0,0 +1,223 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "string_pool.h"
+
+static void test_equal_text_shares_one_handle(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+    char first_text[] = "Discord";
+    char second_text[] = "Discord";
+
+    const char *first = NULL;
+    const char *second = NULL;
+    assert(string_pool_intern(&pool, first_text, &first) == 0);
+    assert(string_pool_intern(&pool, second_text, &second) == 0);
+    assert(first == second);
+    assert(first != first_text);
+    assert(pool.count == 1);
+    assert(pool.allocation_count == 1);
+
+    first_text[0] = 'X';
+    assert(strcmp(first, "Discord") == 0);
+
+    const char *other = NULL;
+    assert(string_pool_intern(&pool, "Firefox", &other) == 0);
+    assert(other != first);
+    assert(strcmp(other, "Firefox") == 0);
+    assert(pool.count == 2);
+
+    const char *empty = NULL;
+    assert(string_pool_intern(&pool, "", &empty) == 0);
+    assert(empty != NULL);
+    assert(empty[0] == '\0');
+    assert(pool.count == 3);
+
+    string_pool_clear(&pool);
+}
+
+static void test_last_release_frees_string(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+
+    const char *first = NULL;
+    const char *second = NULL;
+    assert(string_pool_intern(&pool, "node", &first) == 0);
+    size_t bytes = pool.bytes;
+    assert(bytes > strlen("node"));
+    assert(string_pool_intern(&pool, "node", &second) == 0);
+    assert(pool.bytes == bytes);
+
+    string_pool_release(&pool, first);
+    assert(pool.count == 1);
+    assert(strcmp(second, "node") == 0);
+    string_pool_release(&pool, second);
+    assert(pool.count == 0);
+    assert(pool.bytes == 0);
+
+    const char *again = NULL;
+    assert(string_pool_intern(&pool, "node", &again) == 0);
+    assert(pool.count == 1);
+    assert(pool.allocation_count == 2);
+    string_pool_release(&pool, again);
+
+    string_pool_clear(&pool);
+}
+
+static void test_many_strings_survive_growth_and_removal(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+    const char *handles[300];
+    char text[32];
+
+    for (int i = 0; i < 300; i++) {
+        snprintf(text, sizeof(text), "stream-%d", i);
+        assert(string_pool_intern(&pool, text, &handles[i]) == 0);
+    }
+    assert(pool.count == 300);
+    assert(pool.slot_capacity >= pool.count * 2);
+
+    for (int i = 0; i < 300; i += 2) {
+        string_pool_release(&pool, handles[i]);
+    }
+    assert(pool.count == 150);
+
+    for (int i = 0; i < 300; i++) {
+        snprintf(text, sizeof(text), "stream-%d", i);
+        const char *handle = NULL;
+        assert(string_pool_intern(&pool, text, &handle) == 0);
+        if (i % 2 == 1) {
+            assert(handle == handles[i]);
+            string_pool_release(&pool, handle);
+        } else {
+            handles[i] = handle;
+        }
+        assert(strcmp(handle, text) == 0);
+    }
+    assert(pool.count == 300);
+    assert(pool.allocation_count == 450);
+
+    string_pool_clear(&pool);
+}
+
+static void test_folded_text_shares_lowercase_entries(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+
+    const char *exact = NULL;
+    const char *folded = NULL;
+    assert(string_pool_intern(&pool, "discord", &exact) == 0);
+    assert(string_pool_intern_folded(&pool, "discord", &folded) == 0);
+    assert(folded == exact);
+    assert(pool.count == 1);
+    assert(pool.allocation_count == 1);
+
+    const char *mixed = NULL;
+    const char *upper = NULL;
+    assert(string_pool_intern_folded(&pool, "DisCord", &mixed) == 0);
+    assert(string_pool_intern_folded(&pool, "DISCORD", &upper) == 0);
+    assert(mixed == exact);
+    assert(upper == exact);
+    assert(pool.allocation_count == 1);
+
+    const char *original = NULL;
+    const char *lowered = NULL;
+    assert(string_pool_intern(&pool, "Firefox 2", &original) == 0);
+    assert(string_pool_intern_folded(&pool, "Firefox 2", &lowered) == 0);
+    assert(original != lowered);
+    assert(strcmp(original, "Firefox 2") == 0);
+    assert(strcmp(lowered, "firefox 2") == 0);
+    assert(pool.count == 3);
+    assert(pool.allocation_count == 3);
+
+    string_pool_release(&pool, exact);
+    string_pool_release(&pool, folded);
+    string_pool_release(&pool, mixed);
+    assert(pool.count == 3);
+    string_pool_release(&pool, upper);
+    assert(pool.count == 2);
+
+    const char *handle = "unchanged";
+    assert(string_pool_intern_folded(&pool, NULL, &handle) == 0);
+    assert(handle == NULL);
+    handle = "unchanged";
+    assert(string_pool_intern_folded(NULL, "text", &handle) == -1);
+    assert(handle == NULL);
+
+    string_pool_clear(&pool);
+}
+
+static void test_release_shrinks_slot_table(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+    const char *handles[256];
+    char text[32];
+
+    for (int i = 0; i < 256; i++) {
+        snprintf(text, sizeof(text), "node-%d", i);
+        assert(string_pool_intern(&pool, text, &handles[i]) == 0);
+    }
+    size_t grown_slot_capacity = pool.slot_capacity;
+    size_t peak_bytes = pool.memory.bytes;
+    assert(pool.memory.peak_bytes == peak_bytes);
+    assert(peak_bytes >= pool.bytes);
+
+    for (int i = 0; i < 250; i++) {
+        string_pool_release(&pool, handles[i]);
+    }
+    assert(pool.count == 6);
+    assert(pool.slot_capacity < grown_slot_capacity);
+    assert(pool.slot_capacity >= pool.count * 2);
+    assert(pool.memory.bytes < peak_bytes);
+    assert(pool.memory.peak_bytes == peak_bytes);
+    assert(pool.memory.shrink_count > 0);
+
+    for (int i = 250; i < 256; i++) {
+        snprintf(text, sizeof(text), "node-%d", i);
+        const char *handle = NULL;
+        assert(string_pool_intern(&pool, text, &handle) == 0);
+        assert(handle == handles[i]);
+        string_pool_release(&pool, handle);
+    }
+
+    string_pool_clear(&pool);
+    assert(pool.memory.bytes == 0);
+}
+
+static void test_null_arguments(void) {
+    string_pool_t pool;
+    string_pool_init(&pool);
+
+    const char *handle = "unchanged";
+    assert(string_pool_intern(&pool, NULL, &handle) == 0);
+    assert(handle == NULL);
+    assert(pool.count == 0);
+
+    handle = "unchanged";
+    assert(string_pool_intern(NULL, "text", &handle) == -1);
+    assert(handle == NULL);
+    assert(string_pool_intern(&pool, "text", NULL) == -1);
+
+    string_pool_release(&pool, NULL);
+    string_pool_release(NULL, NULL);
+    string_pool_init(NULL);
+    string_pool_clear(NULL);
+
+    string_pool_clear(&pool);
+    string_pool_clear(&pool);
+    assert(pool.slots == NULL);
+    assert(pool.count == 0);
+}
+
+int main(void) {
+    test_equal_text_shares_one_handle();
+    test_last_release_frees_string();
+    test_many_strings_survive_growth_and_removal();
+    test_folded_text_shares_lowercase_entries();
+    test_release_shrinks_slot_table();
+    test_null_arguments();
+
+    printf("string_pool tests passed\n");
+    return 0;
+}
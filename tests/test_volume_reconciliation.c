@@ -0,0 +1,84 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "mixer/volume_reconciliation.h"
+
+static void test_first_pass_waits_one_interval(void) {
+    volume_reconciliation_t reconciliation;
+    volume_reconciliation_init(&reconciliation, 1000);
+
+    assert(!volume_reconciliation_should_start(&reconciliation, 1000));
+    assert(!volume_reconciliation_should_start(
+        &reconciliation,
+        1000 + VOLUME_RECONCILIATION_INTERVAL_MS - 1));
+    assert(volume_reconciliation_should_start(
+        &reconciliation,
+        1000 + VOLUME_RECONCILIATION_INTERVAL_MS));
+    assert(reconciliation.pass_count == 0);
+}
+
+static void test_pass_records_drift_and_duration(void) {
+    volume_reconciliation_t reconciliation;
+    volume_reconciliation_init(&reconciliation, 0);
+    uint64_t start = VOLUME_RECONCILIATION_INTERVAL_MS;
+
+    volume_reconciliation_begin(&reconciliation, start);
+    assert(!volume_reconciliation_should_start(&reconciliation, start + 1));
+    volume_reconciliation_finish(&reconciliation, start + 12, 3);
+    assert(reconciliation.pass_count == 1);
+    assert(reconciliation.drifted_stream_count == 3);
+    assert(reconciliation.last_drifted_count == 3);
+    assert(reconciliation.last_duration_ms == 12);
+    assert(reconciliation.max_duration_ms == 12);
+    assert(!volume_reconciliation_should_start(&reconciliation, start + 12));
+
+    uint64_t second = start + 12 + VOLUME_RECONCILIATION_INTERVAL_MS;
+    assert(volume_reconciliation_should_start(&reconciliation, second));
+    volume_reconciliation_begin(&reconciliation, second);
+    volume_reconciliation_finish(&reconciliation, second + 4, 0);
+    assert(reconciliation.pass_count == 2);
+    assert(reconciliation.drifted_stream_count == 3);
+    assert(reconciliation.last_drifted_count == 0);
+    assert(reconciliation.last_duration_ms == 4);
+    assert(reconciliation.max_duration_ms == 12);
+
+    volume_reconciliation_finish(&reconciliation, second + 8, 5);
+    assert(reconciliation.pass_count == 2);
+    assert(reconciliation.drifted_stream_count == 3);
+}
+
+static void test_abandoned_pass_is_rescheduled(void) {
+    volume_reconciliation_t reconciliation;
+    volume_reconciliation_init(&reconciliation, 0);
+
+    volume_reconciliation_begin(&reconciliation, 50);
+    volume_reconciliation_abandon(&reconciliation, 60);
+    assert(reconciliation.failed_pass_count == 1);
+    assert(reconciliation.pass_count == 0);
+    assert(!reconciliation.in_flight);
+    assert(!volume_reconciliation_should_start(&reconciliation, 60));
+    assert(volume_reconciliation_should_start(
+        &reconciliation,
+        60 + VOLUME_RECONCILIATION_INTERVAL_MS));
+
+    volume_reconciliation_abandon(&reconciliation, 70);
+    assert(reconciliation.failed_pass_count == 1);
+}
+
+static void test_null_state_is_ignored(void) {
+    volume_reconciliation_init(NULL, 0);
+    assert(!volume_reconciliation_should_start(NULL, 0));
+    volume_reconciliation_begin(NULL, 0);
+    volume_reconciliation_finish(NULL, 0, 1);
+    volume_reconciliation_abandon(NULL, 0);
+}
+
+int main(void) {
+    test_first_pass_waits_one_interval();
+    test_pass_records_drift_and_duration();
+    test_abandoned_pass_is_rescheduled();
+    test_null_state_is_ignored();
+
+    printf("volume_reconciliation tests passed\n");
+    return 0;
+}